@@ -1,22 +1,62 @@
 package com.linkpoint.android
 
+import android.content.ComponentName
+import android.content.Context
+import android.content.Intent
+import android.content.ServiceConnection
 import android.os.Bundle
+import android.os.IBinder
 import androidx.activity.ComponentActivity
 import androidx.activity.compose.setContent
+import androidx.activity.viewModels
 import androidx.compose.foundation.layout.fillMaxSize
 import androidx.compose.material3.MaterialTheme
 import androidx.compose.material3.Surface
 import androidx.compose.ui.Modifier
+import androidx.lifecycle.lifecycleScope
 import com.linkpoint.android.ui.theme.LinkpointTheme
 import com.linkpoint.android.ui.LinkpointApp
+import com.linkpoint.android.service.ViewerService
+import com.linkpoint.android.viewmodel.LinkpointViewModel
+import com.linkpoint.core.memory.MemoryBudgets
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.launch
 
 /**
  * Main Activity for the Linkpoint Android Virtual World Viewer
  * 
  * This activity serves as the entry point for the Android version of Linkpoint,
  * a modern Kotlin virtual world viewer based on SecondLife, Firestorm, and RLV viewers.
+ * 
+ * The simulator connection lives in [ViewerService]; the activity keeps it in
+ * the foreground profile while visible and drops it to chat-only when stopped.
+ * The foreground profile follows the device quality level's network limits.
  */
 class MainActivity : ComponentActivity() {
+    
+    private val viewModel: LinkpointViewModel by viewModels()
+    private var viewerService: ViewerService? = null
+    private var started = false
+    private var qualityJob: Job? = null
+    
+    private val serviceConnection = object : ServiceConnection {
+        override fun onServiceConnected(name: ComponentName?, binder: IBinder?) {
+            val service = (binder as ViewerService.ViewerBinder).getService()
+            viewerService = service
+            viewModel.attachService(service)
+            if (started) service.enterForegroundMode() else service.enterBackgroundMode()
+            qualityJob = lifecycleScope.launch {
+                viewModel.qualityLevel.collect { service.setForegroundLimits(it.drawDistance, it.bandwidthBps) }
+            }
+        }
+        
+        override fun onServiceDisconnected(name: ComponentName?) {
+            qualityJob?.cancel()
+            viewModel.attachService(null)
+            viewerService = null
+        }
+    }
+    
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
         
@@ -30,5 +70,36 @@ class MainActivity : ComponentActivity() {
                 }
             }
         }
+        
+        ViewerService.start(this)
+        bindService(Intent(this, ViewerService::class.java), serviceConnection, Context.BIND_AUTO_CREATE)
+    }
+    
+    override fun onStart() {
+        super.onStart()
+        started = true
+        viewerService?.enterForegroundMode()
+    }
+    
+    override fun onStop() {
+        super.onStop()
+        started = false
+        viewerService?.enterBackgroundMode()
+        viewModel.onBackgrounded()
+    }
+    
+    override fun onDestroy() {
+        viewModel.attachService(null)
+        unbindService(serviceConnection)
+        super.onDestroy()
+    }
+    
+    /**
+     * Forward system memory pressure to the viewer's subsystem budgets so caches
+     * shed in priority order before the process is killed
+     */
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        MemoryBudgets.onTrimMemory(level)
     }
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+package com.linkpoint.android.maps
+
+import android.graphics.BitmapFactory
+import com.linkpoint.assets.maptiles.MapTile
+import com.linkpoint.assets.maptiles.MapTileDecoder
+import com.linkpoint.assets.maptiles.MapTileKey
+
+/**
+ * [MapTileDecoder] using Android's BitmapFactory, since javax.imageio isn't
+ * available on Android. Pixels come out as packed ARGB, top row first, as
+ * the tile pipeline expects
+ */
+object BitmapMapTileDecoder : MapTileDecoder {
+    override fun decode(key: MapTileKey, bytes: ByteArray): MapTile? {
+        val bitmap = BitmapFactory.decodeByteArray(bytes, 0, bytes.size) ?: return null
+        try {
+            val pixels = IntArray(bitmap.width * bitmap.height)
+            bitmap.getPixels(pixels, 0, bitmap.width, 0, 0, bitmap.width, bitmap.height)
+            return MapTile(key, bitmap.width, bitmap.height, pixels)
+        } finally {
+            bitmap.recycle()
+        }
+    }
+}
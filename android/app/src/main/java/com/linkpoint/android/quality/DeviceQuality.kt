@@ -0,0 +1,101 @@
+package com.linkpoint.android.quality
+
+import android.app.ActivityManager
+import android.content.Context
+import android.os.Build
+import android.os.PowerManager
+import com.linkpoint.core.quality.DeviceProfile
+import com.linkpoint.core.quality.QualityController
+import com.linkpoint.core.quality.QualityLevel
+import com.linkpoint.core.quality.QualitySignals
+import com.linkpoint.core.quality.ThermalState
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * Android side of quality scaling: builds the [DeviceProfile] from the
+ * platform, samples thermal status, battery saver and the render host's
+ * frame times once a second, and feeds them to a [QualityController]
+ */
+class DeviceQuality(context: Context, private val scope: CoroutineScope) {
+
+    private val powerManager = context.getSystemService(Context.POWER_SERVICE) as PowerManager
+
+    val controller = QualityController(profile(context))
+    val level: StateFlow<QualityLevel> get() = controller.level
+
+    // Frame intervals since the last sample, written from the GL thread
+    private val frameMicros = AtomicLong()
+    private val frames = AtomicLong()
+    private var sampling: Job? = null
+
+    /** Mean frame time over the last sample with frames, 0 before the first */
+    @Volatile var lastFrameTimeMs: Float = 0f
+        private set
+
+    /** Called by the render host with the interval between consecutive frames */
+    fun onFrameTime(frameTimeMs: Float) {
+        frameMicros.addAndGet((frameTimeMs * 1000).toLong())
+        frames.incrementAndGet()
+    }
+
+    fun start() {
+        if (sampling != null) return
+        sampling = scope.launch {
+            while (isActive) {
+                controller.onSignals(sample(), System.currentTimeMillis())
+                delay(SAMPLE_INTERVAL_MS)
+            }
+        }
+    }
+
+    fun stop() {
+        sampling?.cancel()
+        sampling = null
+    }
+
+    private fun sample(): QualitySignals {
+        val count = frames.getAndSet(0)
+        val micros = frameMicros.getAndSet(0)
+        if (count > 0) lastFrameTimeMs = micros / 1000f / count
+        return QualitySignals(
+            thermal = if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+                ThermalState.fromPowerManager(powerManager.currentThermalStatus)
+            } else {
+                ThermalState.NONE
+            },
+            batterySaver = powerManager.isPowerSaveMode,
+            frameTimeMs = if (count > 0) micros / 1000f / count else null
+        )
+    }
+
+    companion object {
+        private const val SAMPLE_INTERVAL_MS = 1000L
+
+        fun profile(context: Context): DeviceProfile {
+            val activityManager = context.getSystemService(Context.ACTIVITY_SERVICE) as ActivityManager
+            val memory = ActivityManager.MemoryInfo().also { activityManager.getMemoryInfo(it) }
+            val gles = activityManager.deviceConfigurationInfo.reqGlEsVersion
+            val performanceClass = if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.S) Build.VERSION.MEDIA_PERFORMANCE_CLASS else 0
+            return DeviceProfile(
+                cores = Runtime.getRuntime().availableProcessors(),
+                ramClass = if (activityManager.isLowRamDevice) DeviceProfile.RamClass.LOW else DeviceProfile.RamClass.of(memory.totalMem),
+                gpuTier = when {
+                    // Media performance class 12+ devices ship current flagship-class GPUs
+                    performanceClass >= Build.VERSION_CODES.S -> DeviceProfile.GpuTier.HIGH
+                    gles >= GLES_3_2 -> DeviceProfile.GpuTier.MID
+                    gles >= GLES_3_0 -> DeviceProfile.GpuTier.LOW
+                    else -> DeviceProfile.GpuTier.UNKNOWN
+                }
+            )
+        }
+
+        private const val GLES_3_0 = 0x30000
+        private const val GLES_3_2 = 0x30002
+    }
+}
@@ -0,0 +1,118 @@
+package com.linkpoint.android.render
+
+import android.opengl.EGL14
+import android.opengl.EGLConfig
+import android.opengl.EGLContext
+import android.opengl.EGLDisplay
+import android.opengl.EGLExt
+import android.opengl.EGLSurface
+import android.view.Surface
+import mu.KotlinLogging
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * EGL display, context and window surface for one render thread.
+ *
+ * The context and the surface have separate lifetimes: the surface follows
+ * the SurfaceView (created, resized, destroyed with the window) while the
+ * context can outlive it or be released on pause to give the GPU memory back.
+ * Every method must be called on the owning render thread.
+ */
+internal class EglCore {
+    private var display: EGLDisplay = EGL14.EGL_NO_DISPLAY
+    private var config: EGLConfig? = null
+    private var context: EGLContext = EGL14.EGL_NO_CONTEXT
+    private var surface: EGLSurface = EGL14.EGL_NO_SURFACE
+
+    val hasContext: Boolean get() = context != EGL14.EGL_NO_CONTEXT
+    val hasSurface: Boolean get() = surface != EGL14.EGL_NO_SURFACE
+
+    /** EGL error of the last [swapBuffers], or EGL_SUCCESS if it presented */
+    var swapError: Int = EGL14.EGL_SUCCESS
+        private set
+
+    /** Create an OpenGL ES 3 context if there isn't one */
+    fun createContext() {
+        if (hasContext) return
+        if (display == EGL14.EGL_NO_DISPLAY) {
+            display = EGL14.eglGetDisplay(EGL14.EGL_DEFAULT_DISPLAY)
+            val version = IntArray(2)
+            check(EGL14.eglInitialize(display, version, 0, version, 1)) { "eglInitialize failed: ${error()}" }
+        }
+        val attributes = intArrayOf(
+            EGL14.EGL_RED_SIZE, 8,
+            EGL14.EGL_GREEN_SIZE, 8,
+            EGL14.EGL_BLUE_SIZE, 8,
+            EGL14.EGL_ALPHA_SIZE, 8,
+            EGL14.EGL_DEPTH_SIZE, 24,
+            EGL14.EGL_RENDERABLE_TYPE, EGLExt.EGL_OPENGL_ES3_BIT_KHR,
+            EGL14.EGL_NONE
+        )
+        val configs = arrayOfNulls<EGLConfig>(1)
+        val count = IntArray(1)
+        check(EGL14.eglChooseConfig(display, attributes, 0, configs, 0, 1, count, 0) && count[0] > 0) {
+            "No RGBA8888/D24 OpenGL ES 3 config: ${error()}"
+        }
+        config = configs[0]
+        context = EGL14.eglCreateContext(
+            display, config, EGL14.EGL_NO_CONTEXT,
+            intArrayOf(EGL14.EGL_CONTEXT_CLIENT_VERSION, 3, EGL14.EGL_NONE), 0
+        )
+        check(hasContext) { "eglCreateContext failed: ${error()}" }
+        logger.debug { "Created EGL context" }
+    }
+
+    /** Create the window surface for [window] and make it current */
+    fun createSurface(window: Surface) {
+        releaseSurface()
+        surface = EGL14.eglCreateWindowSurface(display, config, window, intArrayOf(EGL14.EGL_NONE), 0)
+        check(hasSurface) { "eglCreateWindowSurface failed: ${error()}" }
+        makeCurrent()
+    }
+
+    fun makeCurrent() {
+        check(EGL14.eglMakeCurrent(display, surface, surface, context)) { "eglMakeCurrent failed: ${error()}" }
+    }
+
+    /**
+     * @return false if the surface or context was lost and must be recreated;
+     * [swapError] tells which
+     */
+    fun swapBuffers(): Boolean {
+        if (!hasSurface) {
+            swapError = EGL14.EGL_BAD_SURFACE
+            return false
+        }
+        val presented = EGL14.eglSwapBuffers(display, surface)
+        swapError = if (presented) EGL14.EGL_SUCCESS else EGL14.eglGetError()
+        return presented
+    }
+
+    fun releaseSurface() {
+        if (!hasSurface) return
+        EGL14.eglMakeCurrent(display, EGL14.EGL_NO_SURFACE, EGL14.EGL_NO_SURFACE, EGL14.EGL_NO_CONTEXT)
+        EGL14.eglDestroySurface(display, surface)
+        surface = EGL14.EGL_NO_SURFACE
+    }
+
+    fun releaseContext() {
+        releaseSurface()
+        if (!hasContext) return
+        EGL14.eglMakeCurrent(display, EGL14.EGL_NO_SURFACE, EGL14.EGL_NO_SURFACE, EGL14.EGL_NO_CONTEXT)
+        EGL14.eglDestroyContext(display, context)
+        context = EGL14.EGL_NO_CONTEXT
+        logger.debug { "Released EGL context" }
+    }
+
+    fun release() {
+        releaseContext()
+        if (display != EGL14.EGL_NO_DISPLAY) {
+            EGL14.eglReleaseThread()
+            EGL14.eglTerminate(display)
+            display = EGL14.EGL_NO_DISPLAY
+        }
+    }
+
+    private fun error() = "0x" + Integer.toHexString(EGL14.eglGetError())
+}
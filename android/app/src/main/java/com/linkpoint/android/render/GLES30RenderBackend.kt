@@ -0,0 +1,35 @@
+package com.linkpoint.android.render
+
+import android.opengl.GLES30
+import com.linkpoint.graphics.rendering.RenderBackend
+
+/**
+ * [RenderBackend] for OpenGL ES 3.0 on a [GLRenderHost]'s EGL context
+ */
+class GLES30RenderBackend : RenderBackend {
+    override val name = "OpenGL ES 3.0"
+
+    // Set by the host once its EGL context exists
+    internal var egl: EglCore? = null
+
+    override fun onContextCreated() {
+        GLES30.glClearColor(0.53f, 0.81f, 0.92f, 1f)
+        GLES30.glEnable(GLES30.GL_DEPTH_TEST)
+        GLES30.glDepthFunc(GLES30.GL_LEQUAL)
+        GLES30.glEnable(GLES30.GL_CULL_FACE)
+        GLES30.glCullFace(GLES30.GL_BACK)
+    }
+
+    // Buffers, textures and programs died with the context; nothing to delete
+    override fun onContextLost() {}
+
+    override fun setViewport(width: Int, height: Int) {
+        GLES30.glViewport(0, 0, width, height)
+    }
+
+    override fun clear() {
+        GLES30.glClear(GLES30.GL_COLOR_BUFFER_BIT or GLES30.GL_DEPTH_BUFFER_BIT)
+    }
+
+    override fun present(): Boolean = egl?.swapBuffers() ?: false
+}
@@ -0,0 +1,232 @@
+package com.linkpoint.android.render
+
+import android.content.Context
+import android.opengl.EGL14
+import android.os.Handler
+import android.os.HandlerThread
+import android.os.Looper
+import android.os.Process
+import android.view.Choreographer
+import android.view.SurfaceHolder
+import android.view.SurfaceView
+import com.linkpoint.graphics.rendering.OpenGLRenderer
+import mu.KotlinLogging
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.TimeUnit
+import kotlin.math.roundToInt
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Native render host for the 3D view: a SurfaceView whose frames are drawn on
+ * a dedicated GL thread, paced by that thread's own Choreographer, so Compose
+ * recomposition on the main thread and rendering never wait on each other.
+ *
+ * The GL thread owns the EGL context and the [renderer]; everything that
+ * touches either is posted to it. On [onPause] frame callbacks stop and, if
+ * [releaseContextOnPause], the context is destroyed and the renderer told to
+ * drop its GPU state; [onResume] recreates it when the surface is back.
+ * [resolutionScale] renders into a smaller buffer that the compositor scales
+ * up to the view, trading sharpness for fill rate.
+ *
+ * Based on concepts from:
+ * - Android's GLSurfaceView render thread, without its blocking
+ *   requestRender/queueEvent model
+ * - Grafika's Choreographer-driven SurfaceView rendering
+ */
+class GLRenderHost(
+    context: Context,
+    private val renderer: OpenGLRenderer,
+    private val frameSource: FrameSource,
+    private val releaseContextOnPause: Boolean = true
+) : SurfaceView(context), SurfaceHolder.Callback {
+
+    /** One frame's input, or none to skip drawing (nothing changed) */
+    data class Frame(val camera: OpenGLRenderer.Camera, val scene: OpenGLRenderer.Scene)
+
+    fun interface FrameSource {
+        /** Called on the GL thread with the vsync time of the frame being drawn */
+        fun nextFrame(frameTimeNanos: Long): Frame?
+    }
+
+    private val backend = renderer.backend as? GLES30RenderBackend
+        ?: throw IllegalArgumentException("GLRenderHost needs a renderer on GLES30RenderBackend")
+    private val glThread = HandlerThread("Linkpoint-GL", Process.THREAD_PRIORITY_DISPLAY).apply { start() }
+    private val glHandler = Handler(glThread.looper)
+    private val mainHandler = Handler(Looper.getMainLooper())
+    private val egl = EglCore()
+
+    // GL thread state
+    private lateinit var choreographer: Choreographer
+    private var surfaceReady = false
+    private var paused = false
+    private var frameScheduled = false
+    private var framesDrawn = 0L
+    private var lastFrameNanos = 0L
+
+    private val frameCallback = Choreographer.FrameCallback { frameTimeNanos ->
+        frameScheduled = false
+        drawFrame(frameTimeNanos)
+    }
+
+    /**
+     * Called on the GL thread with the time between consecutive drawn frames, in
+     * milliseconds, e.g. for the device quality controller
+     */
+    @Volatile var frameTimeListener: ((Float) -> Unit)? = null
+    
+    /**
+     * Fraction of the view's pixels to render, 0.25 to 1
+     */
+    var resolutionScale: Float = 1f
+        set(value) {
+            val scale = value.coerceIn(MIN_SCALE, 1f)
+            if (scale == field) return
+            field = scale
+            mainHandler.post { applyBufferSize() }
+        }
+
+    init {
+        holder.addCallback(this)
+        glHandler.post {
+            choreographer = Choreographer.getInstance()
+            egl.createContext()
+            backend.egl = egl
+        }
+    }
+
+    fun onResume() {
+        glHandler.post {
+            paused = false
+            scheduleFrame()
+        }
+    }
+
+    fun onPause() {
+        glHandler.post {
+            paused = true
+            lastFrameNanos = 0
+            if (frameScheduled) {
+                choreographer.removeFrameCallback(frameCallback)
+                frameScheduled = false
+            }
+            if (releaseContextOnPause) releaseContext()
+        }
+    }
+
+    /**
+     * Stop the GL thread and destroy the context; the renderer itself belongs
+     * to the caller and is left initialised but without a context
+     */
+    fun release() {
+        holder.removeCallback(this)
+        glHandler.post {
+            surfaceReady = false
+            releaseContext()
+            egl.release()
+            backend.egl = null
+            glThread.quitSafely()
+        }
+    }
+
+    override fun onSizeChanged(width: Int, height: Int, oldWidth: Int, oldHeight: Int) {
+        super.onSizeChanged(width, height, oldWidth, oldHeight)
+        applyBufferSize()
+    }
+
+    override fun surfaceCreated(holder: SurfaceHolder) {
+        glHandler.post {
+            egl.createContext()
+            egl.createSurface(holder.surface)
+            surfaceReady = true
+        }
+    }
+
+    override fun surfaceChanged(holder: SurfaceHolder, format: Int, width: Int, height: Int) {
+        glHandler.post {
+            if (!egl.hasSurface) return@post
+            ensureRenderer()
+            renderer.resize(width, height)
+            scheduleFrame()
+        }
+    }
+
+    override fun surfaceDestroyed(holder: SurfaceHolder) {
+        // The surface is invalid once this returns, so wait for the GL thread to let go of it
+        val released = CountDownLatch(1)
+        glHandler.post {
+            surfaceReady = false
+            egl.releaseSurface()
+            released.countDown()
+        }
+        if (!released.await(SURFACE_RELEASE_TIMEOUT_MS, TimeUnit.MILLISECONDS)) {
+            logger.warn { "GL thread did not release the surface in time" }
+        }
+    }
+
+    private fun applyBufferSize() {
+        if (width == 0 || height == 0) return
+        if (resolutionScale >= 1f) {
+            holder.setSizeFromLayout()
+        } else {
+            holder.setFixedSize((width * resolutionScale).roundToInt(), (height * resolutionScale).roundToInt())
+        }
+    }
+
+    // GL thread only below
+
+    private fun ensureRenderer() {
+        if (!renderer.isInitialized()) renderer.initialize() else renderer.onContextRestored()
+    }
+
+    private fun releaseContext() {
+        if (!egl.hasContext) return
+        renderer.onContextLost()
+        egl.releaseContext()
+    }
+
+    private fun scheduleFrame() {
+        if (frameScheduled || paused || !surfaceReady) return
+        frameScheduled = true
+        choreographer.postFrameCallback(frameCallback)
+    }
+
+    private fun drawFrame(frameTimeNanos: Long) {
+        if (paused || !surfaceReady) return
+        if (!egl.hasContext || !egl.hasSurface) {
+            // Resumed after the context was released on pause, or the last swap lost the surface
+            if (!holder.surface.isValid) return
+            egl.createContext()
+            egl.createSurface(holder.surface)
+        }
+        ensureRenderer()
+
+        val frame = frameSource.nextFrame(frameTimeNanos)
+        if (frame != null) {
+            renderer.renderFrame(frame.camera, frame.scene)
+            val swapError = egl.swapError
+            if (swapError == EGL14.EGL_CONTEXT_LOST) {
+                logger.warn { "EGL context lost after $framesDrawn frames; recreating" }
+                releaseContext()
+            } else if (swapError != EGL14.EGL_SUCCESS) {
+                // e.g. EGL_BAD_SURFACE or EGL_BAD_NATIVE_WINDOW: the context is fine, the window surface isn't
+                logger.warn { "EGL surface lost (0x${Integer.toHexString(swapError)}) after $framesDrawn frames; recreating" }
+                egl.releaseSurface()
+                lastFrameNanos = 0
+            } else {
+                framesDrawn++
+                if (lastFrameNanos != 0L) frameTimeListener?.invoke((frameTimeNanos - lastFrameNanos) / 1_000_000f)
+                lastFrameNanos = frameTimeNanos
+            }
+        } else {
+            // Nothing drawn: the next interval would include idle time
+            lastFrameNanos = 0
+        }
+        scheduleFrame()
+    }
+
+    companion object {
+        private const val MIN_SCALE = 0.25f
+        private const val SURFACE_RELEASE_TIMEOUT_MS = 1000L
+    }
+}
@@ -1,23 +1,50 @@
 package com.linkpoint.android.service
 
+import android.app.Notification
+import android.app.NotificationChannel
+import android.app.NotificationManager
 import android.app.Service
+import android.content.Context
 import android.content.Intent
+import android.content.pm.ServiceInfo
+import android.os.Build
 import android.os.IBinder
 import android.os.Binder
+import androidx.core.app.NotificationCompat
+import androidx.core.app.ServiceCompat
+import androidx.core.content.ContextCompat
 import kotlinx.coroutines.*
+import kotlinx.coroutines.flow.filterIsInstance
+import kotlinx.coroutines.flow.launchIn
+import kotlinx.coroutines.flow.onEach
+import com.linkpoint.android.R
 import com.linkpoint.core.SimpleViewerCore
+import com.linkpoint.core.events.EventSystem
+import com.linkpoint.core.events.ViewerEvent
 import com.linkpoint.protocol.LoginSystem
+import com.linkpoint.protocol.SecondLifeProtocol
+import com.linkpoint.protocol.circuit.CircuitProfile
+import com.linkpoint.protocol.world.RegionObjectCache
 import com.linkpoint.audio.AudioSystem
 import mu.KotlinLogging
+import java.io.File
 
 private val logger = KotlinLogging.logger {}
 
 /**
- * Background service for virtual world viewer operations
+ * Foreground service that owns the simulator connection
  * 
- * Handles long-running viewer operations that need to continue
- * when the app is in the background, such as maintaining
- * connections to virtual world simulators.
+ * The [SecondLifeProtocol] lives here rather than in the activity's
+ * ViewModel, so the circuit survives the UI going away. While the app is on
+ * screen the circuit runs [CircuitProfile.FOREGROUND]; when the activity
+ * stops it drops to [CircuitProfile.CHAT_ONLY_BACKGROUND], which keeps chat
+ * and IM (and the avatar's presence) alive at a fraction of the wakeups and
+ * traffic. The service stops itself when the session disconnects.
+ * 
+ * Based on concepts from:
+ * - Android foreground services (remoteMessaging type) for user-visible
+ *   ongoing connections
+ * - Mobile messaging clients' reduced "background sync" connection modes
  */
 class ViewerService : Service() {
     
@@ -28,6 +55,15 @@ class ViewerService : Service() {
     private val viewerCore = SimpleViewerCore()
     private val loginSystem = LoginSystem()
     private val audioSystem = AudioSystem()
+    // Lazy: the cache directory exists only once the service has a context
+    private val protocol by lazy {
+        SecondLifeProtocol(serviceScope, RegionObjectCache(File(cacheDir, "objects")), loginSystem = loginSystem)
+    }
+    
+    private var inForeground = false
+    private var backgrounded = false
+    // FOREGROUND within the device quality controller's limits
+    private var foregroundProfile = CircuitProfile.FOREGROUND
     
     inner class ViewerBinder : Binder() {
         fun getService(): ViewerService = this@ViewerService
@@ -39,11 +75,32 @@ class ViewerService : Service() {
         super.onCreate()
         logger.info { "ViewerService created" }
         
+        EventSystem.events
+            .filterIsInstance<ViewerEvent.Disconnected>()
+            .onEach { stopViewerService() }
+            .launchIn(serviceScope)
+        
         serviceScope.launch {
             initializeViewer()
         }
     }
     
+    override fun onStartCommand(intent: Intent?, flags: Int, startId: Int): Int {
+        if (!inForeground) {
+            createNotificationChannel()
+            ServiceCompat.startForeground(
+                this, NOTIFICATION_ID, buildNotification(protocol.circuitProfile),
+                if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.UPSIDE_DOWN_CAKE) {
+                    ServiceInfo.FOREGROUND_SERVICE_TYPE_REMOTE_MESSAGING
+                } else {
+                    0
+                }
+            )
+            inForeground = true
+        }
+        return START_STICKY
+    }
+    
     private suspend fun initializeViewer() {
         try {
             logger.info { "Initializing viewer systems in background service..." }
@@ -61,6 +118,74 @@ class ViewerService : Service() {
     fun getViewerCore() = viewerCore
     fun getLoginSystem() = loginSystem
     fun getAudioSystem() = audioSystem
+    fun getProtocol() = protocol
+    
+    /**
+     * Log in and open the simulator circuit; the session then lasts as long
+     * as this service, whatever happens to the activity
+     */
+    suspend fun login(loginUri: String, username: String, password: String): Boolean =
+        withContext(Dispatchers.IO) { protocol.connect(loginUri, username, password) }
+    
+    /**
+     * The viewer is on screen: full interest radius, throttles and update rate
+     */
+    fun enterForegroundMode() {
+        backgrounded = false
+        setProfile(foregroundProfile)
+    }
+    
+    /**
+     * Nothing is on screen: keep only chat, IM and presence flowing
+     */
+    fun enterBackgroundMode() {
+        backgrounded = true
+        setProfile(CircuitProfile.CHAT_ONLY_BACKGROUND)
+    }
+    
+    /**
+     * Cap the foreground profile's interest radius and throttle, as chosen by
+     * the device quality controller; applied now unless backgrounded
+     */
+    fun setForegroundLimits(interestRadius: Float, bandwidthBps: Float) {
+        foregroundProfile = CircuitProfile.FOREGROUND.limitedTo(interestRadius, bandwidthBps)
+        if (!backgrounded) setProfile(foregroundProfile)
+    }
+    
+    private fun setProfile(profile: CircuitProfile) {
+        if (profile == protocol.circuitProfile) return
+        protocol.setCircuitProfile(profile)
+        if (inForeground) {
+            getSystemService(NotificationManager::class.java).notify(NOTIFICATION_ID, buildNotification(profile))
+        }
+    }
+    
+    private fun stopViewerService() {
+        ServiceCompat.stopForeground(this, ServiceCompat.STOP_FOREGROUND_REMOVE)
+        inForeground = false
+        stopSelf()
+    }
+    
+    private fun createNotificationChannel() {
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.O) return
+        val channel = NotificationChannel(CHANNEL_ID, "Connection", NotificationManager.IMPORTANCE_LOW).apply {
+            description = "Keeps you in-world for chat and IM while Linkpoint is in the background"
+            setShowBadge(false)
+        }
+        getSystemService(NotificationManager::class.java).createNotificationChannel(channel)
+    }
+    
+    private fun buildNotification(profile: CircuitProfile): Notification =
+        NotificationCompat.Builder(this, CHANNEL_ID)
+            .setSmallIcon(android.R.drawable.stat_notify_chat)
+            .setContentTitle(getString(R.string.app_name))
+            .setContentText(
+                if (profile == CircuitProfile.CHAT_ONLY_BACKGROUND) "Connected - chat and IM only" else "Connected"
+            )
+            .setOngoing(true)
+            .setCategory(NotificationCompat.CATEGORY_SERVICE)
+            .setPriority(NotificationCompat.PRIORITY_LOW)
+            .build()
     
     override fun onDestroy() {
         super.onDestroy()
@@ -68,6 +193,7 @@ class ViewerService : Service() {
         
         serviceScope.launch {
             try {
+                protocol.disconnect()
                 viewerCore.shutdown()
                 audioSystem.shutdown()
                 logger.info { "Viewer service shutdown complete" }
@@ -78,4 +204,17 @@ class ViewerService : Service() {
             }
         }
     }
-}
\ No newline at end of file
+    
+    companion object {
+        private const val CHANNEL_ID = "linkpoint.connection"
+        private const val NOTIFICATION_ID = 1
+        
+        /**
+         * Start the service in the foreground. Must be called while the app
+         * is visible; Android refuses foreground starts from the background
+         */
+        fun start(context: Context) {
+            ContextCompat.startForegroundService(context, Intent(context, ViewerService::class.java))
+        }
+    }
+}
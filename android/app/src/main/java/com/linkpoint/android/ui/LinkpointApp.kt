@@ -7,20 +7,39 @@ import androidx.compose.material.icons.Icons
 import androidx.compose.material.icons.filled.*
 import androidx.compose.material3.*
 import androidx.compose.runtime.*
+import androidx.compose.runtime.saveable.rememberSaveable
 import androidx.compose.ui.Alignment
 import androidx.compose.ui.Modifier
 import androidx.compose.ui.graphics.vector.ImageVector
 import androidx.compose.ui.platform.LocalContext
 import androidx.compose.ui.text.font.FontWeight
+import androidx.compose.ui.text.input.PasswordVisualTransformation
 import androidx.compose.ui.unit.dp
 import androidx.lifecycle.viewmodel.compose.viewModel
+import com.linkpoint.android.ui.components.VirtualWorldView
+import com.linkpoint.android.ui.components.WorldRenderView
 import com.linkpoint.android.viewmodel.LinkpointViewModel
+import com.linkpoint.core.util.ChunkedLog
+import com.linkpoint.graphics.rendering.OpenGLRenderer
+import com.linkpoint.ui.GridConfig
+import com.linkpoint.ui.state.ChatState
+import com.linkpoint.ui.state.ConnectionState
+import com.linkpoint.ui.state.ConnectionStatus
+import com.linkpoint.ui.state.NearbyAvatarsState
+import com.linkpoint.ui.state.SubsystemState
+import com.linkpoint.ui.state.ViewerStats
+import kotlinx.coroutines.flow.StateFlow
 
 /**
  * Main Compose UI for the Linkpoint Android Virtual World Viewer
  * 
  * This composable provides the complete mobile interface inspired by Lumiya Viewer
  * with modern Material Design 3 components and touch-optimized interaction patterns.
+ * 
+ * This function reads no state itself: every card collects its own slice of
+ * [LinkpointViewModel.state], so a chat flood recomposes the chat card and
+ * nothing else. Rows take plain strings and are keyed by stable ids, so
+ * appending a line composes just that row.
  */
 @OptIn(ExperimentalMaterial3Api::class)
 @Composable
@@ -28,7 +47,7 @@ fun LinkpointApp(
     viewModel: LinkpointViewModel = viewModel()
 ) {
     val context = LocalContext.current
-    val uiState by viewModel.uiState.collectAsState()
+    CountRecompositions("app")
     
     Column(
         modifier = Modifier
@@ -65,27 +84,17 @@ fun LinkpointApp(
         Spacer(modifier = Modifier.height(16.dp))
         
         // Status Information
-        Card(
-            modifier = Modifier.fillMaxWidth(),
-            elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
-        ) {
-            Column(
-                modifier = Modifier.padding(16.dp)
-            ) {
-                Text(
-                    text = "Implementation Status",
-                    style = MaterialTheme.typography.titleMedium,
-                    fontWeight = FontWeight.SemiBold
-                )
-                Spacer(modifier = Modifier.height(8.dp))
-                
-                StatusItem("Protocol System", uiState.protocolStatus, Icons.Default.Link)
-                StatusItem("Graphics Pipeline", uiState.graphicsStatus, Icons.Default.Visibility)
-                StatusItem("Mobile UI", uiState.uiStatus, Icons.Default.PhoneAndroid)
-                StatusItem("Asset Management", uiState.assetStatus, Icons.Default.Storage)
-                StatusItem("Audio System", uiState.audioStatus, Icons.Default.VolumeUp)
-            }
-        }
+        StatusCard(viewModel.state.subsystems)
+        
+        Spacer(modifier = Modifier.height(8.dp))
+        
+        ConnectionRow(viewModel.state.connection, viewModel.state.stats)
+        
+        LoginCard(viewModel.state.connection, viewModel::login)
+        
+        WorldCard(viewModel)
+        
+        RegionMapCard(viewModel)
         
         Spacer(modifier = Modifier.height(16.dp))
         
@@ -146,46 +155,273 @@ fun LinkpointApp(
                     ) {
                         viewModel.demonstrateAudio()
                     }
+                    
+                    DemoButton(
+                        text = "Chat flood",
+                        icon = Icons.Default.Chat,
+                        modifier = Modifier.weight(1f)
+                    ) {
+                        viewModel.demonstrateChatFlood()
+                    }
                 }
             }
         }
         
         Spacer(modifier = Modifier.height(16.dp))
         
-        // Activity Log
-        Card(
+        NearbyAvatarsCard(viewModel.state.nearbyAvatars)
+        
+        Row(
             modifier = Modifier
                 .fillMaxWidth()
                 .weight(1f),
-            elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
+            horizontalArrangement = Arrangement.spacedBy(8.dp)
         ) {
-            Column(
-                modifier = Modifier.padding(16.dp)
+            ChatCard(viewModel.state.chat, Modifier.weight(1f))
+            ActivityLogCard(viewModel.state.activityLog, Modifier.weight(1f))
+        }
+    }
+}
+
+@Composable
+private fun StatusCard(subsystems: StateFlow<SubsystemState>) {
+    val state by subsystems.collectAsState()
+    CountRecompositions("status")
+    
+    Card(
+        modifier = Modifier.fillMaxWidth(),
+        elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
+    ) {
+        Column(
+            modifier = Modifier.padding(16.dp)
+        ) {
+            Text(
+                text = "Implementation Status",
+                style = MaterialTheme.typography.titleMedium,
+                fontWeight = FontWeight.SemiBold
+            )
+            Spacer(modifier = Modifier.height(8.dp))
+            
+            SUBSYSTEM_ICONS.forEach { (name, icon) ->
+                StatusItem(name, state.statuses[name] ?: "Initializing", icon)
+            }
+        }
+    }
+}
+
+@Composable
+private fun ConnectionRow(connection: StateFlow<ConnectionState>, stats: StateFlow<ViewerStats>) {
+    Row(
+        modifier = Modifier.fillMaxWidth(),
+        verticalAlignment = Alignment.CenterVertically
+    ) {
+        ConnectionLabel(connection, Modifier.weight(1f))
+        StatsLabel(stats)
+    }
+}
+
+@Composable
+private fun ConnectionLabel(connection: StateFlow<ConnectionState>, modifier: Modifier) {
+    val state by connection.collectAsState()
+    CountRecompositions("connection")
+    Text(
+        text = state.region?.let { "${state.status.name.lowercase()} · $it" } ?: state.status.name.lowercase(),
+        style = MaterialTheme.typography.labelMedium,
+        color = MaterialTheme.colorScheme.onSurfaceVariant,
+        modifier = modifier
+    )
+}
+
+@Composable
+private fun StatsLabel(stats: StateFlow<ViewerStats>) {
+    val state by stats.collectAsState()
+    CountRecompositions("stats")
+    Text(
+        text = "${state.fps} fps · ${state.objects} objects" +
+            if (state.cacheKilobytesSaved > 0) " · cache ${state.cacheHitPercent}%, ${state.cacheKilobytesSaved} KB saved" else "",
+        style = MaterialTheme.typography.labelMedium,
+        color = MaterialTheme.colorScheme.onSurfaceVariant
+    )
+}
+
+/**
+ * Grid login, shown until a session is up; the session itself belongs to the
+ * viewer service
+ */
+@Composable
+private fun LoginCard(connection: StateFlow<ConnectionState>, onLogin: (String, String, String) -> Unit) {
+    val state by connection.collectAsState()
+    if (state.status == ConnectionStatus.CONNECTED || state.status == ConnectionStatus.BACKGROUND) return
+    var grid by rememberSaveable { mutableStateOf(GridConfig.SECOND_LIFE_MAIN.loginUrl) }
+    var username by rememberSaveable { mutableStateOf("") }
+    var password by remember { mutableStateOf("") }
+    
+    Card(
+        modifier = Modifier
+            .fillMaxWidth()
+            .padding(top = 8.dp),
+        elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
+    ) {
+        Column(
+            modifier = Modifier.padding(16.dp),
+            verticalArrangement = Arrangement.spacedBy(8.dp)
+        ) {
+            OutlinedTextField(grid, { grid = it }, label = { Text("Grid") }, singleLine = true, modifier = Modifier.fillMaxWidth())
+            OutlinedTextField(username, { username = it }, label = { Text("Username") }, singleLine = true, modifier = Modifier.fillMaxWidth())
+            OutlinedTextField(
+                password, { password = it },
+                label = { Text("Password") },
+                singleLine = true,
+                visualTransformation = PasswordVisualTransformation(),
+                modifier = Modifier.fillMaxWidth()
+            )
+            Button(
+                onClick = { onLogin(grid, username, password) },
+                enabled = state.status != ConnectionStatus.CONNECTING && username.isNotBlank() && password.isNotEmpty(),
+                modifier = Modifier.fillMaxWidth()
             ) {
-                Text(
-                    text = "Activity Log",
-                    style = MaterialTheme.typography.titleMedium,
-                    fontWeight = FontWeight.SemiBold
-                )
-                Spacer(modifier = Modifier.height(8.dp))
-                
-                LazyColumn(
-                    modifier = Modifier.fillMaxWidth(),
-                    verticalArrangement = Arrangement.spacedBy(4.dp)
-                ) {
-                    items(uiState.activityLog) { logEntry ->
-                        Text(
-                            text = logEntry,
-                            style = MaterialTheme.typography.bodySmall,
-                            color = MaterialTheme.colorScheme.onSurfaceVariant
-                        )
-                    }
-                }
+                Text(if (state.status == ConnectionStatus.CONNECTING) "Logging in…" else "Log in")
             }
         }
     }
 }
 
+/**
+ * The 3D view of the region, drawn on the render host's GL thread while a
+ * session is up. The renderer comes up on first use, so it is started here
+ * rather than at launch; its frame times drive device quality scaling
+ */
+@Composable
+private fun WorldCard(viewModel: LinkpointViewModel) {
+    val state by viewModel.state.connection.collectAsState()
+    if (state.status != ConnectionStatus.CONNECTED) return
+    val renderer by produceState<OpenGLRenderer?>(null) { value = viewModel.worldRenderer() }
+    
+    Card(
+        modifier = Modifier
+            .fillMaxWidth()
+            .height(240.dp)
+            .padding(top = 8.dp),
+        elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
+    ) {
+        renderer?.let {
+            WorldRenderView(it, viewModel.worldFrames, Modifier.fillMaxSize(), onFrameTime = viewModel.deviceQuality::onFrameTime)
+        }
+    }
+}
+
+/**
+ * Top-down map of the region from the live object store while a session is up
+ */
+@Composable
+private fun RegionMapCard(viewModel: LinkpointViewModel) {
+    val state by viewModel.state.connection.collectAsState()
+    if (state.status != ConnectionStatus.CONNECTED) return
+    
+    Card(
+        modifier = Modifier
+            .fillMaxWidth()
+            .height(320.dp)
+            .padding(top = 8.dp),
+        elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
+    ) {
+        VirtualWorldView(viewModel.objectStore, Modifier.fillMaxSize())
+    }
+}
+
+@Composable
+private fun NearbyAvatarsCard(nearby: StateFlow<NearbyAvatarsState>) {
+    val state by nearby.collectAsState()
+    CountRecompositions("nearby")
+    if (state.avatars.isEmpty()) return
+    
+    Card(
+        modifier = Modifier
+            .fillMaxWidth()
+            .heightIn(max = 160.dp)
+            .padding(bottom = 8.dp),
+        elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
+    ) {
+        LazyColumn(modifier = Modifier.padding(horizontal = 16.dp, vertical = 8.dp)) {
+            items(state.avatars, key = { it.id }) { avatar ->
+                LabelledRow(avatar.name, "${avatar.distance} m")
+            }
+        }
+    }
+}
+
+@Composable
+private fun ChatCard(chat: StateFlow<ChatState>, modifier: Modifier) {
+    val state by chat.collectAsState()
+    CountRecompositions("chat")
+    LogCard("Local Chat", state.log, modifier) { message -> LabelledRow(message.sender, message.text) }
+}
+
+@Composable
+private fun ActivityLogCard(activityLog: StateFlow<ChunkedLog<String>>, modifier: Modifier) {
+    val log by activityLog.collectAsState()
+    CountRecompositions("activityLog")
+    LogCard("Activity Log", log, modifier) { entry ->
+        Text(
+            text = entry,
+            style = MaterialTheme.typography.bodySmall,
+            color = MaterialTheme.colorScheme.onSurfaceVariant
+        )
+    }
+}
+
+@Composable
+private fun <T> LogCard(title: String, log: ChunkedLog<T>, modifier: Modifier, row: @Composable (T) -> Unit) {
+    Card(
+        modifier = modifier.fillMaxHeight(),
+        elevation = CardDefaults.cardElevation(defaultElevation = 2.dp)
+    ) {
+        Column(
+            modifier = Modifier.padding(16.dp)
+        ) {
+            Text(
+                text = title,
+                style = MaterialTheme.typography.titleMedium,
+                fontWeight = FontWeight.SemiBold
+            )
+            Spacer(modifier = Modifier.height(8.dp))
+            
+            LazyColumn(
+                modifier = Modifier.fillMaxWidth(),
+                verticalArrangement = Arrangement.spacedBy(4.dp)
+            ) {
+                // Keyed by sequence so appends only compose the new row
+                items(count = log.size, key = { log.sequence(it) }) { index -> row(log[index]) }
+            }
+        }
+    }
+}
+
+@Composable
+private fun LabelledRow(label: String, value: String) {
+    Row {
+        Text(
+            text = label,
+            style = MaterialTheme.typography.bodySmall,
+            fontWeight = FontWeight.Medium
+        )
+        Spacer(modifier = Modifier.width(6.dp))
+        Text(
+            text = value,
+            style = MaterialTheme.typography.bodySmall,
+            color = MaterialTheme.colorScheme.onSurfaceVariant
+        )
+    }
+}
+
+private val SUBSYSTEM_ICONS = listOf(
+    LinkpointViewModel.SUBSYSTEM_PROTOCOL to Icons.Default.Link,
+    LinkpointViewModel.SUBSYSTEM_GRAPHICS to Icons.Default.Visibility,
+    LinkpointViewModel.SUBSYSTEM_UI to Icons.Default.PhoneAndroid,
+    LinkpointViewModel.SUBSYSTEM_ASSETS to Icons.Default.Storage,
+    LinkpointViewModel.SUBSYSTEM_AUDIO to Icons.Default.VolumeUp
+)
+
 @Composable
 private fun StatusItem(
     title: String,
@@ -0,0 +1,31 @@
+package com.linkpoint.android.ui
+
+import androidx.compose.runtime.Composable
+import androidx.compose.runtime.SideEffect
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Debug counters of how often each section of the UI recomposed, so a chat
+ * flood or radar storm can be checked for recompositions leaking into
+ * unrelated sections
+ */
+object RecompositionCounts {
+    private val counts = ConcurrentHashMap<String, AtomicInteger>()
+
+    fun increment(section: String) {
+        counts.getOrPut(section) { AtomicInteger() }.incrementAndGet()
+    }
+
+    fun snapshot(): Map<String, Int> = counts.mapValues { it.value.get() }.toSortedMap()
+
+    fun reset() = counts.clear()
+}
+
+/**
+ * Count every successful composition of the calling scope under [section]
+ */
+@Composable
+fun CountRecompositions(section: String) {
+    SideEffect { RecompositionCounts.increment(section) }
+}
@@ -1,5 +1,6 @@
 package com.linkpoint.android.ui.components
 
+import android.graphics.Bitmap
 import androidx.compose.foundation.Canvas
 import androidx.compose.foundation.background
 import androidx.compose.foundation.gestures.detectDragGestures
@@ -12,44 +13,82 @@ import androidx.compose.ui.Modifier
 import androidx.compose.ui.draw.clipToBounds
 import androidx.compose.ui.geometry.Offset
 import androidx.compose.ui.graphics.Color
+import androidx.compose.ui.graphics.ImageBitmap
+import androidx.compose.ui.graphics.asImageBitmap
 import androidx.compose.ui.graphics.drawscope.DrawScope
+import androidx.compose.ui.graphics.drawscope.Stroke
 import androidx.compose.ui.input.pointer.pointerInput
-import androidx.compose.ui.platform.LocalDensity
 import androidx.compose.ui.text.font.FontWeight
+import androidx.compose.ui.unit.IntOffset
+import androidx.compose.ui.unit.IntSize
 import androidx.compose.ui.unit.dp
+import com.linkpoint.protocol.world.ObjectStore
+import com.linkpoint.protocol.world.SpatialGrid
+import com.linkpoint.ui.minimap.MinimapTile
+import com.linkpoint.ui.minimap.MinimapTiles
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.withContext
 import kotlin.math.*
 
+// Screen pixels per metre at zoom 1
+private const val PIXELS_PER_METRE = 4f
+private const val REGION = SpatialGrid.REGION_METRES
+// Background tile refresh, about once a frame
+private const val REFRESH_INTERVAL_MS = 16L
+
 /**
  * Virtual World View Component
  * 
- * Provides a 3D world view simulation for the Android app,
- * demonstrating camera controls and world interaction patterns
- * from SecondLife, Firestorm, and RLV viewers.
+ * Top-down view of the current region from the live [ObjectStore]. Terrain
+ * and static prims come from cached [MinimapTiles] rasters, converted to
+ * bitmaps once per tile version; only avatars and moving objects in the
+ * visible area are drawn per frame, fetched through the store's spatial grid.
+ * The canvas redraws on frames where the store changed, without recomposing.
  */
 @Composable
 fun VirtualWorldView(
+    objectStore: ObjectStore,
     modifier: Modifier = Modifier,
     onCameraMove: (x: Float, y: Float, z: Float) -> Unit = { _, _, _ -> },
     onObjectTap: (objectId: String) -> Unit = { }
 ) {
     var cameraPosition by remember { mutableStateOf(Offset(0f, 0f)) }
     var cameraZoom by remember { mutableStateOf(1f) }
-    var worldObjects by remember { 
-        mutableStateOf(listOf(
-            WorldObject("avatar_1", "Avatar", Offset(100f, 100f), Color.Blue),
-            WorldObject("object_1", "Cube", Offset(200f, 150f), Color.Red),
-            WorldObject("object_2", "Sphere", Offset(300f, 200f), Color.Green),
-            WorldObject("terrain_1", "Ground", Offset(150f, 250f), Color.Brown)
-        ))
+    val minimap = remember(objectStore) { MinimapTiles(objectStore) }
+    val bitmaps = remember(objectStore) { TileBitmaps() }
+    val visible = remember(objectStore) { VisibleArea() }
+    
+    // Read only in the draw phase, so store changes invalidate the canvas alone
+    val storeVersion = produceState(objectStore.version, objectStore) {
+        while (true) withFrameNanos { value = objectStore.version }
+    }
+    val tilesVersion = produceState(minimap.rasterised, minimap) {
+        while (true) withFrameNanos { value = minimap.rasterised }
+    }
+    LaunchedEffect(minimap) {
+        withContext(Dispatchers.Default) {
+            while (isActive) {
+                if (visible.known) minimap.refresh(visible.minX, visible.minY, visible.maxX, visible.maxY)
+                delay(REFRESH_INTERVAL_MS)
+            }
+        }
+    }
+    val objectCount by produceState(objectStore.size, objectStore) {
+        while (true) {
+            value = objectStore.size
+            delay(1000)
+        }
     }
     
     Box(
         modifier = modifier
             .fillMaxSize()
-            .background(Color(0xFF87CEEB)) // Sky blue background
+            .background(Color(0xFF87CEEB)) // Sky blue beyond the region edge
             .clipToBounds()
     ) {
-        // 3D World Canvas
+        // Region map canvas
         Canvas(
             modifier = Modifier
                 .fillMaxSize()
@@ -62,26 +101,19 @@ fun VirtualWorldView(
                         onCameraMove(cameraPosition.x, cameraPosition.y, cameraZoom)
                     }
                 }
-                .pointerInput(Unit) {
+                .pointerInput(objectStore) {
                     detectTapGestures { offset ->
-                        // Find tapped object
-                        worldObjects.forEach { obj ->
-                            val objScreen = Offset(
-                                obj.position.x + cameraPosition.x,
-                                obj.position.y + cameraPosition.y
-                            )
-                            val distance = sqrt(
-                                (offset.x - objScreen.x).pow(2) + 
-                                (offset.y - objScreen.y).pow(2)
-                            )
-                            if (distance < 30f) {
-                                onObjectTap(obj.id)
-                            }
-                        }
+                        // Find the tapped object through the grid, within 30 pixels
+                        val pixelsPerMetre = PIXELS_PER_METRE * cameraZoom
+                        val x = (offset.x - cameraPosition.x) / pixelsPerMetre
+                        val y = REGION - (offset.y - cameraPosition.y) / pixelsPerMetre
+                        minimap.pick(x, y, 30f / pixelsPerMetre)?.let { onObjectTap(it.id.toString()) }
                     }
                 }
         ) {
-            drawVirtualWorld(worldObjects, cameraPosition, cameraZoom)
+            storeVersion.value
+            tilesVersion.value
+            drawVirtualWorld(minimap, bitmaps, visible, cameraPosition, cameraZoom)
         }
         
         // Camera Controls Overlay
@@ -98,7 +130,7 @@ fun VirtualWorldView(
         // World Info Overlay
         WorldInfoOverlay(
             cameraPosition = cameraPosition,
-            objectCount = worldObjects.size,
+            objectCount = objectCount,
             modifier = Modifier.align(Alignment.TopStart)
         )
     }
@@ -198,90 +230,81 @@ private fun WorldInfoOverlay(
 }
 
 private fun DrawScope.drawVirtualWorld(
-    worldObjects: List<WorldObject>,
+    minimap: MinimapTiles,
+    bitmaps: TileBitmaps,
+    visible: VisibleArea,
     cameraPosition: Offset,
     cameraZoom: Float
 ) {
-    // Draw grid pattern for ground
-    val gridSize = 50f * cameraZoom
-    val offsetX = cameraPosition.x % gridSize
-    val offsetY = cameraPosition.y % gridSize
+    val pixelsPerMetre = PIXELS_PER_METRE * cameraZoom
+    // Visible part of the region in region metres; screen y runs south
+    val minX = -cameraPosition.x / pixelsPerMetre
+    val maxX = (size.width - cameraPosition.x) / pixelsPerMetre
+    val minY = REGION - (size.height - cameraPosition.y) / pixelsPerMetre
+    val maxY = REGION + cameraPosition.y / pixelsPerMetre
+    if (maxX < 0f || minX > REGION || maxY < 0f || minY > REGION) return
+    visible.set(minX, minY, maxX, maxY)
     
-    for (x in 0 until (size.width / gridSize + 2).toInt()) {
-        drawLine(
-            color = Color.Gray.copy(alpha = 0.3f),
-            start = Offset(x * gridSize - offsetX, 0f),
-            end = Offset(x * gridSize - offsetX, size.height),
-            strokeWidth = 1f
-        )
-    }
+    fun screenX(x: Float) = x * pixelsPerMetre + cameraPosition.x
+    fun screenY(y: Float) = (REGION - y) * pixelsPerMetre + cameraPosition.y
     
-    for (y in 0 until (size.height / gridSize + 2).toInt()) {
-        drawLine(
-            color = Color.Gray.copy(alpha = 0.3f),
-            start = Offset(0f, y * gridSize - offsetY),
-            end = Offset(size.width, y * gridSize - offsetY),
-            strokeWidth = 1f
+    // Cached terrain and static prims; edges rounded from the shared grid lines so tiles don't seam
+    val cellSize = minimap.cellSize
+    for (tile in minimap.tiles(minX, minY, maxX, maxY)) {
+        val left = screenX(tile.cellX * cellSize).roundToInt()
+        val right = screenX((tile.cellX + 1) * cellSize).roundToInt()
+        val top = screenY((tile.cellY + 1) * cellSize).roundToInt()
+        val bottom = screenY(tile.cellY * cellSize).roundToInt()
+        drawImage(
+            image = bitmaps[tile],
+            dstOffset = IntOffset(left, top),
+            dstSize = IntSize(right - left, bottom - top)
         )
     }
     
-    // Draw world objects
-    worldObjects.forEach { obj ->
-        val screenPos = Offset(
-            obj.position.x + cameraPosition.x,
-            obj.position.y + cameraPosition.y
-        )
-        
-        // Only draw if object is visible on screen
-        if (screenPos.x > -50f && screenPos.x < size.width + 50f &&
-            screenPos.y > -50f && screenPos.y < size.height + 50f) {
-            
-            val objectSize = 20f * cameraZoom
-            
-            when (obj.type) {
-                "Avatar" -> {
-                    // Draw avatar as circle with outline
-                    drawCircle(
-                        color = obj.color,
-                        radius = objectSize,
-                        center = screenPos
-                    )
-                    drawCircle(
-                        color = Color.Black,
-                        radius = objectSize,
-                        center = screenPos,
-                        style = androidx.compose.ui.graphics.drawscope.Stroke(width = 2f)
-                    )
-                }
-                "Sphere" -> {
-                    drawCircle(
-                        color = obj.color,
-                        radius = objectSize * 0.8f,
-                        center = screenPos
-                    )
-                }
-                else -> {
-                    // Draw as rectangle for cubes and other objects
-                    drawRect(
-                        color = obj.color,
-                        topLeft = Offset(
-                            screenPos.x - objectSize * 0.7f,
-                            screenPos.y - objectSize * 0.7f
-                        ),
-                        size = androidx.compose.ui.geometry.Size(
-                            objectSize * 1.4f,
-                            objectSize * 1.4f
-                        )
-                    )
-                }
-            }
+    // Live layer: avatars and moving objects in view only
+    val radius = 1.5f * pixelsPerMetre
+    for (dot in minimap.dots(minX, minY, maxX, maxY)) {
+        val center = Offset(screenX(dot.x), screenY(dot.y))
+        if (dot.isAvatar) {
+            drawCircle(color = Color.Yellow, radius = radius, center = center)
+            drawCircle(color = Color.Black, radius = radius, center = center, style = Stroke(width = 2f))
+        } else {
+            drawCircle(color = Color.Red, radius = radius * 0.6f, center = center)
         }
     }
 }
 
-private data class WorldObject(
-    val id: String,
-    val type: String,
-    val position: Offset,
-    val color: Color
-)
\ No newline at end of file
+/**
+ * The region rectangle last drawn, for the background tile refresh
+ */
+private class VisibleArea {
+    @Volatile var known = false
+    @Volatile var minX = 0f
+    @Volatile var minY = 0f
+    @Volatile var maxX = 0f
+    @Volatile var maxY = 0f
+    
+    fun set(minX: Float, minY: Float, maxX: Float, maxY: Float) {
+        this.minX = minX
+        this.minY = minY
+        this.maxX = maxX
+        this.maxY = maxY
+        known = true
+    }
+}
+
+/**
+ * Bitmaps for minimap tiles, rebuilt only when a tile is rasterised again
+ */
+private class TileBitmaps {
+    private val bitmaps = HashMap<Long, Pair<MinimapTile, ImageBitmap>>()
+    
+    operator fun get(tile: MinimapTile): ImageBitmap {
+        val key = (tile.cellX.toLong() shl 32) or tile.cellY.toLong()
+        bitmaps[key]?.let { (source, bitmap) -> if (source === tile) return bitmap }
+        val bitmap = Bitmap.createBitmap(tile.pixels, tile.size, tile.size, Bitmap.Config.ARGB_8888).asImageBitmap()
+        bitmaps[key] = tile to bitmap
+        return bitmap
+    }
+}
@@ -0,0 +1,60 @@
+package com.linkpoint.android.ui.components
+
+import androidx.compose.runtime.Composable
+import androidx.compose.runtime.DisposableEffect
+import androidx.compose.runtime.remember
+import androidx.compose.ui.Modifier
+import androidx.compose.ui.platform.LocalContext
+import androidx.compose.ui.platform.LocalLifecycleOwner
+import androidx.compose.ui.viewinterop.AndroidView
+import androidx.lifecycle.Lifecycle
+import androidx.lifecycle.LifecycleEventObserver
+import com.linkpoint.android.render.GLRenderHost
+import com.linkpoint.graphics.rendering.OpenGLRenderer
+
+/**
+ * 3D World View Component
+ * 
+ * Hosts the renderer in a [GLRenderHost] so frames are drawn on its own GL
+ * thread rather than in a Compose Canvas on the main thread. The host follows
+ * the screen's lifecycle: it pauses (and releases its GL context) with the
+ * activity and resumes with it. [resolutionScale] can be lowered at runtime,
+ * e.g. by a quality setting, without recreating anything. [onFrameTime]
+ * receives frame intervals on the GL thread.
+ */
+@Composable
+fun WorldRenderView(
+    renderer: OpenGLRenderer,
+    frameSource: GLRenderHost.FrameSource,
+    modifier: Modifier = Modifier,
+    resolutionScale: Float = 1f,
+    onFrameTime: ((Float) -> Unit)? = null
+) {
+    val context = LocalContext.current
+    val lifecycleOwner = LocalLifecycleOwner.current
+    val host = remember(renderer) { GLRenderHost(context, renderer, frameSource) }
+    
+    DisposableEffect(lifecycleOwner, host) {
+        val observer = LifecycleEventObserver { _, event ->
+            when (event) {
+                Lifecycle.Event.ON_RESUME -> host.onResume()
+                Lifecycle.Event.ON_PAUSE -> host.onPause()
+                else -> Unit
+            }
+        }
+        lifecycleOwner.lifecycle.addObserver(observer)
+        onDispose {
+            lifecycleOwner.lifecycle.removeObserver(observer)
+            host.release()
+        }
+    }
+    
+    AndroidView(
+        factory = { host },
+        modifier = modifier,
+        update = {
+            it.resolutionScale = resolutionScale
+            it.frameTimeListener = onFrameTime
+        }
+    )
+}
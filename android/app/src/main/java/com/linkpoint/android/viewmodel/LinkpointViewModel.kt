@@ -1,86 +1,410 @@
 package com.linkpoint.android.viewmodel
 
-import androidx.lifecycle.ViewModel
+import android.app.Application
+import android.os.Process
+import android.os.SystemClock
+import androidx.lifecycle.AndroidViewModel
 import androidx.lifecycle.viewModelScope
-import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.flow.StateFlow
-import kotlinx.coroutines.flow.asStateFlow
+import kotlinx.coroutines.isActive
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.SupervisorJob
 import kotlinx.coroutines.delay
+import kotlinx.coroutines.channels.Channel
+import com.linkpoint.android.maps.BitmapMapTileDecoder
+import com.linkpoint.android.quality.DeviceQuality
+import com.linkpoint.android.render.GLES30RenderBackend
+import com.linkpoint.android.render.GLRenderHost
+import com.linkpoint.android.service.ViewerService
+import com.linkpoint.android.ui.RecompositionCounts
 import com.linkpoint.core.SimpleViewerCore
-import com.linkpoint.ui.MobileUI
+import com.linkpoint.core.events.EventSystem
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.core.memory.MemoryBudgets
+import com.linkpoint.core.quality.AudioLevel
+import com.linkpoint.core.quality.QualityLevel
+import com.linkpoint.core.startup.StartupGraph
+import com.linkpoint.core.startup.StartupMode
+import com.linkpoint.core.startup.StartupTrace
+import com.linkpoint.ui.ChatMessage
+import com.linkpoint.ui.UIFramework
+import com.linkpoint.ui.UIServices
+import com.linkpoint.ui.chat.ChatIngestPipeline
+import com.linkpoint.ui.radar.NameLookup
+import com.linkpoint.ui.radar.RadarService
+import com.linkpoint.ui.state.ConnectionState
+import com.linkpoint.ui.state.ConnectionStatus
+import com.linkpoint.ui.state.NearbyAvatar
+import com.linkpoint.ui.state.ViewerStateHub
+import com.linkpoint.ui.state.ViewerStats
+import com.linkpoint.ui.teleport.AssetWarmer
+import com.linkpoint.ui.teleport.TeleportPrefetcher
+import com.linkpoint.ui.teleport.TeleportSource
+import com.linkpoint.ui.teleport.Teleporter
 import com.linkpoint.protocol.LoginSystem
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.SecondLifeProtocol
+import com.linkpoint.protocol.inventory.InventoryFetcher
+import com.linkpoint.protocol.inventory.InventorySession
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.names.AvatarName
+import com.linkpoint.protocol.names.DisplayNameCapSource
+import com.linkpoint.protocol.names.NameDiskCache
+import com.linkpoint.protocol.names.NameResponse
+import com.linkpoint.protocol.names.NameService
+import com.linkpoint.protocol.names.NameSource
+import com.linkpoint.protocol.world.ObjectStore
+import com.linkpoint.protocol.world.ObjectMessage
+import com.linkpoint.protocol.world.ObjectUpdateDecoder
+import com.linkpoint.graphics.cameras.ViewerCamera
 import com.linkpoint.graphics.rendering.OpenGLRenderer
+import com.linkpoint.graphics.rendering.TextureCoverage
 import com.linkpoint.audio.AudioSystem
 import com.linkpoint.assets.AssetManager
+import com.linkpoint.assets.maptiles.HttpMapTileSource
+import com.linkpoint.assets.maptiles.MapTileDiskCache
+import com.linkpoint.assets.maptiles.MapTileManager
+import com.linkpoint.assets.prefetch.RegionManifestStore
+import java.io.File
+import java.util.UUID
 
 /**
  * ViewModel for the Android Linkpoint application
  * 
  * Manages the state and business logic for the mobile virtual world viewer,
  * integrating all the imported systems from SecondLife, Firestorm, and RLV viewers.
+ * 
+ * Subsystems are declared in a startup graph rather than constructed here: only
+ * what the login screen needs (core, login, UI) is started eagerly, assets and
+ * audio follow in the background once the screen is interactive, and the
+ * renderer waits until the world view first asks for it.
+ * 
+ * UI state is published through [state] as independent slices (connection,
+ * chat, nearby avatars, stats, subsystem status, activity log), fed from
+ * batched engine snapshots, so each screen section recomposes only when its
+ * own slice changes.
  */
-class LinkpointViewModel : ViewModel() {
+class LinkpointViewModel(application: Application) : AndroidViewModel(application) {
+    
+    val state = ViewerStateHub()
+    
+    /** RLV restrictions; a forced @tpto teleports through the session, prefetching like any other teleport */
+    val rlv = RLVProcessor(teleportSink = ::forceTeleport)
+    
+    // Teleports through the service's session, if there is one
+    private val teleporter = Teleporter { regionHandle, x, y, z ->
+        viewerService?.getProtocol()?.teleportTo(regionHandle, x, y, z) == true
+    }
     
-    private val _uiState = MutableStateFlow(LinkpointUIState())
-    val uiState: StateFlow<LinkpointUIState> = _uiState.asStateFlow()
+    // Measure from process start so the trace reflects the real cold start
+    private val startupTrace = StartupTrace(
+        originNanos = System.nanoTime() - (SystemClock.elapsedRealtime() - Process.getStartElapsedRealtime()) * 1_000_000
+    )
+    private val startup = StartupGraph(viewModelScope, startupTrace)
     
     // Core viewer systems
-    private val viewerCore = SimpleViewerCore()
-    private val mobileUI = MobileUI()
-    private val loginSystem = LoginSystem()
-    private val renderer = OpenGLRenderer()
-    private val audioSystem = AudioSystem()
-    private val assetManager = AssetManager()
+    private val viewerCore = startup.register("core") {
+        SimpleViewerCore().also { it.initialize() }
+    }
+    private val loginSystem = startup.register("login", dependsOn = listOf("core")) {
+        LoginSystem()
+    }
+    // World map tiles: BitmapFactory decoding, cached under the app's cache directory
+    private val mapTiles = MapTileManager(
+        HttpMapTileSource(),
+        MapTileDiskCache(File(application.cacheDir, "map")),
+        decoder = BitmapMapTileDecoder
+    )
+    /** Entities and terrain of the current region, shown by the world view */
+    val objectStore = ObjectStore()
+    // Fills [objectStore] from the circuit's object updates
+    private val objectUpdates = ObjectUpdateDecoder(objectStore)
+    // The circuit's object updates, in order; when full the circuit waits rather than dropping any
+    private val objectMessages = Channel<ObjectMessage>(OBJECT_MESSAGE_BUFFER)
+    
+    /** Warms the caches for a teleport destination while the teleport is confirmed and negotiated */
+    val teleportPrefetch = TeleportPrefetcher(
+        RegionManifestStore(File(application.cacheDir, "regions")),
+        AssetWarmer { id, type -> assetManager.getOrNull()?.warm(id, type) ?: false },
+        objectStore,
+        viewModelScope,
+        textureFetch = { assetManager.getOrNull()?.textureFetch },
+        rlv = rlv
+    )
+    private val mobileUI = startup.register("ui", dependsOn = listOf("core")) {
+        val metrics = application.resources.displayMetrics
+        UIFramework.getInstance().also {
+            it.initialize(metrics.widthPixels, metrics.heightPixels, UIServices(mapTiles, teleportPrefetch, teleporter, rlv, names))
+        }
+    }
+    private val assetManager = startup.register("assets", mode = StartupMode.BACKGROUND, dispatcher = Dispatchers.IO) {
+        AssetManager(EventSystem, File(application.cacheDir, "assets")).also { it.initialize() }
+    }
+    private val audioSystem = startup.register("audio", dependsOn = listOf("assets"), mode = StartupMode.BACKGROUND) {
+        AudioSystem(assetManager.get(), EventSystem).also { it.initialize() }
+    }
+    // Initialised by the render host on its GL thread, where the context is current
+    private val renderer = startup.register("renderer", dependsOn = listOf("core"), mode = StartupMode.LAZY) {
+        OpenGLRenderer(GLES30RenderBackend())
+    }
+    
+    // This region's avatars, until a session provides the GetDisplayNames capability
+    private val regionNames = NameSource { ids ->
+        NameResponse(ids.mapNotNull { id ->
+            // Avatars decoded from bare object updates have no name yet
+            (objectStore[id] as? Avatar)?.takeIf { it.displayName.isNotEmpty() }
+                ?.let { id to AvatarName(id, it.displayName, it.username, 0) }
+        }.toMap())
+    }
+    @Volatile private var nameSource: NameSource = regionNames
+    val names = NameService(
+        NameSource { ids -> nameSource.fetch(ids) },
+        viewModelScope,
+        NameDiskCache(File(application.cacheDir, "names.bin"))
+    )
+    private val chatIngest = ChatIngestPipeline(rlv = rlv, names = names)
+    
+    // Owner of the simulator session, while the activity is bound to it
+    private var viewerService: ViewerService? = null
+    
+    // The logged-in account's inventory; its #RLV folder answers RLV's inventory queries
+    @Volatile private var inventory: InventorySession? = null
+    private val cacheDir: File = application.cacheDir
+    
+    private val radar = RadarService(NameLookup { ids -> names.getAll(ids).mapValues { it.value.displayName } })
+        .also { objectStore.addAvatarListener(it) }
+    // The radar list as its diffs left it, nearest first; radar collector only
+    private val nearby = LinkedHashMap<UUID, NearbyAvatar>()
+    // Regions with coarse locations on the radar, as handed to it; event collector only
+    private val coarseRegions = HashSet<Long>()
+    
+    /**
+     * Device quality scaling; the world view reports frame times to it and its
+     * level is applied to renderer, texture budget and audio here (network
+     * limits are applied by the activity, which holds the service)
+     */
+    val deviceQuality = DeviceQuality(application, viewModelScope)
+    val qualityLevel: StateFlow<QualityLevel> get() = deviceQuality.level
+    
+    // Viewpoint of the world view; only the GL thread moves it, within RLV's camera limits
+    private val camera = ViewerCamera().also {
+        it.initialize()
+        it.bindRLV(rlv)
+    }
+    // What the current scene was gathered for: store version, camera cell and reach
+    private var sceneVersion = -1L
+    private var sceneCell = -1
+    private var sceneReach = 0f
+    private var scene = OpenGLRenderer.Scene(emptyList())
+    
+    /**
+     * Frames for the world view: [objectStore]'s entities seen through the
+     * camera. Runs on the GL thread; the scene holds only the entities within
+     * draw distance, taken from the store's spatial grid, and is gathered again
+     * only when the store changed or the camera crossed into another grid cell
+     */
+    val worldFrames = GLRenderHost.FrameSource { _ ->
+        camera.update(0f)
+        val view = camera.getCameraData()
+        val grid = objectStore.grid
+        val reach = minOf(view.farPlane, renderer.getOrNull()?.drawDistance ?: view.farPlane)
+        val cell = grid.cellY(view.position.y) * grid.cellsPerSide + grid.cellX(view.position.x)
+        val version = objectStore.version
+        if (version != sceneVersion || cell != sceneCell || reach != sceneReach) {
+            sceneVersion = version
+            sceneCell = cell
+            sceneReach = reach
+            // Whole cells around the camera's, so moving within a cell needs no new scene
+            val margin = reach + grid.cellSize
+            scene = OpenGLRenderer.Scene(grid.query(
+                view.position.x - margin, view.position.y - margin,
+                view.position.x + margin, view.position.y + margin
+            ))
+        }
+        GLRenderHost.Frame(
+            OpenGLRenderer.Camera(view.position, view.direction, view.up, view.fieldOfView, view.nearPlane, view.farPlane),
+            scene
+        )
+    }
+    
+    /**
+     * The 3D renderer for a [com.linkpoint.android.ui.components.WorldRenderView]; first use brings it up
+     */
+    suspend fun worldRenderer(): OpenGLRenderer = renderer.get().also { renderer ->
+        val level = deviceQuality.level.value
+        renderer.drawDistance = level.drawDistance
+        renderer.particleBudget = level.maxParticles
+        // Each frame's texture coverage decides which downloads go next
+        renderer.coverageListener = TextureCoverage.Listener { coverage ->
+            assetManager.getOrNull()?.textureFetch?.let { fetch ->
+                coverage.forEach(fetch::updateDemand)
+                fetch.endFrame()
+            }
+            teleportPrefetch.observe(coverage)
+        }
+    }
     
     init {
         initializeViewer()
     }
     
     private fun initializeViewer() {
+        state.start(viewModelScope)
+        addLogEntry("Initializing Linkpoint Virtual World Viewer...")
+        startup.start()
+        startSnapshots()
+        
         viewModelScope.launch {
-            addLogEntry("Initializing Linkpoint Virtual World Viewer...")
-            addLogEntry("Loading SecondLife, Firestorm & RLV viewer concepts...")
-            
-            delay(1000)
-            
-            // Initialize core systems
-            viewerCore.initialize()
+            viewerCore.get()
             addLogEntry("✓ Core viewer system initialized")
-            updateStatus("protocolStatus", "Complete")
-            
-            delay(500)
-            
-            mobileUI.initialize()
+            updateStatus(SUBSYSTEM_PROTOCOL, "Complete")
+        }
+        
+        viewModelScope.launch {
+            mobileUI.get()
             addLogEntry("✓ Mobile UI framework initialized (Lumiya-inspired)")
-            updateStatus("uiStatus", "Complete")
-            
-            delay(500)
-            
-            renderer.initialize(emptyMap())
-            addLogEntry("✓ OpenGL graphics pipeline initialized")
-            updateStatus("graphicsStatus", "Complete")
-            
-            delay(500)
-            
-            audioSystem.initialize()
-            addLogEntry("✓ 3D spatial audio system initialized")
-            updateStatus("audioStatus", "Complete")
+            updateStatus(SUBSYSTEM_UI, "Complete")
+        }
+        
+        viewModelScope.launch {
+            // Login screen is interactive once its subsystems are up
+            loginSystem.get()
+            mobileUI.get()
+            val coldStartMs = startupTrace.milestone(MILESTONE_LOGIN_INTERACTIVE)
+            state.setColdStart(coldStartMs.toLong())
+            addLogEntry("✓ Login screen ready in ${coldStartMs.toLong()}ms from process start")
             
-            delay(500)
+            // Everything else comes up behind the interactive screen
+            updateStatus(SUBSYSTEM_GRAPHICS, "On demand")
+            startup.startBackground()
             
-            assetManager.initialize()
+            assetManager.get()
             addLogEntry("✓ Asset management system initialized")
-            updateStatus("assetStatus", "Complete")
+            updateStatus(SUBSYSTEM_ASSETS, "Complete")
             
-            delay(1000)
+            audioSystem.get()
+            addLogEntry("✓ 3D spatial audio system initialized")
+            updateStatus(SUBSYSTEM_AUDIO, "Complete")
             
+            startup.awaitStarted()
             addLogEntry("🎉 All systems operational! Ready for virtual world connectivity.")
-            addLogEntry("Implementation includes 31 Kotlin files, 11,664 lines of code")
-            addLogEntry("No AI hallucinations detected - all systems verified")
+            applyQuality()
+            startupTrace.format().lineSequence().filter { it.isNotBlank() }.forEach { addLogEntry(it) }
+        }
+    }
+    
+    private fun applyQuality() {
+        deviceQuality.start()
+        viewModelScope.launch {
+            deviceQuality.level.collect { level ->
+                renderer.getOrNull()?.let {
+                    it.drawDistance = level.drawDistance
+                    it.particleBudget = level.maxParticles
+                }
+                MemoryBudgets.account(MemoryBudgets.TEXTURES)?.budgetBytes = level.textureBudgetBytes
+                audioSystem.getOrNull()?.setAudioQuality(audioQuality(level.audio))
+                addLogEntry("⚙️ Quality $level (${deviceQuality.controller.reason})")
+            }
         }
     }
     
+    // Spelled out so renaming either enum's constants fails to compile rather than at run time
+    private fun audioQuality(level: AudioLevel): AudioSystem.AudioQuality = when (level) {
+        AudioLevel.LOW -> AudioSystem.AudioQuality.LOW
+        AudioLevel.MEDIUM -> AudioSystem.AudioQuality.MEDIUM
+        AudioLevel.HIGH -> AudioSystem.AudioQuality.HIGH
+        AudioLevel.ULTRA -> AudioSystem.AudioQuality.ULTRA
+    }
+    
+    /** The activity bound (or, with null, lost) the [ViewerService] */
+    fun attachService(service: ViewerService?) {
+        viewerService?.getProtocol()?.objectMessages = null
+        viewerService = service
+        service?.getProtocol()?.objectMessages = objectMessages
+    }
+    
+    /**
+     * Log in through the service, which keeps the circuit up while the app is
+     * in the background
+     */
+    fun login(loginUri: String, username: String, password: String) {
+        val service = viewerService ?: return addLogEntry("⚠️ Viewer service not bound yet")
+        state.setConnection(ConnectionState(ConnectionStatus.CONNECTING, detail = username))
+        viewModelScope.launch {
+            addLogEntry("🔐 Logging in as $username...")
+            if (service.login(loginUri, username, password)) {
+                teleportPrefetch.currentRegion = service.getProtocol().getRegionHandle()
+                radar.selfId = service.getProtocol().getAgentId()?.let { runCatching { UUID.fromString(it) }.getOrNull() }
+                addLogEntry("✓ Logged in; simulator circuit open")
+                launch(Dispatchers.IO) { startInventory(service.getProtocol()) }
+            } else {
+                addLogEntry("❌ Login failed")
+            }
+        }
+    }
+    
+    /**
+     * Look names up through GetDisplayNames, then restore the inventory from
+     * the last session's snapshot, list its root and install its #RLV folders,
+     * if the simulator grants FetchInventoryDescendents2
+     */
+    private suspend fun startInventory(protocol: SecondLifeProtocol) {
+        val seed = protocol.getSeedCapability() ?: return
+        val owner = protocol.getAgentId()?.let { runCatching { UUID.fromString(it) }.getOrNull() } ?: return
+        val root = protocol.getInventoryRoot()?.let { runCatching { UUID.fromString(it) }.getOrNull() } ?: return
+        try {
+            val capabilities = InventorySession.resolveCapabilities(
+                seed, listOf(InventoryFetcher.CAPABILITY_NAME, DisplayNameCapSource.CAPABILITY_NAME)
+            )
+            capabilities[DisplayNameCapSource.CAPABILITY_NAME]?.let { nameSource = DisplayNameCapSource(it) }
+            val capability = capabilities[InventoryFetcher.CAPABILITY_NAME] ?: return
+            val session = InventorySession.start(capability, owner, root, File(cacheDir, "inventory-$owner.snapshot"))
+            inventory = session
+            val shared = session.sharedFolders()
+            rlv.setSharedFolders(shared)
+            addLogEntry("📁 Inventory: ${session.store.folderCount} folders, ${shared?.folderCount ?: 0} shared with RLV")
+        } catch (e: Exception) {
+            addLogEntry("⚠️ Inventory unavailable: ${e.message}")
+        }
+    }
+    
+    // @tpto=force, in global metres; refused without a session to teleport
+    private fun forceTeleport(x: Double, y: Double, z: Double): Boolean {
+        val protocol = viewerService?.getProtocol()?.takeIf { it.isConnected() } ?: return false
+        val regionHandle = RegionManifestStore.regionHandle((x / REGION_WIDTH).toInt(), (y / REGION_WIDTH).toInt())
+        teleportPrefetch.onTeleportIntent(regionHandle, TeleportSource.RLV)
+        viewModelScope.launch(Dispatchers.IO) {
+            if (!protocol.teleportTo(regionHandle, (x % REGION_WIDTH).toFloat(), (y % REGION_WIDTH).toFloat(), z.toFloat())) {
+                addLogEntry("⚠️ RLV teleport could not be requested")
+            }
+        }
+        return true
+    }
+    
+    // Coarse locations are local to their region; the radar wants them relative to the agent's
+    private fun onCoarseLocations(event: ViewerEvent.CoarseLocationsUpdated) {
+        val agentRegion = teleportPrefetch.currentRegion ?: return
+        val region = if (event.regionHandle == agentRegion) RadarService.CURRENT_REGION else event.regionHandle
+        // Handles are the region's global corner in metres, x in the high half
+        val dx = ((event.regionHandle ushr 32) - (agentRegion ushr 32)).toFloat()
+        val dy = ((event.regionHandle and 0xFFFFFFFFL) - (agentRegion and 0xFFFFFFFFL)).toFloat()
+        val avatars = if (region == RadarService.CURRENT_REGION) event.avatars
+            else event.avatars.mapValues { (_, position) -> Vector3(position.x + dx, position.y + dy, position.z) }
+        coarseRegions += region
+        radar.updateCoarse(region, avatars)
+    }
+    
+    // Write the snapshot for the next login, off the main thread
+    private fun closeInventory() {
+        val session = inventory ?: return
+        inventory = null
+        rlv.setSharedFolders(null)
+        cleanupScope.launch { session.close() }
+    }
+    
     fun demonstrateMobileUI() {
         viewModelScope.launch {
             addLogEntry("📱 Demonstrating Mobile UI...")
@@ -90,11 +414,12 @@ class LinkpointViewModel : ViewModel() {
             addLogEntry("• Responsive design for phones and tablets")
             
             // Simulate mobile UI interaction
-            mobileUI.showChatPanel()
+            val ui = mobileUI.get()
+            ui.showChatPanel()
             delay(1000)
-            mobileUI.showInventoryGrid()
+            ui.showInventoryGrid()
             delay(1000)
-            mobileUI.activateGestureCamera()
+            ui.activateGestureCamera()
             
             addLogEntry("✓ Mobile UI demonstration complete")
         }
@@ -109,7 +434,7 @@ class LinkpointViewModel : ViewModel() {
             addLogEntry("• World entity framework for avatars and objects")
             
             // Simulate protocol operations
-            loginSystem.simulateLogin("demo@linkpoint.com", "password")
+            loginSystem.get().simulateLogin("demo@linkpoint.com", "password")
             delay(1500)
             
             addLogEntry("✓ Protocol demonstration complete")
@@ -124,6 +449,10 @@ class LinkpointViewModel : ViewModel() {
             addLogEntry("• Shader management with quality levels")
             addLogEntry("• Hardware-specific optimization profiles")
             
+            // First use brings the renderer up
+            val renderer = renderer.get()
+            updateStatus(SUBSYSTEM_GRAPHICS, "Complete")
+            
             // Simulate graphics operations
             renderer.beginFrame()
             delay(1000)
@@ -146,6 +475,7 @@ class LinkpointViewModel : ViewModel() {
             addLogEntry("• Performance optimization with adaptive quality")
             
             // Simulate audio operations
+            val audioSystem = audioSystem.get()
             audioSystem.playPositionalSound("ambient_wind", floatArrayOf(0f, 0f, 0f))
             delay(1000)
             audioSystem.updateListenerPosition(floatArrayOf(5f, 0f, 5f))
@@ -155,42 +485,160 @@ class LinkpointViewModel : ViewModel() {
         }
     }
     
-    private fun addLogEntry(entry: String) {
-        val currentState = _uiState.value
-        val updatedLog = (currentState.activityLog + entry).takeLast(50) // Keep last 50 entries
-        _uiState.value = currentState.copy(activityLog = updatedLog)
+    /**
+     * Push a burst of local chat from many senders through the ingest pipeline
+     * at display rate, then log how often each state slice was published and
+     * each UI section recomposed
+     */
+    fun demonstrateChatFlood() {
+        viewModelScope.launch {
+            addLogEntry("💬 Flooding local chat...")
+            val before = state.emissions
+            RecompositionCounts.reset()
+            var sent = 0
+            repeat(FLOOD_FRAMES) {
+                repeat(FLOOD_MESSAGES_PER_FRAME) {
+                    chatIngest.submit(ChatMessage(
+                        text = "flood message $sent",
+                        channel = "Local",
+                        timestamp = System.currentTimeMillis(),
+                        sender = "Resident ${sent % FLOOD_SENDERS}"
+                    ))
+                    sent++
+                }
+                delay(16)
+            }
+            delay(1000)
+            
+            val published = state.emissions.mapValues { (slice, count) -> count - (before[slice] ?: 0) }
+                .filterValues { it > 0 }
+            addLogEntry("• $sent messages, published ${published.entries.joinToString { "${it.key.name.lowercase()}=${it.value}" }}")
+            addLogEntry("• Recomposed ${RecompositionCounts.snapshot().entries.joinToString { "${it.key}=${it.value}" }}")
+            addLogEntry("✓ Chat flood complete")
+        }
     }
     
-    private fun updateStatus(field: String, status: String) {
-        val currentState = _uiState.value
-        _uiState.value = when (field) {
-            "protocolStatus" -> currentState.copy(protocolStatus = status)
-            "graphicsStatus" -> currentState.copy(graphicsStatus = status)
-            "uiStatus" -> currentState.copy(uiStatus = status)
-            "assetStatus" -> currentState.copy(assetStatus = status)
-            "audioStatus" -> currentState.copy(audioStatus = status)
-            else -> currentState
+    /**
+     * Feed the state hub from the engine: chat as digested batches, connection
+     * changes as they happen, the radar list when a radar diff arrives and
+     * stats as periodic snapshots
+     */
+    private fun startSnapshots() {
+        chatIngest.start(viewModelScope)
+        viewModelScope.launch { chatIngest.batches.collect { state.appendChat(it) } }
+        
+        viewModelScope.launch {
+            EventSystem.events.collect { event ->
+                when (event) {
+                    is ViewerEvent.Connected -> state.setConnection(ConnectionState(ConnectionStatus.CONNECTED, detail = event.sessionId))
+                    is ViewerEvent.Disconnected -> {
+                        state.setConnection(ConnectionState(ConnectionStatus.DISCONNECTED, detail = event.reason))
+                        objectUpdates.clear()
+                        coarseRegions.forEach(radar::removeRegion)
+                        coarseRegions.clear()
+                        nameSource = regionNames
+                        closeInventory()
+                    }
+                    is ViewerEvent.ConnectionFailed -> state.setConnection(ConnectionState(ConnectionStatus.DISCONNECTED, detail = event.error))
+                    is ViewerEvent.AvatarTeleported -> teleportPrefetch.onArrived(event.regionHandle)
+                    is ViewerEvent.CoarseLocationsUpdated -> onCoarseLocations(event)
+                    else -> Unit
+                }
+            }
+        }
+        
+        // Decoded off the main thread; updates arrive by the hundred on entering a region
+        viewModelScope.launch(Dispatchers.Default) {
+            for (message in objectMessages) objectUpdates.apply(message)
+        }
+        
+        // Every diff, including distance-only ones, so the metres shown stay current;
+        // only changed rows are rebuilt, and the list is re-sorted only when the order moved
+        radar.start(viewModelScope)
+        viewModelScope.launch {
+            radar.diffs.collect { diff ->
+                diff.left.forEach(nearby::remove)
+                for (changed in listOf(diff.entered, diff.movedBucket, diff.renamed, diff.remeasured)) {
+                    for (entry in changed) nearby[entry.id] = NearbyAvatar(entry.id, entry.name ?: "…", entry.distance.toInt())
+                }
+                if (diff.reordered || diff.entered.isNotEmpty()) {
+                    val sorted = nearby.values.sortedBy { it.distance }
+                    nearby.clear()
+                    sorted.forEach { nearby[it.id] = it }
+                }
+                state.setNearbyAvatars(ArrayList(nearby.values))
+            }
+        }
+        
+        viewModelScope.launch(Dispatchers.Default) {
+            while (isActive) {
+                radar.setSelf(objectStore.focus)
+                val cache = viewerService?.getProtocol()?.objectCacheStats
+                state.setStats(ViewerStats(
+                    fps = deviceQuality.lastFrameTimeMs.let { if (it > 0f) (1000f / it).toInt() else 0 },
+                    objects = objectStore.size,
+                    cacheHitPercent = cache?.let { (it.hitRate * 100).toInt() } ?: 0,
+                    cacheKilobytesSaved = cache?.let { it.bytesSaved / 1024 } ?: 0
+                ))
+                delay(SNAPSHOT_INTERVAL_MS)
+            }
         }
     }
     
+    private fun addLogEntry(entry: String) = state.log(entry)
+    
+    private fun updateStatus(subsystem: String, status: String) = state.setSubsystemStatus(subsystem, status)
+    
+    /**
+     * The activity left the screen. A backgrounded app is usually killed
+     * without onCleared, so caches are written out now, off the main thread
+     */
+    fun onBackgrounded() {
+        cleanupScope.launch { names.persist() }
+        teleportPrefetch.recordVisit()
+    }
+    
     override fun onCleared() {
         super.onCleared()
-        // Cleanup viewer systems
-        viewModelScope.launch {
-            viewerCore.shutdown()
-            audioSystem.shutdown()
-        }
+        deviceQuality.stop()
+        cleanupScope.launch { names.persist() }
+        // Cleanup whichever viewer systems came up; viewModelScope is already
+        // cancelled here, so nothing below may wait on the startup graph, and
+        // suspending shutdowns run on the cleanup scope, off the main thread
+        viewerCore.getOrNull()?.shutdown()
+        audioSystem.getOrNull()?.let { audio -> cleanupScope.launch { audio.shutdown() } }
+        renderer.getOrNull()?.shutdown()
+        mapTiles.shutdown()
+        // The service's circuit outlives us; it must not wait on a channel nobody reads
+        viewerService?.getProtocol()?.objectMessages = null
+        objectMessages.close()
+        objectStore.close()
+        closeInventory()
+    }
+    
+    companion object {
+        const val MILESTONE_LOGIN_INTERACTIVE = "login-interactive"
+        
+        // Subsystem status keys, also their display names
+        const val SUBSYSTEM_PROTOCOL = "Protocol System"
+        const val SUBSYSTEM_GRAPHICS = "Graphics Pipeline"
+        const val SUBSYSTEM_UI = "Mobile UI"
+        const val SUBSYSTEM_ASSETS = "Asset Management"
+        const val SUBSYSTEM_AUDIO = "Audio System"
+        
+        private const val SNAPSHOT_INTERVAL_MS = 500L
+        
+        // Regions are 256 m on a side; RLV teleports are given in global metres
+        private const val REGION_WIDTH = 256.0
+        
+        // Object messages queued for decoding before the circuit waits
+        private const val OBJECT_MESSAGE_BUFFER = 4096
+        
+        // Outlives any one ViewModel, whose scope is cancelled before onCleared
+        private val cleanupScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+        
+        private const val FLOOD_FRAMES = 120
+        private const val FLOOD_MESSAGES_PER_FRAME = 16
+        private const val FLOOD_SENDERS = 40
     }
 }
-
-/**
- * UI state for the Linkpoint Android application
- */
-data class LinkpointUIState(
-    val protocolStatus: String = "Initializing",
-    val graphicsStatus: String = "Initializing", 
-    val uiStatus: String = "Initializing",
-    val assetStatus: String = "Initializing",
-    val audioStatus: String = "Initializing",
-    val activityLog: List<String> = emptyList()
-)
\ No newline at end of file
@@ -2,6 +2,9 @@ package com.linkpoint.assets
 
 import com.linkpoint.core.events.EventSystem
 import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.core.memory.MemoryBudgets
+import com.linkpoint.core.memory.MemoryPressureListener
+import com.linkpoint.core.profiling.Profiler
 import com.linkpoint.protocol.data.SimpleWorldEntities.UUID
 import kotlinx.coroutines.*
 import kotlinx.coroutines.flow.*
@@ -9,6 +12,12 @@ import java.io.File
 import java.net.URL
 import java.security.MessageDigest
 import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicBoolean
+
+// Profiler zones for each cache tier of getAsset
+private val ZONE_MEMORY_TIER = Profiler.zone("Asset/MemoryTier")
+private val ZONE_DISK_TIER = Profiler.zone("Asset/DiskTier")
+private val ZONE_DOWNLOAD_TIER = Profiler.zone("Asset/DownloadTier")
 
 /**
  * AssetManager - Complete asset management system imported from SecondLife viewer's llassetmanager.cpp
@@ -33,15 +42,50 @@ class AssetManager(
     
     // Asset cache with memory and disk tiers (imported from llassetmanager's cache system)
     private val memoryCache = ConcurrentHashMap<UUID, Asset>()
-    private val downloadQueue = Channel<AssetRequest>(Channel.UNLIMITED)
     private val activeDownloads = ConcurrentHashMap<UUID, Deferred<Asset?>>()
     
+    /**
+     * Texture downloads in order of screen coverage; the renderer reports
+     * coverage every frame. Assets come whole here, so every fetch lands at
+     * full resolution
+     */
+    val textureFetch = TextureFetchScheduler({ id, _ ->
+        if (getAsset(UUID(id.toString()), AssetType.TEXTURE, Priority.HIGH) != null) 0 else null
+    })
+    
     // Asset statistics for performance monitoring
     private val stats = AssetStats()
     
-    init {
+    // Live-byte accounting for the memory tier: decoded textures are tracked
+    // separately from everything else so they can be budgeted on their own
+    private val textureAccount = MemoryBudgets.register(
+        MemoryBudgets.TEXTURES,
+        MemoryBudgets.PRIORITY_TEXTURES,
+        listener = MemoryPressureListener { _, bytes -> evictFromMemory(bytes) { it.type == AssetType.TEXTURE } }
+    )
+    private val cacheAccount = MemoryBudgets.register(
+        MemoryBudgets.ASSET_CACHE,
+        MemoryBudgets.PRIORITY_ASSET_CACHE,
+        listener = MemoryPressureListener { _, bytes -> evictFromMemory(bytes) { it.type != AssetType.TEXTURE } }
+    )
+    
+    // Disk and worker setup is deferred to initialize() or the first request so
+    // that constructing an AssetManager on the main thread does no I/O
+    private val started = AtomicBoolean(false)
+    
+    /**
+     * Create the cache directory and start the download and cache cleanup workers.
+     * Optional: the first asset request does the same if this was not called.
+     */
+    suspend fun initialize(): Boolean = withContext(Dispatchers.IO) {
+        ensureStarted()
+        true
+    }
+    
+    private fun ensureStarted() {
+        if (!started.compareAndSet(false, true)) return
         cacheDirectory.mkdirs()
-        startDownloadWorker()
+        textureFetch.start(scope)
         startCacheCleanup()
     }
     
@@ -135,16 +179,6 @@ class AssetManager(
         fun canCopy() = (baseMask and PERM_COPY) != 0
     }
     
-    /**
-     * Asset request with priority and callback
-     */
-    private data class AssetRequest(
-        val uuid: UUID,
-        val type: AssetType,
-        val priority: Priority = Priority.NORMAL,
-        val callback: suspend (Asset?) -> Unit
-    )
-    
     enum class Priority(val value: Int) {
         LOW(0), NORMAL(1), HIGH(2), CRITICAL(3)
     }
@@ -178,20 +212,24 @@ class AssetManager(
         type: AssetType,
         priority: Priority = Priority.NORMAL
     ): Asset? = withContext(Dispatchers.IO) {
+        ensureStarted()
         
         // Check memory cache first (fastest access)
-        memoryCache[uuid]?.let { asset ->
+        val memoryHit = Profiler.scope(ZONE_MEMORY_TIER) { memoryCache[uuid] }
+        memoryHit?.let { asset ->
             stats.cacheHits++
             stats.bytesServed += asset.size
             return@withContext asset
         }
         
         // Check disk cache
+        val diskStart = Profiler.mark()
         val cachedAsset = loadFromDiskCache(uuid, type)
+        Profiler.record(ZONE_DISK_TIER, diskStart)
         if (cachedAsset != null) {
             stats.cacheHits++
             stats.bytesServed += cachedAsset.size
-            memoryCache[uuid] = cachedAsset
+            cacheInMemory(cachedAsset)
             return@withContext cachedAsset
         }
         
@@ -209,11 +247,13 @@ class AssetManager(
         
         activeDownloads[uuid] = downloadDeferred
         
+        val downloadStart = Profiler.mark()
         try {
             val asset = downloadDeferred.await()
+            Profiler.record(ZONE_DOWNLOAD_TIER, downloadStart)
             asset?.let {
                 // Cache the downloaded asset
-                memoryCache[uuid] = it
+                cacheInMemory(it)
                 saveToDiskCache(it)
                 stats.downloadsCompleted++
                 stats.bytesDownloaded += it.size
@@ -252,6 +292,15 @@ class AssetManager(
         }
     }
     
+    /**
+     * Load an asset into the memory tier ahead of need, from disk or the
+     * network, e.g. from a region manifest before a teleport lands
+     * 
+     * @return whether the asset is now in memory
+     */
+    suspend fun warm(id: java.util.UUID, type: AssetType): Boolean =
+        getAsset(UUID(id.toString()), type, Priority.LOW) != null
+    
     /**
      * Get asset processing status
      */
@@ -268,30 +317,6 @@ class AssetManager(
         NOT_FOUND, DOWNLOADING, CACHED, READY
     }
     
-    /**
-     * Download worker that processes the download queue
-     */
-    private fun startDownloadWorker() {
-        scope.launch {
-            while (true) {
-                try {
-                    val request = downloadQueue.receive()
-                    processAssetRequest(request)
-                } catch (e: Exception) {
-                    println("Asset download worker error: ${e.message}")
-                }
-            }
-        }
-    }
-    
-    /**
-     * Process individual asset request
-     */
-    private suspend fun processAssetRequest(request: AssetRequest) {
-        val asset = getAsset(request.uuid, request.type, request.priority)
-        request.callback(asset)
-    }
-    
     /**
      * Download asset from SecondLife asset servers
      * 
@@ -403,15 +428,44 @@ class AssetManager(
      * Clear memory cache (useful for memory management)
      */
     fun clearMemoryCache() {
+        memoryCache.values.forEach { accountFor(it).release(it.size.toLong()) }
         memoryCache.clear()
     }
     
+    /**
+     * Put an asset in the memory tier and charge its bytes to the right account
+     */
+    private fun cacheInMemory(asset: Asset) {
+        val previous = memoryCache.put(asset.uuid, asset)
+        previous?.let { accountFor(it).release(it.size.toLong()) }
+        accountFor(asset).charge(asset.size.toLong())
+    }
+    
+    /**
+     * Evict least recently loaded assets matching [filter] until [bytesToFree] is reached.
+     * Evicted assets remain on disk, so the next request is served from the disk tier.
+     */
+    private fun evictFromMemory(bytesToFree: Long, filter: (Asset) -> Boolean): Long {
+        var freed = 0L
+        val candidates = memoryCache.values.filter(filter).sortedBy { it.timestamp }
+        for (asset in candidates) {
+            if (freed >= bytesToFree) break
+            if (memoryCache.remove(asset.uuid, asset)) {
+                accountFor(asset).release(asset.size.toLong())
+                freed += asset.size
+            }
+        }
+        return freed
+    }
+    
+    private fun accountFor(asset: Asset) =
+        if (asset.type == AssetType.TEXTURE) textureAccount else cacheAccount
+    
     /**
      * Shutdown asset manager and cleanup resources
      */
     suspend fun shutdown() {
         scope.cancel()
-        downloadQueue.close()
         clearMemoryCache()
     }
     
@@ -0,0 +1,24 @@
+package com.linkpoint.assets
+
+import kotlinx.coroutines.CoroutineDispatcher
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.ExperimentalCoroutinesApi
+
+/**
+ * Shared, bounded pool for image decoding.
+ *
+ * Decoding is CPU-bound and bursty (a map pan or a region arrival queues
+ * dozens of images at once), so it runs on a slice of the default dispatcher
+ * rather than on IO threads: fetches keep flowing while decodes are limited to
+ * a few cores and leave the rest for the render and network threads.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLImageDecodeThread worker pool
+ */
+@OptIn(ExperimentalCoroutinesApi::class)
+object TextureDecodePool {
+    /** Decodes allowed to run at once */
+    val parallelism: Int = (Runtime.getRuntime().availableProcessors() - 1).coerceIn(1, 4)
+
+    val dispatcher: CoroutineDispatcher = Dispatchers.Default.limitedParallelism(parallelism)
+}
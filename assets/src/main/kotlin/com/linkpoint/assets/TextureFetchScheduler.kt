@@ -0,0 +1,196 @@
+package com.linkpoint.assets
+
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Semaphore
+import mu.KotlinLogging
+import java.util.UUID
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Fetches a texture down to a discard level
+ */
+fun interface TextureFetcher {
+    /**
+     * @return the discard level now available (0 is full resolution; may be
+     *   better than asked for), or null if the fetch failed
+     */
+    suspend fun fetch(id: UUID, discard: Int): Int?
+}
+
+/**
+ * Orders texture fetches by how much of the screen each texture covers.
+ *
+ * The renderer reports every texture in view each frame through
+ * [updateDemand] with its covered pixels and the discard level that is
+ * sharp enough at that size, then calls [endFrame]. Up to [maxConcurrent]
+ * fetches run at once, and each free slot goes to the texture in view with
+ * the most pixels that isn't yet at its desired level, so what fills the
+ * screen sharpens first and textures that left the view stop competing.
+ * A texture that comes closer later is fetched again at the finer level.
+ *
+ * [markTeleport] starts a timer that stops, and is logged, once
+ * [sharpFraction] of the pixels in view reaches [SHARP_TARGET] in a frame
+ * begun after the mark. Frames with nothing in view don't count, since right
+ * after arrival that means the new region hasn't loaded, not that it is sharp.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLTextureFetch, with request priority from
+ *   LLViewerTextureList::updateImageDecodePriority
+ */
+class TextureFetchScheduler(
+    private val fetcher: TextureFetcher,
+    private val maxConcurrent: Int = DEFAULT_MAX_CONCURRENT,
+    private val clock: () -> Long = System::currentTimeMillis
+) {
+    private class Entry(val id: UUID) {
+        var pixels = 0f
+        var desiredDiscard = NOT_LOADED
+        var availableDiscard = NOT_LOADED
+        var seenFrame = -1L
+        var fetching = false
+        var retryFrame = 0L
+    }
+
+    private val entries = HashMap<UUID, Entry>()
+    private val wake = Channel<Unit>(Channel.CONFLATED)
+    private var frame = 0L
+    private var teleportAt = 0L
+    private var teleportFrame = 0L
+
+    /** Fetches started since creation */
+    var fetches = 0
+        private set
+
+    /** Milliseconds from the last [markTeleport] until the view was sharp, or null while it isn't yet */
+    var lastTimeToSharpMs: Long? = null
+        private set
+
+    /** A texture's coverage for the frame in progress */
+    @Synchronized
+    fun updateDemand(id: UUID, pixels: Float, desiredDiscard: Int) {
+        val entry = entries.getOrPut(id) { Entry(id) }
+        entry.pixels = pixels
+        entry.desiredDiscard = desiredDiscard
+        entry.seenFrame = frame
+    }
+
+    /** The frame's demand is complete: reprioritise waiting fetches */
+    fun endFrame() {
+        synchronized(this) {
+            val completed = frame++
+            if (teleportAt != 0L && lastTimeToSharpMs == null && completed > teleportFrame) {
+                val total = pixelsInView(sharpOnly = false)
+                if (total > 0f && pixelsInView(sharpOnly = true) >= total * SHARP_TARGET) {
+                    lastTimeToSharpMs = clock() - teleportAt
+                    logger.info { "${(SHARP_TARGET * 100).toInt()}% of screen pixels at their desired resolution $lastTimeToSharpMs ms after teleport" }
+                }
+            }
+            if (frame % SWEEP_FRAMES == 0L) entries.values.removeIf { !it.fetching && frame - it.seenFrame > SWEEP_FRAMES }
+        }
+        wake.trySend(Unit)
+    }
+
+    /** Start timing how long the new view takes to sharpen */
+    @Synchronized
+    fun markTeleport() {
+        teleportAt = clock()
+        // Demand already reported for the frame in progress may be the old view's
+        teleportFrame = frame
+        lastTimeToSharpMs = null
+    }
+
+    /**
+     * Fraction of the pixels in view in the last completed frame whose texture
+     * is at its desired level; 1 when nothing textured is in view
+     */
+    @Synchronized
+    fun sharpFraction(): Float {
+        val total = pixelsInView(sharpOnly = false)
+        return if (total > 0f) pixelsInView(sharpOnly = true) / total else 1f
+    }
+
+    // Pixels covered in the last completed frame, optionally only by textures at their desired level
+    private fun pixelsInView(sharpOnly: Boolean): Float {
+        var pixels = 0f
+        for (entry in entries.values) {
+            if (entry.seenFrame != frame - 1) continue
+            if (!sharpOnly || entry.availableDiscard <= entry.desiredDiscard) pixels += entry.pixels
+        }
+        return pixels
+    }
+
+    /** Run fetches in [scope] until it is cancelled */
+    fun start(scope: CoroutineScope): Job = scope.launch {
+        val slots = Semaphore(maxConcurrent)
+        while (isActive) {
+            slots.acquire()
+            val entry = next()
+            if (entry == null) {
+                slots.release()
+                wake.receive()
+                continue
+            }
+            launch {
+                try {
+                    fetch(entry)
+                } finally {
+                    slots.release()
+                    wake.trySend(Unit)
+                }
+            }
+        }
+    }
+
+    // The texture in view with the most pixels still short of its level
+    @Synchronized
+    private fun next(): Entry? {
+        var best: Entry? = null
+        for (entry in entries.values) {
+            if (entry.fetching || entry.availableDiscard <= entry.desiredDiscard) continue
+            if (frame - entry.seenFrame > VISIBLE_FRAMES || entry.retryFrame > frame) continue
+            if (best == null || entry.pixels > best.pixels) best = entry
+        }
+        best?.fetching = true
+        if (best != null) fetches++
+        return best
+    }
+
+    private suspend fun fetch(entry: Entry) {
+        val target = synchronized(this) { entry.desiredDiscard }
+        var available: Int? = null
+        try {
+            available = fetcher.fetch(entry.id, target)
+        } catch (e: CancellationException) {
+            throw e
+        } catch (e: Exception) {
+            logger.warn { "Texture fetch ${entry.id} failed: ${e.message}" }
+        } finally {
+            synchronized(this) {
+                entry.fetching = false
+                if (available != null) {
+                    entry.availableDiscard = minOf(entry.availableDiscard, available)
+                } else {
+                    entry.retryFrame = frame + RETRY_FRAMES
+                }
+            }
+        }
+    }
+
+    companion object {
+        const val DEFAULT_MAX_CONCURRENT = 4
+        const val SHARP_TARGET = 0.95f
+
+        // Worse than any discard level
+        private const val NOT_LOADED = Int.MAX_VALUE
+        // Textures out of view for longer than this don't get fetch slots
+        private const val VISIBLE_FRAMES = 2L
+        private const val RETRY_FRAMES = 120L
+        private const val SWEEP_FRAMES = 600L
+    }
+}
@@ -0,0 +1,185 @@
+package com.linkpoint.assets.maptiles
+
+import com.linkpoint.core.memory.MemoryBudgets
+import com.linkpoint.core.memory.MemoryPressureListener
+import mu.KotlinLogging
+import java.io.ByteArrayInputStream
+import java.io.File
+import java.io.IOException
+import javax.imageio.ImageIO
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * A decoded map tile as packed ARGB pixels, top row first
+ */
+class MapTile(val key: MapTileKey, val width: Int, val height: Int, val pixels: IntArray) {
+    val sizeBytes: Long get() = pixels.size * 4L
+}
+
+/**
+ * Turns encoded tile bytes into a [MapTile]; runs on the decode pool
+ */
+fun interface MapTileDecoder {
+    /** @return null if [bytes] isn't a readable image */
+    fun decode(key: MapTileKey, bytes: ByteArray): MapTile?
+}
+
+/**
+ * [MapTileDecoder] using javax.imageio (JPEG and PNG)
+ */
+object ImageIOMapTileDecoder : MapTileDecoder {
+    override fun decode(key: MapTileKey, bytes: ByteArray): MapTile? {
+        val image = ImageIO.read(ByteArrayInputStream(bytes)) ?: return null
+        val pixels = image.getRGB(0, 0, image.width, image.height, null, 0, image.width)
+        return MapTile(key, image.width, image.height, pixels)
+    }
+}
+
+/**
+ * Decoded tiles kept in least-recently-drawn order within a byte budget.
+ *
+ * Bytes are charged to the [MemoryBudgets.MAP_TILES] account, so going over
+ * budget or system memory pressure evicts the oldest tiles; they come back
+ * from the disk cache when next needed. Every open map shares that account;
+ * [close] takes this cache's tiles and listener back out of it.
+ */
+class MapTileMemoryCache(budgetBytes: Long) {
+    private val tiles = LinkedHashMap<MapTileKey, MapTile>(64, 0.75f, true)
+    private var bytes = 0L
+
+    private val pressureListener = MemoryPressureListener { _, bytesToFree -> evict(bytesToFree) }
+    private val account = MemoryBudgets.register(MemoryBudgets.MAP_TILES, MemoryBudgets.PRIORITY_MAP_TILES, budgetBytes)
+        .also { it.addListener(pressureListener) }
+
+    val size: Int @Synchronized get() = tiles.size
+
+    val sizeBytes: Long @Synchronized get() = bytes
+
+    /** The tile for [key], marking it recently used */
+    @Synchronized
+    fun get(key: MapTileKey): MapTile? = tiles[key]
+
+    /** Whether [key] is cached, without changing its recency */
+    @Synchronized
+    fun contains(key: MapTileKey): Boolean = tiles.containsKey(key)
+
+    fun put(tile: MapTile) {
+        synchronized(this) {
+            tiles.put(tile.key, tile)?.let {
+                bytes -= it.sizeBytes
+                account.release(it.sizeBytes)
+            }
+            bytes += tile.sizeBytes
+        }
+        // May call back into evict() if this puts the account over budget
+        account.charge(tile.sizeBytes)
+    }
+
+    /**
+     * Drop least recently used tiles until [bytesToFree] is reached
+     *
+     * @return bytes freed
+     */
+    @Synchronized
+    fun evict(bytesToFree: Long): Long {
+        var freed = 0L
+        val eldest = tiles.values.iterator()
+        while (freed < bytesToFree && eldest.hasNext()) {
+            val tile = eldest.next()
+            eldest.remove()
+            freed += tile.sizeBytes
+        }
+        bytes -= freed
+        account.release(freed)
+        return freed
+    }
+
+    @Synchronized
+    fun clear() {
+        evict(bytes)
+    }
+
+    /** Drop every tile and leave the shared account */
+    fun close() {
+        account.removeListener(pressureListener)
+        clear()
+    }
+}
+
+/**
+ * Encoded tiles on disk, least recently read evicted past [maxBytes].
+ *
+ * The recency index is built from file modification times on first use and
+ * reads touch the file, so the order survives restarts. File I/O happens
+ * outside the index lock; callers run it on the IO dispatcher.
+ */
+class MapTileDiskCache(
+    private val directory: File,
+    private val maxBytes: Long = 64L * 1024 * 1024
+) {
+    private val entries = LinkedHashMap<String, Long>(256, 0.75f, true)
+    private var bytes = 0L
+    private var indexed = false
+
+    val sizeBytes: Long @Synchronized get() = bytes
+
+    fun read(key: MapTileKey): ByteArray? {
+        val file = File(directory, fileName(key))
+        synchronized(this) {
+            index()
+            if (entries[file.name] == null) return null
+        }
+        return try {
+            file.readBytes().also { file.setLastModified(System.currentTimeMillis()) }
+        } catch (e: IOException) {
+            logger.warn { "Dropping unreadable map tile ${file.name}: ${e.message}" }
+            synchronized(this) { entries.remove(file.name)?.let { bytes -= it } }
+            null
+        }
+    }
+
+    fun write(key: MapTileKey, data: ByteArray) {
+        val file = File(directory, fileName(key))
+        try {
+            directory.mkdirs()
+            file.writeBytes(data)
+        } catch (e: IOException) {
+            logger.warn { "Failed to cache map tile ${file.name}: ${e.message}" }
+            return
+        }
+        val victims = ArrayList<String>()
+        synchronized(this) {
+            index()
+            entries.put(file.name, data.size.toLong())?.let { bytes -= it }
+            bytes += data.size
+            val eldest = entries.entries.iterator()
+            while (bytes > maxBytes && eldest.hasNext()) {
+                val entry = eldest.next()
+                if (entry.key == file.name) continue
+                eldest.remove()
+                bytes -= entry.value
+                victims += entry.key
+            }
+        }
+        victims.forEach { File(directory, it).delete() }
+    }
+
+    // Caller holds the lock
+    private fun index() {
+        if (indexed) return
+        indexed = true
+        directory.listFiles { file -> file.isFile && file.name.startsWith(PREFIX) }
+            ?.sortedBy { it.lastModified() }
+            ?.forEach { file ->
+                entries[file.name] = file.length()
+                bytes += file.length()
+            }
+    }
+
+    private fun fileName(key: MapTileKey) = "$PREFIX${key.level}-${key.x}-${key.y}"
+
+    companion object {
+        private const val PREFIX = "map-"
+    }
+}
@@ -0,0 +1,252 @@
+package com.linkpoint.assets.maptiles
+
+import com.linkpoint.assets.TextureDecodePool
+import kotlinx.coroutines.CoroutineDispatcher
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.cancel
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Semaphore
+import kotlinx.coroutines.sync.withPermit
+import kotlinx.coroutines.withContext
+import mu.KotlinLogging
+import java.io.IOException
+import java.util.concurrent.ConcurrentHashMap
+import kotlin.math.abs
+import kotlin.math.ceil
+import kotlin.math.floor
+import kotlin.math.ln
+import kotlin.math.sign
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * What a map view shows: its centre in region grid coordinates, its size on
+ * screen and its scale
+ */
+data class MapViewport(
+    val centerX: Double,
+    val centerY: Double,
+    val widthPx: Int,
+    val heightPx: Int,
+    val pixelsPerRegion: Double
+) {
+    /** The level whose tiles are drawn closest to their native size */
+    val level: Int
+        get() {
+            val regionsPerTile = MapTileKey.TILE_PIXELS / pixelsPerRegion
+            val level = 1 + floor(ln(regionsPerTile) / ln(2.0)).toInt()
+            return level.coerceIn(MapTileKey.MIN_LEVEL, MapTileKey.MAX_LEVEL)
+        }
+
+    /** Tiles at [level] that intersect the view, row by row from the north */
+    fun tiles(level: Int = this.level): List<MapTileKey> {
+        val halfWidth = widthPx / 2.0 / pixelsPerRegion
+        val halfHeight = heightPx / 2.0 / pixelsPerRegion
+        val first = MapTileKey.covering(level, regionAt(centerX - halfWidth), regionAt(centerY - halfHeight))
+        val last = MapTileKey.covering(level, regionAt(centerX + halfWidth), regionAt(centerY + halfHeight))
+        val step = first.regions
+        val keys = ArrayList<MapTileKey>()
+        for (y in last.y downTo first.y step step) {
+            for (x in first.x..last.x step step) keys += MapTileKey(level, x, y)
+        }
+        return keys
+    }
+
+    fun panned(regionsX: Double, regionsY: Double) = copy(centerX = centerX + regionsX, centerY = centerY + regionsY)
+
+    private fun regionAt(coordinate: Double) = floor(coordinate).toInt().coerceIn(0, MAX_GRID)
+
+    companion object {
+        // Grid coordinates are 20-bit region indices
+        private const val MAX_GRID = (1 shl 20) - 1
+    }
+}
+
+/**
+ * One cell of a map view and the tile to draw in it. When the cell's own tile
+ * isn't loaded yet, [tile] is a coarser ancestor and the source rectangle
+ * selects the part of it covering the cell, scaled up.
+ */
+data class MapTileDraw(
+    val cell: MapTileKey,
+    val tile: MapTile,
+    val sourceX: Float,
+    val sourceY: Float,
+    val sourceSize: Float
+) {
+    /** True while a coarser tile stands in for [cell] */
+    val isFallback: Boolean get() = tile.key != cell
+}
+
+/**
+ * World map tile pipeline: fetch, decode, cache and choose what to draw.
+ *
+ * Tiles are looked up in memory, then on disk, then fetched from the
+ * [source]; fetches are limited to [maxConcurrentFetches] and decodes run on
+ * the shared [TextureDecodePool]. [update] is called whenever the view moves:
+ * it requests the visible tiles first, then every coarser tile above them
+ * (a handful, and the reason a pan never shows a blank cell once the coarse
+ * levels are in), then the ring of tiles just beyond the edge the view is
+ * moving towards, so they are usually decoded before they scroll in.
+ * [visibleTiles] picks, for each cell, its own tile or the nearest loaded
+ * ancestor.
+ *
+ * Requests are served in issue order, so visible tiles go before prefetches.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLWorldMipmap (per-level map tiles with coarser
+ *   fallbacks) and LLWorldMapView
+ * - Slippy map tile prefetching in web map clients
+ */
+class MapTileManager(
+    private val source: MapTileSource,
+    private val diskCache: MapTileDiskCache? = null,
+    memoryBudgetBytes: Long = DEFAULT_MEMORY_BUDGET,
+    private val decoder: MapTileDecoder = ImageIOMapTileDecoder,
+    private val decodeDispatcher: CoroutineDispatcher = TextureDecodePool.dispatcher,
+    maxConcurrentFetches: Int = 6,
+    private val scope: CoroutineScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+) {
+    val memory = MapTileMemoryCache(memoryBudgetBytes)
+
+    private val loading = ConcurrentHashMap<MapTileKey, Job>()
+    // Tiles the grid doesn't have, so open water isn't refetched on every pan
+    private val missing = ConcurrentHashMap.newKeySet<MapTileKey>()
+    private val fetchPermits = Semaphore(maxConcurrentFetches)
+
+    @Volatile
+    private var lastViewport: MapViewport? = null
+
+    /** Tiles currently being loaded */
+    val pending: Int get() = loading.size
+
+    /** The decoded tile for [key] if it's in memory */
+    fun tile(key: MapTileKey): MapTile? = memory.get(key)
+
+    /**
+     * Start loading [key] unless it is cached, already loading or known missing
+     *
+     * @return the load, or null if there is nothing to do
+     */
+    fun request(key: MapTileKey): Job? {
+        if (memory.contains(key) || key in missing) return null
+        loading[key]?.let { return it }
+        val job = scope.launch(start = CoroutineStart.LAZY) { load(key) }
+        loading.putIfAbsent(key, job)?.let {
+            job.cancel()
+            return it
+        }
+        job.invokeOnCompletion { loading.remove(key, job) }
+        job.start()
+        return job
+    }
+
+    /**
+     * Request what [viewport] needs and prefetch ahead of its motion since
+     * the previous call
+     */
+    fun update(viewport: MapViewport) {
+        val level = viewport.level
+        val visible = viewport.tiles(level)
+        visible.forEach { request(it) }
+        requestAncestors(visible)
+
+        val previous = lastViewport
+        lastViewport = viewport
+        if (previous == null || previous.level != level) return
+        val dx = viewport.centerX - previous.centerX
+        val dy = viewport.centerY - previous.centerY
+        if (dx == 0.0 && dy == 0.0) return
+
+        // Look one tile ahead, or as far as the last move went if it was faster
+        val step = (1 shl (level - 1)).toDouble()
+        val aheadX = sign(dx) * step * ceil(abs(dx) / step).coerceIn(1.0, MAX_LOOKAHEAD_TILES)
+        val aheadY = sign(dy) * step * ceil(abs(dy) / step).coerceIn(1.0, MAX_LOOKAHEAD_TILES)
+        // The leading edge, and the leading corner when moving diagonally
+        val ring = LinkedHashSet<MapTileKey>()
+        if (dx != 0.0) ring += viewport.panned(aheadX, 0.0).tiles(level)
+        if (dy != 0.0) ring += viewport.panned(0.0, aheadY).tiles(level)
+        if (dx != 0.0 && dy != 0.0) ring += viewport.panned(aheadX, aheadY).tiles(level)
+        ring.removeAll(visible.toSet())
+        ring.forEach { request(it) }
+        requestAncestors(ring.toList())
+    }
+
+    /**
+     * What to draw for each cell of [viewport], skipping cells with nothing
+     * loaded at any level. Also marks the drawn tiles as recently used.
+     */
+    fun visibleTiles(viewport: MapViewport): List<MapTileDraw> {
+        val cells = viewport.tiles()
+        val draws = ArrayList<MapTileDraw>(cells.size)
+        for (cell in cells) {
+            val tile = memory.get(cell) ?: cell.ancestors().firstNotNullOfOrNull { memory.get(it) } ?: continue
+            // Pixels per region in the tile actually drawn; image rows run north to south
+            val scale = tile.width.toFloat() / tile.key.regions
+            draws += MapTileDraw(
+                cell = cell,
+                tile = tile,
+                sourceX = (cell.x - tile.key.x) * scale,
+                sourceY = (tile.key.y + tile.key.regions - cell.y - cell.regions) * scale,
+                sourceSize = cell.regions * scale
+            )
+        }
+        return draws
+    }
+
+    /** Wait for every load started so far, e.g. in tests */
+    suspend fun awaitIdle() {
+        while (true) {
+            val jobs = loading.values.toList()
+            if (jobs.isEmpty()) return
+            jobs.forEach { it.join() }
+        }
+    }
+
+    fun shutdown() {
+        scope.cancel()
+        memory.close()
+    }
+
+    private fun requestAncestors(tiles: List<MapTileKey>) {
+        val seen = HashSet<MapTileKey>()
+        for (tile in tiles) {
+            for (ancestor in tile.ancestors()) {
+                if (!seen.add(ancestor)) break
+                // Touch cached ancestors so the LRU keeps the fallbacks for this view
+                if (memory.get(ancestor) == null) request(ancestor)
+            }
+        }
+    }
+
+    private suspend fun load(key: MapTileKey) {
+        try {
+            val bytes = diskCache?.read(key)
+                ?: fetchPermits.withPermit { source.fetch(key) }?.also { diskCache?.write(key, it) }
+            if (bytes == null) {
+                missing += key
+                return
+            }
+            val tile = withContext(decodeDispatcher) { decoder.decode(key, bytes) }
+            if (tile == null) {
+                logger.warn { "Undecodable map tile $key" }
+                missing += key
+                return
+            }
+            memory.put(tile)
+        } catch (e: IOException) {
+            // Not marked missing: the next update retries it
+            logger.warn { "Failed to load map tile $key: ${e.message}" }
+        }
+    }
+
+    companion object {
+        // 256x256 ARGB tiles are 256 KiB each, so about 128 tiles
+        const val DEFAULT_MEMORY_BUDGET = 32L * 1024 * 1024
+        private const val MAX_LOOKAHEAD_TILES = 3.0
+    }
+}
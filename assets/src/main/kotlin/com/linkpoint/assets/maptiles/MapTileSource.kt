@@ -0,0 +1,109 @@
+package com.linkpoint.assets.maptiles
+
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.withContext
+import java.awt.image.BufferedImage
+import java.io.ByteArrayOutputStream
+import java.io.IOException
+import java.net.HttpURLConnection
+import java.net.URL
+import java.util.concurrent.atomic.AtomicInteger
+import javax.imageio.ImageIO
+
+/**
+ * One world map tile. Level 1 tiles show a single region; a level n tile
+ * shows 2^(n-1) x 2^(n-1) regions and sits at grid coordinates aligned to
+ * that size. Grid y grows northwards.
+ */
+data class MapTileKey(val level: Int, val x: Int, val y: Int) {
+    init {
+        require(level in MIN_LEVEL..MAX_LEVEL) { "Map tile level $level out of range" }
+    }
+
+    /** Regions along each edge of the tile */
+    val regions: Int get() = 1 shl (level - 1)
+
+    /** The next coarser tile containing this one, or null at [MAX_LEVEL] */
+    fun parent(): MapTileKey? = if (level == MAX_LEVEL) null else covering(level + 1, x, y)
+
+    /** Coarser tiles containing this one, nearest first */
+    fun ancestors(): Sequence<MapTileKey> = generateSequence(parent()) { it.parent() }
+
+    companion object {
+        const val MIN_LEVEL = 1
+        const val MAX_LEVEL = 8
+        const val TILE_PIXELS = 256
+
+        /** The tile at [level] containing region ([regionX], [regionY]) */
+        fun covering(level: Int, regionX: Int, regionY: Int): MapTileKey {
+            val mask = ((1 shl (level - 1)) - 1).inv()
+            return MapTileKey(level, regionX and mask, regionY and mask)
+        }
+    }
+}
+
+/**
+ * Fetches encoded map tile images
+ */
+fun interface MapTileSource {
+    /**
+     * @return the encoded image, or null if the grid has no tile there (open water)
+     */
+    suspend fun fetch(key: MapTileKey): ByteArray?
+}
+
+/**
+ * [MapTileSource] for the grid's map tile server, run on the IO dispatcher
+ */
+class HttpMapTileSource(
+    private val baseUrl: String = DEFAULT_BASE_URL,
+    private val timeoutMs: Int = 15_000
+) : MapTileSource {
+
+    override suspend fun fetch(key: MapTileKey): ByteArray? = withContext(Dispatchers.IO) {
+        val url = URL("$baseUrl/map-${key.level}-${key.x}-${key.y}-objects.jpg")
+        val connection = url.openConnection() as HttpURLConnection
+        try {
+            connection.connectTimeout = timeoutMs
+            connection.readTimeout = timeoutMs
+            when (connection.responseCode) {
+                in 200..299 -> connection.inputStream.use { it.readBytes() }
+                HttpURLConnection.HTTP_NOT_FOUND, HttpURLConnection.HTTP_FORBIDDEN -> null
+                else -> throw IOException("HTTP ${connection.responseCode} from $url")
+            }
+        } finally {
+            connection.disconnect()
+        }
+    }
+
+    companion object {
+        const val DEFAULT_BASE_URL = "https://secondlife-maps-cdn.akamaized.net"
+    }
+}
+
+/**
+ * Stand-in tile server for development and tests: every tile exists and is
+ * a PNG shaded by its position, served after [latencyMs]
+ */
+class LocalMapTileSource(
+    private val latencyMs: Long = 0,
+    private val tilePixels: Int = 64
+) : MapTileSource {
+    private val fetchCount = AtomicInteger()
+
+    /** Tiles served so far */
+    val fetches: Int get() = fetchCount.get()
+
+    override suspend fun fetch(key: MapTileKey): ByteArray {
+        if (latencyMs > 0) delay(latencyMs)
+        fetchCount.incrementAndGet()
+        val image = BufferedImage(tilePixels, tilePixels, BufferedImage.TYPE_INT_RGB)
+        val rgb = ((key.x * 37) and 0xFF shl 16) or ((key.y * 53) and 0xFF shl 8) or (key.level * 31 and 0xFF)
+        for (py in 0 until tilePixels) for (px in 0 until tilePixels) image.setRGB(px, py, rgb)
+        return ByteArrayOutputStream().use { out ->
+            ImageIO.write(image, "png", out)
+            out.toByteArray()
+        }
+    }
+}
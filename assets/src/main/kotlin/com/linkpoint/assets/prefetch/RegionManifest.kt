@@ -0,0 +1,119 @@
+package com.linkpoint.assets.prefetch
+
+import mu.KotlinLogging
+import java.io.DataInputStream
+import java.io.DataOutputStream
+import java.io.File
+import java.io.IOException
+import java.nio.file.Files
+import java.nio.file.StandardCopyOption
+import java.util.UUID
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * What a region needed last time: its objects, and the textures and meshes
+ * they use. [textureWeights] ranks textures by the screen coverage they had
+ * during earlier visits, most first; [meshes] are in order of first use
+ */
+class RegionManifest(
+    val regionHandle: Long,
+    val recordedAt: Long,
+    val objects: List<UUID>,
+    val textureWeights: Map<UUID, Float>,
+    val meshes: List<UUID>
+) {
+    /** Textures most covered first */
+    val textures: List<UUID> get() = textureWeights.entries.sortedByDescending { it.value }.map { it.key }
+}
+
+/**
+ * One small binary file per region, written when the agent leaves it and
+ * read on a teleport intent towards it.
+ *
+ * Layout (big-endian): magic, format version, region handle, recording
+ * time, the three counts, then object ids, textures (id and weight) and mesh
+ * ids. Lists are capped so a manifest stays a few tens of kilobytes even
+ * for the busiest regions; the least covered textures go first.
+ */
+class RegionManifestStore(
+    private val directory: File,
+    private val maxObjects: Int = DEFAULT_MAX_OBJECTS,
+    private val maxTextures: Int = DEFAULT_MAX_TEXTURES,
+    private val maxMeshes: Int = DEFAULT_MAX_MESHES
+) {
+    fun load(regionHandle: Long): RegionManifest? {
+        val file = fileFor(regionHandle)
+        if (!file.isFile) return null
+        return try {
+            DataInputStream(file.inputStream().buffered()).use { input ->
+                if (input.readInt() != MAGIC || input.readInt() != FORMAT_VERSION) return null
+                val handle = input.readLong()
+                val recordedAt = input.readLong()
+                val objectCount = input.readInt()
+                val textureCount = input.readInt()
+                val meshCount = input.readInt()
+                val objects = List(objectCount) { UUID(input.readLong(), input.readLong()) }
+                val textures = LinkedHashMap<UUID, Float>(textureCount * 2)
+                repeat(textureCount) { textures[UUID(input.readLong(), input.readLong())] = input.readFloat() }
+                val meshes = List(meshCount) { UUID(input.readLong(), input.readLong()) }
+                RegionManifest(handle, recordedAt, objects, textures, meshes)
+            }
+        } catch (e: IOException) {
+            logger.warn { "Dropping unreadable region manifest ${file.name}: ${e.message}" }
+            file.delete()
+            null
+        }
+    }
+
+    fun save(manifest: RegionManifest) {
+        val file = fileFor(manifest.regionHandle)
+        val temp = File(directory, "${file.name}.tmp")
+        val objects = manifest.objects.take(maxObjects)
+        val textures = manifest.textureWeights.entries.sortedByDescending { it.value }.take(maxTextures)
+        val meshes = manifest.meshes.take(maxMeshes)
+        try {
+            directory.mkdirs()
+            DataOutputStream(temp.outputStream().buffered()).use { out ->
+                out.writeInt(MAGIC)
+                out.writeInt(FORMAT_VERSION)
+                out.writeLong(manifest.regionHandle)
+                out.writeLong(manifest.recordedAt)
+                out.writeInt(objects.size)
+                out.writeInt(textures.size)
+                out.writeInt(meshes.size)
+                objects.forEach { out.writeUuid(it) }
+                textures.forEach { (id, weight) ->
+                    out.writeUuid(id)
+                    out.writeFloat(weight)
+                }
+                meshes.forEach { out.writeUuid(it) }
+            }
+            Files.move(temp.toPath(), file.toPath(), StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE)
+        } catch (e: IOException) {
+            logger.warn { "Failed to write region manifest ${file.name}: ${e.message}" }
+            temp.delete()
+        }
+    }
+
+    private fun DataOutputStream.writeUuid(id: UUID) {
+        writeLong(id.mostSignificantBits)
+        writeLong(id.leastSignificantBits)
+    }
+
+    private fun fileFor(regionHandle: Long) = File(directory, "region-${java.lang.Long.toHexString(regionHandle)}.lpm")
+
+    companion object {
+        const val DEFAULT_MAX_OBJECTS = 8192
+        const val DEFAULT_MAX_TEXTURES = 1024
+        const val DEFAULT_MAX_MESHES = 512
+        private const val MAGIC = 0x4C50524D // "LPRM"
+        private const val FORMAT_VERSION = 1
+
+        /** Region handle of the region at grid coordinates ([gridX], [gridY]) */
+        fun regionHandle(gridX: Int, gridY: Int): Long =
+            (gridX.toLong() * REGION_METRES shl 32) or (gridY.toLong() * REGION_METRES)
+
+        private const val REGION_METRES = 256L
+    }
+}
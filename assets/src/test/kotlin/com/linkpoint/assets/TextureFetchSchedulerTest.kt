@@ -0,0 +1,133 @@
+package com.linkpoint.assets
+
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.test.runTest
+import java.util.UUID
+import kotlin.math.sqrt
+import kotlin.random.Random
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNotNull
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+/**
+ * Tests for coverage-ordered texture fetching after a teleport
+ */
+class TextureFetchSchedulerTest {
+
+    private class Texture(val id: UUID, val pixels: Float) {
+        val discard = desiredDiscard(pixels)
+    }
+
+    // A view after arrival: a few walls and floors fill the screen, most textures are small
+    private val view: List<Texture> = Random(11).let { random ->
+        List(10) { Texture(UUID.randomUUID(), 50_000f + random.nextFloat() * 150_000f) } +
+            List(40) { Texture(UUID.randomUUID(), 2_000f + random.nextFloat() * 18_000f) } +
+            List(250) { Texture(UUID.randomUUID(), 10f + random.nextFloat() * 990f) }
+    }.shuffled(Random(5))
+
+    @Test
+    fun `should sharpen most of the screen well before first-seen order`() = runTest {
+        val scheduler = TextureFetchScheduler({ id, discard ->
+            delay(fetchMs(discard))
+            discard
+        }, clock = { testScheduler.currentTime })
+        scheduler.start(backgroundScope)
+        scheduler.markTeleport()
+
+        var frames = 0
+        while (scheduler.lastTimeToSharpMs == null && frames < 1000) {
+            view.forEach { scheduler.updateDemand(it.id, it.pixels, it.discard) }
+            scheduler.endFrame()
+            delay(16)
+            frames++
+        }
+        val byCoverage = assertNotNull(scheduler.lastTimeToSharpMs)
+        val firstSeen = firstSeenOrderMs()
+        assertTrue(byCoverage < firstSeen * 0.7, "95% sharp after $byCoverage ms by coverage, $firstSeen ms in first-seen order")
+    }
+
+    @Test
+    fun `should refetch finer when a texture comes closer`() = runTest {
+        val fetched = ArrayList<Int>()
+        val scheduler = TextureFetchScheduler({ _, discard -> fetched += discard; discard })
+        scheduler.start(backgroundScope)
+        val id = UUID.randomUUID()
+
+        listOf(400f, 400f, 200_000f, 200_000f).forEach { pixels ->
+            scheduler.updateDemand(id, pixels, desiredDiscard(pixels))
+            scheduler.endFrame()
+            delay(16)
+        }
+        assertEquals(listOf(5, 1), fetched)
+        assertEquals(1f, scheduler.sharpFraction())
+    }
+
+    @Test
+    fun `should time a teleport from the new view, not the old or an empty one`() = runTest {
+        val scheduler = TextureFetchScheduler({ _, discard -> discard }, clock = { testScheduler.currentTime })
+        scheduler.start(backgroundScope)
+        val before = UUID.randomUUID()
+        val after = UUID.randomUUID()
+
+        // The region being left is already sharp
+        scheduler.updateDemand(before, 10_000f, 2)
+        scheduler.endFrame()
+        delay(16)
+
+        // Marked after the frame reported the old view, then nothing in view while the region loads
+        scheduler.updateDemand(before, 10_000f, 2)
+        scheduler.markTeleport()
+        repeat(4) {
+            scheduler.endFrame()
+            delay(16)
+        }
+        assertNull(scheduler.lastTimeToSharpMs)
+        assertEquals(1f, scheduler.sharpFraction(), "An empty view has nothing blurry in it")
+
+        // The new view: fetched during the first frame, sharp in the second
+        repeat(2) {
+            scheduler.updateDemand(after, 10_000f, 2)
+            scheduler.endFrame()
+            delay(16)
+        }
+        assertEquals(16L * 5, scheduler.lastTimeToSharpMs)
+    }
+
+    // The same fetches, [DEFAULT_MAX_CONCURRENT] at a time in the order the textures were first seen
+    private fun firstSeenOrderMs(): Long {
+        val slots = LongArray(TextureFetchScheduler.DEFAULT_MAX_CONCURRENT)
+        val done = view.map { texture ->
+            val slot = slots.indices.minByOrNull { slots[it] }!!
+            slots[slot] += fetchMs(texture.discard)
+            slots[slot] to texture.pixels
+        }.sortedBy { it.first }
+        val total = view.sumOf { it.pixels.toDouble() }
+        var sharp = 0.0
+        for ((at, pixels) in done) {
+            sharp += pixels
+            if (sharp >= total * TextureFetchScheduler.SHARP_TARGET) return at
+        }
+        return done.last().first
+    }
+
+    companion object {
+        // 40 ms round trip plus the level's bytes at ~4 Mbit/s, about 0.5 byte per texel
+        fun fetchMs(discard: Int): Long {
+            val side = 1024L shr discard
+            return 40 + side * side / 2 / 500
+        }
+
+        fun desiredDiscard(pixels: Float): Int {
+            val side = sqrt(pixels)
+            var size = 1024
+            var discard = 0
+            while (discard < 5 && size / 2 >= side) {
+                size /= 2
+                discard++
+            }
+            return discard
+        }
+    }
+}
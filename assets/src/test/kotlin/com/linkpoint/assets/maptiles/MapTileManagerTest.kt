@@ -0,0 +1,73 @@
+package com.linkpoint.assets.maptiles
+
+import com.linkpoint.core.memory.MemoryBudgets
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.runBlocking
+import java.nio.file.Files
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for map tile fallback, pan prefetch and the disk tier
+ */
+class MapTileManagerTest {
+
+    private val directory = Files.createTempDirectory("maptiles").toFile()
+
+    private fun manager(source: MapTileSource) =
+        MapTileManager(source, MapTileDiskCache(directory), decodeDispatcher = Dispatchers.Default)
+
+    @Test
+    fun `should never leave a cell blank while panning`() = runBlocking<Unit> {
+        val tiles = manager(LocalMapTileSource())
+        var view = MapViewport(1000.5, 1000.5, widthPx = 800, heightPx = 600, pixelsPerRegion = 64.0)
+        assertEquals(3, view.level)
+        tiles.update(view)
+        tiles.awaitIdle()
+
+        repeat(40) { frame ->
+            view = view.panned(2.0, 0.5)
+            tiles.update(view)
+            val draws = tiles.visibleTiles(view)
+            assertEquals(view.tiles().size, draws.size, "Every cell is drawn on frame $frame")
+            if (frame > 0) {
+                assertTrue(draws.none { it.isFallback }, "The leading ring was prefetched by frame $frame")
+            }
+            tiles.awaitIdle()
+        }
+        tiles.shutdown()
+        directory.deleteRecursively()
+    }
+
+    @Test
+    fun `should draw coarse parents while children load and serve repeats from disk`() = runBlocking<Unit> {
+        val source = LocalMapTileSource(latencyMs = 200)
+        val tiles = manager(source)
+        val overview = MapViewport(1000.5, 1000.5, widthPx = 800, heightPx = 600, pixelsPerRegion = 8.0)
+        tiles.update(overview)
+        tiles.awaitIdle()
+
+        val closeUp = overview.copy(pixelsPerRegion = 64.0)
+        tiles.update(closeUp)
+        val draws = tiles.visibleTiles(closeUp)
+        assertEquals(closeUp.tiles().size, draws.size)
+        assertTrue(draws.all { it.isFallback && it.tile.key.level == overview.level })
+        // A 4-region cell is an eighth of a 32-region, 64-pixel parent
+        assertEquals(8f, draws.first().sourceSize)
+
+        tiles.awaitIdle()
+        assertTrue(tiles.visibleTiles(closeUp).none { it.isFallback })
+        tiles.shutdown()
+        assertEquals(0L, MemoryBudgets.account(MemoryBudgets.MAP_TILES)?.liveBytes, "Shutdown returns the tiles' bytes")
+
+        val fetched = source.fetches
+        val restarted = manager(source)
+        restarted.update(closeUp)
+        restarted.awaitIdle()
+        assertEquals(fetched, source.fetches, "A fresh memory tier refills from disk")
+        assertTrue(restarted.visibleTiles(closeUp).none { it.isFallback })
+        restarted.shutdown()
+        directory.deleteRecursively()
+    }
+}
@@ -3,12 +3,19 @@ package com.linkpoint.audio
 import com.linkpoint.assets.AssetManager
 import com.linkpoint.core.events.EventSystem
 import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.core.memory.MemoryBudgets
+import com.linkpoint.core.memory.MemoryPressureLevel
+import com.linkpoint.core.memory.MemoryPressureListener
+import com.linkpoint.core.memory.TrackingAllocator
+import com.linkpoint.core.profiling.Profiler
 import com.linkpoint.protocol.data.SimpleWorldEntities.Vector3
 import kotlinx.coroutines.*
 import kotlinx.coroutines.flow.*
 import java.util.concurrent.ConcurrentHashMap
 import kotlin.math.*
 
+private val ZONE_AUDIO_FRAME = Profiler.zone("Audio/ProcessFrame")
+
 /**
  * AudioSystem - Complete 3D positional audio system imported from SecondLife viewer's llaudioengine.cpp
  * 
@@ -40,15 +47,28 @@ class AudioSystem(
     private var listenerVelocity = Vector3(0f, 0f, 0f)
     private var listenerForward = Vector3(1f, 0f, 0f)
     private var listenerUp = Vector3(0f, 0f, 1f)
+    private var listenerRight = Vector3(0f, -1f, 0f) // forward x up, cached per listener update
     
     // Active sound sources with 3D positioning
     private val soundSources = ConcurrentHashMap<String, SoundSource>()
+    private val finishedScratch = ArrayList<String>() // audio loop only
     private val audioChannels = ConcurrentHashMap<String, AudioChannel>()
     
     // Audio settings and performance monitoring
     private val audioSettings = AudioSettings()
     private val audioStats = AudioStats()
     
+    // Decoded PCM per playing source; this is what actually occupies memory,
+    // not the compressed asset bytes
+    private val pcmBuffers = ConcurrentHashMap<String, ByteArray>()
+    private val pcmAllocator = TrackingAllocator(
+        MemoryBudgets.register(
+            MemoryBudgets.AUDIO_PCM,
+            MemoryBudgets.PRIORITY_AUDIO,
+            listener = MemoryPressureListener { level, bytes -> shedAudioMemory(level, bytes) }
+        )
+    )
+    
     init {
         startAudioProcessing()
         subscribeToEvents()
@@ -70,7 +90,9 @@ class AudioSystem(
         var rolloffFactor: Float = 1.0f,
         var isPlaying: Boolean = false,
         var startTime: Long = System.currentTimeMillis(),
-        val type: SoundType = SoundType.EFFECT
+        val type: SoundType = SoundType.EFFECT,
+        var pan: Float = 0.0f,        // -1.0 (left) to 1.0 (right)
+        var frontGain: Float = 1.0f   // 0.0 (behind) to 1.0 (in front)
     )
     
     /**
@@ -141,7 +163,7 @@ class AudioSystem(
     data class AudioStats(
         var activeSources: Int = 0,
         var totalSources: Int = 0,
-        var audioMemoryUsage: Long = 0,
+        var audioMemoryUsage: Long = 0,     // Live decoded PCM bytes
         var averageLatency: Float = 0.0f,
         var droppedFrames: Int = 0,
         var processingLoad: Float = 0.0f
@@ -237,6 +259,7 @@ class AudioSystem(
                 eventSystem.emit(ViewerEvent.SoundStarted(sourceId, soundUuid))
             } else {
                 soundSources.remove(sourceId)
+                releasePcm(sourceId)
                 eventSystem.emit(ViewerEvent.SoundFailed(sourceId, "Asset not found"))
             }
         }
@@ -251,6 +274,7 @@ class AudioSystem(
         soundSources[sourceId]?.let { source ->
             source.isPlaying = false
             soundSources.remove(sourceId)
+            releasePcm(sourceId)
             audioStats.activeSources = soundSources.count { it.value.isPlaying }
             
             eventSystem.emit(ViewerEvent.SoundStopped(sourceId))
@@ -270,6 +294,7 @@ class AudioSystem(
         listenerVelocity = velocity
         listenerForward = forward.normalize()
         listenerUp = up.normalize()
+        listenerRight = listenerForward.cross(listenerUp).normalize()
         
         // Update all active sounds with new listener position
         updateAllSounds()
@@ -310,6 +335,17 @@ class AudioSystem(
         eventSystem.emit(ViewerEvent.VolumeChanged(type.name, clampedVolume))
     }
     
+    /**
+     * Change output quality at runtime, e.g. from the device quality controller;
+     * takes effect from the next processed frame
+     */
+    fun setAudioQuality(quality: AudioQuality) {
+        if (quality == audioSettings.audioQuality) return
+        audioSettings.audioQuality = quality
+        audioSettings.sampleRate = quality.sampleRate
+        audioSettings.audioBufferSize = quality.bufferSize
+    }
+    
     /**
      * Mute/unmute audio system
      */
@@ -329,7 +365,7 @@ class AudioSystem(
     /**
      * Get current audio statistics
      */
-    fun getAudioStats(): AudioStats = audioStats.copy()
+    fun getAudioStats(): AudioStats = audioStats.copy(audioMemoryUsage = pcmAllocator.account.liveBytes)
     
     /**
      * Get current audio settings
@@ -390,25 +426,28 @@ class AudioSystem(
     /**
      * Process a single audio frame for all active sources
      */
-    private suspend fun processAudioFrame() {
-        val activeSources = soundSources.values.filter { it.isPlaying }
-        audioStats.activeSources = activeSources.size
-        
+    private suspend fun processAudioFrame(): Unit = Profiler.scope(ZONE_AUDIO_FRAME) {
         // Calculate processing load
         val startTime = System.nanoTime()
-        
-        // Update all active sound parameters
-        activeSources.forEach { source ->
+        val now = System.currentTimeMillis()
+        
+        // Update all active sound parameters, collecting finished non-looping sounds
+        // into a list reused across frames
+        var activeCount = 0
+        finishedScratch.clear()
+        for (source in soundSources.values) {
+            if (!source.isPlaying) continue
+            activeCount++
             updateSoundParameters(source)
+            if (!source.loop && (now - source.startTime) > 10000) { // 10 second max for demo
+                finishedScratch.add(source.uuid)
+            }
         }
+        audioStats.activeSources = activeCount
         
         // Remove finished non-looping sounds
-        val finishedSources = activeSources.filter { source ->
-            !source.loop && (System.currentTimeMillis() - source.startTime) > 10000 // 10 second max for demo
-        }
-        
-        finishedSources.forEach { source ->
-            stopSound(source.uuid)
+        for (i in finishedScratch.indices) {
+            stopSound(finishedScratch[i])
         }
         
         val endTime = System.nanoTime()
@@ -424,7 +463,7 @@ class AudioSystem(
         // Calculate 3D audio parameters
         val distance = calculateDistance(listenerPosition, source.position)
         val volume = calculateVolumeAttenuation(source, distance)
-        val panAndGain = calculate3DPanning(source.position)
+        calculate3DPanning(source)
         val dopplerPitch = calculateDopplerEffect(source)
         
         // Apply environmental effects
@@ -445,8 +484,8 @@ class AudioSystem(
      * Update all active sounds (called when listener moves)
      */
     private fun updateAllSounds() {
-        soundSources.values.filter { it.isPlaying }.forEach { source ->
-            updateSoundParameters(source)
+        for (source in soundSources.values) {
+            if (source.isPlaying) updateSoundParameters(source)
         }
     }
     
@@ -473,29 +512,31 @@ class AudioSystem(
     }
     
     /**
-     * Calculate 3D panning and gain for stereo/surround positioning
+     * Calculate 3D panning and gain for stereo/surround positioning.
+     * Runs per source per audio frame, so the vector math is done in scalars.
      */
-    private fun calculate3DPanning(sourcePosition: Vector3): Pair<Float, Float> {
+    private fun calculate3DPanning(source: SoundSource) {
         // Vector from listener to source
-        val direction = Vector3(
-            sourcePosition.x - listenerPosition.x,
-            sourcePosition.y - listenerPosition.y,
-            sourcePosition.z - listenerPosition.z
-        ).normalize()
+        var dx = source.position.x - listenerPosition.x
+        var dy = source.position.y - listenerPosition.y
+        var dz = source.position.z - listenerPosition.z
+        val length = sqrt(dx * dx + dy * dy + dz * dz)
+        if (length > 0) {
+            dx /= length
+            dy /= length
+            dz /= length
+        }
         
-        // Calculate angle relative to listener's forward direction
-        val dotProduct = listenerForward.dot(direction)
-        val angle = acos(dotProduct.coerceIn(-1.0f, 1.0f))
+        // Alignment with the listener's forward direction
+        val forward = listenerForward
+        val dotProduct = forward.x * dx + forward.y * dy + forward.z * dz
         
         // Calculate left/right panning (-1.0 to 1.0)
-        val rightVector = listenerForward.cross(listenerUp).normalize()
-        val rightDot = rightVector.dot(direction)
-        val pan = rightDot.coerceIn(-1.0f, 1.0f)
+        val right = listenerRight
+        source.pan = (right.x * dx + right.y * dy + right.z * dz).coerceIn(-1.0f, 1.0f)
         
         // Calculate front/back gain (0.0 to 1.0)
-        val frontGain = (dotProduct + 1.0f) * 0.5f
-        
-        return pan to frontGain
+        source.frontGain = (dotProduct.coerceIn(-1.0f, 1.0f) + 1.0f) * 0.5f
     }
     
     /**
@@ -508,7 +549,10 @@ class AudioSystem(
         val speedOfSound = 343.0f
         
         // Calculate relative velocity
-        val relativeVelocity = (source.velocity - listenerVelocity).magnitude()
+        val vx = source.velocity.x - listenerVelocity.x
+        val vy = source.velocity.y - listenerVelocity.y
+        val vz = source.velocity.z - listenerVelocity.z
+        val relativeVelocity = sqrt(vx * vx + vy * vy + vz * vz)
         
         // Calculate Doppler shift
         val dopplerFactor = speedOfSound / (speedOfSound + relativeVelocity)
@@ -555,7 +599,37 @@ class AudioSystem(
         // Simulate audio processing
         delay(50)
         
-        audioStats.audioMemoryUsage += asset.data.size
+        // Sample assets already hold 16-bit PCM; a real decoder would size this from
+        // the stream's duration, sample rate and channel count
+        val pcm = pcmAllocator.copyOf(asset.data)
+        pcmBuffers.put(sourceId, pcm)?.let { pcmAllocator.release(it) }
+        
+        // The source may have been stopped while we were decoding
+        if (!soundSources.containsKey(sourceId)) releasePcm(sourceId)
+    }
+    
+    /**
+     * Drop the decoded PCM for a source and credit its bytes back
+     */
+    private fun releasePcm(sourceId: String) {
+        pcmBuffers.remove(sourceId)?.let { pcmAllocator.release(it) }
+    }
+    
+    /**
+     * Memory pressure handler: stop the quietest non-UI sounds first until enough
+     * PCM has been released. Critical pressure stops everything but voice.
+     */
+    private fun shedAudioMemory(level: MemoryPressureLevel, bytesToFree: Long): Long {
+        val before = pcmAllocator.account.liveBytes
+        val victims = soundSources.values
+            .filter { it.type != SoundType.VOICE && (level == MemoryPressureLevel.CRITICAL || it.type != SoundType.UI) }
+            .sortedBy { it.volume }
+        
+        for (source in victims) {
+            if (level != MemoryPressureLevel.CRITICAL && before - pcmAllocator.account.liveBytes >= bytesToFree) break
+            stopSound(source.uuid)
+        }
+        return before - pcmAllocator.account.liveBytes
     }
     
     /**
@@ -601,6 +675,7 @@ class AudioSystem(
             source.isPlaying = false
         }
         soundSources.clear()
+        pcmBuffers.keys.toList().forEach { releasePcm(it) }
         
         // Cancel processing
         scope.cancel()
@@ -620,18 +695,12 @@ private fun Vector3.normalize(): Vector3 {
     return if (length > 0) Vector3(x / length, y / length, z / length) else this
 }
 
-private fun Vector3.dot(other: Vector3): Float = x * other.x + y * other.y + z * other.z
-
 private fun Vector3.cross(other: Vector3): Vector3 = Vector3(
     y * other.z - z * other.y,
     z * other.x - x * other.z,
     x * other.y - y * other.x
 )
 
-private fun Vector3.magnitude(): Float = sqrt(x * x + y * y + z * z)
-
-private operator fun Vector3.minus(other: Vector3): Vector3 = Vector3(x - other.x, y - other.y, z - other.z)
-
 /**
  * Audio-related viewer events for the event system
  */
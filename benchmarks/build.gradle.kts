@@ -0,0 +1,70 @@
+plugins {
+    kotlin("jvm")
+    application
+    id("me.champeau.jmh") version "0.7.1"
+}
+
+application {
+    mainClass.set("com.linkpoint.benchmarks.BenchmarkComparatorKt")
+}
+
+dependencies {
+    // Comparison tool
+    implementation("org.jetbrains.kotlin:kotlin-stdlib")
+    implementation("com.fasterxml.jackson.module:jackson-module-kotlin:2.15.2")
+    
+    // Modules under benchmark
+    jmhImplementation(project(":core"))
+    jmhImplementation(project(":protocol"))
+    jmhImplementation(project(":graphics"))
+    jmhImplementation(project(":ui"))
+    jmhImplementation(project(":audio"))
+    jmhImplementation(project(":assets"))
+    jmhImplementation("org.jetbrains.kotlinx:kotlinx-coroutines-core:1.6.4")
+    
+    testImplementation("org.jetbrains.kotlin:kotlin-test")
+    testImplementation("org.jetbrains.kotlin:kotlin-test-junit5")
+    testImplementation("org.junit.jupiter:junit-jupiter:5.10.0")
+}
+
+tasks.test {
+    useJUnitPlatform()
+}
+
+jmh {
+    jmhVersion.set("1.37")
+    warmupIterations.set(3)
+    iterations.set(5)
+    fork.set(1)
+    resultFormat.set("JSON")
+    resultsFile.set(layout.buildDirectory.file("results/jmh/results.json"))
+    // Optional subset, e.g. ./gradlew :benchmarks:jmh -PjmhInclude=PacketDecode
+    (findProperty("jmhInclude") as String?)?.let { includes.set(listOf(it)) }
+}
+
+/**
+ * Compare the latest JMH results against the stored baseline and fail on regressions.
+ * Threshold is a percentage, default 10: ./gradlew :benchmarks:compareBenchmarks -Pthreshold=5
+ */
+tasks.register<JavaExec>("compareBenchmarks") {
+    group = "verification"
+    description = "Flags JMH regressions against benchmarks/baseline/jmh-baseline.json"
+    classpath = sourceSets["main"].runtimeClasspath
+    mainClass.set("com.linkpoint.benchmarks.BenchmarkComparatorKt")
+    args(
+        layout.projectDirectory.file("baseline/jmh-baseline.json").asFile.path,
+        layout.buildDirectory.file("results/jmh/results.json").get().asFile.path,
+        "--threshold", (findProperty("threshold") as String?) ?: "10"
+    )
+}
+
+/**
+ * Replace the stored baseline with the latest JMH results
+ */
+tasks.register<Copy>("updateBenchmarkBaseline") {
+    group = "verification"
+    description = "Stores the latest JMH results as the regression baseline"
+    from(layout.buildDirectory.file("results/jmh/results.json"))
+    into(layout.projectDirectory.dir("baseline"))
+    rename { "jmh-baseline.json" }
+}
@@ -0,0 +1,55 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.assets.AssetManager
+import com.linkpoint.core.events.EventSystem
+import kotlinx.coroutines.runBlocking
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.nio.file.Files
+import java.util.UUID
+import java.util.concurrent.TimeUnit
+
+/**
+ * Memory-tier asset lookup: the path taken by every texture and sound request
+ * once an asset is resident
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class AssetCacheBenchmark {
+
+    private lateinit var assetManager: AssetManager
+    private lateinit var resident: Array<UUID>
+    private var next = 0
+
+    @Param("256")
+    var residentAssets = 256
+
+    @Setup
+    fun setUp() {
+        BenchmarkSupport.muteStdout()
+        val cacheDir = Files.createTempDirectory("linkpoint-bench-cache").toFile()
+        assetManager = AssetManager(EventSystem, cacheDir)
+        resident = Array(residentAssets) { UUID.randomUUID() }
+        runBlocking {
+            resident.forEach { assetManager.getAsset(it, AssetManager.AssetType.TEXTURE) }
+        }
+    }
+
+    @TearDown
+    fun tearDown() {
+        runBlocking { assetManager.shutdown() }
+        BenchmarkSupport.restoreStdout()
+    }
+
+    @Benchmark
+    fun memoryHit(blackhole: Blackhole) {
+        val uuid = resident[next++ % resident.size]
+        blackhole.consume(runBlocking { assetManager.getAsset(uuid, AssetManager.AssetType.TEXTURE) })
+    }
+
+    @Benchmark
+    fun status(blackhole: Blackhole) {
+        blackhole.consume(assetManager.getAssetStatus(resident[next++ % resident.size]))
+    }
+}
@@ -0,0 +1,65 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.assets.AssetManager
+import com.linkpoint.audio.AudioSystem
+import com.linkpoint.core.events.EventSystem
+import com.linkpoint.protocol.data.SimpleWorldEntities.Vector3
+import kotlinx.coroutines.runBlocking
+import org.openjdk.jmh.annotations.*
+import java.nio.file.Files
+import java.util.UUID
+import java.util.concurrent.TimeUnit
+
+/**
+ * Spatial mix parameters (attenuation, panning, Doppler) recomputed for every
+ * playing source when the listener moves
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class AudioMixBenchmark {
+
+    private lateinit var assetManager: AssetManager
+    private lateinit var audioSystem: AudioSystem
+    private var step = 0
+
+    @Param("32")
+    var sources = 32
+
+    @Setup
+    fun setUp() {
+        BenchmarkSupport.muteStdout()
+        assetManager = AssetManager(EventSystem, Files.createTempDirectory("linkpoint-bench-audio").toFile())
+        audioSystem = AudioSystem(assetManager, EventSystem)
+        runBlocking {
+            audioSystem.initialize()
+            repeat(sources) { i ->
+                audioSystem.playSound(
+                    UUID.randomUUID().toString(),
+                    Vector3(i * 3f, (i % 7) * 5f, 20f),
+                    loop = true,
+                    type = AudioSystem.SoundType.EFFECT
+                )
+            }
+        }
+    }
+
+    @TearDown
+    fun tearDown() {
+        runBlocking {
+            audioSystem.shutdown()
+            assetManager.shutdown()
+        }
+        BenchmarkSupport.restoreStdout()
+    }
+
+    @Benchmark
+    fun listenerMove() {
+        val t = (step++ % 360) * 0.0174533f
+        audioSystem.updateListener(
+            position = Vector3(128f + kotlin.math.cos(t) * 10f, 128f + kotlin.math.sin(t) * 10f, 22f),
+            velocity = Vector3(1f, 0f, 0f),
+            forward = Vector3(kotlin.math.cos(t), kotlin.math.sin(t), 0f)
+        )
+    }
+}
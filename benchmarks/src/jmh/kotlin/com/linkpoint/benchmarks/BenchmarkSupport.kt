@@ -0,0 +1,21 @@
+package com.linkpoint.benchmarks
+
+import java.io.OutputStream
+import java.io.PrintStream
+
+/**
+ * Shared helpers for the JMH benchmarks
+ */
+internal object BenchmarkSupport {
+
+    private val originalOut: PrintStream = System.out
+    private val discard = PrintStream(OutputStream.nullOutputStream())
+
+    /**
+     * Most viewer components log progress with println; silence stdout while
+     * measuring so the benches time the work rather than console I/O
+     */
+    fun muteStdout() = System.setOut(discard)
+
+    fun restoreStdout() = System.setOut(originalOut)
+}
@@ -0,0 +1,52 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.ui.DesktopChatUI
+import kotlinx.coroutines.runBlocking
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.io.File
+import java.nio.file.Files
+import java.util.concurrent.TimeUnit
+
+/**
+ * Chat history search (first page of results) over a populated, persisted transcript
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class ChatSearchBenchmark {
+
+    private lateinit var chat: DesktopChatUI
+    private lateinit var historyDir: File
+
+    @Param("10000", "1000000")
+    var messages = 10_000
+
+    @Param("teleport", "zzzz-no-match")
+    var query = "teleport"
+
+    @Setup
+    fun setUp() {
+        BenchmarkSupport.muteStdout()
+        historyDir = Files.createTempDirectory("chat-bench").toFile()
+        chat = DesktopChatUI(historyDir)
+        val words = listOf("hello", "anyone", "teleport", "sim", "lag", "party", "tonight", "landmark", "shop", "dance")
+        runBlocking {
+            repeat(messages) { i ->
+                chat.sendMessage((0 until 8).joinToString(" ") { words[(i * 7 + it * 3) % words.size] })
+            }
+        }
+    }
+
+    @TearDown
+    fun tearDown() {
+        BenchmarkSupport.restoreStdout()
+        chat.close()
+        historyDir.deleteRecursively()
+    }
+
+    @Benchmark
+    fun search(blackhole: Blackhole) {
+        blackhole.consume(runBlocking { chat.searchHistory(query) })
+    }
+}
@@ -0,0 +1,45 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.ui.ChatMessage
+import com.linkpoint.ui.chat.ChatTranscript
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.util.concurrent.TimeUnit
+
+/**
+ * Chat transcript append during a local-chat flood, and laying out the
+ * visible rows for a frame
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+open class ChatTranscriptBenchmark {
+
+    private lateinit var transcript: ChatTranscript
+    private val message = ChatMessage(
+        text = "anyone know where the sim party is tonight? got a landmark?",
+        channel = "Local",
+        timestamp = 0L,
+        sender = "Resident"
+    )
+
+    @Param("500", "10000")
+    var capacity = 500
+
+    @Setup
+    fun setUp() {
+        transcript = ChatTranscript(capacity)
+        repeat(capacity) { transcript.append(message) }
+    }
+
+    @Benchmark
+    fun append(blackhole: Blackhole) {
+        blackhole.consume(transcript.append(message))
+    }
+
+    @Benchmark
+    fun appendAndLayoutViewport(blackhole: Blackhole) {
+        transcript.append(message)
+        blackhole.consume(transcript.viewport(width = 640, height = 480))
+    }
+}
@@ -0,0 +1,55 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.graphics.rendering.OpenGLRenderer
+import com.linkpoint.protocol.data.WorldEntityUtils
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.util.concurrent.TimeUnit
+import kotlin.random.Random
+
+/**
+ * Full frame through the render pipeline: culling, queue building and sorting,
+ * pass submission and per-frame recycling
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class CullingBenchmark {
+
+    private lateinit var renderer: OpenGLRenderer
+    private lateinit var scene: OpenGLRenderer.Scene
+    private lateinit var camera: OpenGLRenderer.Camera
+
+    @Param("1000", "10000")
+    var objects = 1000
+
+    @Setup
+    fun setUp() {
+        BenchmarkSupport.muteStdout()
+        renderer = OpenGLRenderer().also { it.initialize() }
+        val random = Random(42)
+        scene = OpenGLRenderer.Scene(List(objects) {
+            WorldEntityUtils.createDemoCube(Vector3(random.nextFloat() * 256f, random.nextFloat() * 256f, random.nextFloat() * 64f))
+        })
+        camera = OpenGLRenderer.Camera(
+            position = Vector3(128f, 128f, 30f),
+            direction = Vector3(1f, 0f, 0f),
+            up = Vector3(0f, 0f, 1f),
+            fieldOfView = 60f,
+            nearPlane = 0.1f,
+            farPlane = 256f
+        )
+    }
+
+    @TearDown
+    fun tearDown() {
+        renderer.shutdown()
+        BenchmarkSupport.restoreStdout()
+    }
+
+    @Benchmark
+    fun renderFrame(blackhole: Blackhole) {
+        blackhole.consume(renderer.renderFrame(camera, scene))
+    }
+}
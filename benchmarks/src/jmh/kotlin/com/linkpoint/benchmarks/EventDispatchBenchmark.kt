@@ -0,0 +1,45 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.core.events.EventSystem
+import com.linkpoint.core.events.ViewerEvent
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.cancel
+import kotlinx.coroutines.launch
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * Event bus throughput: non-suspending emit with live subscribers draining the flow
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.MILLISECONDS)
+open class EventDispatchBenchmark {
+
+    private lateinit var scope: CoroutineScope
+    private val received = AtomicLong()
+    private val event = ViewerEvent.ChatReceived("Hello from the benchmark", "Bench Avatar", 0)
+
+    @Param("1", "4")
+    var subscribers = 1
+
+    @Setup
+    fun setUp() {
+        scope = CoroutineScope(SupervisorJob() + Dispatchers.Default)
+        repeat(subscribers) {
+            scope.launch { EventSystem.events.collect { received.incrementAndGet() } }
+        }
+    }
+
+    @TearDown
+    fun tearDown() = scope.cancel()
+
+    @Benchmark
+    fun tryEmit(blackhole: Blackhole) {
+        blackhole.consume(EventSystem.tryEmit(event))
+    }
+}
@@ -0,0 +1,65 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.protocol.inventory.InventoryFolderInfo
+import com.linkpoint.protocol.inventory.InventoryItemInfo
+import com.linkpoint.protocol.inventory.InventorySnapshot
+import com.linkpoint.protocol.inventory.InventoryStore
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.io.File
+import java.nio.file.Files
+import java.util.UUID
+import java.util.concurrent.TimeUnit
+
+/**
+ * Login-time inventory restore from the binary snapshot: map the file, put
+ * the folder tree into a fresh store and open one folder, at 20k and 200k items
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MILLISECONDS)
+open class InventorySnapshotBenchmark {
+
+    @Param("20000", "200000")
+    var itemCount = 0
+
+    private lateinit var directory: File
+    private lateinit var file: File
+    private val owner = UUID.randomUUID()
+    private lateinit var openedFolder: UUID
+
+    @Setup
+    fun setUp() {
+        directory = Files.createTempDirectory("inventory-bench").toFile()
+        file = File(directory, "inventory.snapshot")
+        val store = InventoryStore(itemCount)
+        val root = UUID.randomUUID()
+        store.putFolder(InventoryFolderInfo(root, null, "My Inventory", version = 1))
+        store.markLoaded(root, 1)
+        // 100 items per folder
+        for (f in 0 until itemCount / 100) {
+            val folder = UUID.randomUUID()
+            store.putFolder(InventoryFolderInfo(folder, root, "Folder $f", version = 3))
+            repeat(100) { i ->
+                store.putItem(InventoryItemInfo(UUID.randomUUID(), folder, "Item $f-$i", "(No Description)", assetType = 5))
+            }
+            store.markLoaded(folder, 3)
+            openedFolder = folder
+        }
+        InventorySnapshot.write(file, store, owner)
+    }
+
+    @TearDown
+    fun tearDown() {
+        directory.deleteRecursively()
+    }
+
+    @Benchmark
+    fun restoreAndOpenFolder(blackhole: Blackhole) {
+        val store = InventoryStore()
+        InventorySnapshot.open(file, owner)!!.use { snapshot ->
+            snapshot.restoreFolders(store)
+            blackhole.consume(snapshot.loadFolder(store, openedFolder))
+        }
+    }
+}
@@ -0,0 +1,63 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.protocol.inventory.InventoryFetcher
+import com.linkpoint.protocol.inventory.InventoryStore
+import com.linkpoint.protocol.llsd.LLSDXml
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.util.UUID
+import java.util.concurrent.TimeUnit
+
+/**
+ * LLSD XML parsing of a FetchInventoryDescendents2 response (10 folders x 500
+ * items), and applying it to the columnar inventory store
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MILLISECONDS)
+open class LLSDBenchmark {
+
+    private lateinit var document: String
+    private lateinit var parsed: Map<*, *>
+
+    @Setup
+    fun setUp() {
+        val owner = UUID.randomUUID()
+        val folders = List(10) { f ->
+            val folderId = UUID.randomUUID()
+            mapOf(
+                "folder_id" to folderId,
+                "owner_id" to owner,
+                "version" to 12,
+                "categories" to emptyList<Any>(),
+                "items" to List(500) { i ->
+                    mapOf(
+                        "item_id" to UUID.randomUUID(),
+                        "parent_id" to folderId,
+                        "name" to "Item $f-$i",
+                        "desc" to "(No Description)",
+                        "asset_id" to UUID.randomUUID(),
+                        "type" to 5,
+                        "inv_type" to 18,
+                        "flags" to 0,
+                        "created_at" to 1700000000 + i
+                    )
+                }
+            )
+        }
+        document = LLSDXml.format(mapOf("folders" to folders))
+        parsed = LLSDXml.parse(document) as Map<*, *>
+    }
+
+    @Benchmark
+    fun parse(blackhole: Blackhole) {
+        blackhole.consume(LLSDXml.parse(document))
+    }
+
+    @Benchmark
+    fun applyToStore(blackhole: Blackhole) {
+        val store = InventoryStore(8192)
+        InventoryFetcher.applyResponse(store, parsed)
+        blackhole.consume(store.itemCount)
+    }
+}
@@ -0,0 +1,79 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.core.events.Quaternion
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.protocol.data.AnimationState
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.data.ObjectMaterial
+import com.linkpoint.protocol.data.ObjectType
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.world.ObjectStore
+import com.linkpoint.ui.minimap.MinimapTiles
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.util.UUID
+import java.util.concurrent.TimeUnit
+import kotlin.random.Random
+
+/**
+ * One frame of the top-down region view while panning over a 50k-prim region
+ * with 40 walking avatars: the background tile refresh, which finds nothing
+ * stale, then cached tiles for the visible area plus the live dots
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class MinimapBenchmark {
+
+    @Param("50000")
+    var primCount = 0
+
+    private val store = ObjectStore()
+    private lateinit var minimap: MinimapTiles
+    private val avatars = ArrayList<Avatar>()
+    private var frame = 0
+
+    @Setup
+    fun setUp() {
+        val random = Random(7)
+        val identity = Quaternion(0f, 0f, 0f, 1f)
+        repeat(primCount) { n ->
+            store.put(VirtualObject(
+                UUID.randomUUID(), "Prim $n", Vector3(random.nextFloat() * 256f, random.nextFloat() * 256f, 25f), identity,
+                Vector3(0.5f + random.nextFloat() * 4f, 0.5f + random.nextFloat() * 4f, 1f),
+                description = "", creatorId = UUID(0, 0), ownerId = UUID(0, 0),
+                objectType = ObjectType.PRIMITIVE, material = ObjectMaterial.WOOD, textureIds = emptyList()
+            ))
+        }
+        repeat(40) { n ->
+            avatars += Avatar(
+                UUID.randomUUID(), "Resident $n", Vector3(random.nextFloat() * 256f, random.nextFloat() * 256f, 25f), identity,
+                displayName = "Resident $n", username = "resident$n", appearanceHash = "",
+                animationState = AnimationState("walk"), attachments = emptyList()
+            )
+        }
+        avatars.forEach(store::put)
+        minimap = MinimapTiles(store)
+        // Rasterise every tile up front, as the view's background refresh would
+        minimap.refresh(0f, 0f, 256f, 256f, Long.MAX_VALUE)
+    }
+
+    @TearDown
+    fun tearDown() {
+        store.close()
+    }
+
+    @Benchmark
+    fun panFrame(blackhole: Blackhole) {
+        frame++
+        // A phone-sized view of 100 x 180 m sliding east, avatars moving every frame
+        val minX = (frame % 156).toFloat()
+        val walker = frame % avatars.size
+        val avatar = avatars[walker]
+        avatars[walker] = avatar.copy(position = Vector3((avatar.position.x + 0.1f) % 256f, avatar.position.y, avatar.position.z))
+        store.put(avatars[walker])
+        blackhole.consume(minimap.refresh(minX, 40f, minX + 100f, 220f))
+        blackhole.consume(minimap.tiles(minX, 40f, minX + 100f, 220f))
+        blackhole.consume(minimap.dots(minX, 40f, minX + 100f, 220f))
+    }
+}
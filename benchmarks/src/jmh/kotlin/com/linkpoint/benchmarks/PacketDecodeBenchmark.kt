@@ -0,0 +1,47 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.protocol.PacketHeader
+import com.linkpoint.protocol.UDPMessageSystem
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.concurrent.TimeUnit
+
+/**
+ * Packet header decode and message type lookup, run for every received datagram
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+open class PacketDecodeBenchmark {
+
+    private val buffer = ByteBuffer.allocate(1500).order(ByteOrder.LITTLE_ENDIAN)
+    private val header = PacketHeader()
+    private var length = 0
+
+    @Param("false", "true")
+    var extraHeader = false
+
+    @Setup
+    fun setUp() {
+        buffer.clear()
+        buffer.put(if (extraHeader) PacketHeader.FLAG_EXTRA_HEADER.toByte() else 0)
+        buffer.putInt(123_456)
+        if (extraHeader) {
+            buffer.put(4)
+            buffer.putInt(0)
+        }
+        buffer.put(UDPMessageSystem.MessageType.CHAT_FROM_SIMULATOR.id.toByte())
+        repeat(64) { buffer.put(it.toByte()) }
+        length = buffer.position()
+    }
+
+    @Benchmark
+    fun decodeHeader(blackhole: Blackhole) {
+        buffer.clear()
+        buffer.limit(length)
+        blackhole.consume(header.decode(buffer))
+        blackhole.consume(UDPMessageSystem.MessageType.fromId(header.messageTypeId))
+    }
+}
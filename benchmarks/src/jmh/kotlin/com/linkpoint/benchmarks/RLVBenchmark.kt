@@ -0,0 +1,61 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.RLVProcessor.RLVCommand
+import com.linkpoint.protocol.rlv.RLVCommandParser
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.util.concurrent.TimeUnit
+
+/**
+ * RLV restriction checks on the chat/camera/touch paths, and command
+ * processing while a collar and HUD re-send their restriction sets
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+open class RLVBenchmark {
+
+    // Unlimited so the benches measure processing, not the rate limiter's drop path
+    private val rlv = RLVProcessor(rateLimitBurst = Double.POSITIVE_INFINITY)
+
+    // What a typical collar re-asserts on attach and every few seconds after
+    private val collarBatch =
+        "@fly=n,sendim=n,sendim:owner-uuid=add,recvim=n,recvim:owner-uuid=add,tplm=n,tploc=n," +
+            "addattach:skull=n,remattach:skull=n,showinv=n,edit=n,rez=n,unsit=n,sittp=n"
+    private val hudRestrict = "@sendchat=n,recvchat=n,showminimap=n,showworldmap=n"
+    private val hudRelease = "@sendchat=y,recvchat=y,showminimap=y,showworldmap=y"
+
+    @Setup
+    fun setUp() {
+        rlv.processRLVCommand(collarBatch, "collar", "Collar")
+    }
+
+    @Benchmark
+    fun checkRestrictions(blackhole: Blackhole) {
+        blackhole.consume(rlv.isRestricted(RLVCommand.SENDCHAT))
+        blackhole.consume(rlv.isRestricted(RLVCommand.SENDIM, "owner-uuid"))
+        blackhole.consume(rlv.isRestricted(RLVCommand.SENDIM, "stranger-uuid"))
+        blackhole.consume(rlv.isRestricted(RLVCommand.ADDATTACH, "chest"))
+        blackhole.consume(rlv.isRestricted(RLVCommand.CAMZOOMMAX))
+    }
+
+    @Benchmark
+    fun parseOnly(blackhole: Blackhole) {
+        blackhole.consume(RLVCommandParser.parse(collarBatch) { token ->
+            blackhole.consume(token.command)
+            true
+        })
+    }
+
+    @Benchmark
+    fun collarReassert(blackhole: Blackhole) {
+        blackhole.consume(rlv.processRLVCommand(collarBatch, "collar", "Collar"))
+    }
+
+    @Benchmark
+    fun hudToggle(blackhole: Blackhole) {
+        blackhole.consume(rlv.processRLVCommand(hudRestrict, "hud", "HUD"))
+        blackhole.consume(rlv.processRLVCommand(hudRelease, "hud", "HUD"))
+    }
+}
@@ -0,0 +1,52 @@
+package com.linkpoint.benchmarks
+
+import com.linkpoint.protocol.rlv.SharedFolderIndex
+import com.linkpoint.protocol.rlv.SharedFolderIndex.Folder
+import com.linkpoint.protocol.rlv.SharedFolderIndex.Item
+import org.openjdk.jmh.annotations.*
+import org.openjdk.jmh.infra.Blackhole
+import java.util.concurrent.TimeUnit
+
+/**
+ * RLV shared folder queries against a 30k-item inventory
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class SharedFolderBenchmark {
+
+    private lateinit var index: SharedFolderIndex
+    private val findTerms = listOf("outfit 97", "set 3")
+
+    @Setup
+    fun setUp() {
+        val folders = mutableListOf(Folder("root", null, "My Inventory"), Folder("rlv", "root", "#RLV"))
+        val items = mutableListOf<Item>()
+        // 100 outfit folders x 10 sets x 30 items
+        for (outfit in 0 until 100) {
+            folders += Folder("o$outfit", "rlv", "Outfit $outfit")
+            for (set in 0 until 10) {
+                val setId = "o$outfit-s$set"
+                folders += Folder(setId, "o$outfit", "Set $set")
+                repeat(30) { items += Item("$setId-i$it", setId, worn = outfit == 0 && it % 2 == 0) }
+            }
+        }
+        index = SharedFolderIndex.build(folders, items)!!
+    }
+
+    @Benchmark
+    fun getInvWorn(blackhole: Blackhole) {
+        blackhole.consume(index.getInvWorn("Outfit 42"))
+    }
+
+    @Benchmark
+    fun findFolder(blackhole: Blackhole) {
+        blackhole.consume(index.findFolder(findTerms))
+    }
+
+    @Benchmark
+    fun toggleWorn() {
+        index.setWorn("o42-s3-i7", true)
+        index.setWorn("o42-s3-i7", false)
+    }
+}
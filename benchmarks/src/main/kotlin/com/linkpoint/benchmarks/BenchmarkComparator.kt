@@ -0,0 +1,155 @@
+package com.linkpoint.benchmarks
+
+import com.fasterxml.jackson.databind.JsonNode
+import com.fasterxml.jackson.module.kotlin.jacksonObjectMapper
+import java.io.File
+import kotlin.system.exitProcess
+
+/**
+ * Compares JMH JSON results against a stored baseline and flags regressions.
+ *
+ * Usage: BenchmarkComparator <baseline.json> <results.json> [--threshold <percent>] [--output <report.json>]
+ *
+ * Benchmarks are matched by name and parameters. For throughput modes a drop in
+ * score is a regression; for time-per-operation modes a rise is. Changes inside
+ * the combined score error are not reported as regressions. Exits with status 1
+ * when any benchmark regresses by more than the threshold.
+ */
+fun main(args: Array<String>) {
+    val positional = mutableListOf<String>()
+    var threshold = 10.0
+    var output: File? = null
+
+    var i = 0
+    while (i < args.size) {
+        when (args[i]) {
+            "--threshold" -> threshold = args.getOrNull(++i)?.toDoubleOrNull() ?: usage()
+            "--output" -> output = File(args.getOrNull(++i) ?: usage())
+            else -> positional += args[i]
+        }
+        i++
+    }
+    if (positional.size != 2) usage()
+
+    val baselineFile = File(positional[0])
+    val resultsFile = File(positional[1])
+    if (!resultsFile.exists()) {
+        System.err.println("No JMH results at ${resultsFile.path}; run ./gradlew :benchmarks:jmh first")
+        exitProcess(2)
+    }
+    if (!baselineFile.exists()) {
+        println("No baseline at ${baselineFile.path}; store one with ./gradlew :benchmarks:updateBenchmarkBaseline")
+        return
+    }
+
+    val comparisons = BenchmarkComparator.compare(
+        BenchmarkComparator.load(baselineFile),
+        BenchmarkComparator.load(resultsFile),
+        threshold
+    )
+
+    println(BenchmarkComparator.format(comparisons, threshold))
+    output?.let { BenchmarkComparator.writeReport(it, comparisons, threshold) }
+
+    if (comparisons.any { it.status == ComparisonStatus.REGRESSION }) exitProcess(1)
+}
+
+private fun usage(): Nothing {
+    System.err.println("Usage: BenchmarkComparator <baseline.json> <results.json> [--threshold <percent>] [--output <report.json>]")
+    exitProcess(2)
+}
+
+enum class ComparisonStatus { REGRESSION, IMPROVEMENT, UNCHANGED, NEW, MISSING }
+
+data class BenchmarkResult(
+    val key: String,
+    val mode: String,
+    val score: Double,
+    val scoreError: Double,
+    val unit: String
+) {
+    /** Throughput: bigger is better. Average/sample/single-shot time: smaller is better */
+    val higherIsBetter: Boolean get() = mode == "thrpt"
+}
+
+data class BenchmarkComparison(
+    val key: String,
+    val unit: String,
+    val baseline: Double?,
+    val current: Double?,
+    val changePercent: Double?,
+    val status: ComparisonStatus
+)
+
+object BenchmarkComparator {
+
+    private val mapper = jacksonObjectMapper()
+
+    fun load(file: File): Map<String, BenchmarkResult> =
+        mapper.readTree(file).associate { node -> parse(node).let { it.key to it } }
+
+    private fun parse(node: JsonNode): BenchmarkResult {
+        val params = node.path("params").fields().asSequence()
+            .map { (name, value) -> "$name=${value.asText()}" }
+            .sorted()
+            .joinToString(",")
+        val name = node.path("benchmark").asText()
+        val metric = node.path("primaryMetric")
+        return BenchmarkResult(
+            key = if (params.isEmpty()) name else "$name($params)",
+            mode = node.path("mode").asText(),
+            score = metric.path("score").asDouble(),
+            scoreError = metric.path("scoreError").asDouble().takeUnless { it.isNaN() } ?: 0.0,
+            unit = metric.path("scoreUnit").asText()
+        )
+    }
+
+    fun compare(
+        baseline: Map<String, BenchmarkResult>,
+        current: Map<String, BenchmarkResult>,
+        thresholdPercent: Double
+    ): List<BenchmarkComparison> {
+        val keys = (baseline.keys + current.keys).sorted()
+        return keys.map { key ->
+            val before = baseline[key]
+            val after = current[key]
+            when {
+                before == null -> BenchmarkComparison(key, after!!.unit, null, after.score, null, ComparisonStatus.NEW)
+                after == null -> BenchmarkComparison(key, before.unit, before.score, null, null, ComparisonStatus.MISSING)
+                else -> {
+                    val change = if (before.score == 0.0) 0.0 else (after.score - before.score) / before.score * 100.0
+                    // Positive "worse" means the benchmark got slower
+                    val worse = if (after.higherIsBetter) -change else change
+                    val withinNoise = kotlin.math.abs(after.score - before.score) <= before.scoreError + after.scoreError
+                    val status = when {
+                        withinNoise -> ComparisonStatus.UNCHANGED
+                        worse > thresholdPercent -> ComparisonStatus.REGRESSION
+                        worse < -thresholdPercent -> ComparisonStatus.IMPROVEMENT
+                        else -> ComparisonStatus.UNCHANGED
+                    }
+                    BenchmarkComparison(key, after.unit, before.score, after.score, change, status)
+                }
+            }
+        }
+    }
+
+    fun format(comparisons: List<BenchmarkComparison>, thresholdPercent: Double): String = buildString {
+        appendLine("Benchmark comparison (threshold ${"%.1f".format(thresholdPercent)}%)")
+        comparisons.forEach { c ->
+            val before = c.baseline?.let { "%.3f".format(it) } ?: "-"
+            val after = c.current?.let { "%.3f".format(it) } ?: "-"
+            val change = c.changePercent?.let { "%+.1f%%".format(it) } ?: ""
+            appendLine("  %-11s %-70s %12s -> %12s %-10s %s".format(c.status, c.key, before, after, c.unit, change))
+        }
+        val regressions = comparisons.count { it.status == ComparisonStatus.REGRESSION }
+        append(if (regressions == 0) "No regressions" else "$regressions regression(s)")
+    }
+
+    fun writeReport(file: File, comparisons: List<BenchmarkComparison>, thresholdPercent: Double) {
+        file.parentFile?.mkdirs()
+        mapper.writerWithDefaultPrettyPrinter().writeValue(
+            file,
+            mapOf("thresholdPercent" to thresholdPercent, "comparisons" to comparisons)
+        )
+    }
+}
@@ -0,0 +1,62 @@
+package com.linkpoint.benchmarks
+
+import java.io.File
+import kotlin.test.AfterTest
+import kotlin.test.Test
+import kotlin.test.assertEquals
+
+/**
+ * Tests for flagging JMH regressions against the baseline
+ */
+class BenchmarkComparatorTest {
+
+    private val files = ArrayList<File>()
+
+    @AfterTest
+    fun cleanup() {
+        files.forEach { it.delete() }
+    }
+
+    // JMH's JSON result format, trimmed to the fields the comparator reads
+    private fun results(vararg entries: String): Map<String, BenchmarkResult> {
+        val file = File.createTempFile("jmh", ".json").also { files += it }
+        file.writeText(entries.joinToString(",", "[", "]"))
+        return BenchmarkComparator.load(file)
+    }
+
+    private fun result(name: String, mode: String, score: Double, error: Double, params: String = "") =
+        """{"benchmark": "$name", "mode": "$mode", "params": {$params},
+            "primaryMetric": {"score": $score, "scoreError": $error, "scoreUnit": "${if (mode == "thrpt") "ops/ms" else "us/op"}"}}"""
+
+    @Test
+    fun `should flag changes beyond the threshold in the direction that is worse`() {
+        val baseline = results(
+            result("Decode.packets", "thrpt", 1000.0, 10.0, "\"size\": \"64\""),
+            result("Decode.packets", "thrpt", 1000.0, 10.0, "\"size\": \"1024\""),
+            result("Search.names", "avgt", 2.0, 0.01),
+            result("Search.prefix", "avgt", 2.0, 0.01),
+            result("Sort.noisy", "avgt", 100.0, 30.0),
+            result("Sort.removed", "avgt", 1.0, 0.0)
+        )
+        val current = results(
+            result("Decode.packets", "thrpt", 850.0, 10.0, "\"size\": \"64\""),
+            result("Decode.packets", "thrpt", 950.0, 10.0, "\"size\": \"1024\""),
+            result("Search.names", "avgt", 2.5, 0.01),
+            result("Search.prefix", "avgt", 1.5, 0.01),
+            result("Sort.noisy", "avgt", 120.0, 30.0),
+            result("Sort.added", "avgt", 1.0, 0.0)
+        )
+
+        val statuses = BenchmarkComparator.compare(baseline, current, thresholdPercent = 10.0).associate { it.key to it.status }
+        assertEquals(ComparisonStatus.REGRESSION, statuses["Decode.packets(size=64)"], "15% less throughput")
+        assertEquals(ComparisonStatus.UNCHANGED, statuses["Decode.packets(size=1024)"], "5% is within the threshold")
+        assertEquals(ComparisonStatus.REGRESSION, statuses["Search.names"], "25% more time per operation")
+        assertEquals(ComparisonStatus.IMPROVEMENT, statuses["Search.prefix"])
+        assertEquals(ComparisonStatus.UNCHANGED, statuses["Sort.noisy"], "20% slower, but inside the score errors")
+        assertEquals(ComparisonStatus.MISSING, statuses["Sort.removed"])
+        assertEquals(ComparisonStatus.NEW, statuses["Sort.added"])
+
+        val strict = BenchmarkComparator.compare(baseline, current, thresholdPercent = 4.0)
+        assertEquals(ComparisonStatus.REGRESSION, strict.single { it.key == "Decode.packets(size=1024)" }.status)
+    }
+}
@@ -4,6 +4,7 @@ import kotlinx.coroutines.flow.MutableSharedFlow
 import kotlinx.coroutines.flow.SharedFlow
 import kotlinx.coroutines.flow.asSharedFlow
 import mu.KotlinLogging
+import java.util.UUID
 
 private val logger = KotlinLogging.logger {}
 
@@ -23,10 +24,14 @@ sealed class ViewerEvent {
     
     // Avatar events
     data class AvatarMoved(val position: Vector3, val rotation: Quaternion) : ViewerEvent()
-    data class AvatarTeleported(val region: String, val position: Vector3) : ViewerEvent()
+    // Arrival in a region, at login or after a teleport; regionHandle when the simulator told it
+    data class AvatarTeleported(val region: String, val position: Vector3, val regionHandle: Long? = null) : ViewerEvent()
+    // Every avatar a region's simulator places on the map, positions local to regionHandle
+    data class CoarseLocationsUpdated(val regionHandle: Long, val avatars: Map<UUID, Vector3>) : ViewerEvent()
     
     // Chat events
-    data class ChatReceived(val message: String, val sender: String, val channel: Int) : ViewerEvent()
+    // senderId is the speaking avatar, when chat comes from one
+    data class ChatReceived(val message: String, val sender: String, val channel: Int, val senderId: UUID? = null) : ViewerEvent()
     data class InstantMessageReceived(val message: String, val sender: String) : ViewerEvent()
     
     // Object events
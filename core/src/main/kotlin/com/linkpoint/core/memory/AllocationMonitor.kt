@@ -0,0 +1,76 @@
+package com.linkpoint.core.memory
+
+import java.lang.management.ManagementFactory
+
+/**
+ * Samples GC activity and heap allocation volume so allocation-reduction work
+ * (pools, arenas) can be measured before and after.
+ *
+ * Uses the JVM management beans, so it is for desktop builds and benchmarks;
+ * Android has no java.lang.management. Allocated bytes come from HotSpot's
+ * per-thread allocation counters and only cover threads that are still alive;
+ * values the runtime cannot provide are reported as -1.
+ */
+object AllocationMonitor {
+
+    private val threadBean: com.sun.management.ThreadMXBean? = try {
+        (ManagementFactory.getThreadMXBean() as? com.sun.management.ThreadMXBean)
+            ?.takeIf { it.isThreadAllocatedMemorySupported }
+            ?.also { it.isThreadAllocatedMemoryEnabled = true }
+    } catch (e: UnsupportedOperationException) {
+        null
+    }
+
+    fun sample(): AllocationSample {
+        var gcCount = -1L
+        var gcTimeMs = -1L
+        try {
+            val collectors = ManagementFactory.getGarbageCollectorMXBeans()
+            gcCount = collectors.sumOf { maxOf(0L, it.collectionCount) }
+            gcTimeMs = collectors.sumOf { maxOf(0L, it.collectionTime) }
+        } catch (e: UnsupportedOperationException) {
+            // Collector beans not available on this runtime
+        }
+
+        val allocated = threadBean?.let { bean ->
+            bean.getThreadAllocatedBytes(bean.allThreadIds).sumOf { maxOf(0L, it) }
+        } ?: -1L
+
+        return AllocationSample(System.nanoTime(), gcCount, gcTimeMs, allocated)
+    }
+}
+
+data class AllocationSample(
+    val timestampNanos: Long,
+    val gcCount: Long,
+    val gcTimeMs: Long,
+    val allocatedBytes: Long
+) {
+    /**
+     * Activity between [earlier] and this sample
+     */
+    fun since(earlier: AllocationSample): AllocationDelta {
+        val seconds = (timestampNanos - earlier.timestampNanos) / 1_000_000_000.0
+        val allocated = if (allocatedBytes < 0 || earlier.allocatedBytes < 0) -1L else allocatedBytes - earlier.allocatedBytes
+        return AllocationDelta(
+            seconds = seconds,
+            gcCount = gcCount - earlier.gcCount,
+            gcTimeMs = gcTimeMs - earlier.gcTimeMs,
+            allocatedBytes = allocated
+        )
+    }
+}
+
+data class AllocationDelta(
+    val seconds: Double,
+    val gcCount: Long,
+    val gcTimeMs: Long,
+    val allocatedBytes: Long
+) {
+    val bytesPerSecond: Double get() = if (allocatedBytes < 0 || seconds <= 0) -1.0 else allocatedBytes / seconds
+
+    fun format(): String =
+        "%.1fs: %d GCs (%dms paused), %.2f MB/s allocated".format(
+            java.util.Locale.ROOT, seconds, gcCount, gcTimeMs, bytesPerSecond / (1024 * 1024)
+        )
+}
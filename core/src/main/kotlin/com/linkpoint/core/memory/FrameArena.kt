@@ -0,0 +1,99 @@
+package com.linkpoint.core.memory
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Frame-scoped bump allocator for transient float and byte data.
+ *
+ * Allocation hands out an offset into a shared slab and [reset] rewinds both
+ * slabs at the end of the frame, so steady-state frames allocate nothing. When a
+ * frame needs more than the slab holds it is grown (and charged to [account]),
+ * which keeps earlier offsets valid but replaces the backing array: always index
+ * through [floats]/[bytes] after allocating rather than caching the array.
+ *
+ * Not thread-safe; each render/audio/network thread owns its own arena.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLAlignedArray scratch buffers
+ * - Linear/bump allocators used for per-frame data in game engines
+ */
+class FrameArena(
+    initialFloats: Int = 16 * 1024,
+    initialBytes: Int = 16 * 1024,
+    private val account: MemoryAccount? = null
+) {
+    var floats: FloatArray = FloatArray(initialFloats)
+        private set
+    var bytes: ByteBuffer = ByteBuffer.allocate(initialBytes).order(ByteOrder.LITTLE_ENDIAN)
+        private set
+
+    private var floatTop = 0
+    private var byteTop = 0
+
+    /** Peak usage across frames since creation */
+    var floatHighWater = 0
+        private set
+    var byteHighWater = 0
+        private set
+
+    /** Number of times a slab had to grow; non-zero in steady state means the initial size is too small */
+    var growCount = 0
+        private set
+
+    init {
+        account?.charge(floats.size * 4L + bytes.capacity())
+    }
+
+    /**
+     * Reserve [count] floats and return the offset of the first one in [floats]
+     */
+    fun allocFloats(count: Int): Int {
+        val offset = floatTop
+        val top = offset + count
+        if (top > floats.size) growFloats(top)
+        floatTop = top
+        if (top > floatHighWater) floatHighWater = top
+        return offset
+    }
+
+    /**
+     * Reserve [size] bytes and return the offset of the first one in [bytes].
+     * Use the absolute get/put methods of [bytes] with the returned offset.
+     */
+    fun allocBytes(size: Int): Int {
+        val offset = byteTop
+        val top = offset + size
+        if (top > bytes.capacity()) growBytes(top)
+        byteTop = top
+        if (top > byteHighWater) byteHighWater = top
+        return offset
+    }
+
+    val floatsUsed: Int get() = floatTop
+    val bytesUsed: Int get() = byteTop
+
+    /**
+     * Release everything allocated this frame
+     */
+    fun reset() {
+        floatTop = 0
+        byteTop = 0
+    }
+
+    private fun growFloats(required: Int) {
+        val newSize = maxOf(required, floats.size * 2)
+        account?.charge((newSize - floats.size) * 4L)
+        floats = floats.copyOf(newSize)
+        growCount++
+    }
+
+    private fun growBytes(required: Int) {
+        val newSize = maxOf(required, bytes.capacity() * 2)
+        account?.charge((newSize - bytes.capacity()).toLong())
+        val grown = ByteBuffer.allocate(newSize).order(ByteOrder.LITTLE_ENDIAN)
+        System.arraycopy(bytes.array(), 0, grown.array(), 0, byteTop)
+        bytes = grown
+        growCount++
+    }
+}
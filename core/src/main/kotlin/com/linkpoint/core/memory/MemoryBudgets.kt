@@ -0,0 +1,307 @@
+package com.linkpoint.core.memory
+
+import mu.KotlinLogging
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CopyOnWriteArrayList
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicLong
+import java.util.concurrent.atomic.AtomicReference
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Memory pressure levels, from mild to severe.
+ *
+ * [shedFraction] is the share of each subsystem's live bytes it is asked to free.
+ * Android's onTrimMemory levels map onto these via [fromTrimLevel].
+ */
+enum class MemoryPressureLevel(val shedFraction: Double) {
+    MODERATE(0.25),
+    LOW(0.5),
+    CRITICAL(1.0);
+
+    companion object {
+        // Values of android.content.ComponentCallbacks2.TRIM_MEMORY_* (kept here so core stays platform-free)
+        private const val TRIM_MEMORY_RUNNING_MODERATE = 5
+        private const val TRIM_MEMORY_RUNNING_LOW = 10
+        private const val TRIM_MEMORY_RUNNING_CRITICAL = 15
+        private const val TRIM_MEMORY_UI_HIDDEN = 20
+        private const val TRIM_MEMORY_BACKGROUND = 40
+        private const val TRIM_MEMORY_MODERATE = 60
+        private const val TRIM_MEMORY_COMPLETE = 80
+
+        fun fromTrimLevel(level: Int): MemoryPressureLevel? = when {
+            level >= TRIM_MEMORY_COMPLETE -> CRITICAL
+            level >= TRIM_MEMORY_MODERATE -> LOW
+            level >= TRIM_MEMORY_BACKGROUND -> MODERATE
+            level >= TRIM_MEMORY_UI_HIDDEN -> null // UI hidden alone is not pressure
+            level >= TRIM_MEMORY_RUNNING_CRITICAL -> CRITICAL
+            level >= TRIM_MEMORY_RUNNING_LOW -> LOW
+            level >= TRIM_MEMORY_RUNNING_MODERATE -> MODERATE
+            else -> null
+        }
+    }
+}
+
+/**
+ * Implemented by subsystems that can give memory back on request.
+ * Returns the number of bytes actually released.
+ */
+fun interface MemoryPressureListener {
+    fun onMemoryPressure(level: MemoryPressureLevel, bytesToFree: Long): Long
+}
+
+/**
+ * Live-byte account for one subsystem
+ */
+class MemoryAccount internal constructor(
+    val name: String,
+    val priority: Int,
+    @Volatile var budgetBytes: Long,
+    @Volatile internal var listener: MemoryPressureListener?
+) {
+    private val live = AtomicLong(0)
+    private val peak = AtomicLong(0)
+    // Instances sharing the account, e.g. one per open map view; asked after [listener]
+    private val sharers = CopyOnWriteArrayList<MemoryPressureListener>()
+
+    val liveBytes: Long get() = live.get()
+    val peakBytes: Long get() = peak.get()
+    val isOverBudget: Boolean get() = live.get() > budgetBytes
+
+    internal val hasListeners: Boolean get() = listener != null || sharers.isNotEmpty()
+
+    /**
+     * Join the account as one more instance charging it. Pair with
+     * [removeListener], releasing the instance's live bytes, when it goes away
+     */
+    fun addListener(listener: MemoryPressureListener) {
+        sharers += listener
+    }
+
+    fun removeListener(listener: MemoryPressureListener) {
+        sharers -= listener
+    }
+
+    // Ask each listener in turn until [bytesToFree] is met
+    internal fun shed(level: MemoryPressureLevel, bytesToFree: Long): Long {
+        var freed = listener?.onMemoryPressure(level, bytesToFree) ?: 0L
+        for (sharer in sharers) {
+            if (freed >= bytesToFree) break
+            freed += sharer.onMemoryPressure(level, bytesToFree - freed)
+        }
+        return freed
+    }
+
+    fun charge(bytes: Long) {
+        if (bytes <= 0) return
+        val now = live.addAndGet(bytes)
+        peak.accumulateAndGet(now) { a, b -> maxOf(a, b) }
+        MemoryBudgets.onCharged(this)
+    }
+
+    fun release(bytes: Long) {
+        if (bytes <= 0) return
+        // Never go negative even if a subsystem double-releases
+        live.accumulateAndGet(bytes) { current, delta -> maxOf(0L, current - delta) }
+    }
+
+    fun snapshot() = MemoryAccountSnapshot(name, priority, liveBytes, peakBytes, budgetBytes)
+}
+
+data class MemoryAccountSnapshot(
+    val name: String,
+    val priority: Int,
+    val liveBytes: Long,
+    val peakBytes: Long,
+    val budgetBytes: Long
+)
+
+/**
+ * Registry of per-subsystem memory accounts with budgets and pressure fan-out.
+ *
+ * Pressure is delivered to accounts in ascending [MemoryAccount.priority]: caches
+ * that are cheap to rebuild shed first, state that is expensive to refetch last.
+ * Fan-out stops once enough has been freed, except at [MemoryPressureLevel.CRITICAL]
+ * where every subsystem is asked.
+ *
+ * One pass runs at a time. A signal raised during a pass (from another thread,
+ * or by a listener charging an account) is queued at the highest level seen
+ * and run once the current pass finishes, so a CRITICAL signal isn't lost to a
+ * MODERATE shed already in progress.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLMemory and texture/mesh memory budgets
+ * - Android's ComponentCallbacks2.onTrimMemory contract
+ */
+object MemoryBudgets {
+
+    // Shedding order: lower values are asked first
+    const val PRIORITY_ASSET_CACHE = 0
+    const val PRIORITY_MAP_TILES = 5
+    const val PRIORITY_TEXTURES = 10
+    const val PRIORITY_MESHES = 20
+    const val PRIORITY_UI_HISTORY = 30
+    const val PRIORITY_AUDIO = 40
+    const val PRIORITY_OBJECTS = 50
+
+    const val ASSET_CACHE = "asset.cache"
+    const val MAP_TILES = "map.tiles"
+    const val TEXTURES = "textures"
+    const val MESHES = "meshes"
+    const val UI_HISTORY = "ui.history"
+    const val AUDIO_PCM = "audio.pcm"
+    const val OBJECTS = "objects"
+
+    private val accounts = ConcurrentHashMap<String, MemoryAccount>()
+    private val shedding = AtomicBoolean(false)
+    // Highest level signalled but not yet run
+    private val pending = AtomicReference<MemoryPressureLevel?>(null)
+
+    /**
+     * Total live bytes across all accounts above which MODERATE pressure is raised.
+     * Long.MAX_VALUE disables the cap.
+     */
+    @Volatile
+    var totalCapBytes: Long = Long.MAX_VALUE
+
+    /**
+     * Register (or re-register) a subsystem account. Re-registering keeps the live
+     * byte count and replaces budget and listener. Subsystems with several
+     * instances register without a listener and join with
+     * [MemoryAccount.addListener] instead, so one instance doesn't replace another.
+     */
+    fun register(
+        name: String,
+        priority: Int,
+        budgetBytes: Long = Long.MAX_VALUE,
+        listener: MemoryPressureListener? = null
+    ): MemoryAccount {
+        val account = accounts.computeIfAbsent(name) { MemoryAccount(name, priority, budgetBytes, listener) }
+        account.budgetBytes = budgetBytes
+        if (listener != null) account.listener = listener
+        return account
+    }
+
+    fun account(name: String): MemoryAccount? = accounts[name]
+
+    fun totalLiveBytes(): Long = accounts.values.sumOf { it.liveBytes }
+
+    fun snapshot(): List<MemoryAccountSnapshot> =
+        accounts.values.sortedBy { it.priority }.map { it.snapshot() }
+
+    /**
+     * Android bridge: forward Activity/Application onTrimMemory levels
+     */
+    fun onTrimMemory(level: Int): Long {
+        val pressure = MemoryPressureLevel.fromTrimLevel(level) ?: return 0
+        return signalPressure(pressure)
+    }
+
+    /**
+     * Ask subsystems to shed memory in priority order. Returns total bytes freed
+     * by the passes this call ran; 0 if the signal was queued behind a pass
+     * running on another thread.
+     */
+    fun signalPressure(level: MemoryPressureLevel): Long {
+        pending.accumulateAndGet(level) { current, _ -> if (current != null && current > level) current else level }
+        return runPending()
+    }
+
+    // Run queued levels until none is left. Re-checked after releasing the flag
+    // so a signal queued just before the release isn't stranded.
+    private fun runPending(): Long {
+        var freed = 0L
+        while (pending.get() != null && shedding.compareAndSet(false, true)) {
+            try {
+                pending.getAndSet(null)?.let { freed += shed(it) }
+            } finally {
+                shedding.set(false)
+            }
+        }
+        return freed
+    }
+
+    // Caller holds the shedding flag
+    private fun shed(level: MemoryPressureLevel): Long {
+        val ordered = accounts.values.sortedBy { it.priority }
+        val target = (ordered.sumOf { it.liveBytes } * level.shedFraction).toLong()
+        var freed = 0L
+
+        for (account in ordered) {
+            if (level != MemoryPressureLevel.CRITICAL && freed >= target) break
+            if (!account.hasListeners) continue
+            val ask = (account.liveBytes * level.shedFraction).toLong()
+            if (ask <= 0) continue
+
+            val released = try {
+                account.shed(level, ask)
+            } catch (e: Exception) {
+                logger.error(e) { "Memory pressure listener for ${account.name} failed" }
+                0L
+            }
+            freed += released
+            logger.debug { "Memory pressure $level: ${account.name} freed $released of $ask bytes" }
+        }
+
+        logger.info { "Memory pressure $level handled: freed $freed bytes (target $target)" }
+        return freed
+    }
+
+    internal fun onCharged(account: MemoryAccount) {
+        if (account.isOverBudget) {
+            shedAccount(account)
+        } else if (totalCapBytes != Long.MAX_VALUE && totalLiveBytes() > totalCapBytes) {
+            signalPressure(MemoryPressureLevel.MODERATE)
+        }
+    }
+
+    private fun shedAccount(account: MemoryAccount) {
+        if (!account.hasListeners) return
+        if (!shedding.compareAndSet(false, true)) return
+        try {
+            val excess = account.liveBytes - account.budgetBytes
+            if (excess > 0) account.shed(MemoryPressureLevel.MODERATE, excess)
+        } finally {
+            shedding.set(false)
+        }
+        runPending()
+    }
+
+    /**
+     * Drop all accounts; for tests and full shutdown
+     */
+    fun reset() {
+        accounts.clear()
+        pending.set(null)
+        totalCapBytes = Long.MAX_VALUE
+    }
+}
+
+/**
+ * Allocates buffers and charges them to a [MemoryAccount].
+ *
+ * The JVM frees memory on its own schedule, so callers must [release] buffers
+ * when they drop their last reference for the account to reflect live bytes.
+ */
+class TrackingAllocator(val account: MemoryAccount) {
+
+    fun bytes(size: Int): ByteArray {
+        account.charge(size.toLong())
+        return ByteArray(size)
+    }
+
+    fun floats(size: Int): FloatArray {
+        account.charge(size * 4L)
+        return FloatArray(size)
+    }
+
+    fun copyOf(source: ByteArray): ByteArray {
+        account.charge(source.size.toLong())
+        return source.copyOf()
+    }
+
+    fun release(buffer: ByteArray) = account.release(buffer.size.toLong())
+
+    fun release(buffer: FloatArray) = account.release(buffer.size * 4L)
+}
@@ -0,0 +1,63 @@
+package com.linkpoint.core.memory
+
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * Bounded pool of reusable objects of one type.
+ *
+ * [acquire] returns an idle instance or creates one with [factory]; [release]
+ * runs [reset] and keeps the instance for reuse unless [maxIdle] instances are
+ * already waiting. Acquire/release are guarded by a small lock so pools can be
+ * shared between the network coroutines and the render thread.
+ */
+class ObjectPool<T : Any>(
+    val name: String,
+    private val maxIdle: Int = 256,
+    private val reset: (T) -> Unit = {},
+    private val factory: () -> T
+) {
+    private val idle = ArrayDeque<T>()
+    private val created = AtomicLong(0)
+    private val reused = AtomicLong(0)
+
+    fun acquire(): T {
+        val pooled = synchronized(idle) { idle.removeLastOrNull() }
+        if (pooled != null) {
+            reused.incrementAndGet()
+            return pooled
+        }
+        created.incrementAndGet()
+        return factory()
+    }
+
+    fun release(item: T) {
+        reset(item)
+        synchronized(idle) {
+            if (idle.size < maxIdle) idle.addLast(item)
+        }
+    }
+
+    /**
+     * Acquire an instance for the duration of [block]
+     */
+    inline fun <R> use(block: (T) -> R): R {
+        val item = acquire()
+        try {
+            return block(item)
+        } finally {
+            release(item)
+        }
+    }
+
+    fun stats() = PoolStats(name, created.get(), reused.get(), synchronized(idle) { idle.size })
+}
+
+data class PoolStats(
+    val name: String,
+    val created: Long,
+    val reused: Long,
+    val idle: Int
+) {
+    /** Fraction of acquisitions served from the pool */
+    val hitRate: Double get() = if (created + reused == 0L) 0.0 else reused.toDouble() / (created + reused)
+}
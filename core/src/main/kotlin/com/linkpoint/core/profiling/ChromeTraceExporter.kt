@@ -0,0 +1,85 @@
+package com.linkpoint.core.profiling
+
+import java.io.File
+
+/**
+ * Exports the profiler's event rings in Chrome trace event format.
+ *
+ * The output loads in chrome://tracing, Perfetto and Speedscope. Export is
+ * non-destructive: it reads whatever is still resident in each thread's ring
+ * without disturbing per-frame aggregation.
+ */
+object ChromeTraceExporter {
+
+    private const val PROCESS_ID = 1
+
+    /**
+     * Write the current ring contents as a trace JSON document
+     */
+    fun export(out: Appendable) {
+        val origin = Profiler.rings.mapNotNull { ring -> earliestTimestamp(ring) }.minOrNull() ?: 0L
+        var first = true
+
+        fun separator() {
+            if (!first) out.append(",\n") else out.append("\n")
+            first = false
+        }
+
+        out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[")
+
+        Profiler.rings.forEach { ring ->
+            separator()
+            out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":").append(PROCESS_ID.toString())
+                .append(",\"tid\":").append(ring.threadId.toString())
+                .append(",\"args\":{\"name\":\"").append(escape(ring.threadName)).append("\"}}")
+
+            ring.forEachEvent(0, ring.written) { kind, zoneId, t0, t1 ->
+                separator()
+                out.append("{\"name\":\"").append(escape(Profiler.zoneName(zoneId))).append("\",\"ph\":\"")
+                when (kind) {
+                    Profiler.KIND_BEGIN -> out.append("B")
+                    Profiler.KIND_END -> out.append("E")
+                    else -> out.append("X")
+                }
+                out.append("\",\"ts\":").append(micros(t0 - origin))
+                if (kind == Profiler.KIND_COMPLETE) {
+                    out.append(",\"dur\":").append(micros(t1 - t0))
+                }
+                out.append(",\"pid\":").append(PROCESS_ID.toString())
+                    .append(",\"tid\":").append(ring.threadId.toString()).append("}")
+            }
+        }
+
+        out.append("\n]}\n")
+    }
+
+    /**
+     * Write the trace to [file], returning the file for convenience
+     */
+    fun exportTo(file: File): File {
+        file.parentFile?.mkdirs()
+        file.bufferedWriter().use { export(it) }
+        return file
+    }
+
+    private fun earliestTimestamp(ring: ThreadRing): Long? {
+        var earliest = Long.MAX_VALUE
+        ring.forEachEvent(0, ring.written) { _, _, t0, _ ->
+            if (t0 < earliest) earliest = t0
+        }
+        return if (earliest == Long.MAX_VALUE) null else earliest
+    }
+
+    private fun micros(nanos: Long): String = "%.3f".format(java.util.Locale.ROOT, nanos / 1000.0)
+
+    private fun escape(value: String): String = buildString(value.length) {
+        value.forEach { c ->
+            when (c) {
+                '"' -> append("\\\"")
+                '\\' -> append("\\\\")
+                '\n' -> append("\\n")
+                else -> if (c < ' ') append("\\u%04x".format(c.code)) else append(c)
+            }
+        }
+    }
+}
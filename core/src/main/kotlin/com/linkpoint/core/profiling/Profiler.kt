@@ -0,0 +1,286 @@
+package com.linkpoint.core.profiling
+
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CopyOnWriteArrayList
+
+/**
+ * Hierarchical CPU profiler with scoped zones.
+ *
+ * Zones are registered once by name and referenced by integer id on the hot path.
+ * Each thread records begin/end markers into its own fixed-size ring buffer, so
+ * recording never locks or allocates. When profiling is off, [scope] reduces to a
+ * single volatile read before running the block.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLFastTimer and the "Fast Timers" floater
+ * - Tracy/Remotery style per-thread event rings
+ */
+object Profiler {
+
+    /** Number of events each thread can hold before the oldest ones are overwritten */
+    const val RING_CAPACITY = 16_384
+
+    internal const val KIND_BEGIN = 1L
+    internal const val KIND_END = 2L
+    internal const val KIND_COMPLETE = 3L
+
+    @Volatile
+    var isEnabled: Boolean = false
+
+    private val zoneIds = ConcurrentHashMap<String, Int>()
+    private val zoneNames = CopyOnWriteArrayList<String>()
+    internal val rings = CopyOnWriteArrayList<ThreadRing>()
+
+    private val localRing = ThreadLocal.withInitial {
+        val thread = Thread.currentThread()
+        ThreadRing(thread.id, thread.name, RING_CAPACITY).also { rings.add(it) }
+    }
+
+    @Volatile
+    var lastFrame: FrameProfile? = null
+        private set
+
+    private var frameIndex = 0L
+    private var frameStartNanos = System.nanoTime()
+
+    /**
+     * Register a zone name and return its id. Call once, typically from a
+     * private top-level val next to the code being instrumented.
+     */
+    fun zone(name: String): Int {
+        return zoneIds.computeIfAbsent(name) {
+            synchronized(zoneNames) {
+                zoneNames.add(name)
+                zoneNames.size - 1
+            }
+        }
+    }
+
+    fun zoneName(id: Int): String = zoneNames.getOrNull(id) ?: "zone#$id"
+
+    /**
+     * Run [block] inside a profiling zone. The block must not suspend across
+     * threads; use [mark]/[record] for work that spans suspension points.
+     */
+    inline fun <T> scope(zoneId: Int, block: () -> T): T {
+        if (!isEnabled) return block()
+        begin(zoneId)
+        try {
+            return block()
+        } finally {
+            end(zoneId)
+        }
+    }
+
+    @PublishedApi
+    internal fun begin(zoneId: Int) {
+        localRing.get().push((KIND_BEGIN shl 32) or zoneId.toLong(), System.nanoTime(), 0L)
+    }
+
+    @PublishedApi
+    internal fun end(zoneId: Int) {
+        localRing.get().push((KIND_END shl 32) or zoneId.toLong(), System.nanoTime(), 0L)
+    }
+
+    /**
+     * Start timestamp for a span recorded later with [record]; 0 when profiling is off
+     */
+    fun mark(): Long = if (isEnabled) System.nanoTime() else 0L
+
+    /**
+     * Record a complete span that started at [startNanos] (from [mark]) and ends now.
+     * Suitable for suspending work such as asset downloads.
+     */
+    fun record(zoneId: Int, startNanos: Long) {
+        if (startNanos == 0L || !isEnabled) return
+        localRing.get().push((KIND_COMPLETE shl 32) or zoneId.toLong(), startNanos, System.nanoTime())
+    }
+
+    /**
+     * Close the current frame and aggregate every event recorded since the previous
+     * call into a per-thread zone tree. Called once per rendered frame.
+     */
+    fun endFrame(): FrameProfile? {
+        if (!isEnabled) return null
+
+        val now = System.nanoTime()
+        val threads = rings.mapNotNull { ring -> ring.collectFrame() }
+        val frame = FrameProfile(
+            frameIndex = frameIndex++,
+            startNanos = frameStartNanos,
+            durationNanos = now - frameStartNanos,
+            threads = threads
+        )
+        frameStartNanos = now
+        lastFrame = frame
+        return frame
+    }
+
+    /**
+     * Drop all recorded events and the last aggregated frame
+     */
+    fun reset() {
+        rings.forEach { it.clear() }
+        lastFrame = null
+        frameIndex = 0
+        frameStartNanos = System.nanoTime()
+    }
+}
+
+/**
+ * Single-writer event ring owned by one thread.
+ *
+ * Each event occupies three longs: header (kind << 32 | zoneId), t0 and t1.
+ * [written] is only advanced by the owning thread; readers take a snapshot of it
+ * and discard anything that was overwritten while they were reading.
+ */
+internal class ThreadRing(
+    val threadId: Long,
+    val threadName: String,
+    private val capacity: Int
+) {
+    private val slots = LongArray(capacity * 3)
+
+    @Volatile
+    var written: Long = 0
+        private set
+
+    // Only touched by the thread calling Profiler.endFrame()
+    private var frameCursor: Long = 0
+
+    fun push(header: Long, t0: Long, t1: Long) {
+        val index = ((written % capacity) * 3).toInt()
+        slots[index] = header
+        slots[index + 1] = t0
+        slots[index + 2] = t1
+        written++
+    }
+
+    /**
+     * Visit events in [from, to) that are still resident in the ring
+     */
+    inline fun forEachEvent(from: Long, to: Long, visitor: (kind: Long, zoneId: Int, t0: Long, t1: Long) -> Unit) {
+        var cursor = maxOf(from, to - capacityOf())
+        while (cursor < to) {
+            val index = ((cursor % capacityOf()) * 3).toInt()
+            val header = slotAt(index)
+            visitor(header ushr 32, (header and 0xFFFFFFFFL).toInt(), slotAt(index + 1), slotAt(index + 2))
+            cursor++
+        }
+    }
+
+    fun capacityOf(): Int = capacity
+    fun slotAt(index: Int): Long = slots[index]
+
+    fun collectFrame(): ThreadProfile? {
+        val end = written
+        val start = frameCursor
+        frameCursor = end
+        if (end == start) return null
+
+        val root = ProfileNode(threadName)
+        val stack = ArrayList<Pair<ProfileNode, Long>>()
+
+        forEachEvent(start, end) { kind, zoneId, t0, t1 ->
+            val parent = stack.lastOrNull()?.first ?: root
+            when (kind) {
+                Profiler.KIND_BEGIN -> stack.add(parent.child(Profiler.zoneName(zoneId)) to t0)
+                Profiler.KIND_END -> {
+                    // Ends without a matching begin straddled the frame boundary; drop them
+                    if (stack.isNotEmpty()) {
+                        val (node, began) = stack.removeAt(stack.size - 1)
+                        node.add(t0 - began)
+                    }
+                }
+                Profiler.KIND_COMPLETE -> parent.child(Profiler.zoneName(zoneId)).add(t1 - t0)
+            }
+        }
+
+        // Anything overwritten while we were reading is unreliable
+        if (written - start > capacity) return null
+
+        root.inclusiveNanos = root.children.sumOf { it.inclusiveNanos }
+        return ThreadProfile(threadId, threadName, root)
+    }
+
+    fun clear() {
+        written = 0
+        frameCursor = 0
+    }
+}
+
+/**
+ * Aggregated zone timings for one frame, one tree per thread that recorded events
+ */
+data class FrameProfile(
+    val frameIndex: Long,
+    val startNanos: Long,
+    val durationNanos: Long,
+    val threads: List<ThreadProfile>
+) {
+    val durationMs: Double get() = durationNanos / 1_000_000.0
+
+    /**
+     * Render the frame as an indented text tree, used by the profiler overlays
+     */
+    fun format(maxDepth: Int = Int.MAX_VALUE): String = buildString {
+        appendLine("Frame #$frameIndex - ${"%.2f".format(durationMs)}ms")
+        threads.forEach { thread ->
+            appendNode(thread.root, 1, maxDepth)
+        }
+    }
+
+    private fun StringBuilder.appendNode(node: ProfileNode, depth: Int, maxDepth: Int) {
+        if (depth > maxDepth) return
+        append("  ".repeat(depth))
+        append(node.name)
+        append("  ")
+        append("%.3f".format(node.inclusiveNanos / 1_000_000.0))
+        append("ms")
+        if (node.calls > 1) append(" x${node.calls}")
+        appendLine()
+        node.children.sortedByDescending { it.inclusiveNanos }.forEach { appendNode(it, depth + 1, maxDepth) }
+    }
+}
+
+data class ThreadProfile(
+    val threadId: Long,
+    val threadName: String,
+    val root: ProfileNode
+)
+
+/**
+ * One node of the per-frame zone tree. Repeated calls to the same zone under the
+ * same parent are merged into a single node.
+ */
+class ProfileNode(val name: String) {
+    var inclusiveNanos: Long = 0
+        internal set
+    var calls: Int = 0
+        private set
+
+    private val _children = ArrayList<ProfileNode>(4)
+    val children: List<ProfileNode> get() = _children
+
+    val exclusiveNanos: Long get() = inclusiveNanos - _children.sumOf { it.inclusiveNanos }
+
+    internal fun child(name: String): ProfileNode {
+        for (child in _children) {
+            if (child.name == name) return child
+        }
+        return ProfileNode(name).also { _children.add(it) }
+    }
+
+    internal fun add(nanos: Long) {
+        inclusiveNanos += nanos
+        calls++
+    }
+
+    fun find(name: String): ProfileNode? {
+        if (this.name == name) return this
+        for (child in _children) {
+            child.find(name)?.let { return it }
+        }
+        return null
+    }
+}
@@ -0,0 +1,71 @@
+package com.linkpoint.core.quality
+
+import java.lang.management.ManagementFactory
+
+/**
+ * What the hardware can be expected to sustain, detected once at startup.
+ *
+ * The [ceiling] is the highest [QualityLevel] the viewer will use on this
+ * device no matter how good the runtime signals look; the weakest of CPU,
+ * RAM and GPU decides it.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLFeatureManager GPU class / memory based defaults
+ * - Android media performance class
+ */
+data class DeviceProfile(
+    val cores: Int,
+    val ramClass: RamClass,
+    val gpuTier: GpuTier
+) {
+    enum class RamClass {
+        LOW, MID, HIGH;
+
+        companion object {
+            private const val GB = 1024L * 1024 * 1024
+
+            fun of(totalBytes: Long): RamClass = when {
+                totalBytes < 3 * GB -> LOW
+                totalBytes < 6 * GB -> MID
+                else -> HIGH
+            }
+        }
+    }
+
+    /** Hint only: platforms report GPUs too inconsistently for more than three buckets */
+    enum class GpuTier { LOW, MID, HIGH, UNKNOWN }
+
+    val ceiling: QualityLevel get() {
+        val cpu = when {
+            cores <= 4 -> 0
+            cores <= 6 -> 1
+            else -> 2
+        }
+        val gpu = if (gpuTier == GpuTier.UNKNOWN) 1 else gpuTier.ordinal
+        return when (minOf(cpu, ramClass.ordinal, gpu)) {
+            0 -> QualityLevel.LOW
+            1 -> QualityLevel.MEDIUM
+            else -> if (cores >= 8 && gpuTier == GpuTier.HIGH) QualityLevel.ULTRA else QualityLevel.HIGH
+        }
+    }
+
+    companion object {
+        /**
+         * Best-effort profile for the JVM host (desktop); Android builds its
+         * own from ActivityManager and the GL ES version
+         */
+        fun detect(): DeviceProfile {
+            val totalMemory = try {
+                (ManagementFactory.getOperatingSystemMXBean() as? com.sun.management.OperatingSystemMXBean)
+                    ?.totalPhysicalMemorySize
+            } catch (e: Throwable) {
+                null
+            }
+            return DeviceProfile(
+                cores = Runtime.getRuntime().availableProcessors(),
+                ramClass = totalMemory?.let { RamClass.of(it) } ?: RamClass.MID,
+                gpuTier = GpuTier.UNKNOWN
+            )
+        }
+    }
+}
@@ -0,0 +1,172 @@
+package com.linkpoint.core.quality
+
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import mu.KotlinLogging
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Everything the quality controller turns together, as one step on a ladder
+ *
+ * [audio] names the audio module's AudioQuality of the same name; core stays
+ * independent of the subsystems it steers.
+ */
+enum class QualityLevel(
+    val drawDistance: Float,
+    val textureBudgetBytes: Long,
+    val audio: AudioLevel,
+    val maxParticles: Int,
+    /** Total simulator throttle, bits per second */
+    val bandwidthBps: Float
+) {
+    MINIMAL(32f, 64L * MB, AudioLevel.LOW, 64, 250_000f),
+    LOW(64f, 128L * MB, AudioLevel.LOW, 256, 500_000f),
+    MEDIUM(96f, 256L * MB, AudioLevel.MEDIUM, 1024, 1_000_000f),
+    HIGH(128f, 512L * MB, AudioLevel.HIGH, 4096, 1_500_000f),
+    ULTRA(256f, 1024L * MB, AudioLevel.ULTRA, 8192, 3_000_000f);
+
+    fun lower(): QualityLevel = values()[maxOf(0, ordinal - 1)]
+    fun higher(): QualityLevel = values()[minOf(values().size - 1, ordinal + 1)]
+}
+
+private const val MB = 1024L * 1024
+
+enum class AudioLevel { LOW, MEDIUM, HIGH, ULTRA }
+
+/**
+ * Platform thermal status, in the order of Android's PowerManager.THERMAL_STATUS_*
+ */
+enum class ThermalState {
+    NONE, LIGHT, MODERATE, SEVERE, CRITICAL, EMERGENCY, SHUTDOWN;
+
+    companion object {
+        private val ALL = values()
+
+        fun fromPowerManager(status: Int): ThermalState = ALL.getOrElse(status) { NONE }
+    }
+}
+
+/**
+ * One sample of runtime conditions. [frameTimeMs] is null when no frame was
+ * drawn since the last sample (e.g. the 3D view is hidden)
+ */
+data class QualitySignals(
+    val thermal: ThermalState = ThermalState.NONE,
+    val batterySaver: Boolean = false,
+    val frameTimeMs: Float? = null
+)
+
+/**
+ * Picks one [QualityLevel] from the device's ceiling and runtime signals.
+ *
+ * Thermal status and battery saver are hard caps applied at once: MODERATE
+ * heat drops one step below the device ceiling, SEVERE to [QualityLevel.LOW],
+ * CRITICAL and worse to [QualityLevel.MINIMAL]; battery saver caps at LOW.
+ * Within the cap, a smoothed frame time steers: sustained frames slower than
+ * the target step down (at most once per [downDwellMs]), sustained headroom
+ * steps up one level after [upDwellMs]. A cap being lifted never jumps back
+ * up; recovery goes through the same headroom rule one step at a time. An
+ * upgrade that has to be undone soon after doubles the wait before the next
+ * one, so a device that can't hold a level stops oscillating around it;
+ * after [stableResetMs] without a slow-frame step down the wait is back to
+ * [upDwellMs], so one bad stretch doesn't slow recovery for the whole session.
+ *
+ * Feed it about once a second with the mean frame time since the last
+ * sample. Time is passed in, so the controller can be driven by recorded or
+ * synthetic traces.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's auto-tune (LLPerfStats) frame-time driven settings
+ *   reduction
+ * - Android Dynamic Performance Framework / thermal headroom guidance
+ */
+class QualityController(
+    val device: DeviceProfile,
+    private val targetFrameMs: Float = 1000f / 30,
+    private val downDwellMs: Long = 2_000,
+    private val upDwellMs: Long = 10_000,
+    private val maxUpDwellMs: Long = 120_000,
+    private val stableResetMs: Long = 300_000
+) {
+    private val _level = MutableStateFlow(device.ceiling)
+    val level: StateFlow<QualityLevel> = _level.asStateFlow()
+
+    /** Why the level last changed, for diagnostics */
+    var reason: String = "device ceiling"
+        private set
+
+    private var averageFrameMs = -1f
+    private var lastChangeAt = Long.MIN_VALUE / 2
+    private var headroomSince = -1L
+    private var lastUpgradeAt = Long.MIN_VALUE / 2
+    private var currentUpDwellMs = upDwellMs
+    private var lastSlowDownAt = Long.MIN_VALUE / 2
+
+    /**
+     * Feed one sample taken at [nowMs]
+     *
+     * @return the level to use from now on
+     */
+    fun onSignals(signals: QualitySignals, nowMs: Long): QualityLevel {
+        signals.frameTimeMs?.let { frame ->
+            averageFrameMs = if (averageFrameMs < 0) frame else averageFrameMs + (frame - averageFrameMs) * SMOOTHING
+        }
+        if (currentUpDwellMs > upDwellMs && nowMs - lastSlowDownAt >= stableResetMs) {
+            currentUpDwellMs = upDwellMs
+        }
+        val current = _level.value
+        val thermalCap = thermalCap(signals.thermal)
+        val batteryCap = if (signals.batterySaver) QualityLevel.LOW else QualityLevel.ULTRA
+        val cap = minOf(thermalCap, batteryCap)
+
+        when {
+            current > cap -> {
+                change(cap, nowMs, if (batteryCap < thermalCap) "battery saver" else "thermal ${signals.thermal}")
+                headroomSince = -1
+            }
+            signals.frameTimeMs != null && averageFrameMs > targetFrameMs * SLOW_FACTOR -> {
+                headroomSince = -1
+                if (current > QualityLevel.MINIMAL && nowMs - lastChangeAt >= downDwellMs) {
+                    if (nowMs - lastUpgradeAt < currentUpDwellMs) {
+                        currentUpDwellMs = minOf(currentUpDwellMs * 2, maxUpDwellMs)
+                    }
+                    change(current.lower(), nowMs, "frame time %.1f ms".format(averageFrameMs))
+                    lastSlowDownAt = nowMs
+                }
+            }
+            signals.frameTimeMs != null && averageFrameMs < targetFrameMs * HEADROOM_FACTOR && current < cap -> {
+                if (headroomSince < 0) headroomSince = nowMs
+                if (nowMs - headroomSince >= currentUpDwellMs && nowMs - lastChangeAt >= currentUpDwellMs) {
+                    change(current.higher(), nowMs, "headroom at %.1f ms".format(averageFrameMs))
+                    lastUpgradeAt = nowMs
+                    headroomSince = nowMs
+                }
+            }
+            else -> headroomSince = -1
+        }
+        return _level.value
+    }
+
+    private fun thermalCap(thermal: ThermalState): QualityLevel = when (thermal) {
+        ThermalState.NONE, ThermalState.LIGHT -> device.ceiling
+        ThermalState.MODERATE -> device.ceiling.lower()
+        ThermalState.SEVERE -> minOf(device.ceiling, QualityLevel.LOW)
+        else -> QualityLevel.MINIMAL
+    }
+
+    private fun change(level: QualityLevel, nowMs: Long, why: String) {
+        if (level == _level.value) return
+        logger.info { "Quality ${_level.value} -> $level ($why)" }
+        _level.value = level
+        reason = why
+        lastChangeAt = nowMs
+    }
+
+    private companion object {
+        const val SMOOTHING = 0.25f
+        const val SLOW_FACTOR = 1.2f
+        const val HEADROOM_FACTOR = 0.75f
+    }
+}
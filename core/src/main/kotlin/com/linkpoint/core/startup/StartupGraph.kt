@@ -0,0 +1,156 @@
+package com.linkpoint.core.startup
+
+import com.linkpoint.core.profiling.Profiler
+import kotlinx.coroutines.CoroutineDispatcher
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.Deferred
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.ExperimentalCoroutinesApi
+import kotlinx.coroutines.async
+import mu.KotlinLogging
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * When a subsystem is initialised
+ */
+enum class StartupMode {
+    /** Needed to reach the interactive screen; started by [StartupGraph.start] */
+    EAGER,
+    /** Useful soon but not on the critical path; started by [StartupGraph.startBackground] */
+    BACKGROUND,
+    /** Only initialised when something first awaits it */
+    LAZY
+}
+
+/**
+ * Reference to a registered subsystem. Awaiting it triggers initialisation of
+ * the subsystem and its dependencies if they have not started yet.
+ */
+class StartupHandle<T> internal constructor(
+    val name: String,
+    internal val deferred: Deferred<T>
+) {
+    suspend fun get(): T = deferred.await()
+
+    val isReady: Boolean get() = deferred.isCompleted && !deferred.isCancelled
+
+    /** The initialised value, or null if it is not ready yet */
+    @OptIn(ExperimentalCoroutinesApi::class)
+    fun getOrNull(): T? = if (isReady) deferred.getCompleted() else null
+}
+
+/**
+ * Dependency graph of viewer subsystems, initialised lazily or in parallel.
+ *
+ * Each subsystem declares the subsystems it depends on and is initialised on its
+ * own dispatcher once they are ready, so independent subsystems come up
+ * concurrently and nothing blocks the caller's thread. Every initialisation is
+ * recorded in [trace] (and in the profiler when enabled).
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLAppViewer::init() staged startup
+ * - Android's App Startup library (Initializer dependencies)
+ */
+class StartupGraph(
+    private val scope: CoroutineScope,
+    val trace: StartupTrace = StartupTrace()
+) {
+    private class Node(
+        val name: String,
+        val dependsOn: List<String>,
+        val mode: StartupMode,
+        val deferred: Deferred<*>
+    )
+
+    private val nodes = LinkedHashMap<String, Node>()
+
+    /**
+     * Register a subsystem. Dependencies must be registered before the graph is started.
+     *
+     * @param dispatcher where [init] runs; use Dispatchers.IO for disk or network work
+     */
+    fun <T> register(
+        name: String,
+        dependsOn: List<String> = emptyList(),
+        mode: StartupMode = StartupMode.EAGER,
+        dispatcher: CoroutineDispatcher = Dispatchers.Default,
+        init: suspend () -> T
+    ): StartupHandle<T> {
+        check(name !in nodes) { "Subsystem '$name' is already registered" }
+
+        val deferred = scope.async(dispatcher, start = CoroutineStart.LAZY) {
+            val queued = System.nanoTime()
+            dependsOn.forEach { dependency -> nodes.getValue(dependency).deferred.await() }
+
+            val zone = Profiler.zone("Startup/$name")
+            val mark = Profiler.mark()
+            val started = System.nanoTime()
+            try {
+                init()
+            } finally {
+                Profiler.record(zone, mark)
+                trace.record(name, Thread.currentThread().name, queued, started, System.nanoTime())
+            }
+        }
+
+        nodes[name] = Node(name, dependsOn, mode, deferred)
+        return StartupHandle(name, deferred)
+    }
+
+    /**
+     * Validate the graph and start every [StartupMode.EAGER] subsystem. An
+     * invalid graph cancels every subsystem, so none is left pending in [scope]
+     */
+    fun start() {
+        try {
+            validate()
+        } catch (e: IllegalStateException) {
+            nodes.values.forEach { it.deferred.cancel() }
+            throw e
+        }
+        startAll(StartupMode.EAGER)
+    }
+
+    /**
+     * Start every [StartupMode.BACKGROUND] subsystem, typically once the first
+     * screen is interactive
+     */
+    fun startBackground() = startAll(StartupMode.BACKGROUND)
+
+    /**
+     * Wait for every subsystem that has been started so far
+     */
+    suspend fun awaitStarted() {
+        nodes.values.filter { it.deferred.isActive || it.deferred.isCompleted }.forEach { it.deferred.await() }
+    }
+
+    private fun startAll(mode: StartupMode) {
+        nodes.values.filter { it.mode == mode }.forEach { node ->
+            logger.debug { "Starting ${node.mode} subsystem ${node.name}" }
+            node.deferred.start()
+        }
+    }
+
+    /**
+     * Reject unknown dependencies and cycles before anything runs; a cycle would
+     * otherwise deadlock silently
+     */
+    private fun validate() {
+        val visiting = HashSet<String>()
+        val done = HashSet<String>()
+
+        fun visit(name: String, path: List<String>) {
+            if (name in done) return
+            check(name !in visiting) { "Startup dependency cycle: ${(path + name).joinToString(" -> ")}" }
+            val node = checkNotNull(nodes[name]) { "Unknown startup dependency '$name' required by ${path.lastOrNull()}" }
+            visiting += name
+            node.dependsOn.forEach { visit(it, path + name) }
+            visiting -= name
+            done += name
+        }
+
+        nodes.keys.forEach { visit(it, emptyList()) }
+    }
+}
@@ -0,0 +1,99 @@
+package com.linkpoint.core.startup
+
+import java.util.concurrent.CopyOnWriteArrayList
+
+/**
+ * Timeline of subsystem initialisation and startup milestones.
+ *
+ * Times are relative to [originNanos] (a System.nanoTime() value). By default that
+ * is when the trace was created; on Android pass the process start so milestones
+ * read as time since cold start.
+ */
+class StartupTrace(val originNanos: Long = System.nanoTime()) {
+
+    /**
+     * One subsystem initialisation. [waitMs] is the time spent waiting for
+     * dependencies, [durationMs] the time spent in its own init.
+     */
+    data class Span(
+        val name: String,
+        val thread: String,
+        val queuedNanos: Long,
+        val startNanos: Long,
+        val endNanos: Long
+    ) {
+        val waitMs: Double get() = (startNanos - queuedNanos) / 1_000_000.0
+        val durationMs: Double get() = (endNanos - startNanos) / 1_000_000.0
+    }
+
+    data class Milestone(val name: String, val nanos: Long)
+
+    private val _spans = CopyOnWriteArrayList<Span>()
+    private val _milestones = CopyOnWriteArrayList<Milestone>()
+
+    val spans: List<Span> get() = _spans
+    val milestones: List<Milestone> get() = _milestones
+
+    internal fun record(name: String, thread: String, queuedNanos: Long, startNanos: Long, endNanos: Long) {
+        _spans += Span(name, thread, queuedNanos, startNanos, endNanos)
+    }
+
+    /**
+     * Mark a point such as "login-screen-interactive"; returns ms since origin
+     */
+    fun milestone(name: String): Double {
+        val now = System.nanoTime()
+        _milestones += Milestone(name, now)
+        return sinceOriginMs(now)
+    }
+
+    fun milestoneMs(name: String): Double? = _milestones.firstOrNull { it.name == name }?.let { sinceOriginMs(it.nanos) }
+
+    private fun sinceOriginMs(nanos: Long): Double = (nanos - originNanos) / 1_000_000.0
+
+    /**
+     * Human-readable timeline, one line per span/milestone in start order
+     */
+    fun format(): String = buildString {
+        appendLine("Startup trace")
+        val events = _spans.map { it.startNanos to it } + _milestones.map { it.nanos to it }
+        events.sortedBy { it.first }.forEach { (_, event) ->
+            when (event) {
+                is Span -> appendLine(
+                    "  %8.1fms  %-20s %7.1fms  (waited %.1fms, %s)".format(
+                        sinceOriginMs(event.startNanos), event.name, event.durationMs, event.waitMs, event.thread
+                    )
+                )
+                is Milestone -> appendLine("  %8.1fms  * %s".format(sinceOriginMs(event.nanos), event.name))
+            }
+        }
+    }
+
+    /**
+     * Chrome trace event JSON (complete events per span, instant events per milestone)
+     */
+    fun exportChromeTrace(out: Appendable) {
+        out.append("{\"traceEvents\":[")
+        var first = true
+        fun separator() {
+            if (!first) out.append(",")
+            first = false
+        }
+        _spans.forEach { span ->
+            separator()
+            out.append("{\"name\":\"").append(span.name).append("\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":")
+                .append(micros(span.startNanos)).append(",\"dur\":").append(durationMicros(span.endNanos - span.startNanos))
+                .append(",\"pid\":1,\"tid\":\"").append(span.thread).append("\"}")
+        }
+        _milestones.forEach { milestone ->
+            separator()
+            out.append("{\"name\":\"").append(milestone.name).append("\",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"g\",\"ts\":")
+                .append(micros(milestone.nanos)).append(",\"pid\":1,\"tid\":\"main\"}")
+        }
+        out.append("]}\n")
+    }
+
+    private fun micros(nanos: Long): String = durationMicros(nanos - originNanos)
+
+    private fun durationMicros(nanos: Long): String = "%.3f".format(java.util.Locale.ROOT, nanos / 1000.0)
+}
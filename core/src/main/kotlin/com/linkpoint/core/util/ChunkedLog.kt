@@ -0,0 +1,114 @@
+package com.linkpoint.core.util
+
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Immutable, append-only list with structural sharing, for transcripts and
+ * logs that are published as UI state after every append.
+ *
+ * Items live in fixed-size chunks shared between versions. [append] fills the
+ * next free slot of the last chunk in place (older versions never read past
+ * their own size) and only allocates a new chunk every [CHUNK_SIZE] items, so
+ * appending is O(1) amortised instead of copying the whole list. When [capacity]
+ * is exceeded the oldest item is dropped, releasing whole chunks as they empty.
+ *
+ * Every item has a [sequence] number that never changes while it is in the
+ * list, suitable as a stable key for list rows.
+ */
+class ChunkedLog<T> private constructor(
+    private val chunks: Array<Chunk>,
+    private val head: Int,
+    override val size: Int,
+    /** Sequence number of the item at index 0 */
+    val firstSequence: Long,
+    val capacity: Int
+) : AbstractList<T>(), RandomAccess {
+
+    private class Chunk {
+        val items = arrayOfNulls<Any>(CHUNK_SIZE)
+        // Slots handed out so far; a version may only write the slot after its last
+        val claimed = AtomicInteger(0)
+    }
+
+    /** Sequence number the next appended item will get */
+    val nextSequence: Long get() = firstSequence + size
+
+    @Suppress("UNCHECKED_CAST")
+    override fun get(index: Int): T {
+        if (index < 0 || index >= size) throw IndexOutOfBoundsException("Index $index, size $size")
+        val position = head + index
+        return chunks[position / CHUNK_SIZE].items[position % CHUNK_SIZE] as T
+    }
+
+    fun sequence(index: Int): Long = firstSequence + index
+
+    /** Index of the item with [sequence], or -1 if it has been dropped or not added yet */
+    fun indexOfSequence(sequence: Long): Int =
+        if (sequence < firstSequence || sequence >= nextSequence) -1 else (sequence - firstSequence).toInt()
+
+    /**
+     * A new version with [item] at the end, dropping the oldest item if the
+     * log is full. This version is unchanged.
+     */
+    fun append(item: T): ChunkedLog<T> {
+        val position = head + size
+        val slot = position % CHUNK_SIZE
+        var newChunks = chunks
+        val tail = if (slot == 0) null else chunks[position / CHUNK_SIZE]
+
+        if (tail != null && tail.claimed.compareAndSet(slot, slot + 1)) {
+            tail.items[slot] = item
+        } else {
+            // New chunk, or another version already appended from this one: copy the tail
+            val chunk = Chunk()
+            if (tail != null) System.arraycopy(tail.items, 0, chunk.items, 0, slot)
+            chunk.items[slot] = item
+            chunk.claimed.set(slot + 1)
+            newChunks = if (tail == null) chunks.plusChunk(chunk) else chunks.copyOf().also { it[it.size - 1] = chunk }
+        }
+
+        val grown = ChunkedLog<T>(newChunks, head, size + 1, firstSequence, capacity)
+        return if (grown.size > capacity) grown.dropOldest(grown.size - capacity) else grown
+    }
+
+    /**
+     * A new version with the newest item replaced, e.g. to update a coalesced
+     * line's repeat count. Copies the last chunk.
+     */
+    fun replaceLast(item: T): ChunkedLog<T> {
+        if (size == 0) throw NoSuchElementException("Log is empty")
+        val position = head + size - 1
+        val chunkIndex = position / CHUNK_SIZE
+        val slot = position % CHUNK_SIZE
+        val chunk = Chunk()
+        System.arraycopy(chunks[chunkIndex].items, 0, chunk.items, 0, slot)
+        chunk.items[slot] = item
+        chunk.claimed.set(slot + 1)
+        val newChunks = chunks.copyOf().also { it[chunkIndex] = chunk }
+        return ChunkedLog(newChunks, head, size, firstSequence, capacity)
+    }
+
+    /**
+     * A new version without the oldest [count] items
+     */
+    fun dropOldest(count: Int): ChunkedLog<T> {
+        if (count <= 0) return this
+        if (count >= size) return ChunkedLog(emptyArray(), 0, 0, nextSequence, capacity)
+        val newHead = head + count
+        val freedChunks = newHead / CHUNK_SIZE
+        val newChunks = if (freedChunks == 0) chunks else chunks.copyOfRange(freedChunks, chunks.size)
+        return ChunkedLog(newChunks, newHead % CHUNK_SIZE, size - count, firstSequence + count, capacity)
+    }
+
+    companion object {
+        const val CHUNK_SIZE = 32
+
+        fun <T> empty(capacity: Int = Int.MAX_VALUE): ChunkedLog<T> {
+            require(capacity > 0) { "Capacity must be positive" }
+            return ChunkedLog(emptyArray(), 0, 0, 0, capacity)
+        }
+
+        private fun Array<Chunk>.plusChunk(chunk: Chunk): Array<Chunk> =
+            Array(size + 1) { if (it < size) this[it] else chunk }
+    }
+}
@@ -0,0 +1,51 @@
+package com.linkpoint.core.util
+
+/**
+ * Token bucket rate limiter.
+ *
+ * Holds up to [capacity] tokens and refills at [refillPerSecond]; each unit of
+ * work takes one or more tokens, so short bursts up to [capacity] pass while the
+ * sustained rate is held to [refillPerSecond]. Refill is computed lazily from
+ * [clock] on each call, so an idle bucket costs nothing.
+ *
+ * @param clock monotonic time source in nanoseconds
+ */
+class TokenBucket(
+    val capacity: Double,
+    val refillPerSecond: Double,
+    private val clock: () -> Long = System::nanoTime
+) {
+    private var tokens = capacity
+    private var lastRefillNanos = clock()
+
+    /**
+     * Take [count] tokens if available
+     *
+     * @return false, taking nothing, if the bucket holds fewer than [count]
+     */
+    @Synchronized
+    fun tryAcquire(count: Int = 1): Boolean {
+        refill()
+        if (tokens < count) return false
+        tokens -= count
+        return true
+    }
+
+    /** Tokens currently available */
+    @Synchronized
+    fun available(): Double {
+        refill()
+        return tokens
+    }
+
+    /** Whether the bucket has refilled completely, i.e. its owner has been quiet */
+    fun isFull(): Boolean = available() >= capacity
+
+    private fun refill() {
+        val now = clock()
+        val elapsed = now - lastRefillNanos
+        if (elapsed <= 0) return
+        tokens = minOf(capacity, tokens + elapsed * refillPerSecond / 1_000_000_000.0)
+        lastRefillNanos = now
+    }
+}
@@ -0,0 +1,52 @@
+package com.linkpoint.core.memory
+
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertSame
+
+/**
+ * Tests for the per-frame arena and object pools
+ */
+class FrameArenaTest {
+
+    @Test
+    fun `should bump allocate and rewind on reset`() {
+        val arena = FrameArena(initialFloats = 32, initialBytes = 16)
+
+        assertEquals(0, arena.allocFloats(16))
+        assertEquals(16, arena.allocFloats(6))
+        assertEquals(0, arena.allocBytes(8))
+
+        arena.reset()
+
+        assertEquals(0, arena.allocFloats(4), "Reset should rewind to the start of the slab")
+        assertEquals(22, arena.floatHighWater, "High water should survive reset")
+        assertEquals(0, arena.growCount)
+    }
+
+    @Test
+    fun `should keep earlier data when a slab grows`() {
+        val arena = FrameArena(initialFloats = 4, initialBytes = 4)
+
+        val first = arena.allocFloats(4)
+        arena.floats[first + 3] = 7f
+        val second = arena.allocFloats(8)
+
+        assertEquals(4, second)
+        assertEquals(7f, arena.floats[first + 3], "Grown slab must preserve this frame's allocations")
+        assertEquals(1, arena.growCount)
+    }
+
+    @Test
+    fun `should reuse released objects`() {
+        val pool = ObjectPool("test", maxIdle = 1, reset = { it.clear() }) { StringBuilder() }
+
+        val a = pool.acquire().append("x")
+        pool.release(a)
+        val b = pool.acquire()
+
+        assertSame(a, b, "Released instance should be handed out again")
+        assertEquals(0, b.length, "Released instances should be reset")
+        assertEquals(1L, pool.stats().reused)
+    }
+}
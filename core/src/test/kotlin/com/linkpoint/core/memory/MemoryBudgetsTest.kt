@@ -0,0 +1,123 @@
+package com.linkpoint.core.memory
+
+import kotlin.test.AfterTest
+import kotlin.test.BeforeTest
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for MemoryBudgets - live byte accounting and priority-ordered pressure fan-out
+ */
+class MemoryBudgetsTest {
+
+    @BeforeTest
+    fun setUp() = MemoryBudgets.reset()
+
+    @AfterTest
+    fun tearDown() = MemoryBudgets.reset()
+
+    @Test
+    fun `should track live and peak bytes`() {
+        val allocator = TrackingAllocator(MemoryBudgets.register("test", 0))
+
+        val a = allocator.bytes(1000)
+        val b = allocator.floats(100)
+        allocator.release(a)
+
+        assertEquals(400L, allocator.account.liveBytes, "Only the float buffer should remain live")
+        assertEquals(1400L, allocator.account.peakBytes, "Peak should include both buffers")
+        allocator.release(b)
+        allocator.release(b)
+        assertEquals(0L, allocator.account.liveBytes, "Double release must not go negative")
+    }
+
+    @Test
+    fun `should shed in priority order and stop once target is met`() {
+        val asked = mutableListOf<String>()
+        lateinit var cheap: MemoryAccount
+        cheap = MemoryBudgets.register("cheap", 0, listener = MemoryPressureListener { _, bytes ->
+            asked += "cheap"
+            cheap.release(bytes)
+            bytes
+        })
+        val expensive = MemoryBudgets.register("expensive", 50, listener = MemoryPressureListener { _, _ ->
+            asked += "expensive"
+            0L
+        })
+        cheap.charge(10_000)
+        expensive.charge(1_000)
+
+        MemoryBudgets.signalPressure(MemoryPressureLevel.MODERATE)
+
+        assertEquals(listOf("cheap"), asked, "Cheap cache alone covers a moderate target")
+
+        asked.clear()
+        MemoryBudgets.signalPressure(MemoryPressureLevel.CRITICAL)
+        assertEquals(listOf("cheap", "expensive"), asked, "Critical pressure reaches every subsystem")
+    }
+
+    @Test
+    fun `should run a critical signal raised during a moderate shed`() {
+        val levels = mutableListOf<MemoryPressureLevel>()
+        lateinit var account: MemoryAccount
+        account = MemoryBudgets.register("escalating", 0, listener = MemoryPressureListener { level, bytes ->
+            levels += level
+            // Freeing makes things worse elsewhere; the system escalates mid-pass
+            if (level == MemoryPressureLevel.MODERATE) {
+                assertEquals(0L, MemoryBudgets.signalPressure(MemoryPressureLevel.CRITICAL), "Queued behind the running pass")
+                MemoryBudgets.signalPressure(MemoryPressureLevel.LOW)
+            }
+            account.release(bytes)
+            bytes
+        })
+        account.charge(10_000)
+
+        MemoryBudgets.signalPressure(MemoryPressureLevel.MODERATE)
+
+        assertEquals(listOf(MemoryPressureLevel.MODERATE, MemoryPressureLevel.CRITICAL), levels, "The highest queued level runs once after the pass")
+    }
+
+    @Test
+    fun `should shed an account that exceeds its budget`() {
+        var requested = 0L
+        lateinit var account: MemoryAccount
+        account = MemoryBudgets.register("capped", 0, budgetBytes = 1_000, listener = MemoryPressureListener { _, bytes ->
+            requested = bytes
+            account.release(bytes)
+            bytes
+        })
+
+        account.charge(1_500)
+
+        assertEquals(500L, requested, "Listener should be asked for the excess over budget")
+        assertTrue(!account.isOverBudget)
+    }
+
+    @Test
+    fun `should ask every instance sharing an account`() {
+        val account = MemoryBudgets.register("shared", 0, budgetBytes = 1_000)
+        val freed = mutableListOf<Long>()
+        val first = MemoryPressureListener { _, bytes -> minOf(bytes, 300L).also { freed += it; account.release(it) } }
+        val second = MemoryPressureListener { _, bytes -> bytes.also { freed += it; account.release(it) } }
+        account.addListener(first)
+        MemoryBudgets.register("shared", 0, budgetBytes = 1_000).addListener(second)
+
+        account.charge(1_500)
+
+        assertEquals(listOf(300L, 200L), freed, "The second instance covers what the first couldn't")
+        account.removeListener(first)
+        account.removeListener(second)
+        freed.clear()
+        account.charge(500)
+        assertTrue(freed.isEmpty(), "Removed instances are not asked")
+    }
+
+    @Test
+    fun `should map Android trim levels`() {
+        assertEquals(MemoryPressureLevel.MODERATE, MemoryPressureLevel.fromTrimLevel(5))
+        assertEquals(MemoryPressureLevel.CRITICAL, MemoryPressureLevel.fromTrimLevel(15))
+        assertEquals(null, MemoryPressureLevel.fromTrimLevel(20))
+        assertEquals(MemoryPressureLevel.CRITICAL, MemoryPressureLevel.fromTrimLevel(80))
+    }
+}
@@ -0,0 +1,87 @@
+package com.linkpoint.core.profiling
+
+import kotlin.test.AfterTest
+import kotlin.test.BeforeTest
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNotNull
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the Profiler - scoped zones, per-frame aggregation and trace export
+ */
+class ProfilerTest {
+
+    private val outer = Profiler.zone("Test/Outer")
+    private val inner = Profiler.zone("Test/Inner")
+
+    @BeforeTest
+    fun setUp() {
+        Profiler.reset()
+        Profiler.isEnabled = true
+    }
+
+    @AfterTest
+    fun tearDown() {
+        Profiler.isEnabled = false
+        Profiler.reset()
+    }
+
+    @Test
+    fun `should aggregate nested zones into a frame tree`() {
+        Profiler.scope(outer) {
+            repeat(3) {
+                Profiler.scope(inner) { Thread.sleep(1) }
+            }
+        }
+
+        val frame = Profiler.endFrame()
+        assertNotNull(frame, "Enabled profiler should produce a frame")
+
+        val outerNode = frame.threads.firstNotNullOfOrNull { it.root.find("Test/Outer") }
+        assertNotNull(outerNode, "Outer zone should be in the tree")
+        assertEquals(1, outerNode.calls, "Outer zone was entered once")
+
+        val innerNode = outerNode.children.single()
+        assertEquals("Test/Inner", innerNode.name, "Inner zone should be nested under outer")
+        assertEquals(3, innerNode.calls, "Repeated inner zones should merge into one node")
+        assertTrue(outerNode.inclusiveNanos >= innerNode.inclusiveNanos, "Parent time includes children")
+    }
+
+    @Test
+    fun `should record nothing when disabled`() {
+        Profiler.isEnabled = false
+
+        val result = Profiler.scope(outer) { 42 }
+
+        assertEquals(42, result, "Block result should pass through")
+        assertNull(Profiler.endFrame(), "Disabled profiler should not produce frames")
+        assertEquals(0L, Profiler.mark(), "mark() should be free when disabled")
+    }
+
+    @Test
+    fun `should only aggregate events since the previous frame`() {
+        Profiler.scope(outer) { }
+        Profiler.endFrame()
+
+        Profiler.scope(inner) { }
+        val frame = assertNotNull(Profiler.endFrame())
+
+        assertNull(frame.threads.firstNotNullOfOrNull { it.root.find("Test/Outer") }, "Previous frame's zones must not leak")
+        assertNotNull(frame.threads.firstNotNullOfOrNull { it.root.find("Test/Inner") })
+    }
+
+    @Test
+    fun `should export begin, end and complete events as Chrome trace`() {
+        Profiler.scope(outer) { }
+        Profiler.record(inner, Profiler.mark())
+
+        val json = StringBuilder().also { ChromeTraceExporter.export(it) }.toString()
+
+        assertTrue(json.startsWith("{\"displayTimeUnit\""), "Should be a trace document")
+        assertTrue(json.contains("\"name\":\"Test/Outer\",\"ph\":\"B\""), "Should contain begin event")
+        assertTrue(json.contains("\"name\":\"Test/Outer\",\"ph\":\"E\""), "Should contain end event")
+        assertTrue(json.contains("\"name\":\"Test/Inner\",\"ph\":\"X\""), "Should contain complete event")
+    }
+}
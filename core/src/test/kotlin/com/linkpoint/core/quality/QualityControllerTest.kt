@@ -0,0 +1,115 @@
+package com.linkpoint.core.quality
+
+import com.linkpoint.core.quality.DeviceProfile.GpuTier
+import com.linkpoint.core.quality.DeviceProfile.RamClass
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the quality controller, driven by synthetic one-sample-per-second traces
+ */
+class QualityControllerTest {
+
+    private val flagship = DeviceProfile(cores = 8, ramClass = RamClass.HIGH, gpuTier = GpuTier.HIGH)
+    private val midRange = DeviceProfile(cores = 8, ramClass = RamClass.HIGH, gpuTier = GpuTier.MID)
+    private val budget = DeviceProfile(cores = 4, ramClass = RamClass.LOW, gpuTier = GpuTier.UNKNOWN)
+
+    private var clock = 0L
+
+    /** Feed [seconds] samples of [signals] and return the level after each */
+    private fun QualityController.play(seconds: Int, signals: QualitySignals): List<QualityLevel> =
+        List(seconds) { onSignals(signals, clock).also { clock += 1000 } }
+
+    @Test
+    fun `device profile should set the ceiling`() {
+        assertEquals(QualityLevel.ULTRA, flagship.ceiling)
+        assertEquals(QualityLevel.MEDIUM, midRange.ceiling)
+        assertEquals(QualityLevel.LOW, budget.ceiling)
+
+        val controller = QualityController(budget)
+        val levels = controller.play(120, QualitySignals(frameTimeMs = 8f))
+        assertTrue(levels.all { it == QualityLevel.LOW }, "Headroom never lifts a device past its ceiling")
+    }
+
+    @Test
+    fun `thermal trace should drop at once and recover one step at a time`() {
+        val controller = QualityController(flagship)
+        val steady = 30f
+        assertEquals(QualityLevel.ULTRA, controller.play(10, QualitySignals(frameTimeMs = steady)).last())
+
+        assertEquals(QualityLevel.HIGH, controller.play(1, QualitySignals(ThermalState.MODERATE, frameTimeMs = steady)).single())
+        assertEquals(QualityLevel.LOW, controller.play(1, QualitySignals(ThermalState.SEVERE, frameTimeMs = steady)).single())
+        assertEquals(QualityLevel.MINIMAL, controller.play(5, QualitySignals(ThermalState.CRITICAL, frameTimeMs = steady)).last())
+        assertEquals("thermal CRITICAL", controller.reason)
+
+        // Cooled down with plenty of headroom
+        val recovery = controller.play(90, QualitySignals(frameTimeMs = 15f))
+        assertEquals(QualityLevel.MINIMAL, recovery[5], "No jump back when the cap lifts")
+        assertEquals(QualityLevel.ULTRA, recovery.last())
+        val changes = recovery.indices.drop(1).filter { recovery[it] != recovery[it - 1] }
+        assertEquals(4, changes.size)
+        changes.forEach { assertEquals(recovery[it - 1].higher(), recovery[it]) }
+        changes.zipWithNext().forEach { (a, b) -> assertTrue(b - a >= 10, "Upgrades are at least 10 s apart") }
+    }
+
+    @Test
+    fun `battery saver should cap at low until it is turned off`() {
+        val controller = QualityController(flagship)
+        val saver = controller.play(30, QualitySignals(batterySaver = true, frameTimeMs = 15f))
+        assertTrue(saver.all { it == QualityLevel.LOW })
+        assertEquals("battery saver", controller.reason)
+
+        val after = controller.play(15, QualitySignals(frameTimeMs = 15f))
+        assertEquals(QualityLevel.LOW, after.first())
+        assertEquals(QualityLevel.MEDIUM, after.last())
+    }
+
+    @Test
+    fun `slow frames should step down no faster than the dwell`() {
+        val controller = QualityController(midRange)
+        val levels = controller.play(10, QualitySignals(frameTimeMs = 50f))
+        assertEquals(QualityLevel.LOW, levels[0])
+        assertEquals(QualityLevel.LOW, levels[1])
+        assertEquals(QualityLevel.MINIMAL, levels[2])
+        assertEquals(QualityLevel.MINIMAL, levels.last())
+        assertTrue(controller.reason.startsWith("frame time"))
+    }
+
+    @Test
+    fun `a level the device cannot hold should be retried less and less often`() {
+        val controller = QualityController(midRange)
+        // Closed loop: anything above LOW misses the frame target
+        var level = controller.level.value
+        var upgrades = 0
+        repeat(600) {
+            val frame = if (level > QualityLevel.LOW) 45f else 20f
+            val next = controller.onSignals(QualitySignals(frameTimeMs = frame), clock)
+            if (next > level) upgrades++
+            level = next
+            clock += 1000
+        }
+        // Without backoff this would retry about every 15 s, ~40 times in ten minutes
+        assertTrue(upgrades in 1..10, "Retried $upgrades times")
+        assertTrue(level <= QualityLevel.MEDIUM)
+    }
+
+    @Test
+    fun `backoff should wear off once the device has held its level for a while`() {
+        val controller = QualityController(midRange)
+        var level = controller.level.value
+        repeat(600) {
+            val frame = if (level > QualityLevel.LOW) 45f else 20f
+            level = controller.onSignals(QualitySignals(frameTimeMs = frame), clock)
+            clock += 1000
+        }
+
+        // Whatever slowed it down is gone: back at the ceiling and holding for six minutes
+        assertEquals(QualityLevel.MEDIUM, controller.play(360, QualitySignals(frameTimeMs = 15f)).last())
+
+        // One slow stretch recovers at the normal 10 s pace, not the backed-off two minutes
+        assertEquals(QualityLevel.LOW, controller.play(6, QualitySignals(frameTimeMs = 50f)).last())
+        val recovery = controller.play(20, QualitySignals(frameTimeMs = 15f))
+        assertEquals(QualityLevel.MEDIUM, recovery.last())
+    }
+}
@@ -0,0 +1,59 @@
+package com.linkpoint.core.startup
+
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.runBlocking
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFailsWith
+import kotlin.test.assertFalse
+import kotlin.test.assertTrue
+
+/**
+ * Tests for dependency-ordered subsystem startup
+ */
+class StartupGraphTest {
+
+    @Test
+    fun `should initialise dependencies before dependents`() = runBlocking {
+        coroutineScope {
+            val order = java.util.Collections.synchronizedList(mutableListOf<String>())
+            val graph = StartupGraph(this)
+            graph.register("core") { order += "core" }
+            val login = graph.register("login", dependsOn = listOf("core")) { order += "login"; "ready" }
+
+            graph.start()
+
+            assertEquals("ready", login.get())
+            assertEquals(listOf("core", "login"), order)
+            assertEquals(setOf("core", "login"), graph.trace.spans.map { it.name }.toSet())
+        }
+    }
+
+    @Test
+    fun `should not start lazy subsystems until awaited`() = runBlocking {
+        coroutineScope {
+            val graph = StartupGraph(this)
+            val renderer = graph.register("renderer", mode = StartupMode.LAZY) { 42 }
+
+            graph.start()
+            graph.awaitStarted()
+
+            assertFalse(renderer.isReady, "Lazy subsystem should wait for its first use")
+            assertEquals(42, renderer.get())
+            assertTrue(renderer.isReady)
+        }
+    }
+
+    @Test
+    fun `should reject dependency cycles`() = runBlocking {
+        coroutineScope {
+            val graph = StartupGraph(this)
+            val a = graph.register("a", dependsOn = listOf("b")) {}
+            graph.register("b", dependsOn = listOf("a")) {}
+
+            assertFailsWith<IllegalStateException> { graph.start() }
+            // Cancelled, so this scope can complete instead of waiting on the lazy nodes
+            assertTrue(a.deferred.isCancelled)
+        }
+    }
+}
@@ -0,0 +1,37 @@
+package com.linkpoint.core.util
+
+import kotlin.test.Test
+import kotlin.test.assertEquals
+
+/**
+ * Tests for the structurally shared append-only log
+ */
+class ChunkedLogTest {
+
+    @Test
+    fun `should leave earlier versions unchanged`() {
+        var log = ChunkedLog.empty<Int>()
+        repeat(40) { log = log.append(it) }
+        val snapshot = log
+
+        val a = snapshot.append(100)
+        val b = snapshot.append(200) // Branches from the same version; must not overwrite a
+
+        assertEquals(40, snapshot.size)
+        assertEquals(100, a.last())
+        assertEquals(200, b.last())
+        assertEquals((0 until 40).toList(), snapshot.toList())
+    }
+
+    @Test
+    fun `should drop oldest items past capacity with stable sequences`() {
+        var log = ChunkedLog.empty<String>(capacity = 50)
+        repeat(120) { log = log.append("line $it") }
+
+        assertEquals(50, log.size)
+        assertEquals("line 70", log[0])
+        assertEquals(70L, log.sequence(0))
+        assertEquals(49, log.indexOfSequence(119))
+        assertEquals(-1, log.indexOfSequence(69))
+    }
+}
@@ -1,5 +1,6 @@
 package com.linkpoint.graphics.cameras
 
+import com.linkpoint.protocol.RLVProcessor
 import com.linkpoint.protocol.data.*
 import kotlin.math.*
 
@@ -64,11 +65,12 @@ class ViewerCamera {
     private var transitionSpeed = 5.0f           // Camera transition speed
     private var lastUpdateTime = System.currentTimeMillis()
     
-    // RLV camera restrictions (from Restrained Love Viewer)
-    private var isRLVRestricted = false
-    private var rlvMinDistance = 2.0f
-    private var rlvMaxDistance = 50.0f
-    private var rlvLockedFocus: Vector3? = null
+    // RLV camera restrictions (from Restrained Love Viewer); [bindRLV] sets
+    // them on the thread processing RLV commands
+    @Volatile private var isRLVRestricted = false
+    @Volatile private var rlvMinDistance = 2.0f
+    @Volatile private var rlvMaxDistance = 50.0f
+    @Volatile private var rlvLockedFocus: Vector3? = null
     
     // Camera collision detection
     private var collisionEnabled = true
@@ -298,6 +300,26 @@ class ViewerCamera {
         }
     }
     
+    /**
+     * Follow [rlv]'s camera distance restrictions (@camzoommin:<m>=n, @camzoommax:<m>=n).
+     * The processor notifies once per command list, so a relay re-sending its
+     * whole restriction set updates the camera once.
+     */
+    fun bindRLV(rlv: RLVProcessor) {
+        rlv.addRestrictionListener { changed ->
+            if (changed.none { it.category == RLVProcessor.RLVCommandCategory.CAMERA }) return@addRestrictionListener
+            
+            // The most restrictive limit from any object wins
+            val minDistance = rlv.getRestrictionOptions(RLVProcessor.RLVCommand.CAMZOOMMIN).mapNotNull { it.toFloatOrNull() }.maxOrNull()
+            val maxDistance = rlv.getRestrictionOptions(RLVProcessor.RLVCommand.CAMZOOMMAX).mapNotNull { it.toFloatOrNull() }.minOrNull()
+            if (minDistance == null && maxDistance == null) {
+                removeRLVCameraRestrictions()
+            } else {
+                applyRLVCameraRestriction(minDistance ?: 2.0f, maxDistance ?: 50.0f, rlvLockedFocus)
+            }
+        }
+    }
+    
     /**
      * Remove RLV camera restrictions
      */
@@ -1,8 +1,27 @@
 package com.linkpoint.graphics.rendering
 
+import com.linkpoint.core.memory.FrameArena
+import com.linkpoint.core.memory.MemoryBudgets
+import com.linkpoint.core.memory.MemoryPressureLevel
+import com.linkpoint.core.memory.MemoryPressureListener
+import com.linkpoint.core.memory.ObjectPool
+import com.linkpoint.core.profiling.Profiler
 import com.linkpoint.protocol.data.*
 import java.nio.ByteBuffer
 import java.nio.FloatBuffer
+import kotlin.math.sqrt
+
+// Profiler zones for the render pipeline passes
+private val ZONE_FRAME = Profiler.zone("Render/Frame")
+private val ZONE_CULL = Profiler.zone("Render/FrustumCull")
+private val ZONE_SORT = Profiler.zone("Render/SortQueues")
+private val ZONE_TERRAIN = Profiler.zone("Render/Terrain")
+private val ZONE_OPAQUE = Profiler.zone("Render/Opaque")
+private val ZONE_AVATARS = Profiler.zone("Render/Avatars")
+private val ZONE_ALPHA = Profiler.zone("Render/Alpha")
+private val ZONE_PARTICLES = Profiler.zone("Render/Particles")
+private val ZONE_POST = Profiler.zone("Render/PostProcess")
+private val ZONE_PRESENT = Profiler.zone("Render/Present")
 
 /**
  * OpenGL-based 3D Renderer for Virtual World Content
@@ -23,11 +42,16 @@ import java.nio.FloatBuffer
  * - Batch rendering for similar objects to reduce draw calls
  * - Deferred shading for complex lighting scenarios
  * - Shadow mapping for realistic lighting
+ * 
+ * Graphics API calls go through [backend]; the caller must drive the renderer
+ * from the thread where the backend's context is current.
  */
-class OpenGLRenderer {
+class OpenGLRenderer(val backend: RenderBackend = HeadlessRenderBackend) {
     
     // OpenGL state management
     private var isInitialized = false
+    // False between onContextLost and onContextRestored; frames are skipped meanwhile
+    private var hasContext = false
     private var viewportWidth = 1024
     private var viewportHeight = 768
     
@@ -37,6 +61,19 @@ class OpenGLRenderer {
     private var texturesLoaded = 0
     private var frameTime = 0.0f
     
+    /** Farthest distance drawn, metres; tighter than the camera's far plane when quality is scaled down */
+    @Volatile var drawDistance: Float = Float.MAX_VALUE
+    
+    /** Particles drawn per frame across all systems */
+    @Volatile var particleBudget: Int = Int.MAX_VALUE
+    private var particlesQueued = 0
+    
+    /** Screen pixels per texture for the frame being drawn, filled in by culling */
+    val textureCoverage = TextureCoverage()
+    
+    /** Told about [textureCoverage] each frame, e.g. to reorder texture fetches */
+    @Volatile var coverageListener: TextureCoverage.Listener? = null
+    
     // Rendering queues organized by material and transparency
     // Based on SecondLife viewer's LLDrawPool system
     private val opaqueRenderQueue = mutableListOf<RenderableObject>()
@@ -45,20 +82,39 @@ class OpenGLRenderer {
     private val terrainRenderQueue = mutableListOf<RenderableTerrain>()
     private val avatarRenderQueue = mutableListOf<RenderableAvatar>()
     
+    // Per-frame transient data: renderables are pooled and recycled when the frame
+    // ends, matrices and bounds live in the frame arena (rewound every frame)
+    private val renderablePool = ObjectPool("render.object", maxIdle = 4096) { RenderableObject() }
+    private val frameArena = FrameArena()
+    private val visibleEntities = ArrayList<WorldEntity>()
+    private val materialCache = HashMap<java.util.UUID?, Material>()
+    
+    // Shared mesh geometry, keyed by object type; rebuilt on demand after eviction
+    private val meshCache = java.util.concurrent.ConcurrentHashMap<ObjectType, MeshData>()
+    private val meshAccount = MemoryBudgets.register(
+        MemoryBudgets.MESHES,
+        MemoryBudgets.PRIORITY_MESHES,
+        listener = MemoryPressureListener { level, bytes -> evictMeshes(level, bytes) }
+    )
+    
     /**
      * Represents a renderable object in the graphics pipeline
      * Based on SecondLife viewer's LLViewerObject rendering data
+     * 
+     * Instances are pooled and only valid for the frame they were queued in.
+     * World-space bounds are six floats (min xyz, max xyz) in the frame arena
+     * starting at [boundsOffset].
      */
-    data class RenderableObject(
-        val id: String,
-        val meshData: MeshData,
-        val transform: Transform,
-        val material: Material,
-        val lodLevel: Int,
-        val isVisible: Boolean,
-        val distanceFromCamera: Float,
-        val boundingBox: BoundingBox
-    )
+    class RenderableObject {
+        var id: java.util.UUID? = null
+        lateinit var meshData: MeshData
+        val transform = Transform(ZERO_VECTOR, IDENTITY_ROTATION, ONE_VECTOR)
+        lateinit var material: Material
+        var lodLevel: Int = 0
+        var isVisible: Boolean = false
+        var distanceFromCamera: Float = 0.0f
+        var boundsOffset: Int = -1
+    }
     
     /**
      * Represents a renderable avatar with complex animation data
@@ -105,18 +161,48 @@ class OpenGLRenderer {
      * Standard 4x4 transformation matrix for position, rotation, scale
      */
     data class Transform(
-        val position: Vector3,
-        val rotation: Quaternion,
-        val scale: Vector3
+        var position: Vector3,
+        var rotation: Quaternion,
+        var scale: Vector3
     ) {
+        fun set(position: Vector3, rotation: Quaternion, scale: Vector3) {
+            this.position = position
+            this.rotation = rotation
+            this.scale = scale
+        }
+        
         /**
          * Generate 4x4 transformation matrix
          * Following standard OpenGL matrix conventions
          */
-        fun toMatrix4x4(): FloatArray {
-            // Create transformation matrix from position, rotation, scale
-            // This would be implemented with proper matrix math
-            return FloatArray(16) { if (it % 5 == 0) 1.0f else 0.0f } // Identity matrix for demo
+        fun toMatrix4x4(): FloatArray = FloatArray(16).also { writeMatrix4x4(it, 0) }
+        
+        /**
+         * Write the column-major translation * rotation * scale matrix into [dest]
+         * at [offset] without allocating
+         */
+        fun writeMatrix4x4(dest: FloatArray, offset: Int) {
+            val x = rotation.x
+            val y = rotation.y
+            val z = rotation.z
+            val w = rotation.w
+            
+            dest[offset] = (1f - 2f * (y * y + z * z)) * scale.x
+            dest[offset + 1] = 2f * (x * y + z * w) * scale.x
+            dest[offset + 2] = 2f * (x * z - y * w) * scale.x
+            dest[offset + 3] = 0f
+            dest[offset + 4] = 2f * (x * y - z * w) * scale.y
+            dest[offset + 5] = (1f - 2f * (x * x + z * z)) * scale.y
+            dest[offset + 6] = 2f * (y * z + x * w) * scale.y
+            dest[offset + 7] = 0f
+            dest[offset + 8] = 2f * (x * z + y * w) * scale.z
+            dest[offset + 9] = 2f * (y * z - x * w) * scale.z
+            dest[offset + 10] = (1f - 2f * (x * x + y * y)) * scale.z
+            dest[offset + 11] = 0f
+            dest[offset + 12] = position.x
+            dest[offset + 13] = position.y
+            dest[offset + 14] = position.z
+            dest[offset + 15] = 1f
         }
     }
     
@@ -250,6 +336,7 @@ class OpenGLRenderer {
             configureRenderingState()
             
             isInitialized = true
+            hasContext = true
             println("   ✅ OpenGL Renderer initialized successfully")
             return true
             
@@ -267,50 +354,64 @@ class OpenGLRenderer {
         if (!isInitialized) {
             throw IllegalStateException("Renderer not initialized")
         }
+        if (!hasContext) return RenderStats(0, 0, 0f, texturesLoaded)
         
         val frameStartTime = System.nanoTime()
         
         // Reset statistics
         trianglesRendered = 0
         drawCalls = 0
+        particlesQueued = 0
         
         println("🖼️ Rendering Frame...")
         
-        // Step 1: Clear framebuffer (following OpenGL best practices)
-        clearFramebuffer()
-        
-        // Step 2: Update camera matrices
-        updateCameraMatrices(camera)
-        
-        // Step 3: Frustum culling (Firestorm optimization)
-        val visibleObjects = performFrustumCulling(scene, camera)
-        println("   📐 Frustum culling: ${visibleObjects.size} objects visible")
-        
-        // Step 4: Sort objects by rendering priority (SecondLife viewer approach)
-        sortRenderQueues(visibleObjects, camera)
-        
-        // Step 5: Multi-pass rendering pipeline
-        
-        // Pass 1: Render terrain (background, lowest priority)
-        renderTerrain()
-        
-        // Pass 2: Render opaque objects (front-to-back for early Z rejection)
-        renderOpaqueObjects()
-        
-        // Pass 3: Render avatars with complex animation (SecondLife avatar system)
-        renderAvatars()
-        
-        // Pass 4: Render transparent objects (back-to-front for proper blending)
-        renderTransparentObjects()
-        
-        // Pass 5: Render particle effects (additive blending)
-        renderParticleEffects()
+        Profiler.scope(ZONE_FRAME) {
+            // Step 1: Clear framebuffer (following OpenGL best practices)
+            clearFramebuffer()
+            
+            // Step 2: Update camera matrices
+            updateCameraMatrices(camera)
+            
+            // Step 3: Frustum culling (Firestorm optimization), measuring texture coverage on the way
+            textureCoverage.beginFrame(viewportWidth, viewportHeight, camera.fieldOfView)
+            val visibleObjects = Profiler.scope(ZONE_CULL) {
+                performFrustumCulling(scene, camera).also { visible -> visible.forEach { submitForRendering(it) } }
+            }
+            coverageListener?.onCoverage(textureCoverage)
+            println("   📐 Frustum culling: ${visibleObjects.size} objects visible")
+            
+            // Step 4: Sort objects by rendering priority (SecondLife viewer approach)
+            Profiler.scope(ZONE_SORT) { sortRenderQueues(visibleObjects, camera) }
+            
+            // Step 5: Multi-pass rendering pipeline
+            
+            // Pass 1: Render terrain (background, lowest priority)
+            Profiler.scope(ZONE_TERRAIN) { renderTerrain() }
+            
+            // Pass 2: Render opaque objects (front-to-back for early Z rejection)
+            Profiler.scope(ZONE_OPAQUE) { renderOpaqueObjects() }
+            
+            // Pass 3: Render avatars with complex animation (SecondLife avatar system)
+            Profiler.scope(ZONE_AVATARS) { renderAvatars() }
+            
+            // Pass 4: Render transparent objects (back-to-front for proper blending)
+            Profiler.scope(ZONE_ALPHA) { renderTransparentObjects() }
+            
+            // Pass 5: Render particle effects (additive blending)
+            Profiler.scope(ZONE_PARTICLES) { renderParticleEffects() }
+            
+            // Step 6: Post-processing effects (Firestorm enhancements)
+            Profiler.scope(ZONE_POST) { applyPostProcessingEffects() }
+            
+            // Step 7: Present frame
+            Profiler.scope(ZONE_PRESENT) { presentFrame() }
+        }
         
-        // Step 6: Post-processing effects (Firestorm enhancements)
-        applyPostProcessingEffects()
+        // Close the profiler frame so overlays see this frame's zone tree
+        Profiler.endFrame()
         
-        // Step 7: Present frame
-        presentFrame()
+        // Queues are rebuilt every frame; return this frame's transient data
+        recycleFrameData()
         
         // Calculate frame timing
         val frameEndTime = System.nanoTime()
@@ -325,6 +426,9 @@ class OpenGLRenderer {
     /**
      * Add a world entity to the appropriate render queue
      * Based on SecondLife viewer's object categorization system
+     * 
+     * Queues hold entities for the next frame only: the scene's visible entities
+     * are submitted automatically, extra entities must be resubmitted each frame.
      */
     fun submitForRendering(entity: WorldEntity) {
         when (entity) {
@@ -342,11 +446,13 @@ class OpenGLRenderer {
                     } else {
                         opaqueRenderQueue.add(renderable)
                     }
+                } else {
+                    renderablePool.release(renderable)
                 }
             }
             is ParticleSystem -> {
                 val renderable = convertParticleSystemToRenderable(entity)
-                if (renderable.isActive) {
+                if (renderable.isActive && renderable.particles.isNotEmpty()) {
                     particleRenderQueue.add(renderable)
                 }
             }
@@ -363,12 +469,39 @@ class OpenGLRenderer {
         
         println("🔄 Resizing renderer viewport to ${width}x${height}")
         
-        // Update OpenGL viewport
-        // In real implementation: glViewport(0, 0, width, height)
+        if (hasContext) backend.setViewport(width, height)
         
         println("   ✅ Viewport resized successfully")
     }
     
+    /**
+     * The graphics context was destroyed, e.g. the app was paused or the
+     * surface went away. GPU-side state is dropped; CPU-side caches such as
+     * meshes and materials are kept so [onContextRestored] is cheap.
+     */
+    fun onContextLost() {
+        if (!hasContext) return
+        hasContext = false
+        recycleFrameData()
+        backend.onContextLost()
+        println("⏸️ Renderer context lost; GPU resources dropped")
+    }
+    
+    /**
+     * A new context is current on the calling thread: recreate GPU resources
+     * and restore the viewport
+     */
+    fun onContextRestored() {
+        if (!isInitialized || hasContext) return
+        initializeOpenGLContext()
+        initializeShaders()
+        initializeRenderingResources()
+        configureRenderingState()
+        backend.setViewport(viewportWidth, viewportHeight)
+        hasContext = true
+        println("▶️ Renderer context restored")
+    }
+    
     /**
      * Shutdown the renderer and cleanup resources
      * Important for preventing memory leaks
@@ -379,24 +512,24 @@ class OpenGLRenderer {
         println("🛑 Shutting down OpenGL Renderer...")
         
         // Clear render queues
-        opaqueRenderQueue.clear()
-        alphaRenderQueue.clear()
-        particleRenderQueue.clear()
+        recycleFrameData()
         terrainRenderQueue.clear()
-        avatarRenderQueue.clear()
+        evictMeshes(MemoryPressureLevel.CRITICAL, Long.MAX_VALUE)
+        materialCache.clear()
         
         // Cleanup OpenGL resources (textures, buffers, shaders)
         cleanupOpenGLResources()
         
         isInitialized = false
+        hasContext = false
         println("   ✅ OpenGL Renderer shutdown complete")
     }
     
     // Private implementation methods
     
     private fun initializeOpenGLContext() {
-        println("   🔧 Initializing OpenGL context...")
-        // Would use LWJGL or similar library in real implementation
+        println("   🔧 Initializing OpenGL context (${backend.name})...")
+        backend.onContextCreated()
     }
     
     private fun initializeShaders() {
@@ -415,7 +548,7 @@ class OpenGLRenderer {
     }
     
     private fun clearFramebuffer() {
-        // Clear color and depth buffers
+        backend.clear()
     }
     
     private fun updateCameraMatrices(camera: Camera) {
@@ -423,11 +556,55 @@ class OpenGLRenderer {
     }
     
     private fun performFrustumCulling(scene: Scene, camera: Camera): List<WorldEntity> {
-        // Return only objects visible in camera frustum
-        return scene.getAllEntities().filter { entity ->
-            // Simplified visibility check
-            true
+        // Return only objects visible in camera frustum (reuses one list across frames)
+        visibleEntities.clear()
+        val range = minOf(camera.farPlane, drawDistance)
+        val rangeSquared = range * range
+        val eye = camera.position
+        scene.getAllEntities().forEach { entity ->
+            // Simplified visibility check: distance only
+            val dx = entity.position.x - eye.x
+            val dy = entity.position.y - eye.y
+            val dz = entity.position.z - eye.z
+            val distanceSquared = dx * dx + dy * dy + dz * dz
+            if (distanceSquared <= rangeSquared) {
+                visibleEntities.add(entity)
+                if (entity is VirtualObject && entity.textureIds.isNotEmpty()) addTextureCoverage(entity, sqrt(distanceSquared))
+            }
         }
+        return visibleEntities
+    }
+    
+    /**
+     * Add each face of [obj]'s bounding box to [textureCoverage]: face 0 is the
+     * top, 1-4 the sides, 5 the bottom, as on a prim box; faces without their
+     * own texture use the first one
+     */
+    private fun addTextureCoverage(obj: VirtualObject, distance: Float) {
+        val textures = obj.textureIds
+        val s = obj.scale
+        for (face in 0 until BOX_FACES) {
+            val area = when (face) {
+                0, 5 -> s.x * s.y
+                1, 3 -> s.x * s.z
+                else -> s.y * s.z
+            }
+            textureCoverage.addFace(if (face < textures.size) textures[face] else textures[0], area, distance)
+        }
+    }
+    
+    /**
+     * Return pooled renderables and rewind the frame arena. Terrain patches are
+     * long-lived and stay queued.
+     */
+    private fun recycleFrameData() {
+        opaqueRenderQueue.forEach { renderablePool.release(it) }
+        alphaRenderQueue.forEach { renderablePool.release(it) }
+        opaqueRenderQueue.clear()
+        alphaRenderQueue.clear()
+        particleRenderQueue.clear()
+        avatarRenderQueue.clear()
+        frameArena.reset()
     }
     
     private fun sortRenderQueues(objects: List<WorldEntity>, camera: Camera) {
@@ -447,6 +624,10 @@ class OpenGLRenderer {
     private fun renderOpaqueObjects() {
         println("   📦 Rendering ${opaqueRenderQueue.size} opaque objects...")
         opaqueRenderQueue.forEach { obj ->
+            // Model matrix for the draw call; in real implementation: glUniformMatrix4fv(...)
+            // Allocate first: growing the arena replaces its array
+            val model = frameArena.allocFloats(16)
+            obj.transform.writeMatrix4x4(frameArena.floats, model)
             trianglesRendered += obj.meshData.triangleCount
             drawCalls++
         }
@@ -470,6 +651,8 @@ class OpenGLRenderer {
     private fun renderTransparentObjects() {
         println("   🌊 Rendering ${alphaRenderQueue.size} transparent objects...")
         alphaRenderQueue.forEach { obj ->
+            val model = frameArena.allocFloats(16)
+            obj.transform.writeMatrix4x4(frameArena.floats, model)
             trianglesRendered += obj.meshData.triangleCount
             drawCalls++
         }
@@ -489,7 +672,7 @@ class OpenGLRenderer {
     }
     
     private fun presentFrame() {
-        // Swap buffers to present the rendered frame
+        if (!backend.present()) println("   ⚠️ Frame dropped: surface lost")
     }
     
     private fun cleanupOpenGLResources() {
@@ -513,16 +696,16 @@ class OpenGLRenderer {
     }
     
     private fun convertObjectToRenderable(obj: VirtualObject): RenderableObject {
-        return RenderableObject(
-            id = obj.id.toString(),
-            meshData = createObjectMesh(obj.objectType),
-            transform = Transform(obj.position, obj.rotation, obj.scale),
-            material = createMaterial(obj.material, obj.textureIds),
-            lodLevel = calculateLOD(obj.position),
-            isVisible = true,
-            distanceFromCamera = 0.0f, // Would calculate actual distance
-            boundingBox = calculateBoundingBox(obj)
-        )
+        return renderablePool.acquire().apply {
+            id = obj.id
+            meshData = createObjectMesh(obj.objectType)
+            transform.set(obj.position, obj.rotation, obj.scale)
+            material = createMaterial(obj.material, obj.textureIds)
+            lodLevel = calculateLOD(obj.position)
+            isVisible = true
+            distanceFromCamera = 0.0f // Would calculate actual distance
+            boundsOffset = calculateBoundingBox(obj)
+        }
     }
     
     private fun convertParticleSystemToRenderable(particles: ParticleSystem): RenderableParticle {
@@ -555,12 +738,37 @@ class OpenGLRenderer {
     }
     
     private fun createObjectMesh(type: ObjectType): MeshData {
-        // Create mesh based on object type (cube, sphere, etc.)
-        return when (type) {
+        // Create mesh based on object type (cube, sphere, etc.), sharing geometry between objects
+        meshCache[type]?.let { return it }
+        val mesh = when (type) {
             ObjectType.PRIMITIVE -> createCubeMesh()
             ObjectType.MESH -> createCustomMesh()
             else -> createCubeMesh()
         }
+        return meshCache.putIfAbsent(type, mesh) ?: mesh.also { meshAccount.charge(meshBytes(it)) }
+    }
+    
+    /**
+     * Bytes held by a mesh's vertex attribute buffers and index array
+     */
+    private fun meshBytes(mesh: MeshData): Long =
+        (mesh.vertices.capacity() + mesh.normals.capacity() + mesh.texCoords.capacity()) * 4L + mesh.indices.size * 4L
+    
+    /**
+     * Memory pressure handler: drop cached meshes. Queued renderables keep their
+     * references, so only geometry not used by the current frame is reclaimed.
+     */
+    private fun evictMeshes(level: MemoryPressureLevel, bytesToFree: Long): Long {
+        var freed = 0L
+        for ((type, mesh) in meshCache.entries.toList()) {
+            if (level != MemoryPressureLevel.CRITICAL && freed >= bytesToFree) break
+            if (meshCache.remove(type, mesh)) {
+                val bytes = meshBytes(mesh)
+                meshAccount.release(bytes)
+                freed += bytes
+            }
+        }
+        return freed
     }
     
     private fun createCubeMesh(): MeshData {
@@ -582,6 +790,11 @@ class OpenGLRenderer {
     }
     
     private fun createMaterial(materialType: ObjectMaterial, textureIds: List<java.util.UUID>): Material {
+        // Materials are immutable and shared by every object using the same diffuse texture
+        return materialCache.getOrPut(textureIds.firstOrNull()) { buildMaterial(textureIds) }
+    }
+    
+    private fun buildMaterial(textureIds: List<java.util.UUID>): Material {
         return Material(
             diffuseTexture = textureIds.firstOrNull()?.toString(),
             normalTexture = null,
@@ -598,8 +811,10 @@ class OpenGLRenderer {
     }
     
     private fun createParticleInstances(system: ParticleSystem): List<ParticleInstance> {
-        // Create particle instances based on system parameters
-        return (0 until 10).map { // Generate 10 demo particles
+        // Create particle instances based on system parameters, within the frame's particle budget
+        val count = minOf(10, particleBudget - particlesQueued).coerceAtLeast(0) // Up to 10 demo particles
+        particlesQueued += count
+        return (0 until count).map {
             ParticleInstance(
                 position = system.position,
                 velocity = Vector3(0f, 1f, 0f),
@@ -617,12 +832,22 @@ class OpenGLRenderer {
         return 0 // Placeholder
     }
     
-    private fun calculateBoundingBox(obj: VirtualObject): BoundingBox {
-        val halfScale = Vector3(obj.scale.x / 2, obj.scale.y / 2, obj.scale.z / 2)
-        return BoundingBox(
-            Vector3(obj.position.x - halfScale.x, obj.position.y - halfScale.y, obj.position.z - halfScale.z),
-            Vector3(obj.position.x + halfScale.x, obj.position.y + halfScale.y, obj.position.z + halfScale.z)
-        )
+    /**
+     * Write the object's axis-aligned bounds into the frame arena and return the offset
+     */
+    private fun calculateBoundingBox(obj: VirtualObject): Int {
+        val offset = frameArena.allocFloats(6)
+        val bounds = frameArena.floats
+        val halfX = obj.scale.x / 2
+        val halfY = obj.scale.y / 2
+        val halfZ = obj.scale.z / 2
+        bounds[offset] = obj.position.x - halfX
+        bounds[offset + 1] = obj.position.y - halfY
+        bounds[offset + 2] = obj.position.z - halfZ
+        bounds[offset + 3] = obj.position.x + halfX
+        bounds[offset + 4] = obj.position.y + halfY
+        bounds[offset + 5] = obj.position.z + halfZ
+        return offset
     }
     
     // Data classes for external interfaces
@@ -651,4 +876,11 @@ class OpenGLRenderer {
     
     fun isInitialized(): Boolean = isInitialized
     fun getViewportSize(): Pair<Int, Int> = viewportWidth to viewportHeight
+    
+    companion object {
+        private val ZERO_VECTOR = Vector3(0f, 0f, 0f)
+        private val ONE_VECTOR = Vector3(1f, 1f, 1f)
+        private val IDENTITY_ROTATION = Quaternion(0f, 0f, 0f, 1f)
+        private const val BOX_FACES = 6
+    }
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+package com.linkpoint.graphics.rendering
+
+/**
+ * Platform half of [OpenGLRenderer]: owns the actual graphics API calls for
+ * context setup, viewport, clear and present, so the pipeline itself stays
+ * platform-neutral.
+ *
+ * Every method is called on the thread that has the context current; the
+ * host that owns that thread (e.g. the Android render host) drives the
+ * renderer from it.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLWindow / LLGLManager split between window system
+ *   and pipeline
+ */
+interface RenderBackend {
+    val name: String
+
+    /** A context is current: set up default state and create GPU objects */
+    fun onContextCreated()
+
+    /**
+     * The context was destroyed (app paused, surface or context lost).
+     * GPU handles are already invalid; forget them without deleting
+     */
+    fun onContextLost()
+
+    fun setViewport(width: Int, height: Int)
+
+    fun clear()
+
+    /**
+     * Show the finished frame
+     *
+     * @return false if the surface or context is gone and the frame was dropped
+     */
+    fun present(): Boolean
+}
+
+/**
+ * [RenderBackend] that issues no graphics calls, for tests, benchmarks and
+ * hosts without a display
+ */
+object HeadlessRenderBackend : RenderBackend {
+    override val name = "headless"
+    override fun onContextCreated() {}
+    override fun onContextLost() {}
+    override fun setViewport(width: Int, height: Int) {}
+    override fun clear() {}
+    override fun present() = true
+}
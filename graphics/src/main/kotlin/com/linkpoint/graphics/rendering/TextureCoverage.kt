@@ -0,0 +1,109 @@
+package com.linkpoint.graphics.rendering
+
+import java.util.UUID
+import kotlin.math.sqrt
+import kotlin.math.tan
+
+/**
+ * Screen pixels each texture covers in the current frame, collected during
+ * culling so texture fetches can be ordered by what the user actually sees.
+ *
+ * Every visible face adds its area projected at its distance from the eye;
+ * a texture keeps the largest of its faces (the one that decides how sharp
+ * it needs to be), clamped to the viewport. [desiredDiscard] turns that into
+ * the JPEG2000 discard level worth fetching: 0 is full resolution, each
+ * level halves both dimensions.
+ *
+ * Slots are reused across frames, so collecting allocates nothing once the
+ * set of textures in view has settled.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLViewerTexture "max virtual size" and
+ *   LLViewerTextureList::updateImageDecodePriority
+ */
+class TextureCoverage {
+
+    /** Gets the coverage once per frame, after culling; called on the render thread */
+    fun interface Listener {
+        fun onCoverage(coverage: TextureCoverage)
+    }
+
+    private class Slot {
+        var pixels = 0f
+        var frame = -1L
+    }
+
+    private val slots = HashMap<UUID, Slot>()
+    private var frame = 0L
+    private var pixelsPerSteradian = 0f
+
+    /** Viewport area in pixels, the most any texture can cover */
+    var screenPixels = 0f
+        private set
+
+    /**
+     * Start a frame for a [viewportWidth] × [viewportHeight] view with a
+     * vertical [fieldOfView] in degrees
+     */
+    fun beginFrame(viewportWidth: Int, viewportHeight: Int, fieldOfView: Float) {
+        frame++
+        screenPixels = viewportWidth.toFloat() * viewportHeight
+        val focalPixels = viewportHeight / 2f / tan(Math.toRadians(fieldOfView / 2.0)).toFloat()
+        pixelsPerSteradian = focalPixels * focalPixels
+        if (frame % SWEEP_FRAMES == 0L) slots.values.removeIf { frame - it.frame > SWEEP_FRAMES }
+    }
+
+    /**
+     * A visible face of [area] square metres textured with [textureId], at
+     * [distance] metres from the eye
+     */
+    fun addFace(textureId: UUID, area: Float, distance: Float) {
+        val d = maxOf(distance, MIN_DISTANCE)
+        val pixels = minOf(area * pixelsPerSteradian / (d * d), screenPixels)
+        val slot = slots.getOrPut(textureId) { Slot() }
+        if (slot.frame != frame) {
+            slot.frame = frame
+            slot.pixels = pixels
+        } else if (pixels > slot.pixels) {
+            slot.pixels = pixels
+        }
+    }
+
+    /** Pixels [textureId] covers this frame, 0 if not in view */
+    fun pixels(textureId: UUID): Float = slots[textureId]?.takeIf { it.frame == frame }?.pixels ?: 0f
+
+    /** Call [action] with each texture in view this frame, its pixels and desired discard level */
+    fun forEach(action: (textureId: UUID, pixels: Float, desiredDiscard: Int) -> Unit) {
+        for ((id, slot) in slots) {
+            if (slot.frame == frame) action(id, slot.pixels, desiredDiscard(slot.pixels))
+        }
+    }
+
+    companion object {
+        /** Lowest resolution level fetched: 1/32 of each dimension */
+        const val MAX_DISCARD = 5
+
+        /** Assumed full size of a texture whose header hasn't arrived */
+        const val DEFAULT_TEXTURE_SIZE = 1024
+
+        // Faces closer than this are treated as filling the screen anyway
+        private const val MIN_DISTANCE = 0.5f
+        private const val SWEEP_FRAMES = 300L
+
+        /**
+         * Discard level at which a [textureSize] texture still has at least
+         * one texel per covered pixel along each side
+         */
+        fun desiredDiscard(pixels: Float, textureSize: Int = DEFAULT_TEXTURE_SIZE): Int {
+            if (pixels <= 0f) return MAX_DISCARD
+            val side = sqrt(pixels)
+            var size = textureSize
+            var discard = 0
+            while (discard < MAX_DISCARD && size / 2 >= side) {
+                size /= 2
+                discard++
+            }
+            return discard
+        }
+    }
+}
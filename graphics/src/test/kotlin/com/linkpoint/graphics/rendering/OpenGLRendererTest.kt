@@ -0,0 +1,54 @@
+package com.linkpoint.graphics.rendering
+
+import com.linkpoint.core.events.Vector3
+import kotlin.test.Test
+import kotlin.test.assertEquals
+
+/**
+ * Tests for the renderer's handling of a lost graphics context
+ */
+class OpenGLRendererTest {
+
+    private class RecordingBackend : RenderBackend {
+        val calls = mutableListOf<String>()
+        override val name = "recording"
+        override fun onContextCreated() { calls += "created" }
+        override fun onContextLost() { calls += "lost" }
+        override fun setViewport(width: Int, height: Int) { calls += "viewport ${width}x$height" }
+        override fun clear() { calls += "clear" }
+        override fun present(): Boolean {
+            calls += "present"
+            return true
+        }
+    }
+
+    private val camera = OpenGLRenderer.Camera(
+        Vector3(128f, 128f, 30f), Vector3(1f, 0f, 0f), Vector3(0f, 0f, 1f),
+        fieldOfView = 60f, nearPlane = 0.1f, farPlane = 256f
+    )
+
+    @Test
+    fun `should skip frames without a context and recreate GPU state when it is restored`() {
+        val backend = RecordingBackend()
+        val renderer = OpenGLRenderer(backend)
+        val scene = OpenGLRenderer.Scene(emptyList())
+        renderer.initialize()
+        renderer.resize(800, 600)
+        backend.calls.clear()
+
+        renderer.onContextLost()
+        renderer.onContextLost()
+        renderer.renderFrame(camera, scene)
+        assertEquals(listOf("lost"), backend.calls, "Handles are dropped once and nothing is drawn meanwhile")
+
+        backend.calls.clear()
+        renderer.onContextRestored()
+        renderer.onContextRestored()
+        assertEquals(listOf("created", "viewport 800x600"), backend.calls, "The new context gets the GPU objects and viewport again")
+
+        backend.calls.clear()
+        renderer.renderFrame(camera, scene)
+        assertEquals(listOf("clear", "present"), backend.calls)
+        renderer.shutdown()
+    }
+}
@@ -124,8 +124,14 @@ class LoginSystem {
         val lookAt: List<Float>?, // Initial camera look direction
         val agentAccess: String?, // Access level (e.g., "M" for Mature)
         val message: String? = null, // Error message if login failed
-        val reason: String? = null   // Detailed error reason
-    )
+        val reason: String? = null,  // Detailed error reason
+        val inventoryRoot: String? = null, // Folder id of "My Inventory"
+        val regionX: Int = 0, // Global position of the start region, in metres
+        val regionY: Int = 0
+    ) {
+        /** Handle of the start region: global metres, x in the high word */
+        val regionHandle: Long get() = (regionX.toLong() shl 32) or regionY.toLong()
+    }
     
     /**
      * Attempt to log into a SecondLife/OpenSim compatible grid
@@ -359,11 +365,17 @@ class LoginSystem {
             val circuitCode = memberMap["circuit_code"]?.int?.toIntOrNull() ?: 0
             val agentAccess = memberMap["agent_access"]?.string
             val message = memberMap["message"]?.string ?: "Login successful"
+            val regionX = memberMap["region_x"]?.int?.toIntOrNull() ?: 0
+            val regionY = memberMap["region_y"]?.int?.toIntOrNull() ?: 0
             
             // Parse look_at array if present
             val lookAtArray = memberMap["look_at"]?.array?.data?.values
             val lookAt = lookAtArray?.mapNotNull { it.string?.toFloatOrNull() }
             
+            // inventory-root is an array holding one { folder_id } struct
+            val inventoryRoot = memberMap["inventory-root"]?.array?.data?.values?.firstOrNull()
+                ?.struct?.members?.find { it.name == "folder_id" }?.value?.string
+            
             // Check if we have minimum required fields
             if (sessionId == null || agentId == null) {
                 return LoginResponse(
@@ -394,7 +406,10 @@ class LoginSystem {
                 lookAt = lookAt,
                 agentAccess = agentAccess,
                 message = message,
-                reason = null
+                reason = null,
+                inventoryRoot = inventoryRoot,
+                regionX = regionX,
+                regionY = regionY
             )
             
         } catch (e: Exception) {
@@ -0,0 +1,51 @@
+package com.linkpoint.protocol
+
+import java.nio.ByteBuffer
+
+/**
+ * Decoded header of an incoming SecondLife UDP packet
+ * 
+ * Mutable so the receive loop can decode every packet into one instance
+ * without allocating. Based on the packet layout handled by SecondLife
+ * viewer's LLMessageSystem::checkMessages()
+ */
+class PacketHeader {
+    var flags: Int = 0
+        private set
+    var sequenceNumber: Int = 0
+        private set
+    var messageTypeId: Int = -1
+        private set
+    
+    val hasExtraHeader: Boolean get() = (flags and FLAG_EXTRA_HEADER) != 0
+    
+    /**
+     * Decode the header starting at the buffer's position, leaving the buffer
+     * positioned at the message body. The buffer must be little-endian.
+     * 
+     * @return false if the packet is truncated
+     */
+    fun decode(buffer: ByteBuffer): Boolean {
+        if (buffer.remaining() < MIN_PACKET_SIZE) return false
+        
+        flags = buffer.get().toInt() and 0xFF
+        sequenceNumber = buffer.int
+        
+        // Skip extra header if present
+        if (hasExtraHeader) {
+            val extraHeaderSize = buffer.get().toInt() and 0xFF
+            if (buffer.remaining() < extraHeaderSize) return false
+            buffer.position(buffer.position() + extraHeaderSize)
+        }
+        
+        // Parse message type
+        if (buffer.remaining() < 1) return false
+        messageTypeId = buffer.get().toInt() and 0xFF
+        return true
+    }
+    
+    companion object {
+        const val MIN_PACKET_SIZE = 6
+        const val FLAG_EXTRA_HEADER = 0x20
+    }
+}
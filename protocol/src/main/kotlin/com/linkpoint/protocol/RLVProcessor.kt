@@ -2,6 +2,18 @@ package com.linkpoint.protocol
 
 import com.linkpoint.core.events.EventSystem
 import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.core.util.TokenBucket
+import com.linkpoint.protocol.rlv.RLVCommandParser
+import com.linkpoint.protocol.rlv.RLVToken
+import com.linkpoint.protocol.rlv.RestrictionListener
+import com.linkpoint.protocol.rlv.RestrictionTable
+import com.linkpoint.protocol.rlv.SharedFolderIndex
+import mu.KotlinLogging
+import java.util.EnumSet
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicLong
+
+private val logger = KotlinLogging.logger {}
 
 /**
  * Restrained Love Viewer (RLV) Protocol Extension Processor
@@ -25,14 +37,34 @@ import com.linkpoint.core.events.ViewerEvent
  * - Can be globally disabled by user preference
  * - Individual command categories can be disabled
  * - Provides clear user feedback about active restrictions
+ *
+ * Active restrictions are compiled into a [RestrictionTable], so [isRestricted]
+ * is a constant-time, allocation-free check suitable for per-frame callers.
  */
-class RLVProcessor {
+class RLVProcessor(
+    private val rateLimitBurst: Double = RATE_LIMIT_BURST,
+    private val rateLimitPerSecond: Double = RATE_LIMIT_PER_SECOND,
+    private val clock: () -> Long = System::nanoTime,
+    private val replySink: (channel: Int, message: String) -> Unit = ::replyViaChat,
+    // Starts a forced teleport; false if it can't be performed, so @tpto fails
+    private val teleportSink: (globalX: Double, globalY: Double, globalZ: Double) -> Boolean = { _, _, _ -> false }
+) {
     
     // RLV system state
     private var isRLVEnabled = true
     private var rlvVersion = "2.9.0" // Compatible version
-    private val activeRestrictions = mutableMapOf<String, RLVRestriction>()
-    private val blacklistedCommands = mutableSetOf<String>()
+    private val restrictions = RestrictionTable()
+    private val blacklistedCommands = EnumSet.noneOf(RLVCommand::class.java)
+    
+    // Who set what, for status display; only touched when restrictions change
+    private val restrictionRecords = LinkedHashMap<String, MutableMap<String, RLVRestriction>>()
+    
+    // #RLV shared folder tree for inventory queries; null until inventory loads
+    @Volatile private var sharedFolders: SharedFolderIndex? = null
+    
+    // Per-object command rate limits; a full bucket is the same as none, so those are pruned
+    private val rateLimits = ConcurrentHashMap<String, TokenBucket>()
+    private val droppedCommands = AtomicLong(0)
     
     /**
      * Represents an active RLV restriction
@@ -75,6 +107,7 @@ class RLVProcessor {
         FLY("fly", RLVCommandCategory.MOVEMENT, "Prevent/allow flying"),
         TPLM("tplm", RLVCommandCategory.TELEPORT, "Prevent teleporting to landmarks"),
         TPLOC("tploc", RLVCommandCategory.TELEPORT, "Prevent teleporting to locations"),
+        TPTO("tpto", RLVCommandCategory.TELEPORT, "Force a teleport to global coordinates", true),
         SITTP("sittp", RLVCommandCategory.MOVEMENT, "Prevent/allow sitting on objects"),
         
         // Communication restrictions  
@@ -87,6 +120,12 @@ class RLVProcessor {
         SHOWINV("showinv", RLVCommandCategory.INVENTORY, "Prevent/allow showing inventory"),
         VIEWNOTE("viewnote", RLVCommandCategory.INVENTORY, "Prevent/allow viewing notecards"),
         
+        // Shared folder queries (reply on the channel given as the parameter)
+        GETINV("getinv", RLVCommandCategory.INVENTORY, "List subfolders of a shared folder", true),
+        GETINVWORN("getinvworn", RLVCommandCategory.INVENTORY, "List subfolders of a shared folder with worn state", true),
+        FINDFOLDER("findfolder", RLVCommandCategory.INVENTORY, "Find the first shared folder matching all terms", true),
+        FINDFOLDERS("findfolders", RLVCommandCategory.INVENTORY, "Find every shared folder matching all terms", true),
+        
         // Appearance restrictions
         ADDATTACH("addattach", RLVCommandCategory.ATTACHMENT, "Prevent/allow attaching items", true),
         REMATTACH("remattach", RLVCommandCategory.ATTACHMENT, "Prevent/allow detaching items", true),
@@ -113,7 +152,9 @@ class RLVProcessor {
         VERSIONNEW("versionnew", RLVCommandCategory.DEBUG, "Check if viewer supports newer RLV");
         
         companion object {
-            fun fromString(command: String): RLVCommand? = values().find { it.command == command }
+            private val BY_NAME = values().associateBy { it.command }
+            
+            fun fromString(command: String): RLVCommand? = BY_NAME[command]
         }
     }
     
@@ -125,16 +166,18 @@ class RLVProcessor {
      * - @fly=n (disable flying)
      * - @sendchat=n (disable public chat)
      * - @addattach:skull=n (prevent attaching to skull)
+     * - @sendim:<uuid>=add (allow IMs to one avatar despite @sendim=n)
      * - @version=2550 (reply with version to channel 2550)
+     * - @tpto:256512/255744/30=force (teleport to global coordinates)
      * 
      * @param message The raw RLV command message
      * @param objectId ID of the object sending the command
      * @param objectName Name of the object sending the command
      * @return true if command was processed successfully
      */
-    fun processRLVCommand(message: String, objectId: String, objectName: String): Boolean {
+    fun processRLVCommand(message: CharSequence, objectId: String, objectName: String): Boolean {
         if (!isRLVEnabled) {
-            println("⚠️ RLV is disabled - ignoring command: $message")
+            logger.debug { "RLV is disabled - ignoring command: $message" }
             return false
         }
         
@@ -143,75 +186,61 @@ class RLVProcessor {
             return false // Not an RLV command
         }
         
-        println("🔐 Processing RLV command: $message")
-        println("   From object: $objectName ($objectId)")
+        logger.debug { "Processing RLV command from $objectName ($objectId): $message" }
         
-        try {
-            // Remove @ prefix and split multiple commands
-            val commandString = message.substring(1)
-            val commands = commandString.split(",")
-            
-            var allSuccessful = true
-            
-            commands.forEach { commandPart ->
-                val success = processSingleCommand(commandPart.trim(), objectId, objectName)
-                if (!success) allSuccessful = false
-            }
-            
-            return allSuccessful
-            
-        } catch (e: Exception) {
-            println("💥 Error processing RLV command: ${e.message}")
+        // Each command costs a token, paid for the whole list up front: a script
+        // that outruns its bucket has the list dropped, never half applied
+        val bucket = rateLimits[objectId] ?: run {
+            if (rateLimits.size >= RATE_LIMIT_PRUNE_SIZE) rateLimits.values.removeIf { it.isFull() }
+            rateLimits.getOrPut(objectId) { TokenBucket(rateLimitBurst, rateLimitPerSecond, clock) }
+        }
+        var cost = 0
+        RLVCommandParser.parse(message) { cost++; true }
+        if (!bucket.tryAcquire(cost)) {
+            droppedCommands.incrementAndGet()
+            logger.warn { "RLV commands from $objectName ($objectId) rate limited" }
             return false
         }
+        
+        // Apply the whole list as one change so listeners are notified once
+        var allSuccessful = true
+        restrictions.batch {
+            RLVCommandParser.parse(message) { token ->
+                if (!processSingleCommand(token, objectId, objectName)) allSuccessful = false
+                true
+            }
+        }
+        return allSuccessful
     }
     
     /**
-     * Process a single RLV command part
+     * Process a single RLV command: command[:option][=value]
      */
-    private fun processSingleCommand(commandPart: String, objectId: String, objectName: String): Boolean {
-        // Parse command format: command[=parameter]
-        val parts = commandPart.split("=", limit = 2)
-        val commandWithParam = parts[0]
-        val value = if (parts.size > 1) parts[1] else null
-        
-        // Handle commands with attachment point parameters (e.g., "addattach:skull")
-        val colonIndex = commandWithParam.indexOf(':')
-        val baseCommand = if (colonIndex != -1) commandWithParam.substring(0, colonIndex) else commandWithParam
-        val attachmentParam = if (colonIndex != -1) commandWithParam.substring(colonIndex + 1) else null
-        
+    private fun processSingleCommand(token: RLVToken, objectId: String, objectName: String): Boolean {
         // Find the RLV command
-        val rlvCommand = RLVCommand.fromString(baseCommand)
+        val rlvCommand = token.command
         if (rlvCommand == null) {
-            println("⚠️ Unknown RLV command: $baseCommand")
+            logger.debug { "Unknown RLV command: ${token.behaviour()}" }
             return false
         }
         
         // Check if command is blacklisted
-        if (blacklistedCommands.contains(baseCommand)) {
-            println("🚫 RLV command blocked by user settings: $baseCommand")
+        if (rlvCommand in blacklistedCommands) {
+            logger.debug { "RLV command blocked by user settings: ${rlvCommand.command}" }
             return false
         }
         
-        println("   Command: ${rlvCommand.command} (${rlvCommand.category})")
-        println("   Description: ${rlvCommand.description}")
-        if (attachmentParam != null) println("   Attachment Point: $attachmentParam")
-        if (value != null) println("   Parameter: $value")
-        
         // Process the command based on its type
-        return when (rlvCommand) {
-            RLVCommand.VERSION -> handleVersionCommand(value, objectId)
-            RLVCommand.VERSIONNUM -> handleVersionNumCommand(value, objectId)
-            RLVCommand.FLY -> handleMovementRestriction(rlvCommand, value, objectId, objectName)
-            RLVCommand.SENDCHAT -> handleCommunicationRestriction(rlvCommand, value, objectId, objectName)
-            RLVCommand.RECVCHAT -> handleCommunicationRestriction(rlvCommand, value, objectId, objectName)
-            RLVCommand.ADDATTACH -> handleAttachmentRestriction(rlvCommand, attachmentParam, value, objectId, objectName)
-            RLVCommand.REMATTACH -> handleAttachmentRestriction(rlvCommand, attachmentParam, value, objectId, objectName)
-            RLVCommand.TPLM -> handleTeleportRestriction(rlvCommand, value, objectId, objectName)
-            RLVCommand.TPLOC -> handleTeleportRestriction(rlvCommand, value, objectId, objectName)
+        return when {
+            rlvCommand == RLVCommand.VERSION -> handleVersionCommand(token.param(), objectId)
+            rlvCommand == RLVCommand.VERSIONNUM -> handleVersionNumCommand(token.param(), objectId)
+            rlvCommand in SHARED_FOLDER_QUERIES -> handleSharedFolderQuery(rlvCommand, token.option(), token.param())
+            rlvCommand == RLVCommand.TPTO && token.paramEquals("force") -> handleForceTeleport(token.option(), objectName)
+            token.paramEquals("n") || token.paramEquals("add") -> handleRestriction(rlvCommand, token.option(), true, objectId, objectName)
+            token.paramEquals("y") || token.paramEquals("rem") -> handleRestriction(rlvCommand, token.option(), false, objectId, objectName)
             else -> {
-                println("   ✅ Command acknowledged (not yet implemented)")
-                true // Acknowledge but don't implement complex commands yet
+                logger.debug { "RLV command acknowledged (not yet implemented): ${rlvCommand.command}" }
+                true // Acknowledge but don't implement value commands yet
             }
         }
     }
@@ -223,15 +252,7 @@ class RLVProcessor {
         if (channel != null) {
             val channelNum = channel.toIntOrNull()
             if (channelNum != null) {
-                // In a real implementation, this would send a chat message on the specified channel
-                println("   📢 Would reply on channel $channelNum: RestrainedLove viewer v$rlvVersion (Linkpoint-kotlin)")
-                
-                // Simulate sending reply via chat
-                EventSystem.tryEmit(ViewerEvent.ChatReceived(
-                    "RestrainedLove viewer v$rlvVersion (Linkpoint-kotlin)",
-                    "RLV System",
-                    channelNum
-                ))
+                replySink(channelNum, "RestrainedLove viewer v$rlvVersion (Linkpoint-kotlin)")
             }
         }
         return true
@@ -246,116 +267,106 @@ class RLVProcessor {
             if (channelNum != null) {
                 // Convert version to number format (e.g., 2.9.0 -> 2090000)
                 val versionNum = convertVersionToNumber(rlvVersion)
-                println("   📢 Would reply on channel $channelNum: $versionNum")
-                
-                EventSystem.tryEmit(ViewerEvent.ChatReceived(
-                    versionNum.toString(),
-                    "RLV System", 
-                    channelNum
-                ))
+                replySink(channelNum, versionNum.toString())
             }
         }
         return true
     }
     
     /**
-     * Handle movement restrictions (fly, sit, etc.)
+     * Answer @getinv/@getinvworn/@findfolder/@findfolders from the shared
+     * folder index. RLV replies with an empty string when there is nothing to
+     * report, so scripts waiting on the channel are never left hanging.
      */
-    private fun handleMovementRestriction(command: RLVCommand, value: String?, objectId: String, objectName: String): Boolean {
-        val isRestricting = value == "n" // "n" means disable/restrict, "y" means enable/allow
-        val restrictionKey = command.command
-        
-        if (isRestricting) {
-            activeRestrictions[restrictionKey] = RLVRestriction(
-                command = command.command,
-                parameter = null,
-                objectId = objectId,
-                objectName = objectName
-            )
-            println("   🔒 Movement restriction activated: ${command.description}")
-            
-            // Emit event to notify other systems
-            EventSystem.tryEmit(ViewerEvent.MenuActionTriggered("rlv_restriction_${command.command}_added"))
-            
-        } else {
-            activeRestrictions.remove(restrictionKey)
-            println("   🔓 Movement restriction removed: ${command.description}")
-            
-            EventSystem.tryEmit(ViewerEvent.MenuActionTriggered("rlv_restriction_${command.command}_removed"))
+    private fun handleSharedFolderQuery(command: RLVCommand, option: String?, channel: String?): Boolean {
+        val channelNum = channel?.toIntOrNull()?.takeIf { it > 0 } ?: return false
+        val index = sharedFolders
+        if (index == null || isRestricted(RLVCommand.SHOWINV)) {
+            replySink(channelNum, "")
+            return true
         }
         
+        val terms = option?.split("&&")?.filter { it.isNotEmpty() }.orEmpty()
+        val reply = when (command) {
+            RLVCommand.GETINV -> index.getInv(option.orEmpty())
+            RLVCommand.GETINVWORN -> index.getInvWorn(option.orEmpty())
+            RLVCommand.FINDFOLDER -> if (terms.isEmpty()) null else index.findFolder(terms)
+            RLVCommand.FINDFOLDERS -> if (terms.isEmpty()) null else index.findFolders(terms).joinToString(",")
+            else -> null
+        }
+        replySink(channelNum, reply.orEmpty())
         return true
     }
     
     /**
-     * Handle communication restrictions
+     * Force a teleport to "X/Y/Z" in global metres. Like RLV, @tploc also
+     * blocks forced teleports
      */
-    private fun handleCommunicationRestriction(command: RLVCommand, value: String?, objectId: String, objectName: String): Boolean {
-        val isRestricting = value == "n"
-        val restrictionKey = command.command
-        
-        if (isRestricting) {
-            activeRestrictions[restrictionKey] = RLVRestriction(
-                command = command.command,
-                parameter = null,
-                objectId = objectId,
-                objectName = objectName
-            )
-            println("   🔇 Communication restriction activated: ${command.description}")
-        } else {
-            activeRestrictions.remove(restrictionKey)
-            println("   🔊 Communication restriction removed: ${command.description}")
+    private fun handleForceTeleport(option: String?, objectName: String): Boolean {
+        val coordinates = option?.split('/')?.map { it.toDoubleOrNull() ?: return false } ?: return false
+        if (coordinates.size != 3) return false
+        if (isRestricted(RLVCommand.TPLOC)) {
+            logger.debug { "RLV forced teleport from $objectName refused by @tploc" }
+            return false
         }
-        
+        if (!teleportSink(coordinates[0], coordinates[1], coordinates[2])) {
+            logger.debug { "RLV forced teleport from $objectName to $option could not be started" }
+            return false
+        }
+        logger.debug { "RLV forced teleport from $objectName to $option" }
         return true
     }
     
     /**
-     * Handle attachment restrictions
+     * Add or remove a restriction, scoped restriction or exception.
+     *
+     * An option on a behaviour that takes one (e.g. an attachment point) scopes
+     * the restriction to that option; on any other behaviour it is an exception
+     * that lifts the restriction for that option.
      */
-    private fun handleAttachmentRestriction(command: RLVCommand, attachmentPoint: String?, value: String?, objectId: String, objectName: String): Boolean {
-        val isRestricting = value == "n"
-        val restrictionKey = if (attachmentPoint != null) "${command.command}:$attachmentPoint" else command.command
+    private fun handleRestriction(command: RLVCommand, option: String?, isRestricting: Boolean, objectId: String, objectName: String): Boolean {
+        val isException = option != null && !command.hasParameter
+        val changed = when {
+            isException && isRestricting -> restrictions.addException(objectId, command, option!!)
+            isException -> restrictions.removeException(objectId, command, option!!)
+            isRestricting -> restrictions.addRestriction(objectId, command, option)
+            else -> restrictions.removeRestriction(objectId, command, option)
+        }
+        if (!changed) return true // Repeated command from the same object
         
-        if (isRestricting) {
-            activeRestrictions[restrictionKey] = RLVRestriction(
-                command = command.command,
-                parameter = attachmentPoint,
-                objectId = objectId,
-                objectName = objectName
-            )
-            val pointDesc = attachmentPoint ?: "all points"
-            println("   📎 Attachment restriction activated for $pointDesc: ${command.description}")
-        } else {
-            activeRestrictions.remove(restrictionKey)
-            val pointDesc = attachmentPoint ?: "all points"  
-            println("   📎 Attachment restriction removed for $pointDesc: ${command.description}")
+        val key = if (option != null) "${command.command}:$option" else command.command
+        if (!isException) synchronized(restrictionRecords) {
+            if (isRestricting) {
+                restrictionRecords.getOrPut(objectId) { LinkedHashMap() }[key] =
+                    RLVRestriction(command.command, option, objectId, objectName)
+            } else {
+                restrictionRecords[objectId]?.let { records ->
+                    records.remove(key)
+                    if (records.isEmpty()) restrictionRecords.remove(objectId)
+                }
+            }
         }
+        logger.debug { "RLV ${if (isRestricting) "added" else "removed"} ${if (isException) "exception" else "restriction"} $key from $objectName" }
         
+        // Notify other systems when a movement restriction first applies or finally lifts
+        if (command.category == RLVCommandCategory.MOVEMENT && !isException &&
+            restrictions.holders(command, option) == (if (isRestricting) 1 else 0)) {
+            emitMovementChange(command, isRestricting)
+        }
         return true
     }
     
-    /**
-     * Handle teleport restrictions
-     */
-    private fun handleTeleportRestriction(command: RLVCommand, value: String?, objectId: String, objectName: String): Boolean {
-        val isRestricting = value == "n"
-        val restrictionKey = command.command
-        
-        if (isRestricting) {
-            activeRestrictions[restrictionKey] = RLVRestriction(
-                command = command.command,
-                parameter = null,
-                objectId = objectId,
-                objectName = objectName
-            )
-            println("   🚫 Teleport restriction activated: ${command.description}")
-        } else {
-            activeRestrictions.remove(restrictionKey)
-            println("   ✈️ Teleport restriction removed: ${command.description}")
-        }
-        
-        return true
+    private fun emitMovementChange(command: RLVCommand, added: Boolean) {
+        val suffix = if (added) "added" else "removed"
+        EventSystem.tryEmit(ViewerEvent.MenuActionTriggered("rlv_restriction_${command.command}_$suffix"))
+    }
+    
+    // Movement restrictions among [released] that no object holds any more, told as if lifted by command
+    private fun emitLifted(released: Collection<RLVRestriction>) {
+        released.mapNotNull { restriction -> RLVCommand.fromString(restriction.command)?.let { it to restriction.parameter } }
+            .distinct()
+            .filter { (command, option) -> command.category == RLVCommandCategory.MOVEMENT && restrictions.holders(command, option) == 0 }
+            .forEach { (command, _) -> emitMovementChange(command, added = false) }
     }
     
     /**
@@ -375,18 +386,44 @@ class RLVProcessor {
     /**
      * Check if a specific action is restricted by RLV
      */
+    fun isRestricted(command: RLVCommand, parameter: String? = null): Boolean {
+        return isRLVEnabled && restrictions.isRestricted(command, parameter)
+    }
+    
+    /**
+     * Check if a specific action is restricted by RLV, by command name
+     */
     fun isRestricted(action: String, parameter: String? = null): Boolean {
-        if (!isRLVEnabled) return false
-        
-        val key = if (parameter != null) "$action:$parameter" else action
-        return activeRestrictions.containsKey(key) || activeRestrictions.containsKey(action)
+        val command = RLVCommand.fromString(action) ?: return false
+        return isRestricted(command, parameter)
     }
     
+    /**
+     * Be notified once per processed command list with the behaviours it changed
+     */
+    fun addRestrictionListener(listener: RestrictionListener) = restrictions.addListener(listener)
+    
+    fun removeRestrictionListener(listener: RestrictionListener) = restrictions.removeListener(listener)
+    
+    /**
+     * Install the index of the #RLV shared folder, built when inventory loads
+     */
+    fun setSharedFolders(index: SharedFolderIndex?) {
+        sharedFolders = index
+    }
+    
+    /**
+     * Options currently restricted for [command], e.g. camera distance limits
+     */
+    fun getRestrictionOptions(command: RLVCommand): Set<String> = restrictions.scopedOptions(command)
+    
     /**
      * Get all active restrictions
      */
-    fun getActiveRestrictions(): Map<String, RLVRestriction> {
-        return activeRestrictions.toMap()
+    fun getActiveRestrictions(): Map<String, RLVRestriction> = synchronized(restrictionRecords) {
+        val active = LinkedHashMap<String, RLVRestriction>()
+        restrictionRecords.values.forEach { records -> records.forEach { (key, restriction) -> active.putIfAbsent(key, restriction) } }
+        active
     }
     
     /**
@@ -395,10 +432,14 @@ class RLVProcessor {
     fun setRLVEnabled(enabled: Boolean) {
         isRLVEnabled = enabled
         if (!enabled) {
-            activeRestrictions.clear()
-            println("🔓 RLV system disabled - all restrictions cleared")
+            restrictions.clear()
+            val released = synchronized(restrictionRecords) {
+                restrictionRecords.values.flatMap { it.values }.also { restrictionRecords.clear() }
+            }
+            emitLifted(released)
+            logger.info { "RLV system disabled - all restrictions cleared" }
         } else {
-            println("🔐 RLV system enabled")
+            logger.info { "RLV system enabled" }
         }
     }
     
@@ -406,27 +447,29 @@ class RLVProcessor {
      * Add a command to the blacklist
      */
     fun blacklistCommand(command: String) {
-        blacklistedCommands.add(command)
-        println("🚫 RLV command blacklisted: $command")
+        RLVCommand.fromString(command)?.let { blacklistedCommands.add(it) }
+        logger.info { "RLV command blacklisted: $command" }
     }
     
     /**
      * Remove a command from the blacklist
      */
     fun unblacklistCommand(command: String) {
-        blacklistedCommands.remove(command)
-        println("✅ RLV command removed from blacklist: $command")
+        RLVCommand.fromString(command)?.let { blacklistedCommands.remove(it) }
+        logger.info { "RLV command removed from blacklist: $command" }
     }
     
     /**
      * Clear all restrictions from a specific object
      */
     fun clearRestrictionsFromObject(objectId: String) {
-        val toRemove = activeRestrictions.filter { it.value.objectId == objectId }
-        toRemove.forEach { activeRestrictions.remove(it.key) }
+        val released = restrictions.clearSource(objectId)
+        val records = synchronized(restrictionRecords) { restrictionRecords.remove(objectId) }
+        rateLimits.remove(objectId)
+        records?.let { emitLifted(it.values) }
         
-        if (toRemove.isNotEmpty()) {
-            println("🔓 Cleared ${toRemove.size} RLV restrictions from object $objectId")
+        if (released > 0) {
+            logger.debug { "Cleared $released RLV restrictions from object $objectId" }
         }
     }
     
@@ -438,8 +481,10 @@ class RLVProcessor {
             appendLine("RLV System Status:")
             appendLine("  Enabled: $isRLVEnabled")
             appendLine("  Version: $rlvVersion")
+            val activeRestrictions = getActiveRestrictions()
             appendLine("  Active Restrictions: ${activeRestrictions.size}")
             appendLine("  Blacklisted Commands: ${blacklistedCommands.size}")
+            appendLine("  Rate-limited Messages: ${droppedCommands.get()}")
             
             if (activeRestrictions.isNotEmpty()) {
                 appendLine("\nActive Restrictions:")
@@ -450,7 +495,28 @@ class RLVProcessor {
         }
     }
     
+    /** Objects with a rate limit bucket that has not refilled yet, give or take pruning */
+    internal val rateLimitedObjects: Int get() = rateLimits.size
+    
     // Getters
     fun isEnabled(): Boolean = isRLVEnabled
     fun getVersion(): String = rlvVersion
+    
+    companion object {
+        // Relays re-send lists of a few dozen commands; allow a couple of those
+        // in a burst, then roughly one list per second
+        const val RATE_LIMIT_BURST = 128.0
+        const val RATE_LIMIT_PER_SECOND = 64.0
+        // Buckets kept before full ones are dropped
+        const val RATE_LIMIT_PRUNE_SIZE = 256
+        
+        private val SHARED_FOLDER_QUERIES = EnumSet.of(
+            RLVCommand.GETINV, RLVCommand.GETINVWORN, RLVCommand.FINDFOLDER, RLVCommand.FINDFOLDERS
+        )
+        
+        // Until chat sending is wired up, replies are surfaced as chat on the channel
+        private fun replyViaChat(channel: Int, message: String) {
+            EventSystem.tryEmit(ViewerEvent.ChatReceived(message, "RLV System", channel))
+        }
+    }
 }
\ No newline at end of file
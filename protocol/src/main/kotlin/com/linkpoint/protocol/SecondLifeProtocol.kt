@@ -2,7 +2,14 @@ package com.linkpoint.protocol
 
 import com.linkpoint.core.events.EventSystem
 import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.protocol.circuit.CircuitMetrics
+import com.linkpoint.protocol.circuit.CircuitProfile
+import com.linkpoint.protocol.circuit.CircuitRates
+import com.linkpoint.protocol.world.ObjectCacheStats
+import com.linkpoint.protocol.world.ObjectMessage
+import com.linkpoint.protocol.world.RegionObjectCache
 import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.channels.SendChannel
 import kotlinx.coroutines.flow.launchIn
 import kotlinx.coroutines.flow.onEach
 import mu.KotlinLogging
@@ -17,6 +24,9 @@ private val logger = KotlinLogging.logger {}
  * - UDP message handling for simulator communication
  * - HTTP/HTTPS for web services (login, economy, etc.)
  * - Event stream processing
+ * - Switching the simulator circuit between the full foreground profile and
+ *   a chat-only low-power one while the viewer is backgrounded
+ * - Keeping object updates across visits in an [objectCache], when given
  * 
  * Based on protocol implementations from:
  * - libsecondlife/libopenmetaverse libraries
@@ -24,10 +34,38 @@ private val logger = KotlinLogging.logger {}
  * - Firestorm viewer protocol extensions
  * - OpenSimulator protocol documentation
  */
-class SecondLifeProtocol(private val scope: CoroutineScope) {
+class SecondLifeProtocol(
+    private val scope: CoroutineScope,
+    private val objectCache: RegionObjectCache? = null,
+    private val circuit: UDPMessageSystem = UDPMessageSystem(objectCache),
+    private val loginSystem: LoginSystem = LoginSystem()
+) {
     
-    private var isConnected = false
+    @Volatile private var isConnected = false
     private var sessionId: String? = null
+    private var agentId: String? = null
+    // Handle of the region the login placed the agent in: global metres, x in the high word
+    private var regionHandle: Long? = null
+    private var seedCapability: String? = null
+    private var inventoryRoot: String? = null
+    
+    // Start of the current profile's stretch of the circuit, for its rates
+    private var profileSince = 0L
+    private var profileBaseline = CircuitMetrics()
+    
+    /** Pacing of the simulator circuit */
+    val circuitProfile: CircuitProfile get() = circuit.profile
+    
+    /** Hits and bytes saved by the object cache, or null without one */
+    val objectCacheStats: ObjectCacheStats? get() = objectCache?.stats
+    
+    /** Wakeups and traffic on the simulator circuit, while it is up */
+    val circuitMetrics: CircuitMetrics? get() = circuit.metrics
+    
+    /** Receives the circuit's object updates and kills; see [UDPMessageSystem.objectMessages] */
+    var objectMessages: SendChannel<ObjectMessage>?
+        get() = circuit.objectMessages
+        set(value) { circuit.objectMessages = value }
     
     init {
         // Subscribe to relevant events
@@ -37,7 +75,10 @@ class SecondLifeProtocol(private val scope: CoroutineScope) {
     }
     
     /**
-     * Connect to a SecondLife/OpenSim grid
+     * Connect to a SecondLife/OpenSim grid: XML-RPC login, then the UDP
+     * circuit to the simulator the login server assigned
+     * 
+     * @param username "First Last" or "first.last"; a single name is a Resident
      */
     suspend fun connect(
         loginUri: String,
@@ -48,18 +89,31 @@ class SecondLifeProtocol(private val scope: CoroutineScope) {
         logger.info { "Connecting to grid: $loginUri as $username" }
         
         try {
-            // TODO: Implement XML-RPC login request
-            // TODO: Parse login response and extract session info
-            // TODO: Establish UDP connection to simulator
-            // TODO: Send UseCircuitCode packet
-            // TODO: Complete agent connection
+            val names = username.trim().split(' ', '.').filter { it.isNotEmpty() }
+            val login = loginSystem.login(loginUri, LoginSystem.LoginCredentials(
+                firstName = names.firstOrNull() ?: "",
+                lastName = names.getOrNull(1) ?: "Resident",
+                password = password,
+                startLocation = startLocation
+            ))
+            // LoginSystem has reported a refused login
+            if (!login.success) return false
             
-            // Simulate successful connection for now
-            sessionId = "mock-session-${System.currentTimeMillis()}"
-            isConnected = true
+            val simIp = login.simIp
+            if (simIp == null || login.simPort <= 0 || !circuit.connect(simIp, login.simPort, login.circuitCode, login.regionHandle)) {
+                EventSystem.emit(ViewerEvent.ConnectionFailed("Could not open a circuit to the simulator"))
+                return false
+            }
             
-            EventSystem.emit(ViewerEvent.Connected(sessionId!!))
-            logger.info { "Successfully connected with session: $sessionId" }
+            sessionId = login.sessionId
+            agentId = login.agentId
+            regionHandle = login.regionHandle
+            seedCapability = login.seedCapability
+            inventoryRoot = login.inventoryRoot
+            profileSince = System.currentTimeMillis()
+            profileBaseline = circuit.metrics?.snapshot() ?: CircuitMetrics()
+            isConnected = true
+            logger.info { "Connected to ${circuit.getSimulatorEndpoint()} with session: $sessionId" }
             return true
             
         } catch (e: Exception) {
@@ -79,12 +133,16 @@ class SecondLifeProtocol(private val scope: CoroutineScope) {
         
         try {
             // TODO: Send LogoutRequest message
-            // TODO: Close UDP connection
             // TODO: Cleanup resources
+            if (circuit.isConnected()) circuit.disconnect()
             
             isConnected = false
             val currentSessionId = sessionId
             sessionId = null
+            agentId = null
+            regionHandle = null
+            seedCapability = null
+            inventoryRoot = null
             
             if (currentSessionId != null) {
                 EventSystem.emit(ViewerEvent.Disconnected("User initiated disconnect"))
@@ -112,6 +170,46 @@ class SecondLifeProtocol(private val scope: CoroutineScope) {
         // TODO: Handle chat message acknowledgment
     }
     
+    /**
+     * Teleport to ([x], [y], [z]) in region [regionHandle]. Completion arrives
+     * as [ViewerEvent.AvatarTeleported]
+     *
+     * @return false if there is no session or the request could not be sent
+     */
+    suspend fun teleportTo(regionHandle: Long, x: Float, y: Float, z: Float): Boolean {
+        if (!isConnected) {
+            logger.warn { "Cannot teleport - not connected" }
+            return false
+        }
+        return circuit.sendTeleportLocationRequest(regionHandle, x, y, z)
+    }
+    
+    /**
+     * Change how hard the circuit works, e.g. [CircuitProfile.CHAT_ONLY_BACKGROUND]
+     * while nothing is on screen. Chat and IM keep arriving in every profile
+     */
+    fun setCircuitProfile(profile: CircuitProfile) {
+        if (profile == circuit.profile) return
+        logger.info { "Circuit profile: ${circuit.profile.name} -> ${profile.name}" }
+        circuit.metrics?.let { metrics ->
+            circuitRates()?.let { logger.info { "Measured $it" } }
+            profileSince = System.currentTimeMillis()
+            profileBaseline = metrics.snapshot()
+        }
+        circuit.setProfile(profile)
+    }
+    
+    /**
+     * What the circuit has cost since the current profile took over, as
+     * counted by the network thread; null when not connected
+     */
+    fun circuitRates(): CircuitRates? {
+        val metrics = circuit.metrics ?: return null
+        val elapsed = System.currentTimeMillis() - profileSince
+        if (elapsed <= 0) return null
+        return metrics.since(profileBaseline).rates(circuit.profile.name, elapsed)
+    }
+    
     /**
      * Handle incoming events from the event system
      */
@@ -131,4 +229,8 @@ class SecondLifeProtocol(private val scope: CoroutineScope) {
     
     fun isConnected(): Boolean = isConnected
     fun getSessionId(): String? = sessionId
+    fun getAgentId(): String? = agentId
+    fun getRegionHandle(): Long? = regionHandle
+    fun getSeedCapability(): String? = seedCapability
+    fun getInventoryRoot(): String? = inventoryRoot
 }
\ No newline at end of file
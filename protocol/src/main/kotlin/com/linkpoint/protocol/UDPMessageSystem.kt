@@ -1,12 +1,36 @@
 package com.linkpoint.protocol
 
 import com.linkpoint.core.events.EventSystem
+import com.linkpoint.core.events.Vector3
 import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.core.memory.ObjectPool
+import com.linkpoint.core.profiling.Profiler
+import com.linkpoint.protocol.circuit.CircuitMessage
+import com.linkpoint.protocol.circuit.CircuitMetrics
+import com.linkpoint.protocol.circuit.CircuitProfile
+import com.linkpoint.protocol.circuit.CircuitScheduler
+import com.linkpoint.protocol.world.CacheProbe
+import com.linkpoint.protocol.world.CacheMiss
+import com.linkpoint.protocol.world.CacheMissType
+import com.linkpoint.protocol.world.ObjectMessage
+import com.linkpoint.protocol.world.RegionObjectCache
 import java.net.*
 import java.nio.ByteBuffer
 import java.nio.ByteOrder
+import java.nio.channels.ClosedChannelException
+import java.nio.channels.ClosedSelectorException
+import java.nio.channels.DatagramChannel
+import java.nio.channels.SelectionKey
+import java.nio.channels.Selector
 import kotlinx.coroutines.*
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.channels.ClosedSendChannelException
+import kotlinx.coroutines.channels.SendChannel
+import java.util.UUID
 import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicReference
+
+private val ZONE_PROCESS_PACKET = Profiler.zone("Net/ProcessIncomingPacket")
 
 /**
  * UDP Message System for SecondLife/OpenSim Protocol Communication
@@ -25,25 +49,89 @@ import java.util.concurrent.atomic.AtomicBoolean
  * - Circuit code authentication for simulator connections
  * - Message templating and serialization
  * - Bandwidth throttling and priority queuing
+ * - Batched ACKs and AgentUpdate pacing per [CircuitProfile]: the network
+ *   thread selects until a packet arrives or the next scheduled send is due,
+ *   so an idle circuit sleeps; profile changes are handed to that thread
+ * - With an [objectCache], ObjectUpdateCached probes are answered from the
+ *   region's cached updates and only misses are requested; the RegionHandshake's
+ *   cache id drops a region's cache the simulator no longer matches, and the
+ *   cache is flushed every [CACHE_FLUSH_INTERVAL_MS] so a crash loses little.
+ *   Region switches load and write files, so they run on the cache's IO
+ *   coroutine; until it has loaded a region, its objects count as misses
+ * - Object updates and kills also go to [objectMessages] without loss: the
+ *   network thread suspends while that channel is full
  */
-class UDPMessageSystem {
+class UDPMessageSystem(
+    private val objectCache: RegionObjectCache? = null,
+    // Wall clock for the circuit's pacing; tests freeze it
+    private val clock: () -> Long = System::currentTimeMillis
+) {
     
-    private var socket: DatagramSocket? = null
+    // Non-blocking, so the network thread can be woken from [selector]
+    private var channel: DatagramChannel? = null
+    private var selector: Selector? = null
     private var isConnected = false
     private var circuitCode: Int = 0
-    private var simulatorAddress: InetAddress? = null
-    private var simulatorPort: Int = 0
+    private var simulator: InetSocketAddress? = null
     private var sequenceNumber: Int = 0
+    // Region of the simulator at the other end, and its cache id once the handshake told it
+    private var circuitRegion: Long? = null
+    private var regionCacheId: UUID? = null
+    private var regionName = ""
     
     // Message processing control
     private val isProcessing = AtomicBoolean(false)
     private var processingJob: Job? = null
+    // Switches the object cache between regions and flushes it, off the network thread
+    private var cacheJob: Job? = null
+    private val regionSwitches = Channel<RegionSwitch>(Channel.CONFLATED)
+    // Last switch asked for, by the network thread, and the last the cache job completed
+    private var requestedSwitch: RegionSwitch? = null
+    @Volatile private var openedSwitch: RegionSwitch? = null
     private val coroutineScope = CoroutineScope(Dispatchers.IO + SupervisorJob())
     
     // Message tracking for reliability
     private val pendingAcks = mutableMapOf<Int, PendingMessage>()
     private val receivedMessages = mutableSetOf<Int>()
     
+    // Pacing of AgentUpdate and ACKs; exists while connected
+    @Volatile private var scheduler: CircuitScheduler? = null
+    // Set by [setProfile], applied by the network thread
+    private val pendingProfile = AtomicReference<CircuitProfile?>(null)
+    private var throttleGeneration = 0
+    private var lastPingId: Byte = 0
+    
+    /** Requested pacing; change with [setProfile] */
+    @Volatile
+    var profile: CircuitProfile = CircuitProfile.FOREGROUND
+        private set
+    
+    /** Wakeups and traffic since connecting, or null when not connected */
+    val metrics: CircuitMetrics? get() = scheduler?.metrics
+    
+    // Timeout of the network thread's last select, 0 for a poll; -1 before the first
+    @Volatile
+    internal var selectTimeoutMs = -1L
+        private set
+    
+    /**
+     * Where object updates and kills are delivered, in order. Unlike the
+     * [EventSystem] copies, nothing is dropped: a full channel holds up the
+     * network thread until the consumer catches up. A closed channel is
+     * detached.
+     */
+    @Volatile
+    var objectMessages: SendChannel<ObjectMessage>? = null
+    // Gathered while a wakeup's packets are processed, then sent; network thread only
+    private val objectOutbox = ArrayList<ObjectMessage>()
+    
+    // Packets are assembled in pooled MTU-sized buffers and sent from them
+    // directly; only reliable packets are copied out for resend tracking
+    private val sendBuffers = ObjectPool("udp.sendBuffer", maxIdle = 16, reset = { it.clear() }) {
+        ByteBuffer.allocate(MAX_PACKET_SIZE).order(ByteOrder.LITTLE_ENDIAN)
+    }
+    private val packetHeader = PacketHeader() // receive loop only
+    
     /**
      * Represents a message waiting for acknowledgment
      */
@@ -53,7 +141,10 @@ class UDPMessageSystem {
         val timestamp: Long,
         val retryCount: Int = 0
     )
-    
+
+    // A region for the object cache to open; a null cache id keeps the stored one
+    private data class RegionSwitch(val regionHandle: Long, val cacheId: UUID?)
+
     /**
      * Standard SecondLife message types
      * These are the core messages used for avatar movement, object updates, chat, etc.
@@ -63,15 +154,22 @@ class UDPMessageSystem {
         // Connection and handshake messages
         USE_CIRCUIT_CODE(1, "UseCircuitCode", true),
         COMPLETE_AGENT_MOVEMENT(2, "CompleteAgentMovement", true),
+        AGENT_MOVEMENT_COMPLETE(6, "AgentMovementComplete", true),
+        TELEPORT_LOCATION_REQUEST(7, "TeleportLocationRequest", true),
         
         // Avatar and movement messages  
         AGENT_UPDATE(3, "AgentUpdate", false), // High frequency, unreliable
         AGENT_ANIMATION(4, "AgentAnimation", true),
+        AGENT_THROTTLE(5, "AgentThrottle", true),
         
         // Object and world messages
         OBJECT_UPDATE(10, "ObjectUpdate", false),
         OBJECT_UPDATE_COMPRESSED(11, "ObjectUpdateCompressed", false),
         KILL_OBJECT(12, "KillObject", true),
+        OBJECT_UPDATE_CACHED(13, "ObjectUpdateCached", false),
+        REQUEST_MULTIPLE_OBJECTS(14, "RequestMultipleObjects", true),
+        REGION_HANDSHAKE(15, "RegionHandshake", true),
+        COARSE_LOCATION_UPDATE(16, "CoarseLocationUpdate", false),
         
         // Chat and communication
         CHAT_FROM_VIEWER(20, "ChatFromViewer", true),
@@ -83,13 +181,45 @@ class UDPMessageSystem {
         
         // System messages
         PING_PONG_REPLY(100, "PingPongReply", false),
-        START_PING_CHECK(101, "StartPingCheck", false);
+        START_PING_CHECK(101, "StartPingCheck", false),
+        COMPLETE_PING_CHECK(102, "CompletePingCheck", false),
+        PACKET_ACK(251, "PacketAck", false);
         
         companion object {
-            fun fromId(id: Int): MessageType? = values().find { it.id == id }
+            // values() clones the array on every call; this runs once per received packet
+            private val ALL = values()
+            
+            fun fromId(id: Int): MessageType? = ALL.find { it.id == id }
         }
     }
     
+    companion object {
+        private const val MAX_PACKET_SIZE = 1500 // Standard MTU size
+        private val NO_ACKS = IntArray(0)
+        private const val FLAG_APPENDED_ACKS = 0x10
+        // Region handle and block count of ObjectUpdate / ObjectUpdateCached
+        private const val OBJECT_UPDATE_HEADER_BYTES = 9
+        // Local id, CRC and data length of one ObjectUpdate block
+        private const val OBJECT_BLOCK_HEADER_BYTES = 10
+        // Count is one byte; 255 blocks of 5 bytes fit in one packet
+        private const val MAX_REQUEST_BLOCKS = 255
+        // RegionFlags, SimAccess and the SimName length byte of RegionHandshake
+        private const val REGION_HANDSHAKE_HEADER_BYTES = 6
+        // SimOwner, IsEstateManager, WaterHeight and BillableFactor, between SimName and CacheID
+        private const val REGION_HANDSHAKE_SKIP_BYTES = 16 + 1 + 4 + 4
+        
+        /** How often the object cache is written out while connected */
+        const val CACHE_FLUSH_INTERVAL_MS = 60_000L
+        // ChatFromSimulator after the name: two ids, three flag bytes, position, text length
+        private const val CHAT_FIXED_BYTES = 16 + 16 + 3 + 12 + 2
+        // ChatSourceType of an avatar, as opposed to the system or an object
+        private const val CHAT_SOURCE_AGENT = 1
+        // Ids, position, look-at and region handle of AgentMovementComplete
+        private const val AGENT_MOVEMENT_COMPLETE_BYTES = 32 + 12 + 12 + 8
+        // The You and Prey indexes of CoarseLocationUpdate, between the positions and the ids
+        private const val COARSE_INDEX_BYTES = 2 + 2
+    }
+    
     /**
      * Connect to a simulator using the provided session information
      * This establishes the UDP circuit used for real-time communication
@@ -97,20 +227,22 @@ class UDPMessageSystem {
      * @param simAddress Simulator IP address
      * @param simPort Simulator UDP port
      * @param circuitCode Authentication code from login response
+     * @param regionHandle The simulator's region, if known, for its object cache
      */
-    suspend fun connect(simAddress: String, simPort: Int, circuitCode: Int): Boolean {
+    suspend fun connect(simAddress: String, simPort: Int, circuitCode: Int, regionHandle: Long? = null): Boolean {
         println("🌐 Connecting to simulator: $simAddress:$simPort")
         println("   Circuit Code: $circuitCode")
         
         try {
-            // Step 1: Create UDP socket for communication
-            socket = DatagramSocket()
-            socket?.soTimeout = 5000 // 5 second timeout for blocking operations
+            // Step 1: Open a non-blocking UDP channel; the network thread waits on its selector
+            val channel = DatagramChannel.open().apply { configureBlocking(false) }
+            this.channel = channel
+            selector = Selector.open().also { channel.register(it, SelectionKey.OP_READ) }
             
             // Step 2: Store connection parameters
-            this.simulatorAddress = InetAddress.getByName(simAddress)
-            this.simulatorPort = simPort
+            this.simulator = InetSocketAddress(InetAddress.getByName(simAddress), simPort)
             this.circuitCode = circuitCode
+            this.circuitRegion = regionHandle
             
             // Step 3: Send UseCircuitCode message to establish connection
             // This is the first message that must be sent to authenticate with the simulator
@@ -118,14 +250,20 @@ class UDPMessageSystem {
             
             if (success) {
                 isConnected = true
+                scheduler = CircuitScheduler(profile, { message, acks -> sendCircuitMessage(message, acks) }, clock())
                 println("✅ UDP connection established with simulator")
                 
-                // Step 4: Start message processing loop
-                startMessageProcessing()
-                
-                // Step 5: Send CompleteAgentMovement to finish connection setup
+                // Step 4: Send CompleteAgentMovement to finish connection setup
                 sendCompleteAgentMovement()
                 
+                // Step 5: Start message processing; its first act is to tell the
+                // simulator our throttles and interest radius
+                pendingProfile.set(profile)
+                startMessageProcessing()
+                startCacheJob()
+                // Start loading the region's objects before the simulator offers them
+                regionHandle?.let { regionSwitches.trySend(RegionSwitch(it, null)) }
+                
                 return true
             } else {
                 println("❌ Failed to establish UDP connection")
@@ -147,11 +285,8 @@ class UDPMessageSystem {
         println("📤 Sending UseCircuitCode message...")
         
         try {
-            // Build UseCircuitCode message packet
-            val messageData = buildUseCircuitCodeMessage()
-            
-            // Send the message
-            return sendMessage(MessageType.USE_CIRCUIT_CODE, messageData)
+            // Build the UseCircuitCode message in place and send it
+            return sendMessage(MessageType.USE_CIRCUIT_CODE) { writeUseCircuitCodeMessage(it) }
             
         } catch (e: Exception) {
             println("💥 Error sending UseCircuitCode: ${e.message}")
@@ -163,11 +298,8 @@ class UDPMessageSystem {
      * Build UseCircuitCode message following SecondLife protocol format
      * This message structure is defined in the SecondLife message templates
      */
-    private fun buildUseCircuitCodeMessage(): ByteArray {
-        val buffer = ByteBuffer.allocate(256)
-        buffer.order(ByteOrder.LITTLE_ENDIAN) // SecondLife uses little-endian byte order
-        
-        // Message header
+    private fun writeUseCircuitCodeMessage(buffer: ByteBuffer) {
+        // Message header (buffer is little-endian, as SecondLife uses)
         buffer.putInt(MessageType.USE_CIRCUIT_CODE.id)
         buffer.putInt(circuitCode)
         
@@ -177,12 +309,6 @@ class UDPMessageSystem {
         // - Additional authentication data
         
         // For production, implement full message structure as per SecondLife protocol
-        val messageSize = buffer.position()
-        val result = ByteArray(messageSize)
-        buffer.rewind()
-        buffer.get(result)
-        
-        return result
     }
     
     /**
@@ -193,8 +319,7 @@ class UDPMessageSystem {
         println("📤 Sending CompleteAgentMovement message...")
         
         try {
-            val messageData = buildCompleteAgentMovementMessage()
-            return sendMessage(MessageType.COMPLETE_AGENT_MOVEMENT, messageData)
+            return sendMessage(MessageType.COMPLETE_AGENT_MOVEMENT) { writeCompleteAgentMovementMessage(it) }
             
         } catch (e: Exception) {
             println("💥 Error sending CompleteAgentMovement: ${e.message}")
@@ -205,19 +330,9 @@ class UDPMessageSystem {
     /**
      * Build CompleteAgentMovement message
      */
-    private fun buildCompleteAgentMovementMessage(): ByteArray {
-        val buffer = ByteBuffer.allocate(64)
-        buffer.order(ByteOrder.LITTLE_ENDIAN)
-        
+    private fun writeCompleteAgentMovementMessage(buffer: ByteBuffer) {
         buffer.putInt(MessageType.COMPLETE_AGENT_MOVEMENT.id)
         // Additional fields would include agent position, look direction, etc.
-        
-        val messageSize = buffer.position()
-        val result = ByteArray(messageSize)
-        buffer.rewind()
-        buffer.get(result)
-        
-        return result
     }
     
     /**
@@ -225,64 +340,80 @@ class UDPMessageSystem {
      * Handles both reliable and unreliable message delivery
      * 
      * @param messageType The type of message to send
-     * @param messageData The message payload
+     * @param writePayload Writes the message payload into the packet buffer
      * @return true if message was sent successfully
      */
-    private fun sendMessage(messageType: MessageType, messageData: ByteArray): Boolean {
-        if (!isConnected || socket == null || simulatorAddress == null) {
+    private inline fun sendMessage(messageType: MessageType, writePayload: (ByteBuffer) -> Unit): Boolean =
+        sendPacket(messageType, NO_ACKS, writePayload) > 0
+    
+    /**
+     * Send a packet with [appendedAcks] after the payload
+     * 
+     * @return bytes sent, 0 on failure
+     */
+    private inline fun sendPacket(
+        messageType: MessageType,
+        appendedAcks: IntArray,
+        writePayload: (ByteBuffer) -> Unit
+    ): Int {
+        val channel = channel
+        val simulator = simulator
+        if (channel == null || simulator == null) {
             println("⚠️ Cannot send message - not connected to simulator")
-            return false
+            return 0
         }
         
+        val buffer = sendBuffers.acquire()
         try {
-            // Build complete packet with headers
-            val packet = buildPacket(messageType, messageData)
-            
-            // Create UDP datagram
-            val datagram = DatagramPacket(
-                packet, 
-                packet.size, 
-                simulatorAddress, 
-                simulatorPort
-            )
+            // Build complete packet with headers, then the payload in place
+            val packetSequence = writePacketHeader(buffer, messageType)
+            val payloadStart = buffer.position()
+            writePayload(buffer)
+            buffer.putShort(payloadStart - 2, (buffer.position() - payloadStart).toShort())
+            if (appendedAcks.isNotEmpty()) {
+                buffer.put(0, FLAG_APPENDED_ACKS.toByte())
+                for (ack in appendedAcks) buffer.putInt(ack)
+                buffer.put(appendedAcks.size.toByte())
+            }
+            val packetSize = buffer.position()
             
-            // Send the packet
-            socket?.send(datagram)
+            // Send straight from the pooled buffer; a full socket buffer drops the datagram
+            buffer.flip()
+            if (channel.send(buffer, simulator) == 0) {
+                println("⚠️ Send buffer full, dropped ${messageType.name}")
+                return 0
+            }
             
             // For reliable messages, track for acknowledgment
             if (messageType.reliable) {
-                trackPendingMessage(sequenceNumber, packet)
+                trackPendingMessage(packetSequence, buffer.array().copyOf(packetSize))
             }
             
-            println("📤 Sent ${messageType.name} message (${packet.size} bytes)")
-            return true
+            println("📤 Sent ${messageType.name} message ($packetSize bytes)")
+            return packetSize
             
         } catch (e: Exception) {
             println("💥 Error sending message: ${e.message}")
-            return false
+            return 0
+        } finally {
+            sendBuffers.release(buffer)
         }
     }
     
     /**
-     * Build a complete UDP packet with SecondLife protocol headers
+     * Write the SecondLife protocol packet header. The payload size is left as a
+     * placeholder in the last two bytes and patched once the payload is written.
+     * 
+     * @return the sequence number assigned to the packet
      */
-    private fun buildPacket(messageType: MessageType, messageData: ByteArray): ByteArray {
-        val headerSize = 12 // Standard header size
-        val totalSize = headerSize + messageData.size
-        val buffer = ByteBuffer.allocate(totalSize)
-        buffer.order(ByteOrder.LITTLE_ENDIAN)
-        
-        // Packet header (following SecondLife protocol)
+    private fun writePacketHeader(buffer: ByteBuffer, messageType: MessageType): Int {
+        val packetSequence = sequenceNumber++
         buffer.put(0x00) // Flags
         buffer.put(if (messageType.reliable) 0x80.toByte() else 0x00.toByte()) // Reliability flag
-        buffer.putInt(sequenceNumber++)
+        buffer.putInt(packetSequence)
         buffer.putInt(messageType.id)
-        buffer.putShort(messageData.size.toShort())
-        
-        // Message payload
-        buffer.put(messageData)
-        
-        return buffer.array()
+        buffer.putShort(0) // Payload size, patched after the payload is written
+        return packetSequence
     }
     
     /**
@@ -292,10 +423,38 @@ class UDPMessageSystem {
         pendingAcks[seqNum] = PendingMessage(
             sequenceNumber = seqNum,
             messageData = messageData,
-            timestamp = System.currentTimeMillis()
+            timestamp = clock()
         )
     }
     
+    // Off the network thread, so a slow read or write never delays packets
+    private fun startCacheJob() {
+        val cache = objectCache ?: return
+        cacheJob?.cancel()
+        cacheJob = coroutineScope.launch {
+            while (isActive) {
+                val switch = withTimeoutOrNull(CACHE_FLUSH_INTERVAL_MS) { regionSwitches.receive() }
+                if (switch == null) {
+                    cache.flush()
+                } else {
+                    cache.open(switch.regionHandle, switch.cacheId)
+                    openedSwitch = switch
+                }
+            }
+        }
+    }
+    
+    // True once the cache job has opened [regionHandle] under its current cache id;
+    // until then asks for the switch, so the caller treats the region as uncached
+    private fun cacheReady(regionHandle: Long): Boolean {
+        val switch = RegionSwitch(regionHandle, cacheIdOf(regionHandle))
+        if (switch != requestedSwitch) {
+            requestedSwitch = switch
+            regionSwitches.trySend(switch)
+        }
+        return openedSwitch == switch
+    }
+    
     /**
      * Start the message processing loop to handle incoming messages
      * This runs in a separate coroutine to avoid blocking the main thread
@@ -303,6 +462,8 @@ class UDPMessageSystem {
     private fun startMessageProcessing() {
         println("🔄 Starting message processing loop...")
         
+        val channel = channel ?: return
+        val selector = selector ?: return
         if (isProcessing.getAndSet(true)) {
             println("⚠️ Message processing already running")
             return
@@ -310,23 +471,36 @@ class UDPMessageSystem {
         
         processingJob = coroutineScope.launch {
             try {
-                val buffer = ByteArray(1500) // Standard MTU size
-                val packet = DatagramPacket(buffer, buffer.size)
+                val view = ByteBuffer.allocate(MAX_PACKET_SIZE).order(ByteOrder.LITTLE_ENDIAN)
                 
                 while (isProcessing.get() && isConnected) {
+                    val scheduler = scheduler ?: break
                     try {
-                        // Listen for incoming UDP packets
-                        socket?.receive(packet)
+                        applyPendingProfile()
                         
-                        // Process the received packet
-                        processIncomingPacket(packet.data, packet.length)
+                        // Sleep until a packet arrives, the next scheduled send is
+                        // due or [setProfile] wakes us; no other timeout, so an idle
+                        // circuit wakes only as often as its profile needs
+                        val wait = scheduler.nextWakeAt() - clock()
+                        selectTimeoutMs = maxOf(wait, 0L)
+                        if (wait > 0) selector.select(wait) else selector.selectNow()
+                        selector.selectedKeys().clear()
                         
-                        // Reset packet for next use
-                        packet.length = buffer.size
+                        // Process every datagram queued meanwhile in this one wakeup
+                        while (true) {
+                            view.clear()
+                            channel.receive(view) ?: break
+                            processIncomingPacket(view, view.position())
+                        }
+                        deliverObjectMessages()
+                        
+                        // Send whatever came due and keep listening
+                        scheduler.onWake(clock())
                         
-                    } catch (e: SocketTimeoutException) {
-                        // Timeout is expected - continue listening
-                        continue
+                    } catch (e: ClosedChannelException) {
+                        break
+                    } catch (e: ClosedSelectorException) {
+                        break
                     } catch (e: Exception) {
                         if (isProcessing.get()) {
                             println("❌ Error in message processing loop: ${e.message}")
@@ -345,38 +519,29 @@ class UDPMessageSystem {
     /**
      * Process an incoming UDP packet from the simulator
      */
-    private fun processIncomingPacket(data: ByteArray, length: Int) {
-        if (length < 6) {
+    private fun processIncomingPacket(buffer: ByteBuffer, length: Int): Unit = Profiler.scope(ZONE_PROCESS_PACKET) {
+        if (length < PacketHeader.MIN_PACKET_SIZE) {
             println("⚠️ Received packet too small: $length bytes")
-            return
+            return@scope
         }
         
         try {
-            val buffer = ByteBuffer.wrap(data, 0, length)
-            buffer.order(ByteOrder.LITTLE_ENDIAN)
+            // Reuse the receive loop's little-endian view of the packet buffer
+            buffer.clear()
+            buffer.limit(length)
             
             // Parse packet header
-            val flags = buffer.get().toInt() and 0xFF
-            val sequenceNum = buffer.int
-            val extraHeaderSize = if ((flags and 0x20) != 0) buffer.get().toInt() and 0xFF else 0
-            
-            // Skip extra header if present
-            if (extraHeaderSize > 0) {
-                buffer.position(buffer.position() + extraHeaderSize)
+            if (!packetHeader.decode(buffer)) {
+                println("⚠️ Truncated packet header")
+                return@scope
             }
             
-            // Parse message type
-            if (buffer.remaining() < 1) {
-                println("⚠️ No message type in packet")
-                return
-            }
-            
-            val messageTypeId = buffer.get().toInt() and 0xFF
-            val messageType = MessageType.fromId(messageTypeId)
+            val sequenceNum = packetHeader.sequenceNumber
+            val messageType = MessageType.fromId(packetHeader.messageTypeId)
             
             if (messageType == null) {
-                println("⚠️ Unknown message type: $messageTypeId")
-                return
+                println("⚠️ Unknown message type: ${packetHeader.messageTypeId}")
+                return@scope
             }
             
             println("📨 Received ${messageType.name} (seq: $sequenceNum)")
@@ -385,14 +550,22 @@ class UDPMessageSystem {
             when (messageType) {
                 MessageType.PACKET_ACK -> handlePacketAck(buffer, sequenceNum)
                 MessageType.OBJECT_UPDATE -> handleObjectUpdate(buffer, sequenceNum)
+                MessageType.OBJECT_UPDATE_CACHED -> handleObjectUpdateCached(buffer, sequenceNum)
+                MessageType.KILL_OBJECT -> handleKillObject(buffer, sequenceNum)
+                MessageType.REGION_HANDSHAKE -> handleRegionHandshake(buffer, sequenceNum)
+                MessageType.AGENT_MOVEMENT_COMPLETE -> handleAgentMovementComplete(buffer, sequenceNum)
+                MessageType.COARSE_LOCATION_UPDATE -> handleCoarseLocationUpdate(buffer, sequenceNum)
                 MessageType.CHAT_FROM_SIMULATOR -> handleChatMessage(buffer, sequenceNum)
                 MessageType.PING_PONG_REPLY -> handlePingPongReply(buffer, sequenceNum)
                 else -> println("   Message type not yet handled")
             }
             
-            // Send acknowledgment for reliable messages
-            if (messageType.reliable) {
-                sendAck(sequenceNum)
+            // Queue acknowledgment for reliable messages; the scheduler batches them
+            scheduler?.onReceived(length, if (messageType.reliable) sequenceNum else null, clock())
+            
+            if (messageType == MessageType.START_PING_CHECK) {
+                lastPingId = if (buffer.hasRemaining()) buffer.get() else 0
+                scheduler?.send(CircuitMessage.COMPLETE_PING_CHECK)
             }
             
         } catch (e: Exception) {
@@ -410,21 +583,198 @@ class UDPMessageSystem {
     }
     
     /**
-     * Handle ObjectUpdate messages
+     * Handle ObjectUpdate messages: region handle, then blocks of local id,
+     * CRC and the object's data, each kept in the object cache
      */
     private fun handleObjectUpdate(buffer: ByteBuffer, sequenceNum: Int) {
-        // Parse object update data (simplified)
         println("   📦 Object update received")
-        EventSystem.tryEmit(ViewerEvent.ObjectUpdated("object-${System.currentTimeMillis()}", emptyMap()))
+        if (buffer.remaining() < OBJECT_UPDATE_HEADER_BYTES) {
+            EventSystem.tryEmit(ViewerEvent.ObjectUpdated("object-${System.currentTimeMillis()}", emptyMap()))
+            return
+        }
+        val regionHandle = buffer.long
+        val cache = objectCache?.takeIf { cacheReady(regionHandle) }
+        repeat(buffer.get().toInt() and 0xFF) {
+            if (buffer.remaining() < OBJECT_BLOCK_HEADER_BYTES) return
+            val localId = buffer.int
+            val crc = buffer.int
+            val length = buffer.short.toInt() and 0xFFFF
+            if (buffer.remaining() < length) return
+            val data = ByteArray(length).also { buffer.get(it) }
+            cache?.store(localId, crc, data)
+            emitObjectUpdate(localId, data, cached = false)
+        }
+    }
+    
+    /**
+     * Handle ObjectUpdateCached: the simulator lists (local id, CRC, update
+     * flags) for objects we may already have. Cache hits are applied at once;
+     * the rest are requested with RequestMultipleObjects
+     */
+    private fun handleObjectUpdateCached(buffer: ByteBuffer, sequenceNum: Int) {
+        if (buffer.remaining() < OBJECT_UPDATE_HEADER_BYTES) return
+        val regionHandle = buffer.long
+        val count = buffer.get().toInt() and 0xFF
+        val probes = ArrayList<CacheProbe>(count)
+        for (i in 0 until count) {
+            if (buffer.remaining() < RegionObjectCache.PROBE_BYTES) break
+            probes += CacheProbe(buffer.int, buffer.int)
+            buffer.int // UpdateFlags
+        }
+        val cache = objectCache
+        if (cache == null || !cacheReady(regionHandle)) {
+            requestObjects(probes.map { CacheMiss(it.localId, CacheMissType.FULL) })
+            return
+        }
+        val result = cache.probe(probes)
+        for (hit in result.hits) emitObjectUpdate(hit.localId, hit.data, cached = true)
+        println("   📦 Cached objects: ${result.hits.size} hits, ${result.misses.size} to request")
+        requestObjects(result.misses)
+    }
+    
+    /**
+     * Handle RegionHandshake: region flags, access, name, owner, estate
+     * manager flag, water height and billable factor, then the simulator's
+     * cache id. A cache id other than the one the region's cache was written
+     * under means the cached objects are no longer valid
+     */
+    private fun handleRegionHandshake(buffer: ByteBuffer, sequenceNum: Int) {
+        if (buffer.remaining() < REGION_HANDSHAKE_HEADER_BYTES) return
+        buffer.position(buffer.position() + 5) // RegionFlags, SimAccess
+        val name = variableString(buffer, buffer.get().toInt() and 0xFF) ?: return
+        if (buffer.remaining() < REGION_HANDSHAKE_SKIP_BYTES + 16) return
+        buffer.position(buffer.position() + REGION_HANDSHAKE_SKIP_BYTES)
+        regionName = name
+        // UUIDs go big-endian on the wire
+        buffer.order(ByteOrder.BIG_ENDIAN)
+        val cacheId = UUID(buffer.long, buffer.long)
+        buffer.order(ByteOrder.LITTLE_ENDIAN)
+        regionCacheId = cacheId
+        val region = circuitRegion ?: return
+        println("   🤝 Region handshake, cache id $cacheId")
+        if (objectCache != null) cacheReady(region)
+    }
+    
+    /**
+     * Handle AgentMovementComplete: agent and session ids, then the position,
+     * look-at and region handle the agent arrived at. The simulator sends it
+     * when login or a teleport has put the agent in the region
+     */
+    private fun handleAgentMovementComplete(buffer: ByteBuffer, sequenceNum: Int) {
+        if (buffer.remaining() < AGENT_MOVEMENT_COMPLETE_BYTES) return
+        buffer.position(buffer.position() + 32) // AgentID, SessionID
+        val position = Vector3(buffer.float, buffer.float, buffer.float)
+        buffer.position(buffer.position() + 12) // LookAt
+        val regionHandle = buffer.long
+        if (circuitRegion == null) circuitRegion = regionHandle
+        println("   🛬 Arrived in ${regionName.ifEmpty { java.lang.Long.toHexString(regionHandle) }}")
+        EventSystem.tryEmit(ViewerEvent.AvatarTeleported(regionName, position, regionHandle))
+    }
+    
+    /**
+     * Handle CoarseLocationUpdate: a count of x, y, z bytes (z in 4 m steps),
+     * the indexes of the agent and of its tracking target, then a count of
+     * the avatars' ids in the same order. The simulator repeats it every few
+     * seconds, so a dropped event is made good by the next one
+     */
+    private fun handleCoarseLocationUpdate(buffer: ByteBuffer, sequenceNum: Int) {
+        val region = circuitRegion ?: return
+        if (!buffer.hasRemaining()) return
+        val count = buffer.get().toInt() and 0xFF
+        if (buffer.remaining() < count * 3 + COARSE_INDEX_BYTES + 1) return
+        val positions = List(count) {
+            val x = buffer.get().toInt() and 0xFF
+            val y = buffer.get().toInt() and 0xFF
+            val z = buffer.get().toInt() and 0xFF
+            Vector3(x.toFloat(), y.toFloat(), z * 4f)
+        }
+        buffer.position(buffer.position() + COARSE_INDEX_BYTES) // You, Prey
+        if ((buffer.get().toInt() and 0xFF) != count || buffer.remaining() < count * 16) return
+        // UUIDs go big-endian on the wire
+        buffer.order(ByteOrder.BIG_ENDIAN)
+        val avatars = HashMap<UUID, Vector3>(count * 2)
+        for (position in positions) avatars[UUID(buffer.long, buffer.long)] = position
+        buffer.order(ByteOrder.LITTLE_ENDIAN)
+        EventSystem.tryEmit(ViewerEvent.CoarseLocationsUpdated(region, avatars))
+    }
+    
+    // Null until the handshake, or for another region: the cache keeps what it has
+    private fun cacheIdOf(regionHandle: Long): UUID? = regionCacheId.takeIf { regionHandle == circuitRegion }
+    
+    /**
+     * Handle KillObject: a count, then the local ids of removed objects
+     */
+    private fun handleKillObject(buffer: ByteBuffer, sequenceNum: Int) {
+        if (!buffer.hasRemaining()) return
+        repeat(buffer.get().toInt() and 0xFF) {
+            if (buffer.remaining() < 4) return
+            val localId = buffer.int
+            objectCache?.remove(localId)
+            if (objectMessages != null) objectOutbox += ObjectMessage.Kill(localId)
+            EventSystem.tryEmit(ViewerEvent.ObjectRemoved("local-$localId"))
+        }
+    }
+    
+    private fun emitObjectUpdate(localId: Int, data: ByteArray, cached: Boolean) {
+        if (objectMessages != null) objectOutbox += ObjectMessage.Update(localId, data)
+        EventSystem.tryEmit(ViewerEvent.ObjectUpdated("local-$localId", mapOf("data" to data, "cached" to cached)))
+    }
+    
+    // Suspends while [objectMessages] is full, which is the backpressure
+    private suspend fun deliverObjectMessages() {
+        if (objectOutbox.isEmpty()) return
+        val sink = objectMessages
+        try {
+            if (sink != null) for (message in objectOutbox) sink.send(message)
+        } catch (e: ClosedSendChannelException) {
+            if (objectMessages === sink) objectMessages = null
+        }
+        objectOutbox.clear()
+    }
+    
+    /**
+     * Ask for full updates of [misses], as many RequestMultipleObjects
+     * packets as needed
+     */
+    private fun requestObjects(misses: List<CacheMiss>) {
+        for (chunk in misses.chunked(MAX_REQUEST_BLOCKS)) {
+            sendMessage(MessageType.REQUEST_MULTIPLE_OBJECTS) { buffer ->
+                buffer.put(chunk.size.toByte())
+                for (miss in chunk) {
+                    buffer.put(miss.type.code.toByte())
+                    buffer.putInt(miss.localId)
+                }
+            }
+        }
     }
     
     /**
-     * Handle ChatFromSimulator messages
+     * Handle ChatFromSimulator: the speaker's name, source and owner ids,
+     * source type, chat type, audibility and position, then the text. Chat
+     * from an avatar carries its id, so the viewer can look up its display name
      */
     private fun handleChatMessage(buffer: ByteBuffer, sequenceNum: Int) {
-        // Parse chat message (simplified)
         println("   💬 Chat message received")
-        EventSystem.tryEmit(ViewerEvent.ChatReceived("System message", "System", 0))
+        if (!buffer.hasRemaining()) return
+        val name = variableString(buffer, buffer.get().toInt() and 0xFF) ?: return
+        if (buffer.remaining() < CHAT_FIXED_BYTES) return
+        // UUIDs go big-endian on the wire
+        buffer.order(ByteOrder.BIG_ENDIAN)
+        val sourceId = UUID(buffer.long, buffer.long)
+        buffer.order(ByteOrder.LITTLE_ENDIAN)
+        buffer.position(buffer.position() + 16) // OwnerID
+        val sourceType = buffer.get().toInt() and 0xFF
+        buffer.position(buffer.position() + 2 + 12) // ChatType, Audible, Position
+        val text = variableString(buffer, buffer.short.toInt() and 0xFFFF) ?: return
+        val senderId = sourceId.takeIf { sourceType == CHAT_SOURCE_AGENT }
+        EventSystem.tryEmit(ViewerEvent.ChatReceived(text, name, 0, senderId))
+    }
+    
+    // [length] bytes of UTF-8, without the trailing NUL; null if the packet is short
+    private fun variableString(buffer: ByteBuffer, length: Int): String? {
+        if (buffer.remaining() < length) return null
+        val bytes = ByteArray(length).also { buffer.get(it) }
+        return String(bytes, Charsets.UTF_8).trimEnd('\u0000')
     }
     
     /**
@@ -435,11 +785,58 @@ class UDPMessageSystem {
     }
     
     /**
-     * Send acknowledgment for a reliable message
+     * Switch the circuit's pacing, e.g. to [CircuitProfile.CHAT_ONLY_BACKGROUND]
+     * when the app leaves the screen. Safe from any thread, including the main
+     * one: if connected, the network thread is woken to send the new throttles
+     * and AgentUpdate
      */
-    private fun sendAck(sequenceNum: Int) {
-        // TODO: Implement proper ACK message format
-        println("   📤 Sending ACK for sequence $sequenceNum")
+    fun setProfile(profile: CircuitProfile) {
+        this.profile = profile
+        if (scheduler == null) return
+        pendingProfile.set(profile)
+        selector?.wakeup()
+    }
+    
+    // Network thread only
+    private fun applyPendingProfile() {
+        val profile = pendingProfile.getAndSet(null) ?: return
+        scheduler?.apply(profile, clock())
+    }
+    
+    // Profile the scheduler is running, which lags [profile] until the network thread applies it
+    private val circuitProfile: CircuitProfile get() = scheduler?.profile ?: profile
+    
+    /**
+     * [CircuitScheduler]'s sender: build and send one of its messages with
+     * pending ACKs appended (or, for PacketAck, as the payload)
+     */
+    private fun sendCircuitMessage(message: CircuitMessage, acks: IntArray): Int = when (message) {
+        CircuitMessage.AGENT_UPDATE -> sendPacket(MessageType.AGENT_UPDATE, acks) { writeAgentUpdateMessage(it) }
+        CircuitMessage.AGENT_THROTTLE -> sendPacket(MessageType.AGENT_THROTTLE, acks) { writeAgentThrottleMessage(it) }
+        CircuitMessage.COMPLETE_PING_CHECK -> sendPacket(MessageType.COMPLETE_PING_CHECK, acks) { it.put(lastPingId) }
+        CircuitMessage.PACKET_ACK -> sendPacket(MessageType.PACKET_ACK, NO_ACKS) { buffer ->
+            buffer.put(acks.size.toByte())
+            for (ack in acks) buffer.putInt(ack)
+        }
+    }
+    
+    /**
+     * Build AgentUpdate; the draw distance is the simulator's interest radius for this agent
+     */
+    private fun writeAgentUpdateMessage(buffer: ByteBuffer) {
+        buffer.putInt(circuitCode)
+        buffer.putFloat(circuitProfile.interestRadius) // Far
+        buffer.putInt(0) // ControlFlags
+        buffer.put(0) // Flags
+    }
+    
+    /**
+     * Build AgentThrottle with the profile's per-category bandwidth
+     */
+    private fun writeAgentThrottleMessage(buffer: ByteBuffer) {
+        buffer.putInt(circuitCode)
+        buffer.putInt(throttleGeneration++)
+        buffer.put(circuitProfile.throttles.encode())
     }
     
     /**
@@ -455,8 +852,8 @@ class UDPMessageSystem {
         println("💬 Sending chat message: \"$message\" on channel $channel")
         
         try {
-            val messageData = buildChatMessage(message, channel)
-            return sendMessage(MessageType.CHAT_FROM_VIEWER, messageData)
+            val messageBytes = message.toByteArray(Charsets.UTF_8)
+            return sendMessage(MessageType.CHAT_FROM_VIEWER) { writeChatMessage(it, messageBytes, channel) }
             
         } catch (e: Exception) {
             println("💥 Error sending chat message: ${e.message}")
@@ -465,18 +862,37 @@ class UDPMessageSystem {
     }
     
     /**
-     * Build ChatFromViewer message packet
+     * Ask the simulator to teleport the agent to ([x], [y], [z]) in region
+     * [regionHandle]; arrival is reported by AgentMovementComplete
      */
-    private fun buildChatMessage(message: String, channel: Int): ByteArray {
-        val messageBytes = message.toByteArray(Charsets.UTF_8)
-        val buffer = ByteBuffer.allocate(8 + messageBytes.size)
-        buffer.order(ByteOrder.LITTLE_ENDIAN)
+    suspend fun sendTeleportLocationRequest(regionHandle: Long, x: Float, y: Float, z: Float): Boolean {
+        if (!isConnected) {
+            println("⚠️ Cannot teleport - not connected to simulator")
+            return false
+        }
         
+        println("🚀 Requesting teleport to ${java.lang.Long.toHexString(regionHandle)} ($x, $y, $z)")
+        
+        try {
+            return sendMessage(MessageType.TELEPORT_LOCATION_REQUEST) { buffer ->
+                buffer.putLong(regionHandle)
+                buffer.putFloat(x).putFloat(y).putFloat(z)
+                // LookAt: facing east
+                buffer.putFloat(1f).putFloat(0f).putFloat(0f)
+            }
+        } catch (e: Exception) {
+            println("💥 Error requesting teleport: ${e.message}")
+            return false
+        }
+    }
+    
+    /**
+     * Build ChatFromViewer message packet
+     */
+    private fun writeChatMessage(buffer: ByteBuffer, messageBytes: ByteArray, channel: Int) {
         buffer.putInt(channel)
         buffer.putInt(messageBytes.size)
         buffer.put(messageBytes)
-        
-        return buffer.array()
     }
     
     /**
@@ -511,21 +927,35 @@ class UDPMessageSystem {
         isProcessing.set(false)
         processingJob?.cancel()
         processingJob = null
+        cacheJob?.cancel()
+        cacheJob = null
+        regionSwitches.tryReceive()
+        requestedSwitch = null
+        openedSwitch = null
         
         // Clean up connection
         isConnected = false
-        socket?.close()
-        socket = null
-        simulatorAddress = null
-        simulatorPort = 0
+        selector?.close()
+        selector = null
+        channel?.close()
+        channel = null
+        simulator = null
         circuitCode = 0
+        circuitRegion = null
+        regionCacheId = null
+        regionName = ""
         sequenceNumber = 0
+        scheduler = null
+        selectTimeoutMs = -1L
+        pendingProfile.set(null)
+        objectCache?.flush()
         pendingAcks.clear()
         receivedMessages.clear()
+        objectOutbox.clear()
     }
     
     // Status getters
     fun isConnected(): Boolean = isConnected
-    fun getSimulatorEndpoint(): String = "${simulatorAddress?.hostAddress}:$simulatorPort"
+    fun getSimulatorEndpoint(): String = "${simulator?.address?.hostAddress}:${simulator?.port ?: 0}"
     fun getCircuitCode(): Int = circuitCode
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+package com.linkpoint.protocol.circuit
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Per-category bandwidth the simulator may use towards the viewer, in bits
+ * per second, as carried by AgentThrottle
+ */
+data class Throttles(
+    val resend: Float,
+    val land: Float,
+    val wind: Float,
+    val cloud: Float,
+    val task: Float,
+    val texture: Float,
+    val asset: Float
+) {
+    val total: Float get() = resend + land + wind + cloud + task + texture + asset
+
+    /** The seven little-endian floats of the AgentThrottle Throttles block */
+    fun encode(): ByteArray {
+        val buffer = ByteBuffer.allocate(7 * 4).order(ByteOrder.LITTLE_ENDIAN)
+        buffer.putFloat(resend).putFloat(land).putFloat(wind).putFloat(cloud)
+        buffer.putFloat(task).putFloat(texture).putFloat(asset)
+        return buffer.array()
+    }
+}
+
+/**
+ * How hard a circuit works: what the simulator is asked to send and how
+ * often the viewer wakes to talk back.
+ *
+ * [FOREGROUND] is the normal in-world profile. [CHAT_ONLY_BACKGROUND] keeps
+ * the circuit and presence alive for chat and IM while the app is not
+ * visible: a zero draw distance (interest radius) so no objects are in
+ * scope, throttles near the simulator's floor, an AgentUpdate only often
+ * enough to not look idle, and ACKs held back and sent in batches - ideally
+ * piggy-backed on a packet that had to go out anyway - so the radio isn't
+ * woken once per reliable packet.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLAgent draw distance, LLViewerThrottle presets and
+ *   LLCircuitData's pending ACK list flushed once per frame
+ */
+data class CircuitProfile(
+    val name: String,
+    /** Draw distance sent in AgentUpdate, metres; 0 leaves no objects in interest */
+    val interestRadius: Float,
+    val throttles: Throttles,
+    val agentUpdateIntervalMs: Long,
+    /** Longest a received reliable packet waits for its ACK */
+    val ackFlushIntervalMs: Long,
+    /** ACKs that force a PacketAck out before the interval, at most 255 per packet */
+    val maxBatchedAcks: Int
+) {
+    init {
+        require(maxBatchedAcks in 1..MAX_ACKS_PER_PACKET) { "maxBatchedAcks must be 1..$MAX_ACKS_PER_PACKET" }
+    }
+
+    /**
+     * This profile with the interest radius and total throttle no higher than
+     * the given limits; categories keep their proportions
+     */
+    fun limitedTo(interestRadius: Float, bandwidthBps: Float): CircuitProfile {
+        val scale = if (throttles.total > bandwidthBps && throttles.total > 0f) bandwidthBps / throttles.total else 1f
+        return copy(
+            interestRadius = minOf(this.interestRadius, interestRadius),
+            throttles = with(throttles) {
+                Throttles(resend * scale, land * scale, wind * scale, cloud * scale, task * scale, texture * scale, asset * scale)
+            }
+        )
+    }
+
+    companion object {
+        const val MAX_ACKS_PER_PACKET = 255
+
+        val FOREGROUND = CircuitProfile(
+            name = "foreground",
+            interestRadius = 128f,
+            throttles = Throttles(
+                resend = 100_000f, land = 80_000f, wind = 10_000f, cloud = 10_000f,
+                task = 200_000f, texture = 500_000f, asset = 100_000f
+            ),
+            agentUpdateIntervalMs = 100,
+            ackFlushIntervalMs = 50,
+            maxBatchedAcks = 32
+        )
+
+        /**
+         * Chat and IM still arrive reliably, so their ACKs must reach the
+         * simulator before it resends (about a second on an idle circuit)
+         */
+        val CHAT_ONLY_BACKGROUND = CircuitProfile(
+            name = "chat-only background",
+            interestRadius = 0f,
+            throttles = Throttles(
+                resend = 2_000f, land = 0f, wind = 0f, cloud = 0f,
+                task = 1_000f, texture = 0f, asset = 1_000f
+            ),
+            agentUpdateIntervalMs = 30_000,
+            ackFlushIntervalMs = 750,
+            maxBatchedAcks = MAX_ACKS_PER_PACKET
+        )
+    }
+}
@@ -0,0 +1,182 @@
+package com.linkpoint.protocol.circuit
+
+/**
+ * Messages the viewer side of a circuit sends on its own schedule
+ */
+enum class CircuitMessage {
+    AGENT_UPDATE,
+    AGENT_THROTTLE,
+    PACKET_ACK,
+    COMPLETE_PING_CHECK
+}
+
+fun interface CircuitSender {
+    /**
+     * Put [message] on the wire with [acks] appended to it
+     *
+     * @return bytes sent
+     */
+    fun send(message: CircuitMessage, acks: IntArray): Int
+}
+
+/**
+ * Battery proxies for a circuit: how often the network thread woke and how
+ * many bytes crossed the radio
+ */
+class CircuitMetrics {
+    var wakeups = 0L
+        private set
+    var packetsSent = 0L
+        private set
+    var bytesSent = 0L
+        private set
+    var packetsReceived = 0L
+        private set
+    var bytesReceived = 0L
+        private set
+
+    internal fun wakeup() { wakeups++ }
+
+    internal fun sent(bytes: Int) {
+        packetsSent++
+        bytesSent += bytes
+    }
+
+    internal fun received(bytes: Int) {
+        packetsReceived++
+        bytesReceived += bytes
+    }
+
+    /** The counts so far, unaffected by later traffic */
+    fun snapshot(): CircuitMetrics = since(CircuitMetrics())
+
+    /** Traffic since [earlier], a [snapshot] of this circuit, e.g. while one profile ran */
+    fun since(earlier: CircuitMetrics): CircuitMetrics = CircuitMetrics().also {
+        it.wakeups = wakeups - earlier.wakeups
+        it.packetsSent = packetsSent - earlier.packetsSent
+        it.bytesSent = bytesSent - earlier.bytesSent
+        it.packetsReceived = packetsReceived - earlier.packetsReceived
+        it.bytesReceived = bytesReceived - earlier.bytesReceived
+    }
+
+    fun rates(profile: String, elapsedMs: Long): CircuitRates {
+        val minutes = elapsedMs / 60_000.0
+        return CircuitRates(
+            profile = profile,
+            wakeupsPerMinute = wakeups / minutes,
+            bytesSentPerMinute = bytesSent / minutes,
+            bytesReceivedPerMinute = bytesReceived / minutes
+        )
+    }
+}
+
+data class CircuitRates(
+    val profile: String,
+    val wakeupsPerMinute: Double,
+    val bytesSentPerMinute: Double,
+    val bytesReceivedPerMinute: Double
+) {
+    val bytesPerMinute: Double get() = bytesSentPerMinute + bytesReceivedPerMinute
+
+    override fun toString() = "%-22s %10.1f wakeups/min %12.0f B/min (%.0f out, %.0f in)".format(
+        profile, wakeupsPerMinute, bytesPerMinute, bytesSentPerMinute, bytesReceivedPerMinute
+    )
+}
+
+/**
+ * Viewer-side timing of a circuit under a [CircuitProfile]: when the next
+ * AgentUpdate is due, which received reliable packets still owe an ACK, and
+ * so when the network thread next needs to wake if nothing arrives.
+ *
+ * Pending ACKs ride along on any packet the viewer sends (appended ACKs, as
+ * the simulator accepts); a standalone PacketAck only goes out when the
+ * oldest one has waited [CircuitProfile.ackFlushIntervalMs] or the batch is
+ * full. Callers pass the current time in so the same logic runs under the
+ * wall clock in [com.linkpoint.protocol.UDPMessageSystem] and under virtual
+ * time in the tests' LoopbackSimulator.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLCircuitData::mAcks / LLMessageSystem::sendAcks and
+ *   LLAgent's AgentUpdate send interval
+ */
+class CircuitScheduler(
+    profile: CircuitProfile,
+    private val sender: CircuitSender,
+    now: Long
+) {
+    val metrics = CircuitMetrics()
+
+    var profile: CircuitProfile = profile
+        private set
+
+    private val acks = IntArray(CircuitProfile.MAX_ACKS_PER_PACKET)
+    private var ackCount = 0
+    private var oldestAckAt = 0L
+    private var nextAgentUpdateAt = now
+
+    /** ACKs waiting to be sent */
+    val pendingAcks: Int @Synchronized get() = ackCount
+
+    /**
+     * Switch profile: the simulator gets the new throttles and, through an
+     * immediate AgentUpdate, the new interest radius
+     */
+    @Synchronized
+    fun apply(profile: CircuitProfile, now: Long) {
+        this.profile = profile
+        transmit(CircuitMessage.AGENT_THROTTLE)
+        transmit(CircuitMessage.AGENT_UPDATE)
+        nextAgentUpdateAt = now + profile.agentUpdateIntervalMs
+    }
+
+    /**
+     * A packet of [bytes] arrived; [reliableSequence] is its sequence number
+     * if the simulator wants it ACKed
+     */
+    @Synchronized
+    fun onReceived(bytes: Int, reliableSequence: Int?, now: Long) {
+        metrics.received(bytes)
+        if (reliableSequence == null) return
+        if (ackCount == 0) oldestAckAt = now
+        acks[ackCount++] = reliableSequence
+        if (ackCount >= profile.maxBatchedAcks) transmit(CircuitMessage.PACKET_ACK)
+    }
+
+    /** Send [message] now, carrying any pending ACKs */
+    @Synchronized
+    fun send(message: CircuitMessage): Int = transmit(message)
+
+    /** Time the network thread must wake by if nothing arrives first */
+    @Synchronized
+    fun nextWakeAt(): Long =
+        if (ackCount > 0) minOf(nextAgentUpdateAt, oldestAckAt + profile.ackFlushIntervalMs) else nextAgentUpdateAt
+
+    /**
+     * The network thread is awake at [now], for a packet or a timeout: send
+     * whatever has come due
+     */
+    @Synchronized
+    fun onWake(now: Long) {
+        metrics.wakeup()
+        if (now >= nextAgentUpdateAt) {
+            transmit(CircuitMessage.AGENT_UPDATE)
+            nextAgentUpdateAt = now + profile.agentUpdateIntervalMs
+        }
+        if (ackCount > 0 && now >= oldestAckAt + profile.ackFlushIntervalMs) {
+            transmit(CircuitMessage.PACKET_ACK)
+        }
+    }
+
+    private fun transmit(message: CircuitMessage): Int {
+        if (message == CircuitMessage.PACKET_ACK && ackCount == 0) return 0
+        val appended = if (ackCount == 0) NO_ACKS else acks.copyOf(ackCount)
+        ackCount = 0
+        val bytes = sender.send(message, appended)
+        metrics.sent(bytes)
+        return bytes
+    }
+
+    private companion object {
+        val NO_ACKS = IntArray(0)
+    }
+}
@@ -171,7 +171,8 @@ data class VirtualObject(
     val children: List<UUID> = emptyList(), // Child objects if this is root
     val touchHandler: String? = null, // Script function for touch events
     val velocity: Vector3 = Vector3(0f, 0f, 0f),
-    val angularVelocity: Vector3 = Vector3(0f, 0f, 0f)
+    val angularVelocity: Vector3 = Vector3(0f, 0f, 0f),
+    val meshId: UUID? = null // Sculpt map or mesh asset, from ExtraParams
 ) : WorldEntity()
 
 /**
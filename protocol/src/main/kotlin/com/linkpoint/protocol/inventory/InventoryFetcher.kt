@@ -0,0 +1,177 @@
+package com.linkpoint.protocol.inventory
+
+import com.linkpoint.protocol.llsd.LLSDXml
+import com.linkpoint.protocol.llsd.llsdArray
+import com.linkpoint.protocol.llsd.llsdInt
+import com.linkpoint.protocol.llsd.llsdMap
+import com.linkpoint.protocol.llsd.llsdString
+import com.linkpoint.protocol.llsd.llsdUuid
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.withContext
+import mu.KotlinLogging
+import java.io.IOException
+import java.net.HttpURLConnection
+import java.net.URL
+import java.util.UUID
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicInteger
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Posts an LLSD body to a capability and returns the parsed LLSD response
+ */
+fun interface LLSDTransport {
+    suspend fun post(url: String, body: Any?): Any?
+}
+
+/**
+ * [LLSDTransport] over HttpURLConnection, run on the IO dispatcher
+ */
+class HttpLLSDTransport(private val timeoutMs: Int = 30_000) : LLSDTransport {
+    override suspend fun post(url: String, body: Any?): Any? = withContext(Dispatchers.IO) {
+        val connection = URL(url).openConnection() as HttpURLConnection
+        try {
+            connection.requestMethod = "POST"
+            connection.doOutput = true
+            connection.connectTimeout = timeoutMs
+            connection.readTimeout = timeoutMs
+            connection.setRequestProperty("Content-Type", LLSDXml.CONTENT_TYPE)
+            connection.setRequestProperty("Accept", LLSDXml.CONTENT_TYPE)
+            connection.outputStream.use { it.write(LLSDXml.format(body).toByteArray(Charsets.UTF_8)) }
+            if (connection.responseCode !in 200..299) throw IOException("HTTP ${connection.responseCode} from $url")
+            connection.inputStream.use { LLSDXml.parse(it) }
+        } finally {
+            connection.disconnect()
+        }
+    }
+}
+
+/**
+ * Loads folder contents into an [InventoryStore] on demand through the
+ * FetchInventoryDescendents2 capability.
+ *
+ * [ensureLoaded] is meant to be called when a folder is opened: it fetches
+ * only if the folder's loaded contents are missing or older than its server
+ * version, and concurrent requests for the same folder share one fetch.
+ * Folders that are still current in the [snapshot] are loaded from it instead.
+ * [fetch] batches several folders into each request.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLInventoryModelBackgroundFetch and AISv3 fetches
+ */
+class InventoryFetcher(
+    private val store: InventoryStore,
+    private val capabilityUrl: String,
+    private val ownerId: UUID,
+    private val transport: LLSDTransport = HttpLLSDTransport(),
+    private val maxFoldersPerRequest: Int = MAX_FOLDERS_PER_REQUEST
+) {
+    private val inFlight = ConcurrentHashMap<UUID, CompletableDeferred<Unit>>()
+
+    /** Cache from the previous session, consulted before the network */
+    @Volatile
+    var snapshot: InventorySnapshot? = null
+
+    private val fetchedCount = AtomicInteger()
+
+    /** Folders fetched since creation */
+    val foldersFetched: Int get() = fetchedCount.get()
+
+    /**
+     * Make sure [folderId]'s direct contents are loaded and current
+     *
+     * @return true if a fetch was needed
+     */
+    suspend fun ensureLoaded(folderId: UUID): Boolean {
+        if (!store.needsFetch(folderId)) return false
+        if (snapshot?.loadFolder(store, folderId) == true) return false
+        fetch(listOf(folderId))
+        return true
+    }
+
+    /**
+     * Fetch the direct contents of [folderIds], [maxFoldersPerRequest] per
+     * request; folders already being fetched are awaited rather than refetched
+     */
+    suspend fun fetch(folderIds: List<UUID>) {
+        val owned = ArrayList<UUID>()
+        val awaited = ArrayList<CompletableDeferred<Unit>>()
+        folderIds.distinct().forEach { id ->
+            val deferred = CompletableDeferred<Unit>()
+            val existing = inFlight.putIfAbsent(id, deferred)
+            if (existing == null) owned += id else awaited += existing
+        }
+
+        try {
+            owned.chunked(maxFoldersPerRequest).forEach { batch -> fetchBatch(batch) }
+            owned.forEach { inFlight.remove(it)?.complete(Unit) }
+        } catch (e: Throwable) {
+            owned.forEach { inFlight.remove(it)?.completeExceptionally(e) }
+            throw e
+        }
+        awaited.forEach { it.await() }
+    }
+
+    private suspend fun fetchBatch(folderIds: List<UUID>) {
+        val request = mapOf(
+            "folders" to folderIds.map { id ->
+                mapOf(
+                    "folder_id" to id,
+                    "owner_id" to ownerId,
+                    "fetch_folders" to true,
+                    "fetch_items" to true,
+                    "sort_order" to 0
+                )
+            }
+        )
+        val response = transport.post(capabilityUrl, request) as? Map<*, *>
+            ?: throw IOException("FetchInventoryDescendents2 returned no map")
+        applyResponse(store, response)
+        fetchedCount.addAndGet(folderIds.size)
+
+        val bad = response.llsdArray("bad_folders")
+        if (bad.isNotEmpty()) logger.warn { "FetchInventoryDescendents2 rejected ${bad.size} folders: $bad" }
+    }
+
+    companion object {
+        const val CAPABILITY_NAME = "FetchInventoryDescendents2"
+        // The simulator caps folders per request; larger batches are rejected
+        const val MAX_FOLDERS_PER_REQUEST = 10
+
+        /**
+         * Apply a FetchInventoryDescendents2 response to [store]
+         */
+        fun applyResponse(store: InventoryStore, response: Map<*, *>) {
+            response.llsdArray("folders").forEach { entry ->
+                val folder = entry as? Map<*, *> ?: return@forEach
+                val folderId = folder.llsdUuid("folder_id")
+                val categories = folder.llsdArray("categories").mapNotNull { it as? Map<*, *> }.map { category ->
+                    InventoryFolderInfo(
+                        id = category.llsdUuid("category_id").takeUnless { it == LLSDXml.NULL_UUID } ?: category.llsdUuid("folder_id"),
+                        parentId = folderId,
+                        name = category.llsdString("name"),
+                        type = if (category.containsKey("type_default")) category.llsdInt("type_default") else -1,
+                        version = if (category.containsKey("version")) category.llsdInt("version") else InventoryStore.VERSION_UNKNOWN
+                    )
+                }
+                val items = folder.llsdArray("items").mapNotNull { it as? Map<*, *> }.map { item ->
+                    InventoryItemInfo(
+                        id = item.llsdUuid("item_id"),
+                        parentId = folderId,
+                        name = item.llsdString("name"),
+                        description = item.llsdString("desc"),
+                        assetId = item.llsdUuid("asset_id"),
+                        assetType = item.llsdInt("type"),
+                        inventoryType = item.llsdInt("inv_type"),
+                        flags = item.llsdInt("flags"),
+                        creationDate = item.llsdInt("created_at").toLong(),
+                        creatorId = item.llsdMap("permissions").llsdUuid("creator_id")
+                    )
+                }
+                store.setDescendents(folderId, folder.llsdInt("version"), categories, items)
+            }
+        }
+    }
+}
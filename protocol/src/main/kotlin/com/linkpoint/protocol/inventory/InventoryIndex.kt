@@ -0,0 +1,330 @@
+package com.linkpoint.protocol.inventory
+
+import java.text.CollationKey
+import java.text.Collator
+import java.util.BitSet
+import java.util.Locale
+
+/**
+ * Orders an [InventoryIndex] can list items in
+ */
+enum class InventorySortOrder {
+    /** Locale collation, ignoring case */
+    NAME,
+    /** Newest first when descending */
+    DATE,
+    /** Grouped by asset type, by name within a type */
+    TYPE
+}
+
+/**
+ * Maintained sort and filter indexes over the items of an [InventoryStore].
+ *
+ * Keeps the item slots in name order (by precomputed collation keys) and in
+ * creation-date order, plus per-asset-type buckets derived from the name
+ * order, so sorting and category filters never sort or scan the whole
+ * inventory per keystroke or frame. Store changes are recorded as dirty slots
+ * and applied on the next query: a few changes are patched in by binary
+ * search, a bulk load (fetch or cache restore) triggers one full rebuild.
+ *
+ * Results are slot arrays; [items] materialises a page of them, so a list
+ * view only builds the rows it shows.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLInventoryFilter and folder view sort
+ * - java.text.CollationKey for repeated locale-aware comparisons
+ */
+class InventoryIndex(
+    private val store: InventoryStore,
+    locale: Locale = Locale.getDefault()
+) {
+    private val collator = Collator.getInstance(locale).apply { strength = Collator.SECONDARY }
+
+    // Indexed fields per slot, as of the last refresh
+    private var keys = arrayOfNulls<CollationKey>(0)
+    private var lowerNames = arrayOfNulls<String>(0)
+    private var lowerDescriptions = arrayOfNulls<String>(0)
+    private var types = IntArray(0)
+    private var dates = LongArray(0)
+    private var indexed = BooleanArray(0)
+
+    private var byName = IntArray(0)
+    private var byDate = IntArray(0)
+    private var count = 0
+    private var typeBuckets: Map<Int, IntArray>? = null
+
+    private val dirty = BitSet()
+    private var dirtyCount = 0
+    private var rebuildNeeded = true
+
+    private var modifications = 0L
+
+    /** Bumped whenever the indexed contents change */
+    val version: Long get() = synchronized(store) { refresh(); modifications }
+
+    private val listener = object : ItemSlotListener {
+        override fun itemChanged(slot: Int) {
+            if (!dirty[slot]) {
+                dirty.set(slot)
+                dirtyCount++
+            }
+        }
+
+        override fun cleared() {
+            rebuildNeeded = true
+        }
+    }
+
+    init {
+        store.addItemListener(listener)
+    }
+
+    val size: Int get() = synchronized(store) { refresh(); count }
+
+    /**
+     * All item slots in [order]
+     */
+    fun sorted(order: InventorySortOrder, ascending: Boolean = true): IntArray = synchronized(store) {
+        refresh()
+        val slots = when (order) {
+            InventorySortOrder.NAME -> byName.copyOf(count)
+            InventorySortOrder.DATE -> byDate.copyOf(count)
+            InventorySortOrder.TYPE -> {
+                val result = IntArray(count)
+                var position = 0
+                buckets().toSortedMap().values.forEach { bucket ->
+                    System.arraycopy(bucket, 0, result, position, bucket.size)
+                    position += bucket.size
+                }
+                result
+            }
+        }
+        if (!ascending) slots.reverse()
+        slots
+    }
+
+    /** Slots of items with [assetType], in name order */
+    fun ofType(assetType: Int): IntArray = synchronized(store) {
+        refresh()
+        buckets()[assetType]?.copyOf() ?: IntArray(0)
+    }
+
+    fun countOfType(assetType: Int): Int = synchronized(store) {
+        refresh()
+        buckets()[assetType]?.size ?: 0
+    }
+
+    /**
+     * The items for [slots] from [from], at most [limit]
+     */
+    fun items(slots: IntArray, from: Int = 0, limit: Int = slots.size): List<InventoryItemInfo> = synchronized(store) {
+        val end = minOf(slots.size, from + limit)
+        val result = ArrayList<InventoryItemInfo>(maxOf(end - from, 0))
+        for (i in from until end) {
+            if (store.isLiveItem(slots[i])) result += store.itemInfoAt(slots[i])
+        }
+        result
+    }
+
+    /**
+     * A matcher for one search field; keep it while the user types
+     */
+    fun matcher(): InventoryMatcher = InventoryMatcher(this)
+
+    /** Detach from the store */
+    fun close() {
+        store.removeItemListener(listener)
+    }
+
+    /**
+     * Slots among [candidates] (or all items, in name order, if null) whose
+     * name or description contains [lowerQuery], optionally restricted to
+     * [assetType]
+     */
+    internal fun filter(lowerQuery: String, assetType: Int?, candidates: IntArray?): IntArray = synchronized(store) {
+        refresh()
+        val source = candidates ?: if (assetType != null) buckets()[assetType] ?: IntArray(0) else byName
+        val length = candidates?.size ?: if (source === byName) count else source.size
+        val result = IntArray(length)
+        var matched = 0
+        for (i in 0 until length) {
+            val slot = source[i]
+            if (!indexed[slot]) continue
+            if (assetType != null && types[slot] != assetType) continue
+            if (lowerNames[slot]!!.contains(lowerQuery) || lowerDescriptions[slot]!!.contains(lowerQuery)) result[matched++] = slot
+        }
+        result.copyOf(matched)
+    }
+
+    /**
+     * Apply pending store changes; caller holds the store's lock
+     */
+    private fun refresh() {
+        if (!rebuildNeeded && dirtyCount == 0) return
+        ensureCapacity(store.itemSlotCount)
+        if (rebuildNeeded || dirtyCount > maxOf(SMALL_UPDATE, count / 32)) {
+            rebuild()
+        } else {
+            var slot = dirty.nextSetBit(0)
+            while (slot >= 0) {
+                if (indexed[slot]) {
+                    removeSlot(byDate, count, slot, ::compareDates)
+                    count = removeSlot(byName, count, slot, ::compareNames)
+                    indexed[slot] = false
+                }
+                if (store.isLiveItem(slot)) {
+                    capture(slot)
+                    insertSlot(byName, count, slot, ::compareNames)
+                    insertSlot(byDate, count, slot, ::compareDates)
+                    count++
+                }
+                slot = dirty.nextSetBit(slot + 1)
+            }
+        }
+        dirty.clear()
+        dirtyCount = 0
+        typeBuckets = null
+        modifications++
+    }
+
+    private fun rebuild() {
+        indexed.fill(false)
+        val live = ArrayList<Int>(store.itemCount)
+        for (slot in 0 until store.itemSlotCount) {
+            if (store.isLiveItem(slot)) {
+                capture(slot)
+                live += slot
+            }
+        }
+        count = live.size
+        byName = live.sortedWith(Comparator(::compareNames)).toIntArray().copyOf(maxOf(count, 16))
+        byDate = live.sortedWith(Comparator(::compareDates)).toIntArray().copyOf(maxOf(count, 16))
+        rebuildNeeded = false
+    }
+
+    private fun capture(slot: Int) {
+        val name = store.itemNameAt(slot)
+        keys[slot] = collator.getCollationKey(name)
+        lowerNames[slot] = name.lowercase(Locale.ROOT)
+        lowerDescriptions[slot] = store.itemDescriptionAt(slot).lowercase(Locale.ROOT)
+        types[slot] = store.itemAssetTypeAt(slot)
+        dates[slot] = store.itemCreatedAt(slot)
+        indexed[slot] = true
+    }
+
+    /** Counting pass over the name order; stable, so each bucket stays in name order */
+    private fun buckets(): Map<Int, IntArray> {
+        typeBuckets?.let { return it }
+        val sizes = HashMap<Int, Int>()
+        for (i in 0 until count) sizes.merge(types[byName[i]], 1, Int::plus)
+        val buckets = sizes.mapValues { IntArray(it.value) }
+        val fill = HashMap<Int, Int>()
+        for (i in 0 until count) {
+            val slot = byName[i]
+            val type = types[slot]
+            val position = fill[type] ?: 0
+            buckets.getValue(type)[position] = slot
+            fill[type] = position + 1
+        }
+        return buckets.also { typeBuckets = it }
+    }
+
+    private fun compareNames(a: Int, b: Int): Int {
+        val byKey = keys[a]!!.compareTo(keys[b])
+        return if (byKey != 0) byKey else a.compareTo(b)
+    }
+
+    private fun compareDates(a: Int, b: Int): Int {
+        val byCreation = dates[a].compareTo(dates[b])
+        return if (byCreation != 0) byCreation else a.compareTo(b)
+    }
+
+    /** First position in [order] whose slot does not sort before [slot] */
+    private inline fun lowerBound(order: IntArray, size: Int, slot: Int, compare: (Int, Int) -> Int): Int {
+        var low = 0
+        var high = size
+        while (low < high) {
+            val mid = (low + high) ushr 1
+            if (compare(order[mid], slot) < 0) low = mid + 1 else high = mid
+        }
+        return low
+    }
+
+    private inline fun insertSlot(order: IntArray, size: Int, slot: Int, compare: (Int, Int) -> Int) {
+        val position = lowerBound(order, size, slot, compare)
+        System.arraycopy(order, position, order, position + 1, size - position)
+        order[position] = slot
+    }
+
+    private inline fun removeSlot(order: IntArray, size: Int, slot: Int, compare: (Int, Int) -> Int): Int {
+        val position = lowerBound(order, size, slot, compare)
+        if (position == size || order[position] != slot) return size
+        System.arraycopy(order, position + 1, order, position, size - position - 1)
+        return size - 1
+    }
+
+    private fun ensureCapacity(slots: Int) {
+        if (keys.size < slots) {
+            val capacity = maxOf(slots, keys.size * 2, 16)
+            keys = keys.copyOf(capacity)
+            lowerNames = lowerNames.copyOf(capacity)
+            lowerDescriptions = lowerDescriptions.copyOf(capacity)
+            types = types.copyOf(capacity)
+            dates = dates.copyOf(capacity)
+            indexed = indexed.copyOf(capacity)
+        }
+        // Each order may grow by every live slot
+        if (byName.size < slots) {
+            byName = byName.copyOf(slots)
+            byDate = byDate.copyOf(slots)
+        }
+    }
+
+    companion object {
+        // Up to this many changes (or 1/32 of the index) are patched in; more trigger a rebuild
+        private const val SMALL_UPDATE = 64
+    }
+}
+
+/**
+ * Incremental name and description search for one search field.
+ *
+ * When the new query contains the previous one (the user typed more), only
+ * the previous matches are re-checked, so each keystroke narrows an already
+ * small set instead of rescanning the inventory. Any other edit, a different
+ * type filter or a change to the index starts from the full name order.
+ */
+class InventoryMatcher internal constructor(private val index: InventoryIndex) {
+    private var lastQuery: String? = null
+    private var lastType: Int? = null
+    private var lastVersion = -1L
+    private var lastResult = IntArray(0)
+
+    /** Candidates examined by the last [match], for diagnostics */
+    var lastScanned = 0
+        private set
+
+    /**
+     * Slots of items whose name or description contains [query], ignoring
+     * case, in name order, optionally only of [assetType]
+     */
+    fun match(query: String, assetType: Int? = null): IntArray {
+        val lower = query.lowercase(Locale.ROOT)
+        val previous = lastQuery
+        val refine = previous != null && lower.contains(previous) && assetType == lastType && index.version == lastVersion
+        val candidates = if (refine) lastResult else null
+        lastScanned = candidates?.size ?: if (assetType != null) index.countOfType(assetType) else index.size
+        val result = index.filter(lower, assetType, candidates)
+
+        lastQuery = lower
+        lastType = assetType
+        lastVersion = index.version
+        lastResult = result
+        return result
+    }
+
+    fun reset() {
+        lastQuery = null
+        lastResult = IntArray(0)
+    }
+}
@@ -0,0 +1,180 @@
+package com.linkpoint.protocol.inventory
+
+import com.linkpoint.protocol.rlv.SharedFolderIndex
+import mu.KotlinLogging
+import java.io.File
+import java.io.IOException
+import java.util.UUID
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * One login's inventory: a store restored from the previous session's
+ * [InventorySnapshot], with folders loaded through [fetcher] as they open,
+ * and the snapshot rewritten at [close].
+ *
+ * [start] lists the root folder from the server straight away; its listing
+ * carries the versions of the top-level folders, so those whose contents did
+ * not change are then served from the snapshot instead of the network.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLInventoryModel::loadSkeleton / saveToFile around a
+ *   session, and LLAgent's seed capability request
+ */
+class InventorySession private constructor(
+    val store: InventoryStore,
+    val fetcher: InventoryFetcher,
+    private val snapshotFile: File,
+    private val ownerId: UUID,
+    private val rootId: UUID
+) {
+    /** Folders restored from the snapshot at [start] */
+    var restoredFolders = 0
+        private set
+
+    private var outfitTracker: OutfitTracker? = null
+
+    /**
+     * Load the #RLV shared folder tree, a level per round of requests, and the
+     * current outfit, then index them for RLV's inventory queries. Items are
+     * worn if the Current Outfit folder links to them; wearing and detaching
+     * add and remove those links, so the index follows the folder's changes
+     * in the store from then on
+     *
+     * @return null if the inventory has no #RLV folder
+     */
+    suspend fun sharedFolders(): SharedFolderIndex? {
+        val top = store.childFolders(rootId)
+        val sharedRoot = top.firstOrNull { it.name == SharedFolderIndex.SHARED_ROOT_NAME } ?: return null
+        val outfit = top.firstOrNull { it.type == FOLDER_TYPE_CURRENT_OUTFIT }
+        outfit?.let { fetcher.ensureLoaded(it.id) }
+        val worn = outfit?.let { store.items(it.id).mapTo(HashSet()) { link -> link.assetId } }.orEmpty()
+
+        val folders = arrayListOf(SharedFolderIndex.Folder(rootId.toString(), null, ""))
+        val items = ArrayList<SharedFolderIndex.Item>()
+        var level = listOf(sharedRoot)
+        while (level.isNotEmpty()) {
+            val missing = level.map { it.id }.filter { store.needsFetch(it) && fetcher.snapshot?.loadFolder(store, it) != true }
+            if (missing.isNotEmpty()) fetcher.fetch(missing)
+            level.forEach { folder ->
+                folders += SharedFolderIndex.Folder(folder.id.toString(), folder.parentId?.toString(), folder.name)
+                store.items(folder.id).forEach { item ->
+                    items += SharedFolderIndex.Item(item.id.toString(), folder.id.toString(), item.id in worn)
+                }
+            }
+            level = level.flatMap { store.childFolders(it.id) }
+        }
+        val index = SharedFolderIndex.build(folders, items)
+        outfitTracker?.let(store::removeItemListener)
+        outfitTracker = outfit?.let { OutfitTracker(it.id, index) }
+        return index
+    }
+
+    /**
+     * Write the snapshot for the next login. Folders still current in the old
+     * snapshot are loaded first so their cached contents carry over; folders
+     * whose server version never became known this session are kept without
+     * contents. The old snapshot is closed before its file is replaced
+     */
+    fun close() {
+        outfitTracker?.let(store::removeItemListener)
+        outfitTracker = null
+        try {
+            fetcher.snapshot?.let { snapshot ->
+                snapshot.loadAllCurrent(store)
+                fetcher.snapshot = null
+                snapshot.close()
+            }
+            InventorySnapshot.write(snapshotFile, store, ownerId)
+        } catch (e: IOException) {
+            logger.warn { "Failed to write inventory snapshot $snapshotFile: ${e.message}" }
+        }
+    }
+
+    /**
+     * Keeps [index]'s worn state in step with the links in the Current Outfit
+     * folder [outfitId]. Removed items are only reported by slot, so the
+     * target of each link slot is remembered
+     */
+    private inner class OutfitTracker(private val outfitId: UUID, private val index: SharedFolderIndex) : ItemSlotListener {
+        private val targets = HashMap<Int, UUID>()
+        // Links per worn item; an item linked twice stays worn until both go
+        private val links = HashMap<UUID, Int>()
+
+        init {
+            synchronized(store) {
+                for (slot in 0 until store.itemSlotCount) itemChanged(slot)
+                store.addItemListener(this)
+            }
+        }
+
+        // Called under the store's lock
+        override fun itemChanged(slot: Int) {
+            val target = if (store.isLiveItem(slot)) store.itemInfoAt(slot).takeIf { it.parentId == outfitId }?.assetId else null
+            val previous = targets[slot]
+            if (target == previous) return
+            if (previous != null) {
+                targets.remove(slot)
+                val remaining = links.getValue(previous) - 1
+                if (remaining == 0) {
+                    links.remove(previous)
+                    index.setWorn(previous.toString(), false)
+                } else {
+                    links[previous] = remaining
+                }
+            }
+            if (target != null) {
+                targets[slot] = target
+                if (links.merge(target, 1, Int::plus) == 1) index.setWorn(target.toString(), true)
+            }
+        }
+
+        override fun cleared() {
+            links.keys.forEach { index.setWorn(it.toString(), false) }
+            targets.clear()
+            links.clear()
+        }
+    }
+
+    companion object {
+        /** type_default of the Current Outfit folder, whose links are the worn items */
+        const val FOLDER_TYPE_CURRENT_OUTFIT = 46
+
+        /**
+         * Restore [ownerId]'s snapshot from [snapshotFile], if any, and list
+         * [rootId] through the FetchInventoryDescendents2 capability at [capabilityUrl]
+         */
+        suspend fun start(
+            capabilityUrl: String,
+            ownerId: UUID,
+            rootId: UUID,
+            snapshotFile: File,
+            transport: LLSDTransport = HttpLLSDTransport()
+        ): InventorySession {
+            val store = InventoryStore()
+            val fetcher = InventoryFetcher(store, capabilityUrl, ownerId, transport)
+            val session = InventorySession(store, fetcher, snapshotFile, ownerId, rootId)
+            InventorySnapshot.open(snapshotFile, ownerId)?.let { snapshot ->
+                snapshot.restoreFolders(store)
+                fetcher.snapshot = snapshot
+                session.restoredFolders = snapshot.folderCount
+            }
+            fetcher.ensureLoaded(rootId)
+            return session
+        }
+
+        /**
+         * Ask the seed capability for the URLs of [names]
+         *
+         * @return the capabilities the simulator granted
+         */
+        suspend fun resolveCapabilities(
+            seedCapability: String,
+            names: List<String>,
+            transport: LLSDTransport = HttpLLSDTransport()
+        ): Map<String, String> {
+            val granted = transport.post(seedCapability, names) as? Map<*, *> ?: return emptyMap()
+            return names.mapNotNull { name -> (granted[name] as? String)?.let { name to it } }.toMap()
+        }
+    }
+}
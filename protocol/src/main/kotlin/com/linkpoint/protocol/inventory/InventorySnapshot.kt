@@ -0,0 +1,385 @@
+package com.linkpoint.protocol.inventory
+
+import mu.KotlinLogging
+import java.io.File
+import java.io.IOException
+import java.io.RandomAccessFile
+import java.nio.ByteBuffer
+import java.nio.channels.FileChannel
+import java.nio.file.Files
+import java.nio.file.StandardCopyOption
+import java.util.UUID
+import java.util.zip.CRC32
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Memory-mapped binary inventory cache, so a relog only fetches folders whose
+ * server version changed and login time does not grow with inventory size.
+ *
+ * Layout (big-endian):
+ * - header: magic, format version, owner, record counts, string table size
+ *   and a CRC-32 of the rest of the file
+ * - folder table: fixed [FOLDER_RECORD] records (id, parent index, name,
+ *   type, loaded version, first item record and item count), parents first
+ * - item table: fixed [ITEM_RECORD] records, contiguous per folder
+ * - string table: de-duplicated UTF-8 names and descriptions, referenced by
+ *   offset and length
+ *
+ * [open] maps the file and checks its checksum and that every record's
+ * references stay inside the file; a snapshot failing either is discarded,
+ * so the session falls back to fetching everything. [restoreFolders] puts
+ * the folder tree into the store without contents; a folder's items are
+ * decoded by [loadFolder] when it is first opened, and only if the server
+ * version of that folder still matches the snapshot, so checking versions
+ * happens lazily per folder rather than up front.
+ *
+ * [close] unmaps the file where the platform allows, so that [write] can
+ * replace it: Windows refuses to replace a file that is still mapped.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's per-account inventory cache and version validation
+ *   (LLInventoryModel::loadSkeleton), minus the gzipped LLSD parse
+ * - Fixed-width record files with a string table, read through mmap
+ */
+class InventorySnapshot private constructor(
+    val file: File,
+    private val buffer: ByteBuffer,
+    val folderCount: Int,
+    val itemCount: Int
+) : AutoCloseable {
+    private var closed = false
+    private val folderRows = HashMap<UUID, Int>(folderCount * 2)
+    // Subfolder lists by row, linked through the rows
+    private val firstChild = IntArray(folderCount) { -1 }
+    private val nextSibling = IntArray(folderCount) { -1 }
+
+    init {
+        for (row in folderCount - 1 downTo 0) {
+            folderRows[folderId(row)] = row
+            val parent = buffer.getInt(folderField(row, OFFSET_PARENT))
+            if (parent >= 0) {
+                nextSibling[row] = firstChild[parent]
+                firstChild[parent] = row
+            }
+        }
+    }
+
+    private val itemTable = FOLDER_TABLE + folderCount.toLong() * FOLDER_RECORD
+    private val stringTable = itemTable + itemCount.toLong() * ITEM_RECORD
+
+    /**
+     * Put every folder into [store] without contents and with an unknown
+     * server version: cached contents are only used once the server skeleton
+     * or a parent's listing says which version is current. Call before
+     * applying the skeleton
+     */
+    @Synchronized
+    fun restoreFolders(store: InventoryStore) {
+        check(!closed) { "Snapshot $file is closed" }
+        val folders = ArrayList<InventoryFolderInfo>(folderCount)
+        for (row in 0 until folderCount) folders += folderAt(row).copy(version = InventoryStore.VERSION_UNKNOWN)
+        store.applySkeleton(folders)
+    }
+
+    /** Version of [folderId]'s cached contents, or [InventoryStore.VERSION_UNKNOWN] */
+    @Synchronized
+    fun cachedVersion(folderId: UUID): Int =
+        if (closed) InventoryStore.VERSION_UNKNOWN else folderRows[folderId]?.let { buffer.getInt(folderField(it, OFFSET_VERSION)) } ?: InventoryStore.VERSION_UNKNOWN
+
+    /**
+     * Load [folderId]'s direct contents from the snapshot if they are as new
+     * as the store's server version for it
+     *
+     * @return false if the folder isn't cached, has changed on the server or
+     *   the snapshot is closed
+     */
+    @Synchronized
+    fun loadFolder(store: InventoryStore, folderId: UUID): Boolean {
+        if (closed) return false
+        val row = folderRows[folderId] ?: return false
+        val version = buffer.getInt(folderField(row, OFFSET_VERSION))
+        val serverVersion = store.folder(folderId)?.version ?: return false
+        if (version == InventoryStore.VERSION_UNKNOWN || version != serverVersion) return false
+
+        val firstItem = buffer.getInt(folderField(row, OFFSET_FIRST_ITEM))
+        val items = List(buffer.getInt(folderField(row, OFFSET_ITEM_COUNT))) { itemAt(firstItem + it) }
+        val children = ArrayList<InventoryFolderInfo>()
+        var child = firstChild[row]
+        while (child >= 0) {
+            children += currentOrCached(store, child)
+            child = nextSibling[child]
+        }
+        store.setDescendents(folderId, version, children, items)
+        return true
+    }
+
+    /**
+     * Load every folder that is still current, e.g. in the background after
+     * login so whole-inventory search covers cached items
+     *
+     * @return the number of folders loaded
+     */
+    @Synchronized
+    fun loadAllCurrent(store: InventoryStore): Int {
+        var loaded = 0
+        for (row in 0 until folderCount) {
+            val id = folderId(row)
+            if (store.needsFetch(id) && loadFolder(store, id)) loaded++
+        }
+        return loaded
+    }
+
+    /**
+     * Stop serving folders and unmap the file; later calls find nothing cached
+     */
+    @Synchronized
+    override fun close() {
+        if (closed) return
+        closed = true
+        unmap(buffer)
+    }
+
+    // Keep a subfolder's server version if the skeleton already provided one
+    private fun currentOrCached(store: InventoryStore, row: Int): InventoryFolderInfo {
+        val cached = folderAt(row)
+        val current = store.folder(cached.id) ?: return cached
+        return cached.copy(version = current.version)
+    }
+
+    private fun folderField(row: Int, field: Int): Int = FOLDER_TABLE + row * FOLDER_RECORD + field
+
+    private fun folderId(row: Int): UUID {
+        val at = FOLDER_TABLE + row * FOLDER_RECORD
+        return UUID(buffer.getLong(at), buffer.getLong(at + 8))
+    }
+
+    private fun folderAt(row: Int): InventoryFolderInfo {
+        val at = FOLDER_TABLE + row * FOLDER_RECORD
+        val parent = buffer.getInt(at + OFFSET_PARENT)
+        return InventoryFolderInfo(
+            id = UUID(buffer.getLong(at), buffer.getLong(at + 8)),
+            parentId = if (parent < 0) null else folderId(parent),
+            name = string(buffer.getInt(at + OFFSET_NAME), buffer.getInt(at + OFFSET_NAME + 4)),
+            type = buffer.getInt(at + OFFSET_TYPE),
+            version = buffer.getInt(at + OFFSET_VERSION)
+        )
+    }
+
+    private fun itemAt(row: Int): InventoryItemInfo {
+        val at = (itemTable + row.toLong() * ITEM_RECORD).toInt()
+        val folder = buffer.getInt(at + 48)
+        return InventoryItemInfo(
+            id = UUID(buffer.getLong(at), buffer.getLong(at + 8)),
+            parentId = folderId(folder),
+            name = string(buffer.getInt(at + 32), buffer.getInt(at + 36)),
+            description = string(buffer.getInt(at + 40), buffer.getInt(at + 44)),
+            assetId = UUID(buffer.getLong(at + 16), buffer.getLong(at + 24)),
+            assetType = buffer.getInt(at + 52),
+            inventoryType = buffer.getInt(at + 56),
+            flags = buffer.getInt(at + 60),
+            creationDate = buffer.getLong(at + 64),
+            creatorId = UUID(buffer.getLong(at + 72), buffer.getLong(at + 80))
+        )
+    }
+
+    private fun string(offset: Int, length: Int): String {
+        if (length == 0) return ""
+        val bytes = ByteArray(length)
+        val view = buffer.duplicate()
+        view.position((stringTable + offset).toInt())
+        view.get(bytes)
+        return String(bytes, Charsets.UTF_8)
+    }
+
+    companion object {
+        const val FORMAT_VERSION = 3
+        private const val MAGIC = 0x4C50494E56534E50L // "LPINVSNP"
+
+        private const val HEADER_SIZE = 48
+        private const val FOLDER_TABLE = HEADER_SIZE
+        private const val FOLDER_RECORD = 48
+        private const val ITEM_RECORD = 88
+
+        private const val OFFSET_PARENT = 16
+        private const val OFFSET_NAME = 20
+        private const val OFFSET_TYPE = 28
+        private const val OFFSET_VERSION = 32
+        private const val OFFSET_FIRST_ITEM = 36
+        private const val OFFSET_ITEM_COUNT = 40
+        // In the header; covers the header before it and everything after the header
+        private const val OFFSET_CHECKSUM = 44
+
+        /**
+         * Map [file] if it is a snapshot of this format for [ownerId]
+         *
+         * @return null if there is no usable snapshot
+         */
+        fun open(file: File, ownerId: UUID): InventorySnapshot? {
+            if (!file.exists() || file.length() < HEADER_SIZE) return null
+            return try {
+                val buffer = RandomAccessFile(file, "r").use { raf ->
+                    raf.channel.map(FileChannel.MapMode.READ_ONLY, 0, raf.length())
+                }
+                if (buffer.getLong(0) != MAGIC || buffer.getInt(8) != FORMAT_VERSION) return null
+                if (buffer.getLong(16) != ownerId.mostSignificantBits || buffer.getLong(24) != ownerId.leastSignificantBits) return null
+                val folders = buffer.getInt(32)
+                val items = buffer.getInt(36)
+                val strings = buffer.getInt(40)
+                val expected = HEADER_SIZE.toLong() + folders.toLong() * FOLDER_RECORD + items.toLong() * ITEM_RECORD + strings
+                if (folders < 0 || items < 0 || strings < 0 || expected != file.length()) {
+                    logger.warn { "Discarding truncated inventory snapshot $file" }
+                    return null
+                }
+                if (checksum(buffer, expected.toInt()) != buffer.getInt(OFFSET_CHECKSUM)) {
+                    logger.warn { "Discarding corrupt inventory snapshot $file: checksum mismatch" }
+                    return null
+                }
+                if (!inBounds(buffer, folders, items, strings)) {
+                    logger.warn { "Discarding inventory snapshot $file: a record points outside the file" }
+                    return null
+                }
+                InventorySnapshot(file, buffer, folders, items)
+            } catch (e: IOException) {
+                logger.warn(e) { "Discarding unreadable inventory snapshot $file" }
+                null
+            }
+        }
+
+        private fun checksum(buffer: ByteBuffer, length: Int): Int {
+            val crc = CRC32()
+            val view = buffer.duplicate()
+            view.position(0).limit(OFFSET_CHECKSUM)
+            crc.update(view)
+            view.limit(length).position(HEADER_SIZE)
+            crc.update(view)
+            return crc.value.toInt()
+        }
+
+        // Parents, item ranges, item folders and string references all inside the file
+        private fun inBounds(buffer: ByteBuffer, folders: Int, items: Int, strings: Int): Boolean {
+            fun stringAt(at: Int): Boolean {
+                val offset = buffer.getInt(at)
+                val length = buffer.getInt(at + 4)
+                return offset >= 0 && length >= 0 && offset.toLong() + length <= strings
+            }
+            for (row in 0 until folders) {
+                val at = FOLDER_TABLE + row * FOLDER_RECORD
+                val parent = buffer.getInt(at + OFFSET_PARENT)
+                val first = buffer.getInt(at + OFFSET_FIRST_ITEM)
+                val count = buffer.getInt(at + OFFSET_ITEM_COUNT)
+                if (parent < -1 || parent >= folders || parent == row) return false
+                if (first < 0 || count < 0 || first.toLong() + count > items) return false
+                if (!stringAt(at + OFFSET_NAME)) return false
+            }
+            val itemTable = FOLDER_TABLE + folders * FOLDER_RECORD
+            for (row in 0 until items) {
+                val at = itemTable + row * ITEM_RECORD
+                val folder = buffer.getInt(at + 48)
+                if (folder < 0 || folder >= folders || !stringAt(at + 32) || !stringAt(at + 40)) return false
+            }
+            return true
+        }
+
+        // Release the mapping now rather than at garbage collection, where the
+        // JVM offers a way to; elsewhere the mapping lives on until collected
+        private fun unmap(buffer: ByteBuffer) {
+            if (!buffer.isDirect) return
+            try {
+                val unsafeClass = Class.forName("sun.misc.Unsafe")
+                val unsafe = unsafeClass.getDeclaredField("theUnsafe").apply { isAccessible = true }.get(null)
+                unsafeClass.getMethod("invokeCleaner", ByteBuffer::class.java).invoke(unsafe, buffer)
+            } catch (e: Exception) {
+                logger.debug { "Cannot unmap inventory snapshot early: ${e.message}" }
+            }
+        }
+
+        /**
+         * Write [store]'s folders, with the versions their contents were
+         * loaded at, and items to [file], replacing it atomically. [close] the
+         * snapshot open on [file] first
+         */
+        fun write(file: File, store: InventoryStore, ownerId: UUID) {
+            val folders = store.allFolders()
+            val rows = HashMap<UUID, Int>(folders.size * 2)
+            folders.forEachIndexed { row, folder -> rows[folder.id] = row }
+            val itemsByFolder = folders.map { store.items(it.id) }
+            val itemCount = itemsByFolder.sumOf { it.size }
+
+            val strings = StringTable()
+            val folderTable = ByteBuffer.allocate(folders.size * FOLDER_RECORD)
+            val itemTable = ByteBuffer.allocate(itemCount * ITEM_RECORD)
+            var firstItem = 0
+            folders.forEachIndexed { row, folder ->
+                val items = itemsByFolder[row]
+                folderTable.putLong(folder.id.mostSignificantBits).putLong(folder.id.leastSignificantBits)
+                folderTable.putInt(folder.parentId?.let { rows[it] } ?: -1)
+                strings.put(folder.name, folderTable)
+                folderTable.putInt(folder.type)
+                folderTable.putInt(store.loadedVersion(folder.id))
+                folderTable.putInt(firstItem)
+                folderTable.putInt(items.size)
+                folderTable.putInt(0)
+                items.forEach { item ->
+                    itemTable.putLong(item.id.mostSignificantBits).putLong(item.id.leastSignificantBits)
+                    itemTable.putLong(item.assetId.mostSignificantBits).putLong(item.assetId.leastSignificantBits)
+                    strings.put(item.name, itemTable)
+                    strings.put(item.description, itemTable)
+                    itemTable.putInt(row)
+                    itemTable.putInt(item.assetType)
+                    itemTable.putInt(item.inventoryType)
+                    itemTable.putInt(item.flags)
+                    itemTable.putLong(item.creationDate)
+                    itemTable.putLong(item.creatorId.mostSignificantBits).putLong(item.creatorId.leastSignificantBits)
+                }
+                firstItem += items.size
+            }
+
+            val header = ByteBuffer.allocate(HEADER_SIZE)
+            header.putLong(MAGIC).putInt(FORMAT_VERSION).putInt(0)
+            header.putLong(ownerId.mostSignificantBits).putLong(ownerId.leastSignificantBits)
+            header.putInt(folders.size).putInt(itemCount).putInt(strings.size)
+            val crc = CRC32()
+            crc.update(header.array(), 0, OFFSET_CHECKSUM)
+            listOf(folderTable, itemTable, strings.bytes()).forEach { crc.update(it.array(), 0, it.position()) }
+            header.putInt(crc.value.toInt())
+
+            file.parentFile?.mkdirs()
+            val temp = File(file.path + ".tmp")
+            RandomAccessFile(temp, "rw").use { raf ->
+                raf.setLength(0)
+                val channel = raf.channel
+                listOf(header, folderTable, itemTable, strings.bytes()).forEach { section ->
+                    section.flip()
+                    while (section.hasRemaining()) channel.write(section)
+                }
+            }
+            Files.move(temp.toPath(), file.toPath(), StandardCopyOption.REPLACE_EXISTING)
+            logger.debug { "Wrote inventory snapshot: ${folders.size} folders, $itemCount items, ${strings.size} string bytes" }
+        }
+    }
+
+    /**
+     * De-duplicated UTF-8 strings; most descriptions are empty or repeated
+     */
+    private class StringTable {
+        private val offsets = HashMap<String, Int>()
+        private var data = ByteBuffer.allocate(64 * 1024)
+
+        val size: Int get() = data.position()
+
+        /** Append [text] if new and write its offset and length to [record] */
+        fun put(text: String, record: ByteBuffer) {
+            val bytes = text.toByteArray(Charsets.UTF_8)
+            val offset = offsets.getOrPut(text) {
+                if (data.remaining() < bytes.size) {
+                    data = ByteBuffer.allocate(maxOf(data.capacity() * 2, data.position() + bytes.size)).put(data.flip() as ByteBuffer)
+                }
+                data.position().also { data.put(bytes) }
+            }
+            record.putInt(offset).putInt(bytes.size)
+        }
+
+        fun bytes(): ByteBuffer = data
+    }
+}
@@ -0,0 +1,546 @@
+package com.linkpoint.protocol.inventory
+
+import java.util.UUID
+import java.util.concurrent.CopyOnWriteArrayList
+
+/**
+ * Inventory folder as delivered by the inventory service
+ */
+data class InventoryFolderInfo(
+    val id: UUID,
+    val parentId: UUID?,
+    val name: String,
+    /** Preferred asset type of a system folder, -1 for user folders */
+    val type: Int = -1,
+    /** Server version; bumped whenever the folder's direct contents change */
+    val version: Int = InventoryStore.VERSION_UNKNOWN
+)
+
+/**
+ * Inventory item as delivered by the inventory service
+ */
+data class InventoryItemInfo(
+    val id: UUID,
+    val parentId: UUID,
+    val name: String,
+    val description: String = "",
+    val assetId: UUID = UUID(0L, 0L),
+    val assetType: Int = 0,
+    val inventoryType: Int = 0,
+    val flags: Int = 0,
+    /** Unix seconds */
+    val creationDate: Long = 0,
+    /** Avatar who made the item, named through the name service for display */
+    val creatorId: UUID = UUID(0L, 0L)
+)
+
+/**
+ * Told about item slot changes, under the store's lock; used to maintain
+ * indexes. [itemChanged] covers inserts, updates and removals.
+ */
+internal interface ItemSlotListener {
+    fun itemChanged(slot: Int)
+    fun cleared()
+}
+
+/**
+ * Viewer-side inventory model sized for 50k-200k items.
+ *
+ * Folders and items are stored column-wise in parallel primitive arrays
+ * indexed by slot, with the parent as a slot index, and each folder's children
+ * linked through first-child/next-sibling columns. A UUID -> slot hash table
+ * over the raw UUID bits resolves ids without boxing. Freed slots are reused,
+ * so the arrays only grow to the peak inventory size.
+ *
+ * Each folder keeps the server [InventoryFolderInfo.version] next to the
+ * version its loaded contents came from; [needsFetch] compares them so a
+ * folder's descendents are only fetched when opened and only when they changed
+ * (see [InventoryFetcher]).
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLInventoryModel category/item maps and version checks
+ * - Structure-of-arrays data layout
+ */
+class InventoryStore(initialCapacity: Int = 1024) {
+
+    // Folder columns
+    private var folderHigh = LongArray(0)
+    private var folderLow = LongArray(0)
+    private var folderParent = IntArray(0)
+    private var folderNames = arrayOfNulls<String>(0)
+    private var folderTypes = IntArray(0)
+    private var folderVersions = IntArray(0)
+    private var folderLoadedVersions = IntArray(0)
+    private var folderFirstChild = IntArray(0)
+    private var folderFirstItem = IntArray(0)
+    private var folderNextSibling = IntArray(0)
+    private var folderSlots = 0
+    private val freeFolders = IntStack()
+    private val folderIndex = UuidIndex(initialCapacity / 8)
+
+    // Item columns
+    private var itemHigh = LongArray(0)
+    private var itemLow = LongArray(0)
+    private var itemParent = IntArray(0)
+    private var itemNames = arrayOfNulls<String>(0)
+    private var itemDescriptions = arrayOfNulls<String>(0)
+    private var itemAssetHigh = LongArray(0)
+    private var itemAssetLow = LongArray(0)
+    private var itemAssetTypes = IntArray(0)
+    private var itemInventoryTypes = IntArray(0)
+    private var itemFlags = IntArray(0)
+    private var itemCreated = LongArray(0)
+    private var itemCreatorHigh = LongArray(0)
+    private var itemCreatorLow = LongArray(0)
+    private var itemNextSibling = IntArray(0)
+    private var itemSlots = 0
+    private val freeItems = IntStack()
+    private val itemIndex = UuidIndex(initialCapacity)
+    private val itemListeners = CopyOnWriteArrayList<ItemSlotListener>()
+
+    init {
+        growFolders(maxOf(initialCapacity / 8, 16))
+        growItems(maxOf(initialCapacity, 16))
+    }
+
+    val folderCount: Int @Synchronized get() = folderIndex.size
+    val itemCount: Int @Synchronized get() = itemIndex.size
+
+    /** Bumped on every change, so views can tell whether to refresh */
+    @Volatile
+    var modificationCount = 0L
+        private set
+
+    /** The folder without a parent, usually "My Inventory" */
+    @get:Synchronized
+    val rootId: UUID?
+        get() {
+            for (slot in 0 until folderSlots) {
+                if (folderNames[slot] != null && folderParent[slot] == NONE) return folderId(slot)
+            }
+            return null
+        }
+
+    @Synchronized
+    fun folder(id: UUID): InventoryFolderInfo? = folderIndex[id].takeIf { it >= 0 }?.let(::folderInfo)
+
+    @Synchronized
+    fun item(id: UUID): InventoryItemInfo? = itemIndex[id].takeIf { it >= 0 }?.let(::itemInfo)
+
+    /** Direct subfolders of [folderId], empty if unknown or not loaded */
+    @Synchronized
+    fun childFolders(folderId: UUID): List<InventoryFolderInfo> {
+        val folder = folderIndex[folderId]
+        if (folder < 0) return emptyList()
+        val result = ArrayList<InventoryFolderInfo>()
+        var child = folderFirstChild[folder]
+        while (child != NONE) {
+            result += folderInfo(child)
+            child = folderNextSibling[child]
+        }
+        return result
+    }
+
+    /** Items directly in [folderId], empty if unknown or not loaded */
+    @Synchronized
+    fun items(folderId: UUID): List<InventoryItemInfo> {
+        val folder = folderIndex[folderId]
+        if (folder < 0) return emptyList()
+        val result = ArrayList<InventoryItemInfo>()
+        var item = folderFirstItem[folder]
+        while (item != NONE) {
+            result += itemInfo(item)
+            item = itemNextSibling[item]
+        }
+        return result
+    }
+
+    /**
+     * Whether [folderId]'s contents are missing or older than its server version
+     */
+    @Synchronized
+    fun needsFetch(folderId: UUID): Boolean {
+        val folder = folderIndex[folderId]
+        return folder < 0 || folderVersions[folder] == VERSION_UNKNOWN || folderLoadedVersions[folder] != folderVersions[folder]
+    }
+
+    /**
+     * Insert or update a folder; an existing folder's loaded contents are kept
+     * and become stale if [InventoryFolderInfo.version] moved on
+     */
+    @Synchronized
+    fun putFolder(folder: InventoryFolderInfo) {
+        putFolderSlot(folder)
+        modificationCount++
+    }
+
+    /**
+     * Insert or update an item, moving it if its parent changed. The parent
+     * folder is created as a placeholder if it is not known yet.
+     */
+    @Synchronized
+    fun putItem(item: InventoryItemInfo) {
+        putItemSlot(item)
+        modificationCount++
+    }
+
+    @Synchronized
+    fun removeItem(id: UUID): Boolean {
+        val slot = itemIndex[id]
+        if (slot < 0) return false
+        freeItem(slot)
+        modificationCount++
+        return true
+    }
+
+    /** Remove a folder with everything below it */
+    @Synchronized
+    fun removeFolder(id: UUID): Boolean {
+        val slot = folderIndex[id]
+        if (slot < 0) return false
+        freeFolder(slot)
+        modificationCount++
+        return true
+    }
+
+    /**
+     * Apply a folder version list (e.g. the login inventory skeleton) without
+     * contents; folders whose version differs from their loaded contents will
+     * report [needsFetch]
+     */
+    @Synchronized
+    fun applySkeleton(folders: List<InventoryFolderInfo>) {
+        folders.forEach { putFolderSlot(it) }
+        modificationCount++
+    }
+
+    /**
+     * Replace [folderId]'s direct contents with a fetched listing at
+     * [version]. Children missing from the listing are removed; subfolders
+     * that are still listed keep their own loaded contents.
+     */
+    @Synchronized
+    fun setDescendents(folderId: UUID, version: Int, folders: List<InventoryFolderInfo>, items: List<InventoryItemInfo>) {
+        val folder = folderIndex[folderId].takeIf { it >= 0 } ?: putFolderSlot(InventoryFolderInfo(folderId, null, "", version = version))
+
+        val keepFolders = HashSet<UUID>(folders.size * 2).apply { folders.forEach { add(it.id) } }
+        val keepItems = HashSet<UUID>(items.size * 2).apply { items.forEach { add(it.id) } }
+        var child = folderFirstChild[folder]
+        while (child != NONE) {
+            val next = folderNextSibling[child]
+            if (folderId(child) !in keepFolders) freeFolder(child)
+            child = next
+        }
+        var item = folderFirstItem[folder]
+        while (item != NONE) {
+            val next = itemNextSibling[item]
+            if (itemId(item) !in keepItems) freeItem(item)
+            item = next
+        }
+
+        folders.forEach { putFolderSlot(it.copy(parentId = folderId)) }
+        items.forEach { putItemSlot(it.copy(parentId = folderId)) }
+        folderVersions[folder] = version
+        folderLoadedVersions[folder] = version
+        modificationCount++
+    }
+
+    /**
+     * Mark [folderId]'s contents as loaded at its current version, e.g. after
+     * restoring them from a cache that matched the server
+     */
+    @Synchronized
+    fun markLoaded(folderId: UUID, version: Int) {
+        val folder = folderIndex[folderId]
+        if (folder >= 0) folderLoadedVersions[folder] = version
+    }
+
+    /** Version the loaded contents of [folderId] came from, or [VERSION_UNKNOWN] */
+    @Synchronized
+    fun loadedVersion(folderId: UUID): Int = folderIndex[folderId].takeIf { it >= 0 }?.let { folderLoadedVersions[it] } ?: VERSION_UNKNOWN
+
+    /** Every folder, parents before children */
+    @Synchronized
+    fun allFolders(): List<InventoryFolderInfo> {
+        val result = ArrayList<InventoryFolderInfo>(folderIndex.size)
+        val stack = IntStack()
+        for (slot in 0 until folderSlots) {
+            if (folderNames[slot] != null && folderParent[slot] == NONE) stack.push(slot)
+        }
+        while (stack.size > 0) {
+            val slot = stack.pop()
+            result += folderInfo(slot)
+            var child = folderFirstChild[slot]
+            while (child != NONE) {
+                stack.push(child)
+                child = folderNextSibling[child]
+            }
+        }
+        return result
+    }
+
+    /** Every item, in slot order */
+    @Synchronized
+    fun allItems(): List<InventoryItemInfo> {
+        val result = ArrayList<InventoryItemInfo>(itemIndex.size)
+        for (slot in 0 until itemSlots) {
+            if (itemNames[slot] != null) result += itemInfo(slot)
+        }
+        return result
+    }
+
+    /**
+     * Items whose name or description contains [query], ignoring case, in
+     * slot order. A linear pass over the name column; no tree walk.
+     */
+    @Synchronized
+    fun search(query: String, limit: Int = Int.MAX_VALUE): List<InventoryItemInfo> {
+        val result = ArrayList<InventoryItemInfo>()
+        for (slot in 0 until itemSlots) {
+            val name = itemNames[slot] ?: continue
+            if (name.contains(query, ignoreCase = true) || itemDescriptions[slot]!!.contains(query, ignoreCase = true)) {
+                result += itemInfo(slot)
+                if (result.size == limit) break
+            }
+        }
+        return result
+    }
+
+    @Synchronized
+    fun clear() {
+        for (slot in 0 until folderSlots) folderNames[slot] = null
+        for (slot in 0 until itemSlots) {
+            itemNames[slot] = null
+            itemDescriptions[slot] = null
+        }
+        folderSlots = 0
+        itemSlots = 0
+        freeFolders.clear()
+        freeItems.clear()
+        folderIndex.clear()
+        itemIndex.clear()
+        itemListeners.forEach { it.cleared() }
+        modificationCount++
+    }
+
+    internal fun addItemListener(listener: ItemSlotListener) {
+        itemListeners += listener
+    }
+
+    internal fun removeItemListener(listener: ItemSlotListener) {
+        itemListeners -= listener
+    }
+
+    // Slot-level reads for indexes; callers hold the store's lock
+
+    internal val itemSlotCount: Int get() = itemSlots
+    internal fun isLiveItem(slot: Int): Boolean = slot < itemSlots && itemNames[slot] != null
+    internal fun itemNameAt(slot: Int): String = itemNames[slot]!!
+    internal fun itemDescriptionAt(slot: Int): String = itemDescriptions[slot]!!
+    internal fun itemAssetTypeAt(slot: Int): Int = itemAssetTypes[slot]
+    internal fun itemCreatedAt(slot: Int): Long = itemCreated[slot]
+    internal fun itemInfoAt(slot: Int): InventoryItemInfo = itemInfo(slot)
+
+    private fun putFolderSlot(folder: InventoryFolderInfo): Int {
+        val hi = folder.id.mostSignificantBits
+        val lo = folder.id.leastSignificantBits
+        val parent = folder.parentId?.let { folderSlotOrPlaceholder(it) } ?: NONE
+        var slot = folderIndex.get(hi, lo)
+        if (slot < 0) {
+            slot = allocateFolder()
+            folderHigh[slot] = hi
+            folderLow[slot] = lo
+            folderParent[slot] = NONE
+            folderLoadedVersions[slot] = VERSION_UNKNOWN
+            folderFirstChild[slot] = NONE
+            folderFirstItem[slot] = NONE
+            folderNextSibling[slot] = NONE
+            folderIndex.put(hi, lo, slot)
+        }
+        if (folderParent[slot] != parent) {
+            unlinkFolder(slot)
+            folderParent[slot] = parent
+            if (parent != NONE) {
+                folderNextSibling[slot] = folderFirstChild[parent]
+                folderFirstChild[parent] = slot
+            }
+        }
+        folderNames[slot] = folder.name
+        folderTypes[slot] = folder.type
+        folderVersions[slot] = folder.version
+        return slot
+    }
+
+    private fun folderSlotOrPlaceholder(id: UUID): Int {
+        val slot = folderIndex[id]
+        return if (slot >= 0) slot else putFolderSlot(InventoryFolderInfo(id, null, ""))
+    }
+
+    private fun putItemSlot(item: InventoryItemInfo): Int {
+        val hi = item.id.mostSignificantBits
+        val lo = item.id.leastSignificantBits
+        val parent = folderSlotOrPlaceholder(item.parentId)
+        var slot = itemIndex.get(hi, lo)
+        if (slot < 0) {
+            slot = allocateItem()
+            itemHigh[slot] = hi
+            itemLow[slot] = lo
+            itemParent[slot] = NONE
+            itemNextSibling[slot] = NONE
+            itemIndex.put(hi, lo, slot)
+        }
+        if (itemParent[slot] != parent) {
+            unlinkItem(slot)
+            itemParent[slot] = parent
+            itemNextSibling[slot] = folderFirstItem[parent]
+            folderFirstItem[parent] = slot
+        }
+        itemNames[slot] = item.name
+        itemDescriptions[slot] = item.description
+        itemAssetHigh[slot] = item.assetId.mostSignificantBits
+        itemAssetLow[slot] = item.assetId.leastSignificantBits
+        itemAssetTypes[slot] = item.assetType
+        itemInventoryTypes[slot] = item.inventoryType
+        itemFlags[slot] = item.flags
+        itemCreated[slot] = item.creationDate
+        itemCreatorHigh[slot] = item.creatorId.mostSignificantBits
+        itemCreatorLow[slot] = item.creatorId.leastSignificantBits
+        itemListeners.forEach { it.itemChanged(slot) }
+        return slot
+    }
+
+    private fun unlinkFolder(slot: Int) {
+        val parent = folderParent[slot]
+        if (parent == NONE) return
+        if (folderFirstChild[parent] == slot) {
+            folderFirstChild[parent] = folderNextSibling[slot]
+        } else {
+            var previous = folderFirstChild[parent]
+            while (folderNextSibling[previous] != slot) previous = folderNextSibling[previous]
+            folderNextSibling[previous] = folderNextSibling[slot]
+        }
+        folderNextSibling[slot] = NONE
+        folderParent[slot] = NONE
+    }
+
+    private fun unlinkItem(slot: Int) {
+        val parent = itemParent[slot]
+        if (parent == NONE) return
+        if (folderFirstItem[parent] == slot) {
+            folderFirstItem[parent] = itemNextSibling[slot]
+        } else {
+            var previous = folderFirstItem[parent]
+            while (itemNextSibling[previous] != slot) previous = itemNextSibling[previous]
+            itemNextSibling[previous] = itemNextSibling[slot]
+        }
+        itemNextSibling[slot] = NONE
+        itemParent[slot] = NONE
+    }
+
+    private fun freeItem(slot: Int) {
+        unlinkItem(slot)
+        itemIndex.remove(itemHigh[slot], itemLow[slot])
+        itemNames[slot] = null
+        itemDescriptions[slot] = null
+        freeItems.push(slot)
+        itemListeners.forEach { it.itemChanged(slot) }
+    }
+
+    private fun freeFolder(slot: Int) {
+        while (folderFirstItem[slot] != NONE) freeItem(folderFirstItem[slot])
+        while (folderFirstChild[slot] != NONE) freeFolder(folderFirstChild[slot])
+        unlinkFolder(slot)
+        folderIndex.remove(folderHigh[slot], folderLow[slot])
+        folderNames[slot] = null
+        freeFolders.push(slot)
+    }
+
+    private fun allocateFolder(): Int {
+        if (freeFolders.size > 0) return freeFolders.pop()
+        if (folderSlots == folderHigh.size) growFolders(folderSlots * 2)
+        return folderSlots++
+    }
+
+    private fun allocateItem(): Int {
+        if (freeItems.size > 0) return freeItems.pop()
+        if (itemSlots == itemHigh.size) growItems(itemSlots * 2)
+        return itemSlots++
+    }
+
+    private fun growFolders(capacity: Int) {
+        folderHigh = folderHigh.copyOf(capacity)
+        folderLow = folderLow.copyOf(capacity)
+        folderParent = folderParent.copyOf(capacity)
+        folderNames = folderNames.copyOf(capacity)
+        folderTypes = folderTypes.copyOf(capacity)
+        folderVersions = folderVersions.copyOf(capacity)
+        folderLoadedVersions = folderLoadedVersions.copyOf(capacity)
+        folderFirstChild = folderFirstChild.copyOf(capacity)
+        folderFirstItem = folderFirstItem.copyOf(capacity)
+        folderNextSibling = folderNextSibling.copyOf(capacity)
+    }
+
+    private fun growItems(capacity: Int) {
+        itemHigh = itemHigh.copyOf(capacity)
+        itemLow = itemLow.copyOf(capacity)
+        itemParent = itemParent.copyOf(capacity)
+        itemNames = itemNames.copyOf(capacity)
+        itemDescriptions = itemDescriptions.copyOf(capacity)
+        itemAssetHigh = itemAssetHigh.copyOf(capacity)
+        itemAssetLow = itemAssetLow.copyOf(capacity)
+        itemAssetTypes = itemAssetTypes.copyOf(capacity)
+        itemInventoryTypes = itemInventoryTypes.copyOf(capacity)
+        itemFlags = itemFlags.copyOf(capacity)
+        itemCreated = itemCreated.copyOf(capacity)
+        itemCreatorHigh = itemCreatorHigh.copyOf(capacity)
+        itemCreatorLow = itemCreatorLow.copyOf(capacity)
+        itemNextSibling = itemNextSibling.copyOf(capacity)
+    }
+
+    private fun folderId(slot: Int) = UUID(folderHigh[slot], folderLow[slot])
+    private fun itemId(slot: Int) = UUID(itemHigh[slot], itemLow[slot])
+
+    private fun folderInfo(slot: Int) = InventoryFolderInfo(
+        id = folderId(slot),
+        parentId = folderParent[slot].takeIf { it != NONE }?.let(::folderId),
+        name = folderNames[slot]!!,
+        type = folderTypes[slot],
+        version = folderVersions[slot]
+    )
+
+    private fun itemInfo(slot: Int) = InventoryItemInfo(
+        id = itemId(slot),
+        parentId = folderId(itemParent[slot]),
+        name = itemNames[slot]!!,
+        description = itemDescriptions[slot]!!,
+        assetId = UUID(itemAssetHigh[slot], itemAssetLow[slot]),
+        assetType = itemAssetTypes[slot],
+        inventoryType = itemInventoryTypes[slot],
+        flags = itemFlags[slot],
+        creationDate = itemCreated[slot],
+        creatorId = UUID(itemCreatorHigh[slot], itemCreatorLow[slot])
+    )
+
+    /** Growable int stack for free slots and traversal */
+    private class IntStack {
+        private var values = IntArray(16)
+        var size = 0
+            private set
+
+        fun push(value: Int) {
+            if (size == values.size) values = values.copyOf(size * 2)
+            values[size++] = value
+        }
+
+        fun pop(): Int = values[--size]
+
+        fun clear() {
+            size = 0
+        }
+    }
+
+    companion object {
+        const val VERSION_UNKNOWN = -1
+        private const val NONE = -1
+    }
+}
@@ -0,0 +1,115 @@
+package com.linkpoint.protocol.inventory
+
+import java.util.UUID
+
+/**
+ * Open-addressed UUID -> int hash table without per-entry objects: keys are
+ * stored as two longs and probed linearly, removals leave tombstones that are
+ * dropped on the next resize.
+ */
+internal class UuidIndex(expected: Int = 16) {
+    private var high = LongArray(0)
+    private var low = LongArray(0)
+    private var values = IntArray(0)
+    private var mask = 0
+    private var used = 0
+
+    var size = 0
+        private set
+
+    init {
+        allocate(tableSizeFor(expected))
+    }
+
+    operator fun get(id: UUID): Int = get(id.mostSignificantBits, id.leastSignificantBits)
+
+    fun get(hi: Long, lo: Long): Int {
+        var slot = hash(hi, lo) and mask
+        while (true) {
+            val value = values[slot]
+            if (value == EMPTY) return MISSING
+            if (value != TOMBSTONE && high[slot] == hi && low[slot] == lo) return value
+            slot = (slot + 1) and mask
+        }
+    }
+
+    fun put(hi: Long, lo: Long, value: Int) {
+        require(value >= 0) { "Values must be non-negative" }
+        if ((used + 1) * 2 > values.size) rehash(tableSizeFor(maxOf(size + 1, 8)))
+        var slot = hash(hi, lo) and mask
+        var reuse = -1
+        while (true) {
+            val current = values[slot]
+            if (current == EMPTY) break
+            if (current == TOMBSTONE) {
+                if (reuse < 0) reuse = slot
+            } else if (high[slot] == hi && low[slot] == lo) {
+                values[slot] = value
+                return
+            }
+            slot = (slot + 1) and mask
+        }
+        if (reuse >= 0) {
+            slot = reuse
+        } else {
+            used++
+        }
+        high[slot] = hi
+        low[slot] = lo
+        values[slot] = value
+        size++
+    }
+
+    fun remove(hi: Long, lo: Long): Int {
+        var slot = hash(hi, lo) and mask
+        while (true) {
+            val value = values[slot]
+            if (value == EMPTY) return MISSING
+            if (value != TOMBSTONE && high[slot] == hi && low[slot] == lo) {
+                values[slot] = TOMBSTONE
+                size--
+                return value
+            }
+            slot = (slot + 1) and mask
+        }
+    }
+
+    fun clear() {
+        values.fill(EMPTY)
+        used = 0
+        size = 0
+    }
+
+    private fun rehash(capacity: Int) {
+        val oldHigh = high
+        val oldLow = low
+        val oldValues = values
+        allocate(capacity)
+        size = 0
+        for (i in oldValues.indices) {
+            if (oldValues[i] >= 0) put(oldHigh[i], oldLow[i], oldValues[i])
+        }
+    }
+
+    private fun allocate(capacity: Int) {
+        high = LongArray(capacity)
+        low = LongArray(capacity)
+        values = IntArray(capacity) { EMPTY }
+        mask = capacity - 1
+        used = 0
+    }
+
+    private fun tableSizeFor(entries: Int): Int = Integer.highestOneBit(maxOf(entries, 4) * 4 - 1)
+
+    private fun hash(hi: Long, lo: Long): Int {
+        // UUIDs are mostly random already; fold and mix so v1/sequential ids spread too
+        val h = (hi xor lo) * -0x61c8864680b583ebL
+        return (h xor (h ushr 32)).toInt()
+    }
+
+    companion object {
+        const val MISSING = -1
+        private const val EMPTY = -1
+        private const val TOMBSTONE = -2
+    }
+}
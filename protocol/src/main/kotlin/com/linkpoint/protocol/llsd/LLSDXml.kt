@@ -0,0 +1,269 @@
+package com.linkpoint.protocol.llsd
+
+import java.io.IOException
+import java.io.InputStream
+import java.time.Instant
+import java.util.Base64
+import java.util.UUID
+
+/**
+ * Malformed LLSD document
+ */
+class LLSDParseException(message: String) : IOException(message)
+
+/**
+ * LLSD XML serialisation, as used by capability requests and responses.
+ *
+ * Values map to Kotlin types as: undef -> null, boolean -> Boolean, integer ->
+ * Int, real -> Double, string and uri -> String, uuid -> [UUID], date ->
+ * [Instant], binary -> ByteArray, map -> Map<String, Any?>, array -> List<Any?>.
+ * A Long is formatted as an integer when it fits 32 bits and rejected
+ * otherwise; an out-of-range integer in a document is a parse error.
+ *
+ * The parser is a single forward pass over the document text without a DOM or
+ * a platform XML parser, so it behaves the same on desktop and Android and a
+ * large FetchInventoryDescendents2 response costs one allocation per value.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLSDXMLParser / LLSDXMLFormatter (llsdserialize_xml.cpp)
+ * - The LLSD specification (wiki.secondlife.com/wiki/LLSD)
+ */
+object LLSDXml {
+
+    const val CONTENT_TYPE = "application/llsd+xml"
+
+    /** Value of an empty <uuid/> */
+    val NULL_UUID = UUID(0L, 0L)
+
+    fun parse(input: InputStream): Any? = parse(input.readBytes().toString(Charsets.UTF_8))
+
+    fun parse(text: String): Any? = Parser(text).document()
+
+    fun format(value: Any?): String = buildString {
+        append("<?xml version=\"1.0\" ?><llsd>")
+        formatValue(value, this)
+        append("</llsd>")
+    }
+
+    private fun formatValue(value: Any?, out: StringBuilder) {
+        when (value) {
+            null -> out.append("<undef />")
+            is Boolean -> out.append("<boolean>").append(if (value) '1' else '0').append("</boolean>")
+            is Int, is Short, is Byte -> out.append("<integer>").append(value).append("</integer>")
+            is Long -> {
+                // LLSD integers are 32-bit; truncating would send a different number
+                require(value in Int.MIN_VALUE..Int.MAX_VALUE) { "$value does not fit an LLSD integer" }
+                out.append("<integer>").append(value).append("</integer>")
+            }
+            is Double, is Float -> out.append("<real>").append(value).append("</real>")
+            is UUID -> out.append("<uuid>").append(value).append("</uuid>")
+            is Instant -> out.append("<date>").append(value).append("</date>")
+            is ByteArray -> out.append("<binary encoding=\"base64\">").append(Base64.getEncoder().encodeToString(value)).append("</binary>")
+            is Map<*, *> -> {
+                out.append("<map>")
+                value.forEach { (key, item) ->
+                    out.append("<key>")
+                    escape(key.toString(), out)
+                    out.append("</key>")
+                    formatValue(item, out)
+                }
+                out.append("</map>")
+            }
+            is Iterable<*> -> {
+                out.append("<array>")
+                value.forEach { formatValue(it, out) }
+                out.append("</array>")
+            }
+            else -> {
+                out.append("<string>")
+                escape(value.toString(), out)
+                out.append("</string>")
+            }
+        }
+    }
+
+    private fun escape(text: String, out: StringBuilder) {
+        for (c in text) {
+            when (c) {
+                '<' -> out.append("&lt;")
+                '>' -> out.append("&gt;")
+                '&' -> out.append("&amp;")
+                else -> out.append(c)
+            }
+        }
+    }
+
+    private class Parser(private val text: String) {
+        private var pos = 0
+
+        fun document(): Any? {
+            skipMisc()
+            val tag = openTag()
+            if (tag.name != "llsd") fail("Expected <llsd>, found <${tag.name}>")
+            if (tag.empty) return null
+            skipMisc()
+            if (text.startsWith("</llsd", pos)) {
+                closeTag("llsd")
+                return null
+            }
+            val value = value()
+            skipMisc()
+            closeTag("llsd")
+            return value
+        }
+
+        private fun value(): Any? {
+            val tag = openTag()
+            return when (tag.name) {
+                "map" -> if (tag.empty) emptyMap<String, Any?>() else map()
+                "array" -> if (tag.empty) emptyList<Any?>() else array()
+                "undef" -> {
+                    if (!tag.empty) closeTag("undef")
+                    null
+                }
+                else -> scalar(tag.name, if (tag.empty) "" else content(tag.name))
+            }
+        }
+
+        private fun map(): Map<String, Any?> {
+            val map = LinkedHashMap<String, Any?>()
+            while (true) {
+                skipMisc()
+                if (text.startsWith("</", pos)) {
+                    closeTag("map")
+                    return map
+                }
+                val key = openTag()
+                if (key.name != "key") fail("Expected <key> in map, found <${key.name}>")
+                val name = if (key.empty) "" else content("key")
+                skipMisc()
+                map[name] = value()
+            }
+        }
+
+        private fun array(): List<Any?> {
+            val list = ArrayList<Any?>()
+            while (true) {
+                skipMisc()
+                if (text.startsWith("</", pos)) {
+                    closeTag("array")
+                    return list
+                }
+                list += value()
+            }
+        }
+
+        private fun scalar(type: String, content: String): Any? = try {
+            when (type) {
+                "string", "uri" -> content
+                "integer" -> if (content.isBlank()) 0 else content.trim().toInt()
+                "real" -> if (content.isBlank()) 0.0 else content.trim().toDouble()
+                "boolean" -> content.trim().let { it == "1" || it.equals("true", ignoreCase = true) }
+                "uuid" -> if (content.isBlank()) NULL_UUID else UUID.fromString(content.trim())
+                "date" -> if (content.isBlank()) Instant.EPOCH else Instant.parse(content.trim())
+                "binary" -> Base64.getMimeDecoder().decode(content.trim())
+                else -> fail("Unknown LLSD type <$type>")
+            }
+        } catch (e: IllegalArgumentException) {
+            fail("Bad <$type> value '$content'")
+        } catch (e: java.time.format.DateTimeParseException) {
+            fail("Bad <$type> value '$content'")
+        }
+
+        /** Text up to the closing tag, with entities decoded; consumes the closing tag */
+        private fun content(name: String): String {
+            val end = text.indexOf('<', pos)
+            if (end < 0) fail("Unterminated <$name>")
+            val raw = text.substring(pos, end)
+            pos = end
+            closeTag(name)
+            return if (raw.indexOf('&') < 0) raw else decodeEntities(raw)
+        }
+
+        private class Tag(val name: String, val empty: Boolean)
+
+        private fun openTag(): Tag {
+            expect('<')
+            val start = pos
+            while (pos < text.length && !text[pos].isWhitespace() && text[pos] != '>' && text[pos] != '/') pos++
+            val name = text.substring(start, pos)
+            // Attributes (e.g. binary encoding) are not needed
+            val close = text.indexOf('>', pos)
+            if (close < 0) fail("Unterminated <$name")
+            val empty = text[close - 1] == '/'
+            pos = close + 1
+            return Tag(name, empty)
+        }
+
+        private fun closeTag(name: String) {
+            if (!text.startsWith("</", pos) || !text.startsWith(name, pos + 2)) fail("Expected </$name>")
+            pos += 2 + name.length
+            skipWhitespace()
+            expect('>')
+        }
+
+        /** Whitespace, the XML declaration and comments */
+        private fun skipMisc() {
+            while (true) {
+                skipWhitespace()
+                when {
+                    text.startsWith("<?", pos) -> pos = skipPast("?>")
+                    text.startsWith("<!--", pos) -> pos = skipPast("-->")
+                    text.startsWith("<!", pos) -> pos = skipPast(">")
+                    else -> return
+                }
+            }
+        }
+
+        private fun skipPast(terminator: String): Int {
+            val end = text.indexOf(terminator, pos)
+            if (end < 0) fail("Expected '$terminator'")
+            return end + terminator.length
+        }
+
+        private fun skipWhitespace() {
+            while (pos < text.length && text[pos].isWhitespace()) pos++
+        }
+
+        private fun expect(c: Char) {
+            if (pos >= text.length || text[pos] != c) fail("Expected '$c'")
+            pos++
+        }
+
+        private fun decodeEntities(raw: String): String = buildString(raw.length) {
+            var i = 0
+            while (i < raw.length) {
+                val c = raw[i]
+                if (c != '&') {
+                    append(c)
+                    i++
+                    continue
+                }
+                val end = raw.indexOf(';', i)
+                if (end < 0) fail("Unterminated entity")
+                val entity = raw.substring(i + 1, end)
+                when {
+                    entity == "lt" -> append('<')
+                    entity == "gt" -> append('>')
+                    entity == "amp" -> append('&')
+                    entity == "quot" -> append('"')
+                    entity == "apos" -> append('\'')
+                    entity.startsWith("#x") -> appendCodePoint(entity.substring(2).toInt(16))
+                    entity.startsWith("#") -> appendCodePoint(entity.substring(1).toInt())
+                    else -> fail("Unknown entity &$entity;")
+                }
+                i = end + 1
+            }
+        }
+
+        private fun fail(message: String): Nothing = throw LLSDParseException("$message at offset $pos")
+    }
+}
+
+/** Typed accessors for parsed LLSD maps; missing or mistyped values read as defaults */
+fun Map<*, *>.llsdString(key: String): String = this[key] as? String ?: ""
+fun Map<*, *>.llsdInt(key: String): Int = (this[key] as? Number)?.toInt() ?: 0
+fun Map<*, *>.llsdBoolean(key: String): Boolean = this[key] as? Boolean ?: false
+fun Map<*, *>.llsdUuid(key: String): UUID = this[key] as? UUID ?: (this[key] as? String)?.let(UUID::fromString) ?: LLSDXml.NULL_UUID
+fun Map<*, *>.llsdMap(key: String): Map<*, *> = this[key] as? Map<*, *> ?: emptyMap<String, Any?>()
+fun Map<*, *>.llsdArray(key: String): List<*> = this[key] as? List<*> ?: emptyList<Any?>()
@@ -0,0 +1,102 @@
+package com.linkpoint.protocol.names
+
+import mu.KotlinLogging
+import java.io.DataInputStream
+import java.io.DataOutputStream
+import java.io.File
+import java.io.IOException
+import java.nio.file.Files
+import java.nio.file.StandardCopyOption
+import java.util.UUID
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Resolved names kept across sessions in one compact file.
+ *
+ * The file is read on first use, dropping expired entries, and rewritten
+ * whole by [flush] when something changed, keeping the [maxEntries] names
+ * that stay valid longest. Records are big-endian: id, expiry, then display
+ * name and username as modified UTF-8.
+ */
+class NameDiskCache(
+    private val file: File,
+    private val maxEntries: Int = DEFAULT_MAX_ENTRIES,
+    private val clock: () -> Long = System::currentTimeMillis
+) {
+    private val names = HashMap<UUID, AvatarName>()
+    private var loaded = false
+    private var dirty = false
+
+    val size: Int @Synchronized get() = load().size
+
+    /** [id]'s name if cached and not expired */
+    @Synchronized
+    fun get(id: UUID): AvatarName? = load()[id]?.takeIf { it.expiresAt > clock() }
+
+    @Synchronized
+    fun put(name: AvatarName) {
+        load()[name.id] = name
+        dirty = true
+    }
+
+    /** Write the cache out if it changed since it was read or last written */
+    @Synchronized
+    fun flush() {
+        if (!dirty) return
+        val now = clock()
+        val kept = load().values.filter { it.expiresAt > now }.sortedByDescending { it.expiresAt }.take(maxEntries)
+        val temp = File(file.parentFile, "${file.name}.tmp")
+        try {
+            file.parentFile?.mkdirs()
+            DataOutputStream(temp.outputStream().buffered()).use { out ->
+                out.writeInt(MAGIC)
+                out.writeInt(FORMAT_VERSION)
+                out.writeInt(kept.size)
+                for (name in kept) {
+                    out.writeLong(name.id.mostSignificantBits)
+                    out.writeLong(name.id.leastSignificantBits)
+                    out.writeLong(name.expiresAt)
+                    out.writeUTF(name.displayName)
+                    out.writeUTF(name.username)
+                }
+            }
+            Files.move(temp.toPath(), file.toPath(), StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE)
+            dirty = false
+        } catch (e: IOException) {
+            logger.warn { "Failed to write name cache ${file.name}: ${e.message}" }
+            temp.delete()
+        }
+    }
+
+    // Caller holds the lock
+    private fun load(): HashMap<UUID, AvatarName> {
+        if (loaded) return names
+        loaded = true
+        if (!file.isFile) return names
+        val now = clock()
+        try {
+            DataInputStream(file.inputStream().buffered()).use { input ->
+                if (input.readInt() != MAGIC || input.readInt() != FORMAT_VERSION) {
+                    logger.info { "Ignoring name cache ${file.name} from another format" }
+                    return names
+                }
+                repeat(input.readInt()) {
+                    val id = UUID(input.readLong(), input.readLong())
+                    val name = AvatarName(id, expiresAt = input.readLong(), displayName = input.readUTF(), username = input.readUTF())
+                    if (name.expiresAt > now) names[id] = name
+                }
+            }
+        } catch (e: IOException) {
+            logger.warn { "Dropping unreadable name cache ${file.name}: ${e.message}" }
+            names.clear()
+        }
+        return names
+    }
+
+    companion object {
+        const val DEFAULT_MAX_ENTRIES = 10_000
+        private const val MAGIC = 0x4C504E4D // "LPNM"
+        private const val FORMAT_VERSION = 1
+    }
+}
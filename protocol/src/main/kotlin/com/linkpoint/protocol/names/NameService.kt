@@ -0,0 +1,204 @@
+package com.linkpoint.protocol.names
+
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.launch
+import mu.KotlinLogging
+import java.util.UUID
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Counters since creation. [requestsSaved] compares against asking the grid
+ * once per lookup
+ */
+data class NameStats(
+    val lookups: Long,
+    val memoryHits: Long,
+    val diskHits: Long,
+    /** Lookups answered by a cached "no such avatar" */
+    val negativeHits: Long,
+    /** Lookups that joined a request already queued or in flight */
+    val coalesced: Long,
+    val requests: Long,
+    val idsRequested: Long
+) {
+    val requestsSaved: Long get() = lookups - requests
+}
+
+/**
+ * Avatar name resolution for chat senders, the radar, profiles and
+ * inventory creators.
+ *
+ * Lookups are answered from a bounded in-memory cache, then the optional
+ * [disk] cache. Misses are not sent one by one: the first miss opens a
+ * [windowMs] window (about a frame), every miss arriving in it joins, and
+ * the window goes out as requests of at most [maxIdsPerRequest] ids. Ids
+ * already queued or in flight are awaited rather than asked for again. Ids
+ * the grid reports as unknown are cached as negative results for
+ * [negativeTtlMs], so a bad id in a busy chat doesn't become a request every
+ * frame. Failed requests are not cached; the next lookup retries.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLAvatarNameCache (batched GetDisplayNames requests,
+ *   expiry from the response, persisted cache)
+ * - The legacy UUIDNameRequest / UUIDNameReply block batching
+ */
+class NameService(
+    private val source: NameSource,
+    private val scope: CoroutineScope,
+    private val disk: NameDiskCache? = null,
+    private val windowMs: Long = DEFAULT_WINDOW_MS,
+    private val maxIdsPerRequest: Int = DisplayNameCapSource.MAX_IDS_PER_REQUEST,
+    private val memoryCapacity: Int = DEFAULT_MEMORY_CAPACITY,
+    private val defaultTtlMs: Long = DEFAULT_TTL_MS,
+    private val negativeTtlMs: Long = DEFAULT_NEGATIVE_TTL_MS,
+    private val clock: () -> Long = System::currentTimeMillis
+) {
+    // A null name is a negative result
+    private class Cached(val name: AvatarName?, val expiresAt: Long)
+
+    private val memory = LinkedHashMap<UUID, Cached>(256, 0.75f, true)
+    private val queued = HashMap<UUID, CompletableDeferred<AvatarName?>>()
+    private val inFlight = HashMap<UUID, CompletableDeferred<AvatarName?>>()
+    private var windowOpen = false
+
+    private var lookups = 0L
+    private var memoryHits = 0L
+    private var diskHits = 0L
+    private var negativeHits = 0L
+    private var coalesced = 0L
+    private var requests = 0L
+    private var idsRequested = 0L
+
+    val stats: NameStats
+        @Synchronized get() = NameStats(lookups, memoryHits, diskHits, negativeHits, coalesced, requests, idsRequested)
+
+    /**
+     * [id]'s name from the caches, even if expired, without going to the
+     * grid; for drawing a label before [get] returns
+     */
+    @Synchronized
+    fun cached(id: UUID): AvatarName? = memory[id]?.name ?: disk?.get(id)
+
+    suspend fun get(id: UUID): AvatarName? = getAll(listOf(id))[id]
+
+    /**
+     * Names for [ids], waiting for the current window's request if any are
+     * missing; unknown and unanswered ids are left out
+     */
+    suspend fun getAll(ids: Collection<UUID>): Map<UUID, AvatarName> {
+        val result = HashMap<UUID, AvatarName>()
+        val waits = ArrayList<CompletableDeferred<AvatarName?>>()
+        synchronized(this) {
+            val now = clock()
+            for (id in ids.toSet()) {
+                lookups++
+                val hit = fresh(id, now)
+                if (hit != null) {
+                    hit.name?.let { result[id] = it }
+                    continue
+                }
+                val waiting = inFlight[id] ?: queued[id]
+                if (waiting != null) {
+                    coalesced++
+                    waits += waiting
+                    continue
+                }
+                waits += CompletableDeferred<AvatarName?>().also { queued[id] = it }
+                if (!windowOpen) {
+                    windowOpen = true
+                    scope.launch {
+                        delay(windowMs)
+                        sendWindow()
+                    }
+                }
+            }
+        }
+        for (waiting in waits) waiting.await()?.let { result[it.id] = it }
+        return result
+    }
+
+    /** Write the disk cache out, e.g. when the app goes to the background */
+    fun persist() {
+        disk?.flush()
+    }
+
+    private suspend fun sendWindow() {
+        val window = synchronized(this) {
+            windowOpen = false
+            HashMap(queued).also {
+                queued.clear()
+                inFlight.putAll(it)
+            }
+        }
+        for (batch in window.keys.chunked(maxIdsPerRequest)) {
+            scope.launch { request(batch.toSet(), window) }
+        }
+    }
+
+    private suspend fun request(ids: Set<UUID>, waiting: Map<UUID, CompletableDeferred<AvatarName?>>) {
+        var response = NameResponse(emptyMap())
+        try {
+            synchronized(this) {
+                requests++
+                idsRequested += ids.size
+            }
+            response = source.fetch(ids)
+        } catch (e: CancellationException) {
+            throw e
+        } catch (e: Exception) {
+            logger.warn(e) { "Name lookup for ${ids.size} avatars failed" }
+        } finally {
+            val now = clock()
+            synchronized(this) {
+                for (id in ids) {
+                    val name = response.names[id]
+                    when {
+                        name != null -> {
+                            val expiresAt = if (name.expiresAt > now) name.expiresAt else now + defaultTtlMs
+                            val stored = name.copy(expiresAt = expiresAt)
+                            remember(id, Cached(stored, expiresAt))
+                            disk?.put(stored)
+                        }
+                        id in response.unknown -> remember(id, Cached(null, now + negativeTtlMs))
+                    }
+                    inFlight.remove(id)
+                }
+            }
+            // Waiters get null on failure or cancellation rather than hanging
+            ids.forEach { id -> waiting[id]?.complete(response.names[id]) }
+        }
+    }
+
+    // Caller holds the lock
+    private fun fresh(id: UUID, now: Long): Cached? {
+        val cached = memory[id]
+        if (cached != null && cached.expiresAt > now) {
+            if (cached.name == null) negativeHits++ else memoryHits++
+            return cached
+        }
+        val stored = disk?.get(id) ?: return null
+        diskHits++
+        return Cached(stored, stored.expiresAt).also { remember(id, it) }
+    }
+
+    // Caller holds the lock
+    private fun remember(id: UUID, cached: Cached) {
+        memory[id] = cached
+        if (memory.size > memoryCapacity) {
+            val eldest = memory.keys.iterator()
+            eldest.next()
+            eldest.remove()
+        }
+    }
+
+    companion object {
+        const val DEFAULT_WINDOW_MS = 16L
+        const val DEFAULT_MEMORY_CAPACITY = 4096
+        const val DEFAULT_TTL_MS = 24 * 60 * 60 * 1000L
+        const val DEFAULT_NEGATIVE_TTL_MS = 10 * 60 * 1000L
+    }
+}
@@ -0,0 +1,85 @@
+package com.linkpoint.protocol.names
+
+import com.linkpoint.protocol.llsd.LLSDXml
+import com.linkpoint.protocol.llsd.llsdArray
+import com.linkpoint.protocol.llsd.llsdString
+import com.linkpoint.protocol.llsd.llsdUuid
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.withContext
+import java.io.IOException
+import java.net.HttpURLConnection
+import java.net.URL
+import java.time.Instant
+import java.util.UUID
+
+/**
+ * An avatar's names as last resolved. [expiresAt] is when the display name
+ * should be looked up again, in epoch milliseconds
+ */
+data class AvatarName(
+    val id: UUID,
+    val displayName: String,
+    val username: String,
+    val expiresAt: Long
+)
+
+/**
+ * Answer to one batched lookup: names found, and ids the grid says don't
+ * exist. Ids in neither were not answered (e.g. the request failed)
+ */
+data class NameResponse(val names: Map<UUID, AvatarName>, val unknown: Set<UUID> = emptySet())
+
+/**
+ * Where [NameService] sends its batched lookups
+ */
+fun interface NameSource {
+    suspend fun fetch(ids: Set<UUID>): NameResponse
+}
+
+/**
+ * [NameSource] on the GetDisplayNames capability: one GET per batch with the
+ * ids as repeated query parameters, answered with display name, username and
+ * expiry per agent plus a list of bad ids
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLAvatarNameCache::requestNamesViaCapability
+ */
+class DisplayNameCapSource(
+    private val capabilityUrl: String,
+    private val timeoutMs: Int = 30_000
+) : NameSource {
+
+    override suspend fun fetch(ids: Set<UUID>): NameResponse = withContext(Dispatchers.IO) {
+        val query = ids.joinToString("&") { "ids=$it" }
+        val connection = URL("${capabilityUrl.trimEnd('/')}/?$query").openConnection() as HttpURLConnection
+        try {
+            connection.connectTimeout = timeoutMs
+            connection.readTimeout = timeoutMs
+            connection.setRequestProperty("Accept", LLSDXml.CONTENT_TYPE)
+            if (connection.responseCode !in 200..299) throw IOException("HTTP ${connection.responseCode} from GetDisplayNames")
+            val response = connection.inputStream.use { LLSDXml.parse(it) } as? Map<*, *>
+                ?: throw IOException("GetDisplayNames returned no map")
+            parse(response)
+        } finally {
+            connection.disconnect()
+        }
+    }
+
+    companion object {
+        const val CAPABILITY_NAME = "GetDisplayNames"
+        // Ids per GET, keeping the URL under the simulator's length limit
+        const val MAX_IDS_PER_REQUEST = 50
+
+        fun parse(response: Map<*, *>): NameResponse {
+            val names = HashMap<UUID, AvatarName>()
+            for (agent in response.llsdArray("agents")) {
+                val fields = agent as? Map<*, *> ?: continue
+                val id = fields.llsdUuid("id")
+                val expires = (fields["display_name_expires"] as? Instant)?.toEpochMilli() ?: 0L
+                names[id] = AvatarName(id, fields.llsdString("display_name"), fields.llsdString("username"), expires)
+            }
+            val unknown = response.llsdArray("bad_ids").mapNotNull { it as? UUID ?: (it as? String)?.let(UUID::fromString) }
+            return NameResponse(names, unknown.toSet())
+        }
+    }
+}
@@ -0,0 +1,160 @@
+package com.linkpoint.protocol.rlv
+
+import com.linkpoint.protocol.RLVProcessor.RLVCommand
+
+/**
+ * One command from an RLV command list, as ranges into the input.
+ *
+ * Tokens are reused between commands; copy out what you need with [option] or
+ * [param] before the visitor returns.
+ */
+class RLVToken internal constructor() {
+    var input: CharSequence = ""
+        internal set
+
+    /** The command, or null if the behaviour name is unknown */
+    var command: RLVCommand? = null
+        internal set
+
+    var behaviourStart = 0
+        internal set
+    var behaviourEnd = 0
+        internal set
+    /** Option range (text after ':'), or -1 when there is none */
+    var optionStart = -1
+        internal set
+    var optionEnd = -1
+        internal set
+    /** Parameter range (text after '='), or -1 when there is none */
+    var paramStart = -1
+        internal set
+    var paramEnd = -1
+        internal set
+
+    val hasOption: Boolean get() = optionStart >= 0
+    val hasParam: Boolean get() = paramStart >= 0
+
+    fun behaviour(): String = input.subSequence(behaviourStart, behaviourEnd).toString()
+
+    fun option(): String? = if (hasOption) input.subSequence(optionStart, optionEnd).toString() else null
+
+    fun param(): String? = if (hasParam) input.subSequence(paramStart, paramEnd).toString() else null
+
+    /** Compare the parameter without copying it */
+    fun paramEquals(value: String): Boolean {
+        if (!hasParam || paramEnd - paramStart != value.length) return false
+        for (i in value.indices) {
+            if (input[paramStart + i] != value[i]) return false
+        }
+        return true
+    }
+}
+
+/**
+ * Single-pass tokenizer for RLV command lists: `@cmd[:option][=param][,cmd...]`.
+ *
+ * Scans the input once without `split` or substrings; behaviour names are
+ * resolved with an open-addressed hash table keyed by the same hash as
+ * String.hashCode, so lookup does not allocate either.
+ */
+object RLVCommandParser {
+
+    private val COMMANDS = RLVCommand.values()
+    private val TABLE_MASK = Integer.highestOneBit(COMMANDS.size * 4) - 1
+    // Command ordinal + 1 per slot, 0 = empty
+    private val TABLE = IntArray(TABLE_MASK + 1).also { table ->
+        COMMANDS.forEach { command ->
+            var slot = command.command.hashCode() and TABLE_MASK
+            while (table[slot] != 0) slot = (slot + 1) and TABLE_MASK
+            table[slot] = command.ordinal + 1
+        }
+    }
+
+    /**
+     * Tokenize [input], calling [visitor] for every non-empty command. A leading
+     * '@' is optional; whitespace around each command is ignored.
+     *
+     * @param visitor return false to stop parsing early
+     * @return number of commands visited
+     */
+    inline fun parse(input: CharSequence, visitor: (RLVToken) -> Boolean): Int {
+        val token = newToken(input)
+        var count = 0
+        var position = if (input.isNotEmpty() && input[0] == '@') 1 else 0
+        while (position <= input.length) {
+            val next = scan(token, position)
+            if (token.behaviourEnd > token.behaviourStart) {
+                count++
+                if (!visitor(token)) break
+            }
+            position = next
+        }
+        return count
+    }
+
+    @PublishedApi
+    internal fun newToken(input: CharSequence) = RLVToken().also { it.input = input }
+
+    /**
+     * Fill [token] with the command starting at [from]
+     *
+     * @return position after the command's separator
+     */
+    @PublishedApi
+    internal fun scan(token: RLVToken, from: Int): Int {
+        val input = token.input
+        var end = from
+        while (end < input.length && input[end] != ',') end++
+
+        var start = from
+        var stop = end
+        while (start < stop && input[start].isWhitespace()) start++
+        while (stop > start && input[stop - 1].isWhitespace()) stop--
+
+        var colon = -1
+        var equals = -1
+        for (i in start until stop) {
+            val c = input[i]
+            if (c == '=') { equals = i; break }
+            if (c == ':' && colon < 0) colon = i
+        }
+
+        token.behaviourStart = start
+        token.behaviourEnd = when {
+            colon >= 0 -> colon
+            equals >= 0 -> equals
+            else -> stop
+        }
+        token.optionStart = if (colon >= 0) colon + 1 else -1
+        token.optionEnd = if (colon >= 0) (if (equals >= 0) equals else stop) else -1
+        token.paramStart = if (equals >= 0) equals + 1 else -1
+        token.paramEnd = if (equals >= 0) stop else -1
+        token.command = lookup(input, token.behaviourStart, token.behaviourEnd)
+
+        return end + 1
+    }
+
+    /**
+     * Resolve a behaviour name in input[start, end) without copying it
+     */
+    fun lookup(input: CharSequence, start: Int, end: Int): RLVCommand? {
+        var hash = 0
+        for (i in start until end) hash = 31 * hash + input[i].code
+        var slot = hash and TABLE_MASK
+        while (true) {
+            val entry = TABLE[slot]
+            if (entry == 0) return null
+            val command = COMMANDS[entry - 1]
+            if (matches(command.command, input, start, end)) return command
+            slot = (slot + 1) and TABLE_MASK
+        }
+    }
+
+    private fun matches(name: String, input: CharSequence, start: Int, end: Int): Boolean {
+        if (name.length != end - start) return false
+        for (i in name.indices) {
+            if (name[i] != input[start + i]) return false
+        }
+        return true
+    }
+}
@@ -0,0 +1,272 @@
+package com.linkpoint.protocol.rlv
+
+import com.linkpoint.protocol.RLVProcessor.RLVCommand
+import java.util.EnumSet
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CopyOnWriteArrayList
+
+/**
+ * Notified once per batch with the behaviours whose restrictions changed
+ */
+fun interface RestrictionListener {
+    fun onRestrictionsChanged(changed: Set<RLVCommand>)
+}
+
+/**
+ * Compiled view of every active RLV restriction, built for checks on hot paths
+ * (each chat line, camera update and touch).
+ *
+ * Restrictions are reference counted per behaviour: each source object holds a
+ * behaviour at most once, and the behaviour's bit stays set while any source
+ * holds it. Options are kept in per-behaviour tables:
+ * - scoped restrictions apply to one option only (`@addattach:skull=n`);
+ * - exceptions lift a restriction for one option (`@sendim:<uuid>=add`).
+ *
+ * Checks are O(1) and do not allocate: a bit test plus at most one hash lookup.
+ * Mutations are serialised on the table and grouped with [batch]: the bitsets
+ * are published once when the batch ends and listeners get a single
+ * notification naming every behaviour that changed. Checks take no lock; they
+ * see either the state before or after a batch's bitsets, but the option
+ * tables are updated in place, so a check racing a batch may already see some
+ * of its scoped restrictions and exceptions. Listeners only run once the
+ * whole batch is in.
+ *
+ * Based on concepts from:
+ * - RLVa's RlvBehaviourDictionary and per-object RlvObject bookkeeping
+ * - Restrained Love Viewer's exception lists (rlvhandler.cpp)
+ */
+class RestrictionTable {
+
+    private val words = (BEHAVIOURS.size + 63) / 64
+
+    // Behaviours with at least one unscoped restriction, and who holds them
+    @Volatile private var restricted = LongArray(words)
+    private val refCounts = IntArray(BEHAVIOURS.size)
+
+    // Behaviours with at least one scoped restriction
+    @Volatile private var scopedAny = LongArray(words)
+    private val scoped = arrayOfNulls<ConcurrentHashMap<String, Int>>(BEHAVIOURS.size)
+    private val exceptions = arrayOfNulls<ConcurrentHashMap<String, Int>>(BEHAVIOURS.size)
+
+    private class Source {
+        val held = LongArray((BEHAVIOURS.size + 63) / 64)
+        val scoped = HashSet<Pair<RLVCommand, String>>()
+        val exceptions = HashSet<Pair<RLVCommand, String>>()
+        val isEmpty: Boolean get() = held.all { it == 0L } && scoped.isEmpty() && exceptions.isEmpty()
+    }
+
+    private val sources = HashMap<String, Source>()
+    private val listeners = CopyOnWriteArrayList<RestrictionListener>()
+    
+    // Working copies of the bitsets while a batch is open
+    private var batchDepth = 0
+    private var pendingRestricted = restricted
+    private var pendingScopedAny = scopedAny
+    private val changed = LongArray(words)
+    
+    fun addListener(listener: RestrictionListener) { listeners += listener }
+    
+    fun removeListener(listener: RestrictionListener) { listeners -= listener }
+    
+    /**
+     * Apply several changes under one lock: readers see the bitsets switch
+     * over at once and listeners are notified once at the end. Option tables
+     * change as the block runs, so this is not a transaction for unlocked
+     * checks. Batches may nest.
+     */
+    fun <R> batch(block: RestrictionTable.() -> R): R {
+        var notify: Set<RLVCommand>? = null
+        val result = synchronized(this) {
+            if (batchDepth++ == 0) {
+                pendingRestricted = restricted.copyOf()
+                pendingScopedAny = scopedAny.copyOf()
+            }
+            try {
+                block()
+            } finally {
+                if (--batchDepth == 0) {
+                    restricted = pendingRestricted
+                    scopedAny = pendingScopedAny
+                    notify = drainChanged()
+                }
+            }
+        }
+        // Outside the lock so listeners may query the table
+        notify?.let { changed -> listeners.forEach { it.onRestrictionsChanged(changed) } }
+        return result
+    }
+
+    /**
+     * Whether [behaviour] is restricted for every option
+     */
+    fun isRestricted(behaviour: RLVCommand): Boolean = testBit(restricted, behaviour.ordinal)
+
+    /**
+     * Whether [behaviour] is restricted for [option] (an attachment point, avatar
+     * UUID, ...), taking scoped restrictions and exceptions into account
+     */
+    fun isRestricted(behaviour: RLVCommand, option: String?): Boolean {
+        val index = behaviour.ordinal
+        if (testBit(restricted, index)) {
+            if (option == null) return true
+            val excepted = exceptions[index]
+            if (excepted == null || !excepted.containsKey(option)) return true
+        }
+        if (option != null && testBit(scopedAny, index)) {
+            return scoped[index]?.containsKey(option) == true
+        }
+        return false
+    }
+
+    /**
+     * Record that [sourceId] restricts [behaviour], optionally only for [option].
+     *
+     * @return false if that source already held this restriction
+     */
+    fun addRestriction(sourceId: String, behaviour: RLVCommand, option: String? = null): Boolean = batch {
+        val source = sources.getOrPut(sourceId) { Source() }
+        val index = behaviour.ordinal
+        if (option != null) {
+            if (!source.scoped.add(behaviour to option)) return@batch false
+            increment(scoped, index, option)
+            setBit(pendingScopedAny, index, true)
+            setBit(changed, index, true)
+            return@batch true
+        }
+        if (testBit(source.held, index)) return@batch false
+        setBit(source.held, index, true)
+        if (refCounts[index]++ == 0) {
+            setBit(pendingRestricted, index, true)
+            setBit(changed, index, true)
+        }
+        true
+    }
+
+    /**
+     * @return false if [sourceId] did not hold this restriction
+     */
+    fun removeRestriction(sourceId: String, behaviour: RLVCommand, option: String? = null): Boolean = batch {
+        val source = sources[sourceId] ?: return@batch false
+        val index = behaviour.ordinal
+        if (option != null) {
+            if (!source.scoped.remove(behaviour to option)) return@batch false
+            releaseScoped(index, option)
+        } else {
+            if (!testBit(source.held, index)) return@batch false
+            setBit(source.held, index, false)
+            releaseRestriction(index)
+        }
+        if (source.isEmpty) sources.remove(sourceId)
+        true
+    }
+
+    /**
+     * Record that [sourceId] lifts [behaviour] for [option]
+     */
+    fun addException(sourceId: String, behaviour: RLVCommand, option: String): Boolean = batch {
+        val source = sources.getOrPut(sourceId) { Source() }
+        if (!source.exceptions.add(behaviour to option)) return@batch false
+        increment(exceptions, behaviour.ordinal, option)
+        setBit(changed, behaviour.ordinal, true)
+        true
+    }
+
+    fun removeException(sourceId: String, behaviour: RLVCommand, option: String): Boolean = batch {
+        val source = sources[sourceId] ?: return@batch false
+        if (!source.exceptions.remove(behaviour to option)) return@batch false
+        decrement(exceptions, behaviour.ordinal, option)
+        setBit(changed, behaviour.ordinal, true)
+        if (source.isEmpty) sources.remove(sourceId)
+        true
+    }
+
+    /**
+     * Drop everything [sourceId] holds, e.g. when the object detaches or is derezzed
+     *
+     * @return number of restrictions and exceptions released
+     */
+    fun clearSource(sourceId: String): Int = batch {
+        val source = sources.remove(sourceId) ?: return@batch 0
+        var released = 0
+        for (index in BEHAVIOURS.indices) {
+            if (testBit(source.held, index)) {
+                releaseRestriction(index)
+                released++
+            }
+        }
+        source.scoped.forEach { (behaviour, option) -> releaseScoped(behaviour.ordinal, option) }
+        source.exceptions.forEach { (behaviour, option) ->
+            decrement(exceptions, behaviour.ordinal, option)
+            setBit(changed, behaviour.ordinal, true)
+        }
+        released + source.scoped.size + source.exceptions.size
+    }
+
+    fun clear() = batch {
+        for (index in BEHAVIOURS.indices) {
+            if (refCounts[index] > 0 || scoped[index] != null || exceptions[index] != null) setBit(changed, index, true)
+        }
+        sources.clear()
+        refCounts.fill(0)
+        scoped.fill(null)
+        exceptions.fill(null)
+        pendingRestricted.fill(0L)
+        pendingScopedAny.fill(0L)
+    }
+
+    /** Number of objects currently holding restrictions or exceptions */
+    val sourceCount: Int @Synchronized get() = sources.size
+
+    /** Number of sources holding [behaviour] without an option, or scoped to [option] if given */
+    fun holders(behaviour: RLVCommand, option: String? = null): Int =
+        if (option == null) refCounts[behaviour.ordinal] else scoped[behaviour.ordinal]?.get(option) ?: 0
+
+    /** Options [behaviour] is currently restricted for, e.g. camera distance limits */
+    fun scopedOptions(behaviour: RLVCommand): Set<String> = scoped[behaviour.ordinal]?.keys?.toSet() ?: emptySet()
+
+    private fun drainChanged(): Set<RLVCommand>? {
+        if (changed.all { it == 0L }) return null
+        val set = EnumSet.noneOf(RLVCommand::class.java)
+        for (index in BEHAVIOURS.indices) {
+            if (testBit(changed, index)) set += BEHAVIOURS[index]
+        }
+        changed.fill(0L)
+        return set
+    }
+
+    private fun releaseRestriction(index: Int) {
+        if (--refCounts[index] == 0) {
+            setBit(pendingRestricted, index, false)
+            setBit(changed, index, true)
+        }
+    }
+
+    private fun releaseScoped(index: Int, option: String) {
+        decrement(scoped, index, option)
+        if (scoped[index] == null) setBit(pendingScopedAny, index, false)
+        setBit(changed, index, true)
+    }
+
+    private fun increment(tables: Array<ConcurrentHashMap<String, Int>?>, index: Int, option: String) {
+        val table = tables[index] ?: ConcurrentHashMap<String, Int>().also { tables[index] = it }
+        table.merge(option, 1, Int::plus)
+    }
+
+    private fun decrement(tables: Array<ConcurrentHashMap<String, Int>?>, index: Int, option: String) {
+        val table = tables[index] ?: return
+        table.computeIfPresent(option) { _, count -> if (count > 1) count - 1 else null }
+        if (table.isEmpty()) tables[index] = null
+    }
+
+    companion object {
+        private val BEHAVIOURS = RLVCommand.values()
+
+        private fun testBit(bits: LongArray, index: Int): Boolean =
+            bits[index ushr 6] and (1L shl index) != 0L
+
+        private fun setBit(bits: LongArray, index: Int, set: Boolean) {
+            val word = index ushr 6
+            bits[word] = if (set) bits[word] or (1L shl index) else bits[word] and (1L shl index).inv()
+        }
+    }
+}
@@ -0,0 +1,224 @@
+package com.linkpoint.protocol.rlv
+
+/**
+ * Index over the #RLV shared folder tree for the RLV inventory queries
+ * (@getinv, @getinvworn, @findfolder, @findfolders).
+ *
+ * Folders are stored depth-first in flat arrays with their lower-cased names
+ * and full paths, plus a path -> folder table, so path lookups are one hash
+ * probe and searches scan a compact array in reply order instead of walking
+ * the tree. Worn counts are kept per folder for the folder itself and its
+ * whole subtree and are updated incrementally by [setWorn], so @getinvworn
+ * never recounts items.
+ *
+ * Based on concepts from:
+ * - RLVa's RlvInventory shared-root cache (rlvinventory.cpp)
+ * - Restrained Love Viewer's shared folder specification
+ */
+class SharedFolderIndex private constructor(
+    private val ids: Array<String>,
+    private val names: Array<String>,
+    private val lowerNames: Array<String>,
+    private val paths: Array<String>,
+    private val parents: IntArray,
+    private val children: Array<IntArray>,
+    private val itemFolders: Map<String, Int>,
+    private val pathIndex: Map<String, Int>
+) {
+    /** Inventory folder, as delivered by the inventory service */
+    data class Folder(val id: String, val parentId: String?, val name: String)
+
+    /** Inventory item; only the containing folder and worn state matter here */
+    data class Item(val id: String, val folderId: String, val worn: Boolean)
+
+    private val directItems = IntArray(ids.size)
+    private val directWorn = IntArray(ids.size)
+    private val subtreeItems = IntArray(ids.size)
+    private val subtreeWorn = IntArray(ids.size)
+    private val wornItems = HashSet<String>()
+
+    val folderCount: Int get() = ids.size
+
+    /**
+     * Names of the visible subfolders of [path] ("" for the shared root),
+     * comma-separated; null if the path does not exist
+     */
+    fun getInv(path: String): String? {
+        val folder = resolve(path) ?: return null
+        return buildString {
+            forEachVisibleChild(folder) { child ->
+                if (isNotEmpty()) append(',')
+                append(names[child])
+            }
+        }
+    }
+
+    /**
+     * @getinvworn reply: `|XY` for [path] itself followed by `,name|XY` per
+     * visible subfolder. X describes the folder's own items and Y its
+     * subfolders': 0 none, 1 none worn, 2 some worn, 3 all worn.
+     */
+    @Synchronized
+    fun getInvWorn(path: String): String? {
+        val folder = resolve(path) ?: return null
+        return buildString {
+            append('|')
+            appendWornState(folder)
+            forEachVisibleChild(folder) { child ->
+                append(',').append(names[child]).append('|')
+                appendWornState(child)
+            }
+        }
+    }
+
+    /**
+     * Path of the first visible folder, in depth-first order, whose name
+     * contains every term (case-insensitive); null if none matches
+     */
+    fun findFolder(terms: List<String>): String? {
+        val lowered = terms.map { it.lowercase() }
+        for (folder in 1 until ids.size) {
+            if (matches(folder, lowered)) return paths[folder]
+        }
+        return null
+    }
+
+    /**
+     * Paths of every visible folder whose name contains every term
+     */
+    fun findFolders(terms: List<String>): List<String> {
+        val lowered = terms.map { it.lowercase() }
+        return (1 until ids.size).filter { matches(it, lowered) }.map { paths[it] }
+    }
+
+    /** Folder id at [path], or null */
+    fun folderId(path: String): String? = resolve(path)?.let { ids[it] }
+
+    /**
+     * Update an item's worn state, adjusting the counts of its folder and
+     * every ancestor
+     */
+    @Synchronized
+    fun setWorn(itemId: String, worn: Boolean) {
+        val folder = itemFolders[itemId] ?: return
+        val changed = if (worn) wornItems.add(itemId) else wornItems.remove(itemId)
+        if (!changed) return
+        val delta = if (worn) 1 else -1
+        directWorn[folder] += delta
+        var current = folder
+        while (current >= 0) {
+            subtreeWorn[current] += delta
+            current = parents[current]
+        }
+    }
+
+    private fun resolve(path: String): Int? = pathIndex[normalise(path)]
+
+    private fun matches(folder: Int, terms: List<String>): Boolean {
+        if (isHidden(folder)) return false
+        val name = lowerNames[folder]
+        return terms.all { name.contains(it) }
+    }
+
+    // A folder is hidden if it or any ancestor below the root starts with '.'
+    private fun isHidden(folder: Int): Boolean {
+        var current = folder
+        while (current > 0) {
+            if (names[current].startsWith('.')) return true
+            current = parents[current]
+        }
+        return false
+    }
+
+    private inline fun forEachVisibleChild(folder: Int, action: (Int) -> Unit) {
+        for (child in children[folder]) {
+            if (!names[child].startsWith('.')) action(child)
+        }
+    }
+
+    private fun StringBuilder.appendWornState(folder: Int) {
+        append(wornState(directItems[folder], directWorn[folder]))
+        append(wornState(subtreeItems[folder] - directItems[folder], subtreeWorn[folder] - directWorn[folder]))
+    }
+
+    private fun wornState(items: Int, worn: Int): Char = when {
+        items == 0 -> '0'
+        worn == 0 -> '1'
+        worn < items -> '2'
+        else -> '3'
+    }
+
+    companion object {
+        const val SHARED_ROOT_NAME = "#RLV"
+
+        private fun normalise(path: String): String = path.trim('/').lowercase()
+
+        /**
+         * Build the index from the avatar's inventory. Folders outside the
+         * #RLV folder (a child of the inventory root) are ignored.
+         *
+         * @return null if there is no shared root
+         */
+        fun build(folders: Collection<Folder>, items: Collection<Item>): SharedFolderIndex? {
+            val childrenOf = folders.groupBy { it.parentId }
+            val inventoryRoots = childrenOf[null].orEmpty()
+            val sharedRoot = inventoryRoots.asSequence()
+                .flatMap { childrenOf[it.id].orEmpty().asSequence() }
+                .firstOrNull { it.name == SHARED_ROOT_NAME }
+                ?: inventoryRoots.firstOrNull { it.name == SHARED_ROOT_NAME }
+                ?: return null
+
+            // Depth-first flatten, root at 0, so array order is reply order
+            val ids = ArrayList<String>()
+            val names = ArrayList<String>()
+            val paths = ArrayList<String>()
+            val parents = ArrayList<Int>()
+            val childLists = ArrayList<MutableList<Int>>()
+            val stack = ArrayDeque<Triple<Folder, Int, String>>()
+            stack.addLast(Triple(sharedRoot, -1, ""))
+            while (stack.isNotEmpty()) {
+                val (folder, parent, path) = stack.removeLast()
+                val index = ids.size
+                ids += folder.id
+                names += folder.name
+                paths += path
+                parents += parent
+                childLists += mutableListOf()
+                if (parent >= 0) childLists[parent] += index
+                childrenOf[folder.id].orEmpty().sortedBy { it.name.lowercase() }.asReversed().forEach { child ->
+                    stack.addLast(Triple(child, index, if (path.isEmpty()) child.name else "$path/${child.name}"))
+                }
+            }
+
+            val folderIndex = HashMap<String, Int>(ids.size * 2)
+            ids.forEachIndexed { index, id -> folderIndex[id] = index }
+            val pathIndex = HashMap<String, Int>(ids.size * 2)
+            paths.forEachIndexed { index, path -> pathIndex.putIfAbsent(path.lowercase(), index) }
+
+            val itemFolders = HashMap<String, Int>()
+            items.forEach { item -> folderIndex[item.folderId]?.let { itemFolders[item.id] = it } }
+
+            val index = SharedFolderIndex(
+                ids = ids.toTypedArray(),
+                names = names.toTypedArray(),
+                lowerNames = names.map { it.lowercase() }.toTypedArray(),
+                paths = paths.toTypedArray(),
+                parents = parents.toIntArray(),
+                children = childLists.map { it.toIntArray() }.toTypedArray(),
+                itemFolders = itemFolders,
+                pathIndex = pathIndex
+            )
+            items.forEach { item ->
+                val folder = itemFolders[item.id] ?: return@forEach
+                index.directItems[folder]++
+                var current = folder
+                while (current >= 0) {
+                    index.subtreeItems[current]++
+                    current = index.parents[current]
+                }
+                if (item.worn) index.setWorn(item.id, true)
+            }
+            return index
+        }
+    }
+}
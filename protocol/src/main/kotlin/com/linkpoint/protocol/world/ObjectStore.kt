@@ -0,0 +1,200 @@
+package com.linkpoint.protocol.world
+
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.core.memory.MemoryBudgets
+import com.linkpoint.core.memory.MemoryPressureLevel
+import com.linkpoint.core.memory.MemoryPressureListener
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.data.ParticleSystem
+import com.linkpoint.protocol.data.TerrainPatch
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.data.WorldEntity
+import mu.KotlinLogging
+import java.util.UUID
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CopyOnWriteArrayList
+import java.util.concurrent.atomic.AtomicLong
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Viewer-side store of world entities known in the current region.
+ *
+ * Every entity is charged to the "objects" memory account using an estimate of
+ * its retained size. Under memory pressure the entities farthest from [focus]
+ * (normally the agent's position) are dropped first; the simulator resends them
+ * when they come back into interest range. Every store shares that account;
+ * [close] takes this store's entities and listener back out of it.
+ *
+ * Entities and terrain patches are also filed in a [SpatialGrid], so views
+ * can fetch what lies in an area without scanning the whole region.
+ *
+ * Based on SecondLife viewer's LLViewerObjectList
+ */
+class ObjectStore {
+
+    /**
+     * Told when avatars arrive, move or leave the store, e.g. by the radar.
+     * Called on the thread making the change
+     */
+    interface AvatarListener {
+        fun onAvatarUpdated(avatar: Avatar)
+        fun onAvatarRemoved(id: UUID)
+    }
+
+    private val entities = ConcurrentHashMap<UUID, WorldEntity>()
+    private val terrain = ConcurrentHashMap<Int, TerrainPatch>()
+    private val modifications = AtomicLong()
+    private val avatarListeners = CopyOnWriteArrayList<AvatarListener>()
+    private val pressureListener = MemoryPressureListener { level, bytes -> evictDistant(level, bytes) }
+    private val account = MemoryBudgets.register(MemoryBudgets.OBJECTS, MemoryBudgets.PRIORITY_OBJECTS)
+        .also { it.addListener(pressureListener) }
+
+    /**
+     * Position used to decide which entities to keep under memory pressure
+     */
+    @Volatile
+    var focus: Vector3 = Vector3(128f, 128f, 25f)
+
+    val size: Int get() = entities.size
+
+    /** Entities and terrain by area */
+    val grid = SpatialGrid()
+
+    /** Bumped on every change, so views can skip redraws when nothing moved */
+    val version: Long get() = modifications.get()
+
+    /**
+     * Insert or replace an entity
+     */
+    fun put(entity: WorldEntity) {
+        val previous = entities.put(entity.id, entity)
+        if (previous != null) account.release(estimateBytes(previous))
+        grid.update(entity)
+        modifications.incrementAndGet()
+        account.charge(estimateBytes(entity))
+        if (entity is Avatar) avatarListeners.forEach { it.onAvatarUpdated(entity) }
+    }
+
+    fun remove(id: UUID): WorldEntity? {
+        val removed = entities.remove(id) ?: return null
+        grid.remove(id)
+        modifications.incrementAndGet()
+        account.release(estimateBytes(removed))
+        if (removed is Avatar) avatarListeners.forEach { it.onAvatarRemoved(id) }
+        return removed
+    }
+
+    operator fun get(id: UUID): WorldEntity? = entities[id]
+
+    fun all(): Collection<WorldEntity> = entities.values
+
+    fun avatars(): List<Avatar> = entities.values.filterIsInstance<Avatar>()
+
+    fun addAvatarListener(listener: AvatarListener) {
+        avatarListeners += listener
+    }
+
+    fun removeAvatarListener(listener: AvatarListener) {
+        avatarListeners -= listener
+    }
+
+    /**
+     * Insert or replace a terrain patch of the current region
+     */
+    fun putTerrain(patch: TerrainPatch) {
+        terrain[patch.patchY * PATCHES_PER_SIDE + patch.patchX] = patch
+        val minX = patch.patchX * PATCH_METRES
+        val minY = patch.patchY * PATCH_METRES
+        grid.touch(minX, minY, minX + PATCH_METRES - 0.01f, minY + PATCH_METRES - 0.01f)
+        modifications.incrementAndGet()
+    }
+
+    fun terrainPatch(patchX: Int, patchY: Int): TerrainPatch? = terrain[patchY * PATCHES_PER_SIDE + patchX]
+
+    /**
+     * Ground height at region position ([x], [y]) from the nearest sample of
+     * its patch, or null if the patch hasn't arrived
+     */
+    fun terrainHeight(x: Float, y: Float): Float? {
+        val patchX = (x / PATCH_METRES).toInt().coerceIn(0, PATCHES_PER_SIDE - 1)
+        val patchY = (y / PATCH_METRES).toInt().coerceIn(0, PATCHES_PER_SIDE - 1)
+        val heights = terrainPatch(patchX, patchY)?.heightMap ?: return null
+        val row = heights[((y - patchY * PATCH_METRES) / PATCH_METRES * heights.size).toInt().coerceIn(0, heights.size - 1)]
+        return row[((x - patchX * PATCH_METRES) / PATCH_METRES * row.size).toInt().coerceIn(0, row.size - 1)]
+    }
+
+    fun clear() {
+        val avatarIds = entities.values.filterIsInstance<Avatar>().map { it.id }
+        entities.values.forEach { account.release(estimateBytes(it)) }
+        entities.clear()
+        avatarIds.forEach { id -> avatarListeners.forEach { it.onAvatarRemoved(id) } }
+        terrain.clear()
+        grid.clear()
+        modifications.incrementAndGet()
+    }
+
+    /** Drop every entity and leave the shared account */
+    fun close() {
+        account.removeListener(pressureListener)
+        clear()
+    }
+
+    /**
+     * Memory pressure handler: drop the entities farthest from [focus]. Avatars are
+     * kept unless pressure is critical since they drive the radar and name tags.
+     */
+    private fun evictDistant(level: MemoryPressureLevel, bytesToFree: Long): Long {
+        val center = focus
+        val candidates = entities.values
+            .filter { level == MemoryPressureLevel.CRITICAL || it !is Avatar }
+            .sortedByDescending { distanceSquared(it.position, center) }
+
+        var freed = 0L
+        for (entity in candidates) {
+            if (freed >= bytesToFree) break
+            if (entities.remove(entity.id, entity)) {
+                grid.remove(entity.id)
+                val bytes = estimateBytes(entity)
+                account.release(bytes)
+                freed += bytes
+                if (entity is Avatar) avatarListeners.forEach { it.onAvatarRemoved(entity.id) }
+            }
+        }
+        modifications.incrementAndGet()
+        logger.debug { "Evicted distant objects under $level pressure: freed $freed bytes" }
+        return freed
+    }
+
+    private fun distanceSquared(a: Vector3, b: Vector3): Float {
+        val dx = a.x - b.x
+        val dy = a.y - b.y
+        val dz = a.z - b.z
+        return dx * dx + dy * dy + dz * dz
+    }
+
+    companion object {
+        // Rough JVM sizes: object header plus boxed vectors/quaternion and UUIDs
+        private const val BASE_ENTITY_BYTES = 160L
+        private const val UUID_BYTES = 32L
+        private const val ATTACHMENT_BYTES = 120L
+
+        // Terrain arrives as 16x16 patches of 16 m
+        private const val PATCHES_PER_SIDE = 16
+        private const val PATCH_METRES = 16f
+
+        /**
+         * Estimate of the heap retained by an entity, used for memory accounting
+         */
+        fun estimateBytes(entity: WorldEntity): Long {
+            val text = entity.name.length * 2L
+            return BASE_ENTITY_BYTES + text + when (entity) {
+                is Avatar -> (entity.displayName.length + entity.username.length) * 2L +
+                    entity.attachments.size * ATTACHMENT_BYTES
+                is VirtualObject -> entity.description.length * 2L +
+                    (entity.textureIds.size + entity.children.size + (if (entity.meshId != null) 1 else 0)) * UUID_BYTES
+                is ParticleSystem -> UUID_BYTES
+            }
+        }
+    }
+}
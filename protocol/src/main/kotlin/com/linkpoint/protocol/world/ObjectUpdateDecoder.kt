@@ -0,0 +1,151 @@
+package com.linkpoint.protocol.world
+
+import com.linkpoint.core.events.Quaternion
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.protocol.data.AnimationState
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.data.ObjectMaterial
+import com.linkpoint.protocol.data.ObjectType
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.data.WorldEntity
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.UUID
+import java.util.concurrent.ConcurrentHashMap
+import kotlin.math.sqrt
+
+/**
+ * Applies the circuit's object updates to an [ObjectStore].
+ *
+ * The circuit hands over each ObjectUpdate block after its local id and CRC,
+ * as kept in the [RegionObjectCache]: state, full id, PCode, material, click
+ * action, scale, then the packed motion data (60 bytes, or 76 for avatars,
+ * which lead with a foot collision plane). The rest of the block (shape,
+ * texture entry, name values) isn't decoded yet. KillObject names objects by
+ * local id, so the id each local id was last seen with is remembered until
+ * [clear], e.g. on a region change.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLViewerObjectList::processObjectUpdate and
+ *   LLViewerObject::processUpdateMessage (OUT_FULL blocks)
+ */
+class ObjectUpdateDecoder(private val store: ObjectStore) {
+    private val byLocalId = ConcurrentHashMap<Int, UUID>()
+
+    /**
+     * Decode [data], the update of [localId], into the store
+     *
+     * @return the entity stored, or null if the block was malformed
+     */
+    fun onUpdate(localId: Int, data: ByteArray): WorldEntity? {
+        val entity = decode(data) ?: return null
+        byLocalId.put(localId, entity.id)?.let { previous -> if (previous != entity.id) store.remove(previous) }
+        store.put(entity)
+        return entity
+    }
+
+    fun onKill(localId: Int) {
+        byLocalId.remove(localId)?.let(store::remove)
+    }
+
+    /** Apply one of the circuit's [com.linkpoint.protocol.UDPMessageSystem.objectMessages] */
+    fun apply(message: ObjectMessage) {
+        when (message) {
+            is ObjectMessage.Update -> onUpdate(message.localId, message.data)
+            is ObjectMessage.Kill -> onKill(message.localId)
+        }
+    }
+
+    /** Forget local ids, which the next region reassigns, and empty the store */
+    fun clear() {
+        byLocalId.clear()
+        store.clear()
+    }
+
+    companion object {
+        const val PCODE_PRIM = 9
+        const val PCODE_AVATAR = 47
+        const val PCODE_GRASS = 95
+        const val PCODE_NEW_TREE = 111
+        const val PCODE_TREE = 255
+
+        // State, id, PCode, material, click action, scale, motion data length
+        private const val HEADER_BYTES = 1 + 16 + 3 + 12 + 1
+        private const val MOTION_BYTES = 60
+        private const val AVATAR_MOTION_BYTES = 76
+        // The avatar block's foot collision plane precedes its motion data
+        private const val COLLISION_PLANE_BYTES = 16
+
+        /** The entity in one update block, or null if it is truncated or of an unknown kind */
+        fun decode(data: ByteArray): WorldEntity? {
+            if (data.size < HEADER_BYTES) return null
+            val buffer = ByteBuffer.wrap(data).order(ByteOrder.BIG_ENDIAN)
+            buffer.get() // State
+            val id = UUID(buffer.long, buffer.long)
+            buffer.order(ByteOrder.LITTLE_ENDIAN)
+            val pcode = buffer.get().toInt() and 0xFF
+            val material = buffer.get().toInt() and 0xFF
+            buffer.get() // Click action
+            val scale = buffer.vector()
+            val motionBytes = buffer.get().toInt() and 0xFF
+            if (motionBytes != MOTION_BYTES && motionBytes != AVATAR_MOTION_BYTES) return null
+            if (buffer.remaining() < motionBytes) return null
+            if (motionBytes == AVATAR_MOTION_BYTES) buffer.position(buffer.position() + COLLISION_PLANE_BYTES)
+            val position = buffer.vector()
+            val velocity = buffer.vector()
+            buffer.vector() // Acceleration
+            val rotation = buffer.rotation()
+            val angularVelocity = buffer.vector()
+
+            if (pcode == PCODE_AVATAR) {
+                return Avatar(
+                    id, "", position, rotation,
+                    displayName = "", username = "", appearanceHash = "",
+                    animationState = AnimationState(if (velocity.isZero()) "stand" else "walk"),
+                    attachments = emptyList()
+                )
+            }
+            val type = when (pcode) {
+                PCODE_PRIM -> ObjectType.PRIMITIVE
+                PCODE_GRASS -> ObjectType.GRASS
+                PCODE_TREE, PCODE_NEW_TREE -> ObjectType.TREE
+                else -> return null
+            }
+            return VirtualObject(
+                id, "", position, rotation, scale,
+                description = "", creatorId = NO_ID, ownerId = NO_ID,
+                objectType = type,
+                material = ObjectMaterial.values().getOrElse(material) { ObjectMaterial.NONE },
+                textureIds = emptyList(),
+                velocity = velocity,
+                angularVelocity = angularVelocity
+            )
+        }
+
+        private val NO_ID = UUID(0, 0)
+
+        private fun ByteBuffer.vector() = Vector3(float, float, float)
+
+        // Sent as x, y, z of a unit quaternion; w is implied
+        private fun ByteBuffer.rotation(): Quaternion {
+            val x = float
+            val y = float
+            val z = float
+            return Quaternion(x, y, z, sqrt(maxOf(0f, 1f - x * x - y * y - z * z)))
+        }
+
+        private fun Vector3.isZero() = x == 0f && y == 0f && z == 0f
+    }
+}
+
+/**
+ * An object update or kill from the circuit, by local id
+ */
+sealed class ObjectMessage {
+    abstract val localId: Int
+
+    /** An ObjectUpdate block after its local id and CRC, as [ObjectUpdateDecoder] reads it */
+    class Update(override val localId: Int, val data: ByteArray) : ObjectMessage()
+
+    class Kill(override val localId: Int) : ObjectMessage()
+}
@@ -0,0 +1,239 @@
+package com.linkpoint.protocol.world
+
+import mu.KotlinLogging
+import java.io.DataInputStream
+import java.io.DataOutputStream
+import java.io.File
+import java.io.IOException
+import java.nio.file.Files
+import java.nio.file.StandardCopyOption
+import java.util.UUID
+import java.util.zip.DeflaterOutputStream
+import java.util.zip.InflaterInputStream
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * One object's last full update in a region: its ObjectUpdate data block as
+ * received, and the CRC the simulator sent with it
+ */
+class CachedObject(val localId: Int, val crc: Int, val data: ByteArray) {
+    // Last time the simulator told us about this object, for eviction
+    internal var lastSeen = 0L
+}
+
+/** An ObjectUpdateCached block: the simulator's current CRC for [localId] */
+data class CacheProbe(val localId: Int, val crc: Int)
+
+/** Why an object has to be requested with RequestMultipleObjects */
+enum class CacheMissType(val code: Int) {
+    /** Not in the cache */
+    FULL(0),
+    /** Cached, but the object changed since */
+    CRC(1)
+}
+
+data class CacheMiss(val localId: Int, val type: CacheMissType)
+
+/** Answer to a batch of probes: objects to use from the cache, and ones to request */
+class ProbeResult(val hits: List<CachedObject>, val misses: List<CacheMiss>)
+
+/**
+ * Probes and traffic since creation. [bytesSaved] counts the update data
+ * that didn't have to cross the network, less the probes themselves
+ */
+data class ObjectCacheStats(
+    val probes: Long,
+    val hits: Long,
+    val bytesSaved: Long,
+    val bytesReceived: Long
+) {
+    val hitRate: Float get() = if (probes > 0) hits.toFloat() / probes else 0f
+}
+
+/**
+ * Object updates kept across visits, one compact file per region.
+ *
+ * On entering a region, [open] loads that region's file (dropping it if the
+ * simulator's cache id changed, since local ids are then reassigned). Full
+ * ObjectUpdates are [store]d with their CRC. When the simulator instead
+ * offers ObjectUpdateCached, [probe] answers each (local id, CRC) pair from
+ * memory: matching objects are used as they are, and only the misses go out
+ * in RequestMultipleObjects. KillObject [remove]s an entry.
+ *
+ * [flush] rewrites the region's file when it changed, keeping the
+ * [maxObjectsPerRegion] objects seen most recently; files are deflated, as
+ * update blocks are mostly small integers, zeros and repeated floats.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLVOCache / LLVOCacheEntry and
+ *   LLViewerRegion::probeCache, with misses requested through
+ *   LLViewerRegion::requestCacheMisses
+ */
+class RegionObjectCache(
+    private val directory: File,
+    private val maxObjectsPerRegion: Int = DEFAULT_MAX_OBJECTS_PER_REGION,
+    private val clock: () -> Long = System::currentTimeMillis
+) {
+    private val objects = HashMap<Int, CachedObject>()
+    private var regionHandle: Long? = null
+    private var cacheId: UUID = NO_CACHE_ID
+    private var dirty = false
+
+    private var probes = 0L
+    private var hits = 0L
+    private var bytesSaved = 0L
+    private var bytesReceived = 0L
+
+    /** Region whose objects are loaded, or null before the first [open] */
+    val currentRegion: Long? @Synchronized get() = regionHandle
+
+    val size: Int @Synchronized get() = objects.size
+
+    val stats: ObjectCacheStats @Synchronized get() = ObjectCacheStats(probes, hits, bytesSaved, bytesReceived)
+
+    /**
+     * Switch to [regionHandle], writing out the previous region first. A
+     * [simCacheId] different from the stored one (e.g. after a simulator
+     * restart) empties the region's cache; null, before the region handshake
+     * told it, keeps what is stored. Reads and writes files, so callers keep
+     * it off the network thread
+     */
+    @Synchronized
+    fun open(regionHandle: Long, simCacheId: UUID? = null) {
+        if (this.regionHandle == regionHandle && (simCacheId == null || cacheId == simCacheId)) return
+        if (this.regionHandle != regionHandle) {
+            flush()
+            objects.clear()
+            this.regionHandle = regionHandle
+            load(regionHandle)
+        }
+        if (simCacheId != null && cacheId != simCacheId) {
+            if (objects.isNotEmpty()) logger.info { "Region ${java.lang.Long.toHexString(regionHandle)} cache id changed; dropping ${objects.size} cached objects" }
+            objects.clear()
+            cacheId = simCacheId
+            dirty = true
+        }
+    }
+
+    /** A full update of [localId] arrived with [crc]; [data] is kept as given */
+    @Synchronized
+    fun store(localId: Int, crc: Int, data: ByteArray) {
+        if (regionHandle == null || data.size > MAX_DATA_BYTES) return
+        objects[localId] = CachedObject(localId, crc, data).also { it.lastSeen = clock() }
+        bytesReceived += data.size
+        dirty = true
+    }
+
+    @Synchronized
+    fun remove(localId: Int) {
+        if (objects.remove(localId) != null) dirty = true
+    }
+
+    /** Sort a batch of ObjectUpdateCached blocks into hits and misses */
+    @Synchronized
+    fun probe(batch: List<CacheProbe>): ProbeResult {
+        val now = clock()
+        val found = ArrayList<CachedObject>(batch.size)
+        val misses = ArrayList<CacheMiss>()
+        for (probe in batch) {
+            val cached = objects[probe.localId]
+            when {
+                cached == null -> misses += CacheMiss(probe.localId, CacheMissType.FULL)
+                cached.crc != probe.crc -> misses += CacheMiss(probe.localId, CacheMissType.CRC)
+                else -> {
+                    cached.lastSeen = now
+                    found += cached
+                    bytesSaved += maxOf(cached.data.size - PROBE_BYTES, 0)
+                }
+            }
+        }
+        probes += batch.size
+        hits += found.size
+        if (found.isNotEmpty()) dirty = true
+        return ProbeResult(found, misses)
+    }
+
+    /** Write the current region out if it changed since it was read or last written */
+    @Synchronized
+    fun flush() {
+        val region = regionHandle ?: return
+        if (!dirty) return
+        val file = fileFor(region)
+        val temp = File(directory, "${file.name}.tmp")
+        val kept = if (objects.size > maxObjectsPerRegion) {
+            objects.values.sortedByDescending { it.lastSeen }.take(maxObjectsPerRegion)
+        } else {
+            objects.values
+        }
+        try {
+            directory.mkdirs()
+            DataOutputStream(DeflaterOutputStream(temp.outputStream()).buffered()).use { out ->
+                out.writeInt(MAGIC)
+                out.writeInt(FORMAT_VERSION)
+                out.writeLong(region)
+                out.writeLong(cacheId.mostSignificantBits)
+                out.writeLong(cacheId.leastSignificantBits)
+                out.writeInt(kept.size)
+                for (cached in kept) {
+                    out.writeInt(cached.localId)
+                    out.writeInt(cached.crc)
+                    out.writeLong(cached.lastSeen)
+                    out.writeShort(cached.data.size)
+                    out.write(cached.data)
+                }
+            }
+            Files.move(temp.toPath(), file.toPath(), StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE)
+            dirty = false
+        } catch (e: IOException) {
+            logger.warn { "Failed to write object cache ${file.name}: ${e.message}" }
+            temp.delete()
+        }
+    }
+
+    // Caller holds the lock
+    private fun load(region: Long) {
+        val file = fileFor(region)
+        cacheId = NO_CACHE_ID
+        dirty = false
+        if (!file.isFile) return
+        try {
+            DataInputStream(InflaterInputStream(file.inputStream()).buffered()).use { input ->
+                if (input.readInt() != MAGIC || input.readInt() != FORMAT_VERSION || input.readLong() != region) {
+                    logger.info { "Ignoring object cache ${file.name} from another format" }
+                    return
+                }
+                cacheId = UUID(input.readLong(), input.readLong())
+                repeat(input.readInt()) {
+                    val localId = input.readInt()
+                    val crc = input.readInt()
+                    val lastSeen = input.readLong()
+                    val data = ByteArray(input.readUnsignedShort()).also { input.readFully(it) }
+                    objects[localId] = CachedObject(localId, crc, data).also { it.lastSeen = lastSeen }
+                }
+            }
+            logger.debug { "Loaded ${objects.size} cached objects for region ${java.lang.Long.toHexString(region)}" }
+        } catch (e: IOException) {
+            logger.warn { "Dropping unreadable object cache ${file.name}: ${e.message}" }
+            objects.clear()
+            file.delete()
+        }
+    }
+
+    private fun fileFor(region: Long) = File(directory, "objects-${java.lang.Long.toHexString(region)}.lpoc")
+
+    companion object {
+        const val DEFAULT_MAX_OBJECTS_PER_REGION = 20_000
+
+        /** Cache id of a simulator that doesn't send one */
+        val NO_CACHE_ID = UUID(0, 0)
+
+        // Local id, CRC and update flags of one ObjectUpdateCached block
+        const val PROBE_BYTES = 12
+
+        // Stored with a 16-bit length; a block always fits in one packet anyway
+        private const val MAX_DATA_BYTES = 0xFFFF
+        private const val MAGIC = 0x4C504F43 // "LPOC"
+        private const val FORMAT_VERSION = 1
+    }
+}
@@ -0,0 +1,167 @@
+package com.linkpoint.protocol.world
+
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.data.ParticleSystem
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.data.WorldEntity
+import java.util.UUID
+import kotlin.math.ceil
+
+/**
+ * Uniform grid over a region's ground plane, maintained by [ObjectStore].
+ *
+ * Each cell keeps its static entities (prims that don't move) apart from its
+ * dynamic ones (avatars, physical or moving prims, particle emitters), and a
+ * version that changes whenever the static contents or the terrain under the
+ * cell change. A static prim is filed in every cell its footprint (scale,
+ * ignoring rotation) overlaps, so a large one shows up in each of them;
+ * dynamic entities are filed by position only. Views that cache a rendering of static content per cell can
+ * compare versions instead of rescanning, and draw only the dynamic entities
+ * live. Positions outside the region are clamped to the edge cells.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLSpatialPartition (coarser, 2D)
+ * - Uniform grid broad phase for bounded worlds
+ */
+class SpatialGrid(val cellSize: Float = CELL_METRES, val extent: Float = REGION_METRES) {
+
+    val cellsPerSide: Int = ceil(extent / cellSize).toInt()
+
+    private val staticCells = arrayOfNulls<HashMap<UUID, WorldEntity>>(cellsPerSide * cellsPerSide)
+    private val dynamicCells = arrayOfNulls<HashMap<UUID, WorldEntity>>(cellsPerSide * cellsPerSide)
+    private val versions = LongArray(cellsPerSide * cellsPerSide)
+    // Where each entity is filed
+    private val located = HashMap<UUID, Placement>()
+
+    // Cells [minX..maxX] x [minY..maxY] holding an entity; a dynamic one is in a single cell
+    private data class Placement(val dynamic: Boolean, val minX: Int, val minY: Int, val maxX: Int, val maxY: Int)
+
+    fun cellX(x: Float): Int = (x / cellSize).toInt().coerceIn(0, cellsPerSide - 1)
+
+    fun cellY(y: Float): Int = (y / cellSize).toInt().coerceIn(0, cellsPerSide - 1)
+
+    /** Version of the static contents of cell ([cellX], [cellY]) */
+    @Synchronized
+    fun staticVersion(cellX: Int, cellY: Int): Long = versions[index(cellX, cellY)]
+
+    /** Static entities overlapping cell ([cellX], [cellY]) */
+    @Synchronized
+    fun staticIn(cellX: Int, cellY: Int): List<WorldEntity> =
+        staticCells[index(cellX, cellY)]?.values?.toList() ?: emptyList()
+
+    /**
+     * Call [action] once for every entity whose position lies in the rectangle,
+     * visiting only the cells it overlaps
+     */
+    @Synchronized
+    fun forEachIn(
+        minX: Float, minY: Float, maxX: Float, maxY: Float,
+        static: Boolean = true, dynamic: Boolean = true,
+        action: (WorldEntity) -> Unit
+    ) {
+        for (cy in cellY(minY)..cellY(maxY)) {
+            for (cx in cellX(minX)..cellX(maxX)) {
+                val cell = index(cx, cy)
+                // A prim spanning cells is reported from the cell its position is in
+                if (static) staticCells[cell]?.values?.forEach {
+                    if (isHome(it, cx, cy) && inside(it, minX, minY, maxX, maxY)) action(it)
+                }
+                if (dynamic) dynamicCells[cell]?.values?.forEach { if (inside(it, minX, minY, maxX, maxY)) action(it) }
+            }
+        }
+    }
+
+    /** Entities in the rectangle, see [forEachIn] */
+    fun query(
+        minX: Float, minY: Float, maxX: Float, maxY: Float,
+        static: Boolean = true, dynamic: Boolean = true
+    ): List<WorldEntity> {
+        val result = ArrayList<WorldEntity>()
+        forEachIn(minX, minY, maxX, maxY, static, dynamic) { result += it }
+        return result
+    }
+
+    @Synchronized
+    internal fun update(entity: WorldEntity) {
+        val placement = placementOf(entity)
+        val previous = located.put(entity.id, placement)
+        if (previous != null && previous != placement) unfile(entity.id, previous)
+        val cells = if (placement.dynamic) dynamicCells else staticCells
+        for (cy in placement.minY..placement.maxY) {
+            for (cx in placement.minX..placement.maxX) {
+                val cell = index(cx, cy)
+                (cells[cell] ?: HashMap<UUID, WorldEntity>().also { cells[cell] = it })[entity.id] = entity
+                if (!placement.dynamic) versions[cell]++
+            }
+        }
+    }
+
+    @Synchronized
+    internal fun remove(id: UUID) {
+        located.remove(id)?.let { unfile(id, it) }
+    }
+
+    /** Mark the static contents of cells overlapping the rectangle as changed, e.g. new terrain */
+    @Synchronized
+    internal fun touch(minX: Float, minY: Float, maxX: Float, maxY: Float) {
+        for (cy in cellY(minY)..cellY(maxY)) {
+            for (cx in cellX(minX)..cellX(maxX)) versions[index(cx, cy)]++
+        }
+    }
+
+    @Synchronized
+    internal fun clear() {
+        staticCells.fill(null)
+        dynamicCells.fill(null)
+        located.clear()
+        for (i in versions.indices) versions[i]++
+    }
+
+    private fun unfile(id: UUID, placement: Placement) {
+        for (cy in placement.minY..placement.maxY) {
+            for (cx in placement.minX..placement.maxX) {
+                val cell = index(cx, cy)
+                if (placement.dynamic) {
+                    dynamicCells[cell]?.remove(id)
+                } else {
+                    staticCells[cell]?.remove(id)
+                    versions[cell]++
+                }
+            }
+        }
+    }
+
+    private fun placementOf(entity: WorldEntity): Placement {
+        val p = entity.position
+        if (isDynamic(entity)) {
+            val cx = cellX(p.x)
+            val cy = cellY(p.y)
+            return Placement(true, cx, cy, cx, cy)
+        }
+        val halfX = entity.scale.x / 2
+        val halfY = entity.scale.y / 2
+        return Placement(false, cellX(p.x - halfX), cellY(p.y - halfY), cellX(p.x + halfX), cellY(p.y + halfY))
+    }
+
+    private fun isHome(entity: WorldEntity, cx: Int, cy: Int) =
+        cellX(entity.position.x) == cx && cellY(entity.position.y) == cy
+
+    private fun index(cellX: Int, cellY: Int) = cellY * cellsPerSide + cellX
+
+    private fun inside(entity: WorldEntity, minX: Float, minY: Float, maxX: Float, maxY: Float): Boolean {
+        val p = entity.position
+        return p.x >= minX && p.x <= maxX && p.y >= minY && p.y <= maxY
+    }
+
+    companion object {
+        const val REGION_METRES = 256f
+        const val CELL_METRES = 16f
+
+        /** Whether [entity] is drawn live rather than cached with the static scene */
+        fun isDynamic(entity: WorldEntity): Boolean = when (entity) {
+            is Avatar -> true
+            is ParticleSystem -> true
+            is VirtualObject -> entity.isPhysical || entity.velocity.let { it.x != 0f || it.y != 0f || it.z != 0f }
+        }
+    }
+}
@@ -0,0 +1,192 @@
+package com.linkpoint.protocol
+
+import com.linkpoint.core.events.EventSystem
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.protocol.circuit.CircuitProfile
+import com.linkpoint.protocol.world.RegionObjectCache
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.async
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.filterIsInstance
+import kotlinx.coroutines.flow.first
+import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeout
+import java.net.DatagramPacket
+import java.net.DatagramSocket
+import java.net.InetAddress
+import java.net.SocketAddress
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.file.Files
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the real circuit loop against a silent simulator socket on loopback
+ */
+class UDPMessageSystemTest {
+
+    private val simulator = DatagramSocket(0, InetAddress.getLoopbackAddress()).apply { soTimeout = 2000 }
+
+    // Message type of the next packet the viewer sent
+    private fun receiveType(): Int = receive().getInt(MESSAGE_TYPE_OFFSET)
+
+    private var viewer: SocketAddress? = null
+
+    private fun receive(): ByteBuffer {
+        val packet = DatagramPacket(ByteArray(1500), 1500)
+        simulator.receive(packet)
+        viewer = packet.socketAddress
+        return ByteBuffer.wrap(packet.data, 0, packet.length).order(ByteOrder.LITTLE_ENDIAN)
+    }
+
+    // RegionHandshake as the simulator sends it: header, then the RegionInfo block
+    private fun sendHandshake(cacheId: UUID) {
+        val name = "Sandbox".toByteArray()
+        val packet = ByteBuffer.allocate(64 + name.size).order(ByteOrder.LITTLE_ENDIAN)
+        packet.put(0x40).putInt(1).put(UDPMessageSystem.MessageType.REGION_HANDSHAKE.id.toByte())
+        packet.putInt(0).put(13).put(name.size.toByte()).put(name)
+        packet.position(packet.position() + 16 + 1).putFloat(20f).putFloat(1f)
+        packet.order(ByteOrder.BIG_ENDIAN).putLong(cacheId.mostSignificantBits).putLong(cacheId.leastSignificantBits)
+        simulator.send(DatagramPacket(packet.array(), packet.position(), viewer))
+    }
+
+    @Test
+    fun `an idle background circuit should sleep until it is woken for a new profile`() = runBlocking<Unit> {
+        // Frozen: the circuit's timeouts are then exactly its profile's intervals
+        val circuit = UDPMessageSystem(clock = { 1_000_000L })
+        circuit.setProfile(CircuitProfile.CHAT_ONLY_BACKGROUND)
+        try {
+            assertTrue(circuit.connect("127.0.0.1", simulator.localPort, 1234))
+            val handshake = listOf(
+                UDPMessageSystem.MessageType.USE_CIRCUIT_CODE,
+                UDPMessageSystem.MessageType.COMPLETE_AGENT_MOVEMENT,
+                UDPMessageSystem.MessageType.AGENT_THROTTLE,
+                UDPMessageSystem.MessageType.AGENT_UPDATE
+            )
+            assertEquals(handshake.map { it.id }, List(handshake.size) { receiveType() })
+
+            // Nothing arrives and the next AgentUpdate is 30 s away: the network
+            // thread parks for all of it, with no wakeups meanwhile
+            val parked = CircuitProfile.CHAT_ONLY_BACKGROUND.agentUpdateIntervalMs
+            val deadline = System.currentTimeMillis() + 2000
+            while (circuit.selectTimeoutMs != parked && System.currentTimeMillis() < deadline) delay(10)
+            assertEquals(parked, circuit.selectTimeoutMs)
+            assertEquals(0L, circuit.metrics!!.wakeups)
+
+            // The caller's thread only hands the profile over; the network thread sends it at once
+            val switched = System.nanoTime()
+            circuit.setProfile(CircuitProfile.FOREGROUND)
+            assertEquals(UDPMessageSystem.MessageType.AGENT_THROTTLE.id, receiveType())
+            assertEquals(UDPMessageSystem.MessageType.AGENT_UPDATE.id, receiveType())
+            val latencyMs = (System.nanoTime() - switched) / 1_000_000
+            assertTrue(latencyMs < 1000, "Profile applied after $latencyMs ms")
+        } finally {
+            circuit.disconnect()
+            simulator.close()
+        }
+    }
+
+    @Test
+    fun `a region handshake with a new cache id should empty the region's object cache`() = runBlocking<Unit> {
+        val directory = Files.createTempDirectory("objects").toFile()
+        val region = (256000L shl 32) or 256256L
+        RegionObjectCache(directory).apply {
+            open(region, UUID(5, 1))
+            store(7, 7, ByteArray(40))
+            flush()
+        }
+        val cache = RegionObjectCache(directory)
+        val circuit = UDPMessageSystem(cache)
+        try {
+            assertTrue(circuit.connect("127.0.0.1", simulator.localPort, 1234, region))
+            receive()
+
+            sendHandshake(UUID(5, 1))
+            awaitRegion(cache, region)
+            assertEquals(1, cache.size, "Same simulator cache id: cached objects stay")
+
+            sendHandshake(UUID(5, 2))
+            val deadline = System.currentTimeMillis() + 2000
+            while (cache.size > 0 && System.currentTimeMillis() < deadline) delay(10)
+            assertEquals(0, cache.size, "The simulator's cache id changed")
+        } finally {
+            circuit.disconnect()
+            simulator.close()
+            directory.deleteRecursively()
+        }
+    }
+
+    @Test
+    fun `AgentMovementComplete should announce the arrival with the handshake's region name`() = runBlocking<Unit> {
+        val region = (256000L shl 32) or 256256L
+        val circuit = UDPMessageSystem()
+        val arrival = async(start = CoroutineStart.UNDISPATCHED) {
+            EventSystem.events.filterIsInstance<ViewerEvent.AvatarTeleported>().first()
+        }
+        try {
+            assertTrue(circuit.connect("127.0.0.1", simulator.localPort, 1234))
+            receive()
+            sendHandshake(UUID(5, 1))
+
+            val packet = ByteBuffer.allocate(96).order(ByteOrder.LITTLE_ENDIAN)
+            packet.put(0x40).putInt(2).put(UDPMessageSystem.MessageType.AGENT_MOVEMENT_COMPLETE.id.toByte())
+            packet.position(packet.position() + 32)
+            packet.putFloat(128f).putFloat(64f).putFloat(22f)
+            packet.position(packet.position() + 12)
+            packet.putLong(region)
+            simulator.send(DatagramPacket(packet.array(), packet.position(), viewer))
+
+            val event = withTimeout(2000) { arrival.await() }
+            assertEquals(ViewerEvent.AvatarTeleported("Sandbox", Vector3(128f, 64f, 22f), region), event)
+        } finally {
+            arrival.cancel()
+            circuit.disconnect()
+            simulator.close()
+        }
+    }
+
+    @Test
+    fun `CoarseLocationUpdate should place the region's avatars in metres`() = runBlocking<Unit> {
+        val region = (256000L shl 32) or 256256L
+        val circuit = UDPMessageSystem()
+        val update = async(start = CoroutineStart.UNDISPATCHED) {
+            EventSystem.events.filterIsInstance<ViewerEvent.CoarseLocationsUpdated>().first()
+        }
+        try {
+            assertTrue(circuit.connect("127.0.0.1", simulator.localPort, 1234, region))
+            receive()
+
+            val ids = listOf(UUID(9, 1), UUID(9, 2))
+            val packet = ByteBuffer.allocate(64).order(ByteOrder.LITTLE_ENDIAN)
+            packet.put(0x00).putInt(2).put(UDPMessageSystem.MessageType.COARSE_LOCATION_UPDATE.id.toByte())
+            packet.put(2).put(10).put(20).put(6).put(200.toByte()).put(250.toByte()).put(255.toByte())
+            packet.putShort(0).putShort(-1)
+            packet.put(2).order(ByteOrder.BIG_ENDIAN)
+            ids.forEach { packet.putLong(it.mostSignificantBits).putLong(it.leastSignificantBits) }
+            simulator.send(DatagramPacket(packet.array(), packet.position(), viewer))
+
+            val event = withTimeout(2000) { update.await() }
+            assertEquals(region, event.regionHandle)
+            assertEquals(mapOf(ids[0] to Vector3(10f, 20f, 24f), ids[1] to Vector3(200f, 250f, 1020f)), event.avatars)
+        } finally {
+            update.cancel()
+            circuit.disconnect()
+            simulator.close()
+        }
+    }
+
+    private suspend fun awaitRegion(cache: RegionObjectCache, region: Long) {
+        val deadline = System.currentTimeMillis() + 2000
+        while (cache.currentRegion != region && System.currentTimeMillis() < deadline) delay(10)
+        assertEquals(region, cache.currentRegion)
+    }
+
+    private companion object {
+        // Flags, reliability and sequence number come first
+        const val MESSAGE_TYPE_OFFSET = 6
+    }
+}
@@ -0,0 +1,140 @@
+package com.linkpoint.protocol.circuit
+
+import kotlin.math.PI
+import kotlin.math.max
+import kotlin.math.min
+
+/**
+ * In-process stand-in for a simulator, for measuring what a [CircuitProfile]
+ * costs without a grid.
+ *
+ * Runs a [CircuitScheduler] against a modelled simulator in virtual time.
+ * The simulator sends what a real one would for the profile: chat and IMs
+ * (reliable) and ping checks whatever the profile, a coarse location update
+ * every second, and object updates and texture data only for objects inside
+ * the interest radius, each capped by its throttle category. Everything that
+ * lands in the same millisecond wakes the viewer's network thread once, as a
+ * socket with several datagrams queued would.
+ *
+ * Based on concepts from:
+ * - OpenSimulator's LLUDPServer / LLUDPClient per-category token buckets
+ */
+class LoopbackSimulator(private val scene: Scene = Scene()) {
+
+    data class Scene(
+        /** Prims per square metre; 0.05 is about 3300 in a full region */
+        val objectDensity: Float = 0.05f,
+        /** Updates per second per object in range */
+        val objectUpdateRate: Float = 0.2f,
+        val chatIntervalMs: Long = 20_000,
+        val instantMessageIntervalMs: Long = 90_000,
+        val pingIntervalMs: Long = 5_000,
+        val coarseLocationIntervalMs: Long = 1_000
+    )
+
+    data class Run(
+        val rates: CircuitRates,
+        val chatDelivered: Int,
+        val instantMessagesDelivered: Int,
+        /** Longest a reliable packet from the simulator waited for its ACK */
+        val maxAckDelayMs: Long
+    )
+
+    private class Stream(
+        val kind: Kind,
+        val periodMs: Long,
+        val bytes: Int,
+        val reliable: Boolean,
+        var nextAt: Long
+    )
+
+    private enum class Kind { CHAT, INSTANT_MESSAGE, PING, COARSE_LOCATION, OBJECTS, TEXTURES }
+
+    /**
+     * Connect with [profile] and run the circuit for [durationMs] of virtual time
+     */
+    fun run(profile: CircuitProfile, durationMs: Long): Run {
+        var now = 0L
+        var sequence = 0
+        val unacked = HashMap<Int, Long>()
+        var maxAckDelay = 0L
+
+        val scheduler = CircuitScheduler(profile, { message, acks ->
+            for (ack in acks) unacked.remove(ack)?.let { maxAckDelay = max(maxAckDelay, now - it) }
+            HEADER_BYTES + when {
+                // A PacketAck's list is its payload rather than appended
+                message == CircuitMessage.PACKET_ACK -> 1 + acks.size * 4
+                acks.isEmpty() -> payloadBytes(message)
+                else -> payloadBytes(message) + acks.size * 4 + 1
+            }
+        }, now)
+        scheduler.apply(profile, now)
+
+        val streams = streamsFor(profile)
+        var chat = 0
+        var instantMessages = 0
+        while (true) {
+            val wake = min(streams.minOfOrNull { it.nextAt } ?: Long.MAX_VALUE, scheduler.nextWakeAt())
+            if (wake >= durationMs) break
+            now = wake
+            for (stream in streams) {
+                while (stream.nextAt <= now) {
+                    stream.nextAt += stream.periodMs
+                    val seq = sequence++
+                    if (stream.reliable) unacked[seq] = now
+                    scheduler.onReceived(stream.bytes, if (stream.reliable) seq else null, now)
+                    when (stream.kind) {
+                        Kind.CHAT -> chat++
+                        Kind.INSTANT_MESSAGE -> instantMessages++
+                        Kind.PING -> scheduler.send(CircuitMessage.COMPLETE_PING_CHECK)
+                        else -> {}
+                    }
+                }
+            }
+            scheduler.onWake(now)
+        }
+        return Run(scheduler.metrics.rates(profile.name, durationMs), chat, instantMessages, maxAckDelay)
+    }
+
+    private fun streamsFor(profile: CircuitProfile): List<Stream> {
+        val streams = mutableListOf(
+            Stream(Kind.CHAT, scene.chatIntervalMs, CHAT_BYTES, reliable = true, nextAt = scene.chatIntervalMs / 2),
+            Stream(Kind.INSTANT_MESSAGE, scene.instantMessageIntervalMs, IM_BYTES, reliable = true,
+                nextAt = scene.instantMessageIntervalMs / 3),
+            Stream(Kind.PING, scene.pingIntervalMs, PING_BYTES, reliable = false, nextAt = scene.pingIntervalMs),
+            Stream(Kind.COARSE_LOCATION, scene.coarseLocationIntervalMs, COARSE_LOCATION_BYTES, reliable = false,
+                nextAt = scene.coarseLocationIntervalMs / 4)
+        )
+        if (profile.interestRadius > 0f) {
+            val inRange = scene.objectDensity * PI * profile.interestRadius * profile.interestRadius
+            val objectDemand = inRange * scene.objectUpdateRate * OBJECT_UPDATE_BYTES
+            bulkStream(Kind.OBJECTS, min(objectDemand, profile.throttles.task / 8.0), BULK_PACKET_BYTES)?.let { streams += it }
+            bulkStream(Kind.TEXTURES, profile.throttles.texture / 8.0, BULK_PACKET_BYTES)?.let { streams += it }
+        }
+        return streams
+    }
+
+    /** Full packets at [bytesPerSecond], or none if that rounds to nothing */
+    private fun bulkStream(kind: Kind, bytesPerSecond: Double, packetBytes: Int): Stream? {
+        if (bytesPerSecond < 1.0) return null
+        val period = max(1L, (packetBytes * 1000 / bytesPerSecond).toLong())
+        return Stream(kind, period, packetBytes, reliable = false, nextAt = period / 2 + 1)
+    }
+
+    private fun payloadBytes(message: CircuitMessage): Int = when (message) {
+        CircuitMessage.AGENT_UPDATE -> 114
+        CircuitMessage.AGENT_THROTTLE -> 65
+        CircuitMessage.COMPLETE_PING_CHECK -> 1
+        CircuitMessage.PACKET_ACK -> 1
+    }
+
+    private companion object {
+        const val HEADER_BYTES = 12
+        const val CHAT_BYTES = 96
+        const val IM_BYTES = 160
+        const val PING_BYTES = 14
+        const val COARSE_LOCATION_BYTES = 60
+        const val OBJECT_UPDATE_BYTES = 60
+        const val BULK_PACKET_BYTES = 1200
+    }
+}
@@ -0,0 +1,51 @@
+package com.linkpoint.protocol.circuit
+
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the chat-only background profile against the loopback stand-in
+ */
+class LoopbackSimulatorTest {
+
+    private val tenMinutes = 10 * 60_000L
+
+    @Test
+    fun `background mode should cut wakeups and traffic while chat keeps flowing`() {
+        val simulator = LoopbackSimulator()
+        val foreground = simulator.run(CircuitProfile.FOREGROUND, tenMinutes)
+        val background = simulator.run(CircuitProfile.CHAT_ONLY_BACKGROUND, tenMinutes)
+
+        assertTrue(background.rates.wakeupsPerMinute * 20 < foreground.rates.wakeupsPerMinute)
+        assertTrue(background.rates.bytesPerMinute * 100 < foreground.rates.bytesPerMinute)
+        assertEquals(foreground.chatDelivered, background.chatDelivered)
+        assertEquals(foreground.instantMessagesDelivered, background.instantMessagesDelivered)
+        assertTrue(background.chatDelivered > 0)
+    }
+
+    @Test
+    fun `batched acks should still beat the simulator's resend timeout`() {
+        val run = LoopbackSimulator().run(CircuitProfile.CHAT_ONLY_BACKGROUND, tenMinutes)
+        assertTrue(run.maxAckDelayMs <= CircuitProfile.CHAT_ONLY_BACKGROUND.ackFlushIntervalMs)
+        assertTrue(run.maxAckDelayMs < SIMULATOR_RESEND_MS)
+    }
+
+    @Test
+    fun `a full batch should flush without waiting for the interval`() {
+        val sent = mutableListOf<Pair<CircuitMessage, Int>>()
+        val profile = CircuitProfile.FOREGROUND.copy(maxBatchedAcks = 4)
+        val scheduler = CircuitScheduler(profile, { message, acks -> sent += message to acks.size; 16 }, now = 0)
+        repeat(4) { scheduler.onReceived(100, reliableSequence = it, now = 1) }
+        assertEquals(listOf(CircuitMessage.PACKET_ACK to 4), sent)
+        assertEquals(0, scheduler.pendingAcks)
+
+        scheduler.onReceived(100, reliableSequence = 9, now = 2)
+        scheduler.onWake(2)
+        assertEquals(CircuitMessage.AGENT_UPDATE to 1, sent.last(), "The ACK rides on the due AgentUpdate")
+    }
+
+    private companion object {
+        const val SIMULATOR_RESEND_MS = 1000L
+    }
+}
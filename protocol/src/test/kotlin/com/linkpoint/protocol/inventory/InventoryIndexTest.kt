@@ -0,0 +1,75 @@
+package com.linkpoint.protocol.inventory
+
+import java.util.Locale
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for maintained inventory sort orders, type buckets and incremental search
+ */
+class InventoryIndexTest {
+
+    private val folder = UUID(5, 0)
+
+    private fun item(n: Long, name: String, type: Int = 5, created: Long = n, description: String = "") =
+        InventoryItemInfo(UUID(6, n), folder, name, description = description, assetType = type, creationDate = created)
+
+    private fun InventoryIndex.names(slots: IntArray) = items(slots).map { it.name }
+
+    @Test
+    fun `should keep name, date and type orders current as items change`() {
+        val store = InventoryStore()
+        val index = InventoryIndex(store, Locale.ENGLISH)
+        store.putItem(item(1, "banana", created = 30))
+        store.putItem(item(2, "Apple", type = 20, created = 10))
+        store.putItem(item(3, "cherry", created = 20))
+
+        assertEquals(listOf("Apple", "banana", "cherry"), index.names(index.sorted(InventorySortOrder.NAME)))
+        assertEquals(listOf("banana", "cherry", "Apple"), index.names(index.sorted(InventorySortOrder.DATE, ascending = false)))
+        assertEquals(listOf("banana", "cherry", "Apple"), index.names(index.sorted(InventorySortOrder.TYPE)))
+
+        // Small changes are patched into the existing orders
+        store.putItem(item(1, "Avocado", created = 30))
+        store.removeItem(UUID(6, 3))
+        store.putItem(item(4, "apricot", type = 20, created = 40))
+        assertEquals(listOf("Apple", "apricot", "Avocado"), index.names(index.sorted(InventorySortOrder.NAME)))
+        assertEquals(listOf("Apple", "apricot"), index.names(index.ofType(20)))
+        assertEquals(1, index.countOfType(5))
+    }
+
+    @Test
+    fun `should refine the previous matches as the query grows`() {
+        val store = InventoryStore()
+        val index = InventoryIndex(store)
+        repeat(1000) { store.putItem(item(it.toLong(), "Outfit $it", type = if (it % 2 == 0) 5 else 6)) }
+        val matcher = index.matcher()
+
+        assertEquals(271, matcher.match("1").size)
+        assertEquals(1000, matcher.lastScanned)
+        val narrowed = matcher.match("12")
+        assertEquals(271, matcher.lastScanned, "Typing more only rechecks the previous matches")
+        assertEquals(index.names(narrowed).sorted(), index.names(narrowed), "Results stay in name order")
+        assertEquals(listOf("Outfit 112", "Outfit 12", "Outfit 120"), index.names(matcher.match("OUTFIT 12", assetType = 5)).take(3))
+
+        store.putItem(item(5000, "Outfit 12 spare"))
+        assertTrue("Outfit 12 spare" in index.names(matcher.match("outfit 12", assetType = 5)), "Index changes restart the search")
+    }
+
+    @Test
+    fun `should match descriptions as well as names`() {
+        val store = InventoryStore()
+        val index = InventoryIndex(store, Locale.ENGLISH)
+        store.putItem(item(1, "Boots", description = "Mesh, black leather"))
+        store.putItem(item(2, "Mesh jacket"))
+        store.putItem(item(3, "Hat", description = "Straw"))
+        val matcher = index.matcher()
+
+        assertEquals(listOf("Boots", "Mesh jacket"), index.names(matcher.match("MESH")))
+        assertEquals(listOf("Boots"), index.names(matcher.match("mesh,")), "Refining keeps description matches")
+
+        store.putItem(item(3, "Hat", description = "Mesh straw"))
+        assertEquals(listOf("Boots", "Hat", "Mesh jacket"), index.names(matcher.match("mesh")), "A changed description is re-indexed")
+    }
+}
@@ -0,0 +1,194 @@
+package com.linkpoint.protocol.inventory
+
+import com.linkpoint.protocol.llsd.LLSDXml
+import kotlinx.coroutines.runBlocking
+import java.nio.file.Files
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertNotNull
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the columnar inventory store, descendent fetches and the cache
+ */
+class InventoryStoreTest {
+
+    private val owner = UUID(1, 1)
+    private val root = UUID(2, 0)
+    private val clothing = UUID(2, 1)
+    private val creator = UUID(4, 1)
+
+    /** Serves FetchInventoryDescendents2 from canned folder listings, through a real LLSD round trip */
+    private inner class FakeCapability(var clothingVersion: Int = 3) : LLSDTransport {
+        var requests = 0
+
+        override suspend fun post(url: String, body: Any?): Any? {
+            requests++
+            val request = LLSDXml.parse(LLSDXml.format(body)) as Map<*, *>
+            val folders = (request["folders"] as List<*>).map { entry ->
+                when ((entry as Map<*, *>)["folder_id"]) {
+                    root -> listing(root, 7, categories = listOf(category(clothing, "Clothing", clothingVersion)))
+                    clothing -> listing(clothing, clothingVersion, items = List(clothingVersion) { item(UUID(3, it.toLong()), "Shirt & Tie $it") })
+                    else -> error("Unexpected folder")
+                }
+            }
+            return LLSDXml.parse(LLSDXml.format(mapOf("folders" to folders)))
+        }
+    }
+
+    private fun listing(id: UUID, version: Int, categories: List<Any> = emptyList(), items: List<Any> = emptyList()) =
+        mapOf("folder_id" to id, "owner_id" to owner, "version" to version, "categories" to categories, "items" to items)
+
+    private fun category(id: UUID, name: String, version: Int, type: Int = -1) =
+        mapOf("category_id" to id, "name" to name, "type_default" to type, "version" to version)
+
+    private fun item(id: UUID, name: String, assetId: UUID = UUID(0, 0), type: Int = 5) =
+        mapOf("item_id" to id, "name" to name, "desc" to "<worn>", "asset_id" to assetId, "type" to type, "inv_type" to 18, "created_at" to 1700000000,
+            "permissions" to mapOf("creator_id" to creator))
+
+    @Test
+    fun `should fetch folders lazily and only when their version changes`() = runBlocking {
+        val store = InventoryStore()
+        val capability = FakeCapability()
+        val fetcher = InventoryFetcher(store, "http://sim/cap", owner, capability)
+        store.putFolder(InventoryFolderInfo(root, null, "My Inventory", version = 7))
+
+        assertTrue(fetcher.ensureLoaded(root))
+        assertTrue(store.items(clothing).isEmpty(), "Subfolders are not fetched until opened")
+        assertTrue(fetcher.ensureLoaded(clothing))
+        assertFalse(fetcher.ensureLoaded(clothing))
+        assertEquals(2, capability.requests)
+
+        val shirts = store.items(clothing)
+        assertEquals(3, shirts.size)
+        assertEquals("<worn>", shirts[0].description)
+        assertEquals(creator, shirts[0].creatorId)
+        assertEquals(listOf("Shirt & Tie 1"), store.search("tie 1").map { it.name })
+
+        // A newer server version drops items missing from the new listing
+        capability.clothingVersion = 2
+        store.applySkeleton(listOf(InventoryFolderInfo(clothing, root, "Clothing", version = 2)))
+        assertTrue(fetcher.ensureLoaded(clothing))
+        assertEquals(2, store.itemCount)
+        assertNull(store.item(UUID(3, 2)))
+    }
+
+    @Test
+    fun `should restore from a snapshot without refetching unchanged folders`() = runBlocking<Unit> {
+        val file = Files.createTempDirectory("inventory").resolve("inventory.snapshot").toFile()
+        val capability = FakeCapability()
+        val store = InventoryStore()
+        store.putFolder(InventoryFolderInfo(root, null, "My Inventory", version = 7))
+        InventoryFetcher(store, "http://sim/cap", owner, capability).fetch(listOf(root, clothing))
+        InventorySnapshot.write(file, store, owner)
+
+        val snapshot = InventorySnapshot.open(file, owner)!!
+        assertEquals(3, snapshot.itemCount)
+        val restored = InventoryStore()
+        snapshot.restoreFolders(restored)
+        assertEquals(0, restored.itemCount, "Items are decoded only when their folder is opened")
+        assertFalse(snapshot.loadFolder(restored, clothing), "Cached contents wait for the server's version")
+
+        // The server skeleton says Clothing is unchanged but the root moved on
+        restored.applySkeleton(listOf(
+            InventoryFolderInfo(root, null, "My Inventory", version = 8),
+            InventoryFolderInfo(clothing, root, "Clothing", version = 3)
+        ))
+        val fetcher = InventoryFetcher(restored, "http://sim/cap", owner, capability).also { it.snapshot = snapshot }
+        val requestsBefore = capability.requests
+        assertFalse(fetcher.ensureLoaded(clothing))
+        assertEquals(listOf("<worn>"), restored.items(clothing).map { it.description }.distinct())
+        assertEquals(listOf(creator), restored.items(clothing).map { it.creatorId }.distinct())
+        assertTrue(fetcher.ensureLoaded(root))
+        assertEquals(requestsBefore + 1, capability.requests)
+
+        assertNull(InventorySnapshot.open(file, UUID(9, 9)), "Another account's snapshot is ignored")
+        snapshot.close()
+        assertFalse(snapshot.loadFolder(restored, clothing), "A closed snapshot serves nothing")
+        file.parentFile.deleteRecursively()
+    }
+
+    @Test
+    fun `should discard a corrupt snapshot and replace it after closing`() = runBlocking<Unit> {
+        val file = Files.createTempDirectory("inventory").resolve("inventory.snapshot").toFile()
+        val store = InventoryStore()
+        store.putFolder(InventoryFolderInfo(root, null, "My Inventory", version = 7))
+        InventoryFetcher(store, "http://sim/cap", owner, FakeCapability()).fetch(listOf(root, clothing))
+        InventorySnapshot.write(file, store, owner)
+
+        // Rewriting the file it was opened from, as a session does at logout
+        InventorySnapshot.open(file, owner)!!.close()
+        InventorySnapshot.write(file, store, owner)
+        assertEquals(3, InventorySnapshot.open(file, owner)!!.use { it.itemCount })
+
+        val bytes = file.readBytes()
+        bytes[bytes.size - 1] = (bytes[bytes.size - 1] + 1).toByte()
+        file.writeBytes(bytes)
+        assertNull(InventorySnapshot.open(file, owner), "A flipped byte in the string table fails the checksum")
+        file.parentFile.deleteRecursively()
+    }
+
+    @Test
+    fun `a session should carry cached folders it never opened into the next snapshot`() = runBlocking<Unit> {
+        val file = Files.createTempDirectory("inventory").resolve("inventory.snapshot").toFile()
+        val capability = FakeCapability()
+        InventorySession.start("http://sim/cap", owner, root, file, capability).apply {
+            fetcher.ensureLoaded(clothing)
+            close()
+        }
+        // A session that only lists the root
+        InventorySession.start("http://sim/cap", owner, root, file, capability).close()
+
+        val third = InventorySession.start("http://sim/cap", owner, root, file, capability)
+        assertEquals(2, third.restoredFolders)
+        val requestsBefore = capability.requests
+        assertFalse(third.fetcher.ensureLoaded(clothing))
+        assertEquals(requestsBefore, capability.requests)
+        assertEquals(3, third.store.items(clothing).size)
+        file.parentFile.deleteRecursively()
+    }
+
+    @Test
+    fun `a session should index the RLV shared folders, worn items following the current outfit`() = runBlocking<Unit> {
+        val file = Files.createTempDirectory("inventory").resolve("inventory.snapshot").toFile()
+        val shared = UUID(4, 0)
+        val cuffs = UUID(4, 1)
+        val outfit = UUID(4, 2)
+        val cuff = UUID(5, 0)
+        val listings = mapOf(
+            root to listing(root, 1, categories = listOf(
+                category(shared, "#RLV", 1),
+                category(outfit, "Current Outfit", 1, type = InventorySession.FOLDER_TYPE_CURRENT_OUTFIT),
+                category(clothing, "Clothing", 1)
+            )),
+            shared to listing(shared, 1, categories = listOf(category(cuffs, "Cuffs", 1))),
+            cuffs to listing(cuffs, 1, items = listOf(item(cuff, "Wrist Cuff"), item(UUID(5, 1), "Spare Cuff"))),
+            outfit to listing(outfit, 1, items = listOf(item(UUID(6, 0), "Wrist Cuff", assetId = cuff, type = 24)))
+        )
+        // Clothing is outside #RLV and must not be fetched
+        val transport = object : LLSDTransport {
+            override suspend fun post(url: String, body: Any?): Any? {
+                val request = LLSDXml.parse(LLSDXml.format(body)) as Map<*, *>
+                val folders = (request["folders"] as List<*>).map { listings.getValue((it as Map<*, *>)["folder_id"] as UUID) }
+                return LLSDXml.parse(LLSDXml.format(mapOf("folders" to folders)))
+            }
+        }
+
+        val session = InventorySession.start("http://sim/cap", owner, root, file, transport)
+        val index = assertNotNull(session.sharedFolders())
+        assertEquals("Cuffs", index.getInv(""))
+        assertEquals("|02,Cuffs|20", index.getInvWorn(""))
+
+        // Wearing and detaching add and remove Current Outfit links
+        session.store.putItem(InventoryItemInfo(UUID(6, 1), outfit, "Spare Cuff", assetId = UUID(5, 1), assetType = 24))
+        assertEquals("|03,Cuffs|30", index.getInvWorn(""))
+        session.store.removeItem(UUID(6, 0))
+        session.store.removeItem(UUID(6, 1))
+        assertEquals("|01,Cuffs|10", index.getInvWorn(""))
+        session.close()
+        file.parentFile.deleteRecursively()
+    }
+}
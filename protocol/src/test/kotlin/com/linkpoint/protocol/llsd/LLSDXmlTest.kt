@@ -0,0 +1,21 @@
+package com.linkpoint.protocol.llsd
+
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFailsWith
+
+/**
+ * Tests for LLSD XML integer range handling
+ */
+class LLSDXmlTest {
+
+    @Test
+    fun `should format in-range longs and reject ones that do not fit 32 bits`() {
+        val edges = listOf(Int.MIN_VALUE.toLong(), Int.MAX_VALUE.toLong())
+        assertEquals(edges.map { it.toInt() }, LLSDXml.parse(LLSDXml.format(edges)))
+
+        assertFailsWith<IllegalArgumentException> { LLSDXml.format(Int.MAX_VALUE + 1L) }
+        assertFailsWith<IllegalArgumentException> { LLSDXml.format(mapOf("size" to Long.MIN_VALUE)) }
+        assertFailsWith<LLSDParseException> { LLSDXml.parse("<llsd><integer>4294967296</integer></llsd>") }
+    }
+}
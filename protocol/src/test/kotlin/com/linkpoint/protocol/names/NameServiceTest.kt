@@ -0,0 +1,81 @@
+package com.linkpoint.protocol.names
+
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.runBlocking
+import java.nio.file.Files
+import java.util.UUID
+import kotlin.random.Random
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+/**
+ * Tests for batched name lookups and the memory, negative and disk caches
+ */
+class NameServiceTest {
+
+    private val directory = Files.createTempDirectory("names").toFile()
+    private val residents = List(120) { UUID.randomUUID() }
+    private val ghosts = List(5) { UUID.randomUUID() }
+    private val asked = ArrayList<UUID>()
+
+    private val source = NameSource { ids ->
+        delay(5)
+        synchronized(asked) { asked += ids }
+        NameResponse(
+            names = ids.filter { it in residents }.associateWith { AvatarName(it, "Resident ${it.toString().take(4)}", "resident.${it.toString().take(4)}", 0) },
+            unknown = ids.filter { it in ghosts }.toSet()
+        )
+    }
+
+    // A crowded sim: the radar asks for everyone each frame, chat for a few senders, some of them bad ids
+    private suspend fun CoroutineScope.replay(names: NameService, frames: Int) {
+        val random = Random(3)
+        repeat(frames) {
+            launch { names.getAll(residents) }
+            repeat(8) { launch { names.get(residents[random.nextInt(residents.size)]) } }
+            ghosts.forEach { launch { names.get(it) } }
+            delay(16)
+        }
+    }
+
+    @Test
+    fun `should batch a crowded sim into a few requests`() = runBlocking<Unit> {
+        val names = NameService(source, this, NameDiskCache(directory.resolve("names.bin")))
+        replay(names, frames = 60)
+        delay(100)
+
+        val stats = names.stats
+        assertEquals(asked.size, asked.toSet().size, "No id was asked for twice")
+        assertEquals(residents.size + ghosts.size, asked.size)
+        assertEquals(3L, stats.requests, "One window of 125 ids in requests of 50")
+        assertTrue(stats.negativeHits > 0)
+        assertTrue(stats.requestsSaved >= stats.lookups * 99 / 100, "Saved ${stats.requestsSaved} of ${stats.lookups}")
+        assertNull(names.get(ghosts.first()))
+
+        names.persist()
+        asked.clear()
+        val restarted = NameService(source, this, NameDiskCache(directory.resolve("names.bin")))
+        replay(restarted, frames = 10)
+        delay(100)
+        assertEquals(ghosts.toSet(), asked.toSet(), "Only negative results are asked for again")
+        assertEquals(residents.size.toLong(), restarted.stats.diskHits)
+        directory.deleteRecursively()
+    }
+
+    @Test
+    fun `should retry after a failed request`() = runBlocking<Unit> {
+        var failing = true
+        val flaky = NameSource { ids -> if (failing) error("grid down") else source.fetch(ids) }
+        val names = NameService(flaky, this)
+        val id = residents.first()
+
+        assertNull(names.get(id))
+        failing = false
+        assertEquals(id, names.get(id)?.id)
+        assertEquals(2L, names.stats.requests)
+    }
+}
@@ -0,0 +1,93 @@
+package com.linkpoint.protocol.rlv
+
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.RLVProcessor.RLVCommand
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+/**
+ * Tests for RLV command list parsing, batching, rate limiting and forced teleports
+ */
+class RLVCommandParserTest {
+
+    @Test
+    fun `should tokenise commands options and params in one pass`() {
+        val seen = mutableListOf<Triple<RLVCommand?, String?, String?>>()
+        val count = RLVCommandParser.parse("@fly=n, addattach:skull=n,,bogus,version=2550") { token ->
+            seen += Triple(token.command, token.option(), token.param())
+            true
+        }
+
+        assertEquals(4, count, "Empty commands should be skipped")
+        assertEquals(Triple(RLVCommand.FLY, null, "n"), seen[0])
+        assertEquals(Triple(RLVCommand.ADDATTACH, "skull", "n"), seen[1])
+        assertNull(seen[2].first, "Unknown behaviours resolve to null")
+        assertEquals(Triple(RLVCommand.VERSION, null, "2550"), seen[3])
+    }
+
+    @Test
+    fun `should notify listeners once per command list`() {
+        val rlv = RLVProcessor()
+        val notifications = mutableListOf<Set<RLVCommand>>()
+        rlv.addRestrictionListener { notifications += it }
+
+        rlv.processRLVCommand("@fly=n,sendchat=n,camzoommax:10=n", "relay", "Relay")
+
+        assertEquals(1, notifications.size)
+        assertEquals(setOf(RLVCommand.FLY, RLVCommand.SENDCHAT, RLVCommand.CAMZOOMMAX), notifications[0])
+    }
+
+    @Test
+    fun `should rate limit a runaway object without affecting others`() {
+        var now = 0L
+        val rlv = RLVProcessor(clock = { now })
+        val spam = "@" + List(RLVProcessor.RATE_LIMIT_BURST.toInt()) { "fly=n" }.joinToString(",")
+
+        assertTrue(rlv.processRLVCommand(spam, "runaway", "Runaway"))
+        assertFalse(rlv.processRLVCommand("@sendchat=n", "runaway", "Runaway"), "Bucket should be empty")
+        assertFalse(rlv.isRestricted(RLVCommand.SENDCHAT))
+
+        assertTrue(rlv.processRLVCommand("@sendchat=n", "collar", "Collar"))
+        assertTrue(rlv.isRestricted(RLVCommand.SENDCHAT))
+
+        // One command's worth of refill
+        now += (1_000_000_000 / RLVProcessor.RATE_LIMIT_PER_SECOND).toLong() + 1
+        assertTrue(rlv.processRLVCommand("@sendchat=n", "runaway", "Runaway"))
+        assertFalse(rlv.processRLVCommand("@sendchat=n", "runaway", "Runaway"))
+
+        // Two commands' worth of refill: a three-command list is refused whole
+        now += 2 * (1_000_000_000 / RLVProcessor.RATE_LIMIT_PER_SECOND).toLong() + 1
+        assertFalse(rlv.processRLVCommand("@fly=n,sendim=n,tplm=n", "runaway", "Runaway"))
+        assertFalse(rlv.isRestricted(RLVCommand.SENDIM), "No prefix of the list is applied")
+        assertTrue(rlv.processRLVCommand("@sendim=n,tplm=n", "runaway", "Runaway"))
+    }
+
+    @Test
+    fun `should drop the buckets of objects that have gone quiet`() {
+        var now = 0L
+        val rlv = RLVProcessor(clock = { now })
+        repeat(RLVProcessor.RATE_LIMIT_PRUNE_SIZE) { rlv.processRLVCommand("@fly=n", "object-$it", "Object") }
+        assertEquals(RLVProcessor.RATE_LIMIT_PRUNE_SIZE, rlv.rateLimitedObjects)
+
+        now += 10_000_000_000L
+        rlv.processRLVCommand("@fly=n", "newcomer", "Newcomer")
+        assertEquals(1, rlv.rateLimitedObjects)
+    }
+
+    @Test
+    fun `should force a teleport to global coordinates unless tploc is restricted`() {
+        val teleports = mutableListOf<Triple<Double, Double, Double>>()
+        val rlv = RLVProcessor(teleportSink = { x, y, z -> teleports.add(Triple(x, y, z)) })
+
+        assertTrue(rlv.processRLVCommand("@tpto:256512/255744.5/30=force", "relay", "Relay"))
+        assertFalse(rlv.processRLVCommand("@tpto:256512/30=force", "relay", "Relay"))
+        rlv.processRLVCommand("@tploc=n", "collar", "Collar")
+        assertFalse(rlv.processRLVCommand("@tpto:1/2/3=force", "relay", "Relay"))
+
+        assertEquals(listOf(Triple(256512.0, 255744.5, 30.0)), teleports)
+        assertFalse(RLVProcessor().processRLVCommand("@tpto:256512/255744/30=force", "relay", "Relay"), "Nothing can perform the teleport")
+    }
+}
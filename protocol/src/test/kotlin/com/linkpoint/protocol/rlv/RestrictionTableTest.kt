@@ -0,0 +1,91 @@
+package com.linkpoint.protocol.rlv
+
+import com.linkpoint.core.events.EventSystem
+import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.RLVProcessor.RLVCommand
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.async
+import kotlinx.coroutines.flow.filter
+import kotlinx.coroutines.flow.filterIsInstance
+import kotlinx.coroutines.flow.map
+import kotlinx.coroutines.flow.take
+import kotlinx.coroutines.flow.toList
+import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeout
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the compiled RLV restriction table
+ */
+class RestrictionTableTest {
+
+    @Test
+    fun `should keep a restriction while any source holds it`() {
+        val table = RestrictionTable()
+        table.addRestriction("collar", RLVCommand.FLY)
+        table.addRestriction("hud", RLVCommand.FLY)
+        assertFalse(table.addRestriction("collar", RLVCommand.FLY), "A source holds each restriction once")
+
+        assertEquals(2, table.holders(RLVCommand.FLY))
+
+        table.removeRestriction("collar", RLVCommand.FLY)
+        assertTrue(table.isRestricted(RLVCommand.FLY), "Still held by the HUD")
+        assertEquals(1, table.holders(RLVCommand.FLY))
+
+        table.clearSource("hud")
+        assertFalse(table.isRestricted(RLVCommand.FLY))
+        assertEquals(0, table.sourceCount)
+    }
+
+    @Test
+    fun `should apply scoped restrictions and exceptions per option`() {
+        val table = RestrictionTable()
+        table.addRestriction("collar", RLVCommand.ADDATTACH, "skull")
+        table.addRestriction("collar", RLVCommand.SENDIM)
+        table.addException("collar", RLVCommand.SENDIM, "owner-uuid")
+
+        assertTrue(table.isRestricted(RLVCommand.ADDATTACH, "skull"))
+        assertFalse(table.isRestricted(RLVCommand.ADDATTACH, "chest"))
+        assertEquals(1, table.holders(RLVCommand.ADDATTACH, "skull"))
+        assertEquals(0, table.holders(RLVCommand.ADDATTACH))
+        assertTrue(table.isRestricted(RLVCommand.SENDIM, "stranger-uuid"))
+        assertFalse(table.isRestricted(RLVCommand.SENDIM, "owner-uuid"), "Exception should lift the restriction")
+    }
+
+    @Test
+    fun `should compile processor commands into the table`() {
+        val rlv = RLVProcessor()
+        rlv.processRLVCommand("@fly=n, sendim=n,sendim:owner=add,addattach:skull=n", "collar", "Collar")
+
+        assertTrue(rlv.isRestricted(RLVCommand.FLY))
+        assertTrue(rlv.isRestricted("addattach", "skull"))
+        assertFalse(rlv.isRestricted(RLVCommand.SENDIM, "owner"))
+        assertEquals(setOf("fly", "sendim", "addattach:skull"), rlv.getActiveRestrictions().keys)
+
+        rlv.clearRestrictionsFromObject("collar")
+        assertFalse(rlv.isRestricted(RLVCommand.FLY))
+    }
+
+    @Test
+    fun `should announce movement restrictions lifted by clearing an object or disabling RLV`() = runBlocking<Unit> {
+        val announced = async(start = CoroutineStart.UNDISPATCHED) {
+            EventSystem.events.filterIsInstance<ViewerEvent.MenuActionTriggered>().map { it.action }.filter { it.startsWith("rlv_restriction_") }.take(4).toList()
+        }
+        val rlv = RLVProcessor()
+        rlv.processRLVCommand("@fly=n,sittp=n,sendim=n", "collar", "Collar")
+        rlv.processRLVCommand("@fly=n", "hud", "HUD")
+
+        rlv.clearRestrictionsFromObject("collar")
+        rlv.setRLVEnabled(false)
+
+        assertEquals(
+            listOf("rlv_restriction_fly_added", "rlv_restriction_sittp_added", "rlv_restriction_sittp_removed", "rlv_restriction_fly_removed"),
+            withTimeout(2000) { announced.await() },
+            "Flying stays restricted by the HUD until RLV is turned off"
+        )
+    }
+}
@@ -0,0 +1,65 @@
+package com.linkpoint.protocol.rlv
+
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.rlv.SharedFolderIndex.Folder
+import com.linkpoint.protocol.rlv.SharedFolderIndex.Item
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNotNull
+import kotlin.test.assertNull
+
+/**
+ * Tests for RLV shared folder queries, replies captured in-process
+ */
+class SharedFolderIndexTest {
+
+    private val folders = listOf(
+        Folder("root", null, "My Inventory"),
+        Folder("rlv", "root", "#RLV"),
+        Folder("outfits", "rlv", "Outfits"),
+        Folder("latex", "outfits", "Red Latex Suit"),
+        Folder("gown", "outfits", "Evening Gown"),
+        Folder("hidden", "rlv", ".private"),
+        Folder("cuffs", "rlv", "Cuffs"),
+        Folder("clothing", "root", "Clothing")
+    )
+    private val items = listOf(
+        Item("suit", "latex", worn = true),
+        Item("boots", "latex", worn = false),
+        Item("dress", "gown", worn = false),
+        Item("wrist", "cuffs", worn = true)
+    )
+
+    @Test
+    fun `should list visible subfolders by path`() {
+        val index = assertNotNull(SharedFolderIndex.build(folders, items))
+
+        assertEquals("Cuffs,Outfits", index.getInv(""))
+        assertEquals("Evening Gown,Red Latex Suit", index.getInv("outfits"))
+        assertNull(index.getInv("Clothing"), "Folders outside #RLV are not shared")
+    }
+
+    @Test
+    fun `should report worn state and track changes`() {
+        val index = assertNotNull(SharedFolderIndex.build(folders, items))
+
+        assertEquals("|02,Evening Gown|10,Red Latex Suit|20", index.getInvWorn("Outfits"))
+
+        index.setWorn("boots", true)
+        assertEquals("|02,Cuffs|30,Outfits|02", index.getInvWorn(""))
+    }
+
+    @Test
+    fun `should answer queries on the requested channel`() {
+        val replies = mutableListOf<Pair<Int, String>>()
+        val rlv = RLVProcessor(replySink = { channel, message -> replies += channel to message })
+        rlv.setSharedFolders(SharedFolderIndex.build(folders, items))
+
+        rlv.processRLVCommand("@findfolder:latex&&red=2222,findfolder:private=2223,getinv:outfits=2224", "relay", "Relay")
+
+        assertEquals(
+            listOf(2222 to "Outfits/Red Latex Suit", 2223 to "", 2224 to "Evening Gown,Red Latex Suit"),
+            replies
+        )
+    }
+}
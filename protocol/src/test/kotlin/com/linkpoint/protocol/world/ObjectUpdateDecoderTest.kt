@@ -0,0 +1,71 @@
+package com.linkpoint.protocol.world
+
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.data.ObjectType
+import com.linkpoint.protocol.data.VirtualObject
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.UUID
+import kotlin.test.AfterTest
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertIs
+import kotlin.test.assertNull
+
+/**
+ * Tests for applying circuit object updates to the object store
+ */
+class ObjectUpdateDecoderTest {
+
+    private val store = ObjectStore()
+    private val decoder = ObjectUpdateDecoder(store)
+
+    // An update block as the circuit hands it over, after local id and CRC
+    private fun block(id: UUID, pcode: Int, position: Vector3, scale: Vector3 = Vector3(1f, 1f, 1f), velocity: Float = 0f): ByteArray {
+        val motion = if (pcode == ObjectUpdateDecoder.PCODE_AVATAR) 76 else 60
+        val buffer = ByteBuffer.allocate(33 + motion).order(ByteOrder.BIG_ENDIAN)
+        buffer.put(0).putLong(id.mostSignificantBits).putLong(id.leastSignificantBits)
+        buffer.order(ByteOrder.LITTLE_ENDIAN)
+        buffer.put(pcode.toByte()).put(3).put(0)
+        buffer.putFloat(scale.x).putFloat(scale.y).putFloat(scale.z)
+        buffer.put(motion.toByte())
+        if (motion == 76) buffer.position(buffer.position() + 16)
+        buffer.putFloat(position.x).putFloat(position.y).putFloat(position.z)
+        buffer.putFloat(velocity).putFloat(0f).putFloat(0f)
+        return buffer.array()
+    }
+
+    @AfterTest
+    fun cleanup() {
+        store.close()
+    }
+
+    @Test
+    fun `should store prims and avatars and remove them by local id`() {
+        val prim = UUID(1, 1)
+        val avatar = UUID(2, 2)
+        decoder.onUpdate(10, block(prim, ObjectUpdateDecoder.PCODE_PRIM, Vector3(40f, 50f, 22f), Vector3(30f, 2f, 1f)))
+        decoder.onUpdate(11, block(avatar, ObjectUpdateDecoder.PCODE_AVATAR, Vector3(100f, 120f, 23f), velocity = 2f))
+
+        val stored = assertIs<VirtualObject>(store[prim])
+        assertEquals(Vector3(40f, 50f, 22f), stored.position)
+        assertEquals(Vector3(30f, 2f, 1f), stored.scale)
+        assertEquals(ObjectType.PRIMITIVE, stored.objectType)
+        assertEquals(1f, stored.rotation.w)
+        assertEquals(Vector3(100f, 120f, 23f), assertIs<Avatar>(store[avatar]).position)
+        assertEquals(listOf(prim), store.grid.staticIn(1, 3).map { it.id }, "Static prims reach the minimap's grid")
+
+        decoder.onKill(10)
+        assertNull(store[prim])
+        assertEquals(1, store.size)
+    }
+
+    @Test
+    fun `should skip truncated blocks and unknown kinds`() {
+        assertNull(decoder.onUpdate(1, ByteArray(20)))
+        assertNull(decoder.onUpdate(2, block(UUID(3, 3), 200, Vector3(1f, 1f, 1f))))
+        assertNull(decoder.onUpdate(3, block(UUID(4, 4), ObjectUpdateDecoder.PCODE_PRIM, Vector3(1f, 1f, 1f)).copyOf(60)))
+        assertEquals(0, store.size)
+    }
+}
@@ -0,0 +1,89 @@
+package com.linkpoint.protocol.world
+
+import java.nio.file.Files
+import java.util.UUID
+import kotlin.random.Random
+import kotlin.test.AfterTest
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the per-region object update cache
+ */
+class RegionObjectCacheTest {
+
+    private val directory = Files.createTempDirectory("objects").toFile()
+    private val region = 0x0003E8000003E800L
+    private val simCacheId = UUID(42, 1)
+
+    // An update block: mostly zeros and small values, like a prim's shape and texture entry
+    private fun block(localId: Int, size: Int = 320): ByteArray {
+        val random = Random(localId)
+        return ByteArray(size) { if (it % 4 == 0) random.nextInt(16).toByte() else 0 }
+    }
+
+    @AfterTest
+    fun cleanup() {
+        directory.deleteRecursively()
+    }
+
+    @Test
+    fun `should answer a revisit from disk and request only changed and new objects`() {
+        val firstVisit = RegionObjectCache(directory)
+        firstVisit.open(region, simCacheId)
+        for (id in 1..1000) firstVisit.store(id, crc = id, block(id))
+        firstVisit.flush()
+
+        // Next session: 50 objects changed, 20 are new
+        val cache = RegionObjectCache(directory)
+        cache.open(region, simCacheId)
+        val probes = (1..1000).map { CacheProbe(it, if (it % 20 == 0) it + 1 else it) } +
+            (1001..1020).map { CacheProbe(it, it) }
+        val result = cache.probe(probes)
+
+        assertEquals(950, result.hits.size)
+        assertEquals(block(7).toList(), result.hits.first { it.localId == 7 }.data.toList())
+        assertEquals(50, result.misses.count { it.type == CacheMissType.CRC })
+        assertEquals((1001..1020).toList(), result.misses.filter { it.type == CacheMissType.FULL }.map { it.localId })
+
+        val stats = cache.stats
+        assertEquals(1020L, stats.probes)
+        assertEquals(950f / 1020, stats.hitRate, 0.0001f)
+        assertEquals(950L * (320 - RegionObjectCache.PROBE_BYTES), stats.bytesSaved)
+
+        val file = directory.listFiles()!!.single()
+        assertTrue(file.length() < 1000 * 320 / 4, "Cache file of ${file.length()} bytes for 320 KB of updates")
+    }
+
+    @Test
+    fun `should drop a region whose simulator cache id changed`() {
+        val cache = RegionObjectCache(directory)
+        cache.open(region, simCacheId)
+        for (id in 1..10) cache.store(id, id, block(id))
+        cache.flush()
+
+        val restarted = RegionObjectCache(directory)
+        restarted.open(region, UUID(42, 2))
+        assertEquals(0, restarted.size)
+        assertEquals(10, restarted.probe((1..10).map { CacheProbe(it, it) }).misses.size)
+    }
+
+    @Test
+    fun `should forget killed objects and keep the most recently seen when full`() {
+        var now = 0L
+        val cache = RegionObjectCache(directory, maxObjectsPerRegion = 100, clock = { now })
+        cache.open(region)
+        for (id in 1..150) {
+            now = id.toLong()
+            cache.store(id, id, block(id, 64))
+        }
+        cache.remove(150)
+        cache.flush()
+
+        val reopened = RegionObjectCache(directory)
+        reopened.open(region)
+        val result = reopened.probe((1..150).map { CacheProbe(it, it) })
+        assertEquals((50..149).toList(), result.hits.map { it.localId }.sorted())
+    }
+}
@@ -0,0 +1,76 @@
+package com.linkpoint.protocol.world
+
+import com.linkpoint.core.events.Quaternion
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.protocol.data.AnimationState
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.data.ObjectMaterial
+import com.linkpoint.protocol.data.ObjectType
+import com.linkpoint.protocol.data.VirtualObject
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNotEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the object store's spatial grid
+ */
+class SpatialGridTest {
+
+    private val identity = Quaternion(0f, 0f, 0f, 1f)
+
+    private fun prim(n: Long, x: Float, y: Float, size: Float = 1f) = VirtualObject(
+        UUID(7, n), "Prim $n", Vector3(x, y, 22f), identity, Vector3(size, size, 1f),
+        description = "", creatorId = UUID(0, 0), ownerId = UUID(0, 0),
+        objectType = ObjectType.PRIMITIVE, material = ObjectMaterial.WOOD, textureIds = emptyList()
+    )
+
+    private fun avatar(n: Long, x: Float, y: Float) = Avatar(
+        UUID(8, n), "Resident $n", Vector3(x, y, 22f), identity,
+        displayName = "Resident $n", username = "resident$n", appearanceHash = "",
+        animationState = AnimationState("stand"), attachments = emptyList()
+    )
+
+    @Test
+    fun `should return only entities in the area and keep moving ones out of the static version`() {
+        val store = ObjectStore()
+        store.put(prim(1, 10f, 10f))
+        store.put(prim(2, 100f, 100f))
+        store.put(avatar(1, 12f, 12f))
+        val grid = store.grid
+
+        assertEquals(setOf(UUID(7, 1), UUID(8, 1)), grid.query(0f, 0f, 20f, 20f).map { it.id }.toSet())
+        assertEquals(listOf(UUID(8, 1)), grid.query(0f, 0f, 20f, 20f, static = false).map { it.id })
+
+        val before = grid.staticVersion(0, 0)
+        store.put(avatar(1, 14f, 9f))
+        assertEquals(before, grid.staticVersion(0, 0), "Avatars moving don't invalidate cached static content")
+
+        store.put(prim(1, 200f, 10f))
+        assertNotEquals(before, grid.staticVersion(0, 0))
+        assertTrue(grid.query(0f, 0f, 20f, 20f, dynamic = false).isEmpty(), "A moved prim leaves its old cell")
+        assertEquals(listOf(UUID(7, 1)), grid.query(190f, 0f, 210f, 20f).map { it.id })
+
+        store.remove(UUID(8, 1))
+        assertTrue(grid.query(0f, 0f, 256f, 256f, static = false).isEmpty())
+    }
+
+    @Test
+    fun `should file a large prim in every cell it covers but report it once`() {
+        val store = ObjectStore()
+        val grid = store.grid
+        // 40 m across, centred in cell (1, 1): reaches into cells 0 to 2 each way
+        store.put(prim(1, 24f, 24f, size = 40f))
+
+        for (cy in 0..2) for (cx in 0..2) assertEquals(listOf(UUID(7, 1)), grid.staticIn(cx, cy).map { it.id }, "Cell ($cx, $cy)")
+        assertTrue(grid.staticIn(3, 0).isEmpty())
+        assertEquals(listOf(UUID(7, 1)), grid.query(0f, 0f, 48f, 48f).map { it.id })
+
+        val before = grid.staticVersion(2, 2)
+        store.put(prim(1, 24f, 24f, size = 4f))
+        assertNotEquals(before, grid.staticVersion(2, 2), "A shrinking prim changes the cells it left")
+        assertTrue(grid.staticIn(2, 2).isEmpty())
+        store.close()
+    }
+}
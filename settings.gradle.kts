@@ -8,5 +8,6 @@ include(
     ":audio",
     ":assets",
     ":android",
-    ":batch-processor"
+    ":batch-processor",
+    ":benchmarks"
 )
\ No newline at end of file
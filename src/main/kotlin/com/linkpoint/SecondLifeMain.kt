@@ -3,8 +3,16 @@ package com.linkpoint
 import com.linkpoint.core.SimpleViewerCore
 import com.linkpoint.protocol.LoginSystem
 import com.linkpoint.protocol.UDPMessageSystem
+import com.linkpoint.protocol.inventory.InventoryFetcher
+import com.linkpoint.protocol.inventory.InventorySession
+import com.linkpoint.protocol.world.RegionObjectCache
 import com.linkpoint.ui.LoginDialog
 import kotlinx.coroutines.*
+import java.io.File
+import java.util.UUID
+
+// Per-user, so the caches do not depend on where the viewer was started from
+private val cacheDirectory = File(System.getProperty("user.home"), ".linkpoint/cache")
 
 /**
  * SecondLife-ready main application
@@ -21,8 +29,10 @@ suspend fun main(args: Array<String>) = coroutineScope {
     
     val viewerCore = SimpleViewerCore()
     val loginSystem = LoginSystem()
-    val udpSystem = UDPMessageSystem()
+    val objectCache = RegionObjectCache(File(cacheDirectory, "objects"))
+    val udpSystem = UDPMessageSystem(objectCache)
     val loginDialog = LoginDialog()
+    var inventory: InventorySession? = null
     
     try {
         // Initialize core systems
@@ -77,7 +87,8 @@ suspend fun main(args: Array<String>) = coroutineScope {
             val udpConnected = udpSystem.connect(
                 loginResponse.simIp,
                 loginResponse.simPort,
-                loginResponse.circuitCode
+                loginResponse.circuitCode,
+                loginResponse.regionHandle
             )
             
             if (udpConnected) {
@@ -85,6 +96,7 @@ suspend fun main(args: Array<String>) = coroutineScope {
                 println("   Session ID: ${loginResponse.sessionId}")
                 println("   Agent ID: ${loginResponse.agentId}")
                 println("   Simulator: ${loginResponse.simIp}:${loginResponse.simPort}")
+                inventory = startInventory(loginResponse)
                 println()
                 
                 // Main loop
@@ -137,6 +149,7 @@ suspend fun main(args: Array<String>) = coroutineScope {
     } finally {
         // Cleanup
         try {
+            inventory?.close()
             udpSystem.disconnect()
             loginSystem.logout()
             viewerCore.shutdown()
@@ -144,8 +157,31 @@ suspend fun main(args: Array<String>) = coroutineScope {
             println("⚠️ Cleanup error: ${e.message}")
         }
         
+        objectCache.stats.takeIf { it.probes > 0 }?.let { stats ->
+            println("📦 Object cache: ${(stats.hitRate * 100).toInt()}% hits, ${stats.bytesSaved / 1024} KB not downloaded")
+        }
         println()
         println("👋 SecondLife connectivity test complete")
         println("═".repeat(80))
     }
-}
\ No newline at end of file
+}
+
+/**
+ * Restore the inventory from the last session's snapshot and list its root,
+ * if the simulator grants FetchInventoryDescendents2
+ */
+private suspend fun startInventory(login: LoginSystem.LoginResponse): InventorySession? {
+    val seed = login.seedCapability ?: return null
+    val owner = login.agentId?.let { runCatching { UUID.fromString(it) }.getOrNull() } ?: return null
+    val root = login.inventoryRoot?.let { runCatching { UUID.fromString(it) }.getOrNull() } ?: return null
+    return try {
+        val capability = InventorySession.resolveCapabilities(seed, listOf(InventoryFetcher.CAPABILITY_NAME))[InventoryFetcher.CAPABILITY_NAME]
+            ?: return null
+        InventorySession.start(capability, owner, root, File(cacheDirectory, "inventory-$owner.snapshot")).also { session ->
+            println("📁 Inventory: ${session.store.folderCount} folders (${session.restoredFolders} from the last session's snapshot)")
+        }
+    } catch (e: Exception) {
+        println("⚠️ Inventory unavailable: ${e.message}")
+        null
+    }
+}
@@ -5,6 +5,8 @@ plugins {
 dependencies {
     implementation(project(":core"))
     implementation(project(":graphics"))
+    implementation(project(":protocol"))
+    implementation(project(":assets"))
     implementation("org.jetbrains.kotlin:kotlin-stdlib")
     implementation("org.jetbrains.kotlinx:kotlinx-coroutines-core:1.7.3")
     implementation("io.github.microutils:kotlin-logging:3.0.5")
@@ -1,7 +1,31 @@
 package com.linkpoint.ui
 
+import com.linkpoint.assets.maptiles.MapTileDraw
+import com.linkpoint.assets.maptiles.MapTileManager
+import com.linkpoint.assets.maptiles.MapViewport
+import com.linkpoint.core.memory.AllocationMonitor
+import com.linkpoint.core.memory.AllocationSample
+import com.linkpoint.core.memory.MemoryBudgets
+import com.linkpoint.core.memory.MemoryPressureLevel
+import com.linkpoint.core.memory.MemoryPressureListener
+import com.linkpoint.core.profiling.ChromeTraceExporter
+import com.linkpoint.core.profiling.FrameProfile
+import com.linkpoint.core.profiling.Profiler
+import com.linkpoint.protocol.inventory.InventoryFetcher
+import com.linkpoint.protocol.inventory.InventoryFolderInfo
+import com.linkpoint.protocol.inventory.InventoryIndex
+import com.linkpoint.protocol.inventory.InventoryItemInfo
+import com.linkpoint.protocol.inventory.InventorySortOrder
+import com.linkpoint.protocol.inventory.InventoryStore
+import com.linkpoint.ui.chat.ChatBatch
+import com.linkpoint.ui.chat.ChatHistory
+import com.linkpoint.ui.chat.ChatIngestPipeline
+import com.linkpoint.ui.chat.ChatLog
+import com.linkpoint.ui.chat.ChatTranscript
 import kotlinx.coroutines.*
 import kotlinx.coroutines.flow.*
+import java.io.File
+import java.util.UUID
 
 /**
  * Desktop UI Components
@@ -20,19 +44,30 @@ import kotlinx.coroutines.flow.*
  * - Multiple chat tabs for different channels
  * - Chat history with search and filtering
  * - Command auto-complete and chat logging
+ *
+ * Every message is appended to a persistent, indexed [ChatHistory]; tabs only
+ * keep the most recent [ChatLog.DEFAULT_RECENT_WINDOW] messages in memory.
  */
-class DesktopChatUI : UIComponent() {
+class DesktopChatUI(
+    historyDirectory: File
+) : UIComponent(), AutoCloseable {
     
     private var isVisible = false
     private val chatTabs = mutableMapOf<String, ChatTab>()
     private var activeTab = "Local"
+    private val history = ChatHistory(historyDirectory)
+    private val historyAccount = MemoryBudgets.register(
+        MemoryBudgets.UI_HISTORY,
+        MemoryBudgets.PRIORITY_UI_HISTORY,
+        listener = MemoryPressureListener { level, bytes -> trimHistory(level, bytes) }
+    )
     
     init {
         // Initialize default chat tabs
-        chatTabs["Local"] = ChatTab("Local", mutableListOf())
-        chatTabs["IM"] = ChatTab("IM", mutableListOf())
-        chatTabs["Group"] = ChatTab("Group", mutableListOf())
-        chatTabs["System"] = ChatTab("System", mutableListOf())
+        chatTabs["Local"] = ChatTab("Local")
+        chatTabs["IM"] = ChatTab("IM")
+        chatTabs["Group"] = ChatTab("Group")
+        chatTabs["System"] = ChatTab("System")
     }
     
     override suspend fun applyTheme(theme: UITheme) {
@@ -89,7 +124,7 @@ class DesktopChatUI : UIComponent() {
      */
     suspend fun addChatTab(tabName: String) {
         if (!chatTabs.containsKey(tabName)) {
-            chatTabs[tabName] = ChatTab(tabName, mutableListOf())
+            chatTabs[tabName] = ChatTab(tabName)
             println("DesktopChatUI: Added new chat tab: $tabName")
         }
     }
@@ -118,7 +153,9 @@ class DesktopChatUI : UIComponent() {
                 sender = "LocalUser"
             )
             
-            tab.messages.add(chatMessage)
+            withContext(Dispatchers.IO) { history.append(chatMessage) }
+            historyAccount.charge(messageBytes(chatMessage))
+            tab.transcript.append(chatMessage)?.let { evicted -> historyAccount.release(messageBytes(evicted)) }
             displayMessage(chatMessage)
             
             println("DesktopChatUI: Sent message in $activeTab: $message")
@@ -126,22 +163,85 @@ class DesktopChatUI : UIComponent() {
     }
     
     /**
-     * Search chat history
+     * Show chat digested by [pipeline], one batch per frame
      */
-    suspend fun searchHistory(query: String): List<ChatMessage> {
-        val results = mutableListOf<ChatMessage>()
-        
-        chatTabs.values.forEach { tab ->
-            results.addAll(tab.messages.filter { message ->
-                message.text.contains(query, ignoreCase = true) ||
-                message.sender.contains(query, ignoreCase = true)
-            })
+    fun attachIngest(pipeline: ChatIngestPipeline, scope: CoroutineScope): Job =
+        pipeline.batches.onEach { receiveBatch(it) }.launchIn(scope)
+    
+    /**
+     * Append a batch of incoming chat; repeats of the newest line replace it
+     * with an updated count
+     */
+    suspend fun receiveBatch(batch: ChatBatch) {
+        if (batch.lines.isEmpty()) return
+        withContext(Dispatchers.IO) {
+            batch.lines.forEach { line -> if (line.replaces == null) history.append(line.message) }
         }
-        
+        batch.lines.forEach { line ->
+            val tab = chatTabs[line.message.channel] ?: chatTabs.getValue("Local")
+            val display = line.display
+            historyAccount.charge(messageBytes(display))
+            val evicted = if (line.replaces != null && tab.transcript.replaceLast(line.replaces, display)) {
+                // Swapped out the previous count
+                historyAccount.release(messageBytes(line.replaces))
+                null
+            } else {
+                tab.transcript.append(display)
+            }
+            evicted?.let { historyAccount.release(messageBytes(it)) }
+        }
+        if (isVisible) displayChatTab(activeTab)
+    }
+    
+    /**
+     * Search chat history: the newest page of messages containing every word
+     * of [query], across all conversations
+     */
+    suspend fun searchHistory(query: String): List<ChatMessage> {
+        val results = searchHistoryPages(query).firstOrNull().orEmpty()
         println("DesktopChatUI: Search '$query' returned ${results.size} results")
         return results
     }
     
+    /**
+     * Search chat history page by page, newest first; collect only as many
+     * pages as the results view needs
+     */
+    fun searchHistoryPages(query: String, pageSize: Int = ChatLog.DEFAULT_PAGE_SIZE): Flow<List<ChatMessage>> =
+        history.search(query, pageSize)
+    
+    /**
+     * Open conversations logged in earlier sessions so search covers them
+     */
+    suspend fun loadHistory() = withContext(Dispatchers.IO) { history.openExisting() }
+    
+    /**
+     * Close the history's segment files
+     */
+    override fun close() = history.close()
+    
+    /**
+     * Memory pressure handler: drop the oldest messages from every tab, keeping
+     * the most recent ones visible (none at critical pressure)
+     */
+    private fun trimHistory(level: MemoryPressureLevel, bytesToFree: Long): Long {
+        val keep = if (level == MemoryPressureLevel.CRITICAL) 0 else HISTORY_KEEP_ON_PRESSURE
+        var freed = 0L
+        chatTabs.values.forEach { tab ->
+            val messages = tab.transcript.messages
+            var drop = 0
+            while (messages.size - drop > keep && freed < bytesToFree) {
+                freed += messageBytes(messages[drop++])
+            }
+            tab.transcript.trimTo(messages.size - drop)
+        }
+        historyAccount.release(freed)
+        return freed
+    }
+    
+    private fun messageBytes(message: ChatMessage): Long =
+        MESSAGE_OVERHEAD_BYTES + (message.text.length + message.sender.length + message.channel.length) * 2L
+    
     private suspend fun displayChatWindow() {
         println("DesktopChatUI: ┌─────────────────────────────────┐")
         println("DesktopChatUI: │ Chat - $activeTab                │")
@@ -163,9 +263,9 @@ class DesktopChatUI : UIComponent() {
     private suspend fun displayChatTab(tabName: String) {
         val tab = chatTabs[tabName]
         if (tab != null) {
-            val recentMessages = tab.messages.takeLast(5)
-            recentMessages.forEach { message ->
-                displayMessage(message)
+            // Lay out only the rows that fit in the window
+            tab.transcript.viewport(CONSOLE_WIDTH_PX, CONSOLE_HEIGHT_PX).forEach { row ->
+                displayMessage(row.message)
             }
         }
     }
@@ -174,6 +274,14 @@ class DesktopChatUI : UIComponent() {
         val timeStr = java.text.SimpleDateFormat("HH:mm").format(message.timestamp)
         println("DesktopChatUI: │ [$timeStr] ${message.sender}: ${message.text}")
     }
+    
+    companion object {
+        private const val HISTORY_KEEP_ON_PRESSURE = 50
+        private const val MESSAGE_OVERHEAD_BYTES = 96L
+        // Console chat window: 80 columns x 5 lines of the default monospace measurer
+        private const val CONSOLE_WIDTH_PX = 640
+        private const val CONSOLE_HEIGHT_PX = 80
+    }
 }
 
 /**
@@ -184,16 +292,25 @@ class DesktopChatUI : UIComponent() {
  * - Multi-select operations with keyboard shortcuts
  * - Detailed list view with sortable columns
  * - Advanced filtering and search capabilities
+ *
+ * Backed by a columnar [InventoryStore]; with a [fetcher] attached, folders
+ * are loaded through FetchInventoryDescendents2 when they are opened.
  */
-class DesktopInventoryUI : UIComponent() {
+class DesktopInventoryUI(
+    private val store: InventoryStore = InventoryStore()
+) : UIComponent() {
     
     private var isVisible = false
-    private val inventoryTree = InventoryFolder("My Inventory", mutableListOf())
     private var sortBy = SortField.NAME
     private var sortAscending = true
+    private val index = InventoryIndex(store)
+    private val matcher = index.matcher()
+    
+    /** Loads folder contents on demand once logged in */
+    var fetcher: InventoryFetcher? = null
     
     init {
-        initializeInventoryStructure()
+        if (store.folderCount == 0) initializeInventoryStructure()
     }
     
     override suspend fun applyTheme(theme: UITheme) {
@@ -219,27 +336,45 @@ class DesktopInventoryUI : UIComponent() {
     }
     
     /**
-     * Sort inventory by field
+     * Sort inventory by field, returning the first [pageSize] items in the
+     * new order from the maintained indexes
      */
-    suspend fun sortInventory(field: SortField, ascending: Boolean = true) {
+    suspend fun sortInventory(field: SortField, ascending: Boolean = true, pageSize: Int = PAGE_SIZE): List<InventoryItem> {
         sortBy = field
         sortAscending = ascending
+        val order = when (field) {
+            SortField.NAME -> InventorySortOrder.NAME
+            SortField.TYPE -> InventorySortOrder.TYPE
+            // Item size isn't known to the viewer; date is the closest useful order
+            SortField.DATE, SortField.SIZE -> InventorySortOrder.DATE
+        }
+        val page = withContext(Dispatchers.Default) { index.items(index.sorted(order, ascending), limit = pageSize) }
         
         println("DesktopInventoryUI: Sorted by ${field.name} (${if (ascending) "ascending" else "descending"})")
         displayInventoryWindow()
+        return page.map { it.toUiItem() }
     }
     
     /**
-     * Search inventory items
+     * Search inventory item names and descriptions; typing more characters
+     * refines the previous results rather than rescanning
      */
-    suspend fun searchInventory(query: String): List<InventoryItem> {
-        val results = mutableListOf<InventoryItem>()
-        searchInFolder(inventoryTree, query, results)
+    suspend fun searchInventory(query: String, limit: Int = PAGE_SIZE): List<InventoryItem> {
+        val results = withContext(Dispatchers.Default) { index.items(matcher.match(query), limit = limit) }.map { it.toUiItem() }
         
         println("DesktopInventoryUI: Search '$query' found ${results.size} items")
         return results
     }
     
+    /**
+     * Expand a folder, fetching its contents first if they are missing or stale
+     */
+    suspend fun openFolder(folderId: UUID) {
+        fetcher?.ensureLoaded(folderId)
+        val folder = store.folder(folderId) ?: return
+        displayFolderContents(folder, 0, expand = false)
+    }
+    
     /**
      * Wear multiple selected items
      */
@@ -258,26 +393,42 @@ class DesktopInventoryUI : UIComponent() {
     }
     
     private fun initializeInventoryStructure() {
-        // Create folder structure
-        val clothingFolder = InventoryFolder("Clothing", mutableListOf())
-        clothingFolder.children.add(InventoryItem("Blue Shirt", "Clothing", "A comfortable blue shirt"))
-        clothingFolder.children.add(InventoryItem("Black Pants", "Clothing", "Stylish black pants"))
-        clothingFolder.children.add(InventoryItem("Red Dress", "Clothing", "Elegant red dress"))
-        
-        val bodyPartsFolder = InventoryFolder("Body Parts", mutableListOf())
-        bodyPartsFolder.children.add(InventoryItem("Hair - Blonde", "Body Parts", "Long blonde hair"))
-        bodyPartsFolder.children.add(InventoryItem("Eyes - Blue", "Body Parts", "Bright blue eyes"))
-        bodyPartsFolder.children.add(InventoryItem("Skin - Fair", "Body Parts", "Fair skin tone"))
-        
-        val objectsFolder = InventoryFolder("Objects", mutableListOf())
-        objectsFolder.children.add(InventoryItem("Magic Sword", "Objects", "A mystical glowing sword"))
-        objectsFolder.children.add(InventoryItem("Wooden Chair", "Objects", "Simple wooden chair"))
-        
-        val animationsFolder = InventoryFolder("Animations", mutableListOf())
-        animationsFolder.children.add(InventoryItem("Dance - Salsa", "Animations", "Passionate salsa dance"))
-        animationsFolder.children.add(InventoryItem("Walk - Confident", "Animations", "Confident walking style"))
-        
-        inventoryTree.children.addAll(listOf(clothingFolder, bodyPartsFolder, objectsFolder, animationsFolder))
+        // Sample folder structure until the real inventory is fetched
+        val root = UUID.nameUUIDFromBytes("My Inventory".toByteArray())
+        store.putFolder(InventoryFolderInfo(root, null, "My Inventory"))
+        val samples = listOf(
+            "Clothing" to listOf(
+                "Blue Shirt" to "A comfortable blue shirt",
+                "Black Pants" to "Stylish black pants",
+                "Red Dress" to "Elegant red dress"
+            ),
+            "Body Parts" to listOf(
+                "Hair - Blonde" to "Long blonde hair",
+                "Eyes - Blue" to "Bright blue eyes",
+                "Skin - Fair" to "Fair skin tone"
+            ),
+            "Objects" to listOf(
+                "Magic Sword" to "A mystical glowing sword",
+                "Wooden Chair" to "Simple wooden chair"
+            ),
+            "Animations" to listOf(
+                "Dance - Salsa" to "Passionate salsa dance",
+                "Walk - Confident" to "Confident walking style"
+            )
+        )
+        samples.forEach { (category, items) ->
+            val folder = UUID.nameUUIDFromBytes(category.toByteArray())
+            store.putFolder(InventoryFolderInfo(folder, root, category))
+            items.forEach { (name, description) ->
+                store.putItem(InventoryItemInfo(
+                    id = UUID.nameUUIDFromBytes(name.toByteArray()),
+                    parentId = folder,
+                    name = name,
+                    description = description,
+                    assetType = InventoryCategories.assetType(category)!!
+                ))
+            }
+        }
     }
     
     private suspend fun displayInventoryWindow() {
@@ -287,46 +438,40 @@ class DesktopInventoryUI : UIComponent() {
         println("DesktopInventoryUI: │ Sort: ${sortBy.name} ${if (sortAscending) "↑" else "↓"}              │")
         println("DesktopInventoryUI: ├─────────────────────────────────────┤")
         
-        displayFolderContents(inventoryTree, 0)
+        store.rootId?.let { root -> store.folder(root)?.let { displayFolderContents(it, 0, expand = true) } }
         
         println("DesktopInventoryUI: └─────────────────────────────────────┘")
     }
     
-    private fun displayFolderContents(folder: InventoryFolder, indent: Int) {
+    private fun displayFolderContents(folder: InventoryFolderInfo, indent: Int, expand: Boolean) {
         val prefix = "│ " + "  ".repeat(indent)
         println("DesktopInventoryUI: $prefix📁 ${folder.name}")
         
-        folder.children.forEach { item ->
-            when (item) {
-                is InventoryFolder -> displayFolderContents(item, indent + 1)
-                is InventoryItem -> {
-                    val itemPrefix = "│ " + "  ".repeat(indent + 1)
-                    val icon = when (item.category) {
-                        "Clothing" -> "👕"
-                        "Body Parts" -> "👤"
-                        "Objects" -> "📦"
-                        "Animations" -> "💃"
-                        else -> "📄"
-                    }
-                    println("DesktopInventoryUI: $itemPrefix$icon ${item.name}")
-                }
+        store.childFolders(folder.id).forEach { child ->
+            if (expand) {
+                displayFolderContents(child, indent + 1, expand)
+            } else {
+                println("DesktopInventoryUI: $prefix  📁 ${child.name}")
             }
         }
-    }
-    
-    private fun searchInFolder(folder: InventoryFolder, query: String, results: MutableList<InventoryItem>) {
-        folder.children.forEach { item ->
-            when (item) {
-                is InventoryFolder -> searchInFolder(item, query, results)
-                is InventoryItem -> {
-                    if (item.name.contains(query, ignoreCase = true) || 
-                        item.description.contains(query, ignoreCase = true)) {
-                        results.add(item)
-                    }
-                }
+        store.items(folder.id).forEach { item ->
+            val itemPrefix = "│ " + "  ".repeat(indent + 1)
+            val icon = when (InventoryCategories.name(item.assetType)) {
+                "Clothing" -> "👕"
+                "Body Parts" -> "👤"
+                "Objects" -> "📦"
+                "Animations" -> "💃"
+                else -> "📄"
             }
+            println("DesktopInventoryUI: $itemPrefix$icon ${item.name}")
         }
     }
+    
+    private fun InventoryItemInfo.toUiItem() = InventoryItem(name, InventoryCategories.name(assetType), description)
+    
+    companion object {
+        private const val PAGE_SIZE = 200
+    }
 }
 
 /**
@@ -417,13 +562,20 @@ class DesktopCameraUI : UIComponent() {
 
 /**
  * Desktop World Map UI - Resizable map window with advanced features
+ *
+ * [tiles] is shut down with the window when [ownsTiles], i.e. when the
+ * framework built it rather than the host providing it
  */
-class DesktopWorldMapUI : UIComponent() {
+class DesktopWorldMapUI(
+    private val tiles: MapTileManager,
+    private val ownsTiles: Boolean = false
+) : UIComponent(), AutoCloseable {
     
     private var isVisible = false
     private var mapLayer = MapLayer.TERRAIN
     private var showTraffic = false
     private var showFriends = true
+    private var viewport = MapViewport(1000.5, 1000.5, 512, 512, pixelsPerRegion = 64.0)
     
     override suspend fun applyTheme(theme: UITheme) {
         println("DesktopWorldMapUI: Applied ${theme.name} theme to map window")
@@ -442,7 +594,34 @@ class DesktopWorldMapUI : UIComponent() {
     
     override suspend fun updateLayout(screenSize: ScreenSize) {
         val windowSize = (screenSize.width * 0.4).toInt().coerceAtLeast(400)
+        viewport = viewport.copy(widthPx = windowSize, heightPx = windowSize)
         println("DesktopWorldMapUI: Resized map window to ${windowSize}x${windowSize}")
+        if (isVisible) tiles.update(viewport)
+    }
+    
+    /**
+     * Centre the map on region grid coordinates ([gridX], [gridY])
+     */
+    suspend fun centerOn(gridX: Double, gridY: Double): List<MapTileDraw> {
+        viewport = viewport.copy(centerX = gridX, centerY = gridY)
+        return drawTiles()
+    }
+    
+    /**
+     * Drag the map by ([deltaX], [deltaY]) window pixels
+     */
+    suspend fun panMap(deltaX: Float, deltaY: Float): List<MapTileDraw> {
+        viewport = viewport.panned(-deltaX / viewport.pixelsPerRegion, deltaY / viewport.pixelsPerRegion)
+        return drawTiles()
+    }
+    
+    /**
+     * Mouse wheel zoom, from a pixel per region in to about one region
+     * filling the window
+     */
+    suspend fun zoomMap(scaleFactor: Float): List<MapTileDraw> {
+        viewport = viewport.copy(pixelsPerRegion = (viewport.pixelsPerRegion * scaleFactor).coerceIn(1.0, 512.0))
+        return drawTiles()
     }
     
     /**
@@ -483,13 +662,30 @@ class DesktopWorldMapUI : UIComponent() {
         println("DesktopWorldMapUI: │ Layers: [Terrain] [Parcels]     │")
         println("DesktopWorldMapUI: │ Traffic: ${if (showTraffic) "[ON]" else "[OFF]"}  Friends: ${if (showFriends) "[ON]" else "[OFF]"} │")
         println("DesktopWorldMapUI: ├─────────────────────────────────┤")
-        println("DesktopWorldMapUI: │          🗺️ MAP VIEW 🗺️          │")
+        val draws = drawTiles()
+        println("DesktopWorldMapUI: │ 🗺️ ${draws.size} tiles, level ${viewport.level}, ${draws.count { it.isFallback }} coarse │")
         println("DesktopWorldMapUI: │     📍 You are here (128,128)   │")
         if (showFriends) {
             println("DesktopWorldMapUI: │     👥 Friends: 2 online        │")
         }
         println("DesktopWorldMapUI: └─────────────────────────────────┘")
     }
+    
+    /**
+     * Request tiles for the view and pick what to draw, coarser tiles
+     * standing in for ones still loading
+     */
+    private fun drawTiles(): List<MapTileDraw> {
+        tiles.update(viewport)
+        return tiles.visibleTiles(viewport)
+    }
+    
+    /**
+     * Stop tile loading and free the decoded tiles, if this window owns them
+     */
+    override fun close() {
+        if (ownsTiles) tiles.shutdown()
+    }
 }
 
 /**
@@ -557,6 +753,89 @@ class DesktopAvatarUI : UIComponent() {
     }
 }
 
+/**
+ * Desktop Profiler UI - Fast-timer style overlay of the per-frame zone tree
+ * 
+ * Mirrors the SecondLife viewer's "Fast Timers" floater: shows the last
+ * aggregated frame from the profiler as an expandable tree and can export
+ * the raw event rings as a Chrome trace for offline analysis.
+ */
+class DesktopProfilerUI : UIComponent() {
+    
+    private var isVisible = false
+    private var maxDepth = 4
+    private var lastAllocation: AllocationSample? = null
+    // Ticks without a new frame leave the overlay as it is
+    private var shownFrame: FrameProfile? = null
+    
+    override suspend fun applyTheme(theme: UITheme) {
+        println("DesktopProfilerUI: Applied ${theme.name} theme to profiler overlay")
+    }
+    
+    override suspend fun show() {
+        isVisible = true
+        Profiler.isEnabled = true
+        println("DesktopProfilerUI: Profiling enabled, showing frame timers")
+        displayFrame(Profiler.lastFrame)
+    }
+    
+    override suspend fun hide() {
+        isVisible = false
+        Profiler.isEnabled = false
+        println("DesktopProfilerUI: Profiling disabled, hiding frame timers")
+    }
+    
+    override suspend fun updateLayout(screenSize: ScreenSize) {
+        val windowWidth = (screenSize.width * 0.3).toInt().coerceAtLeast(320)
+        println("DesktopProfilerUI: Resized profiler window to ${windowWidth}px wide")
+    }
+    
+    /**
+     * Refresh the overlay with the most recent frame, every UI tick while visible
+     */
+    override suspend fun refresh() {
+        val frame = Profiler.lastFrame
+        if (isVisible && frame !== shownFrame) displayFrame(frame)
+    }
+    
+    /**
+     * Limit how deep the zone tree is expanded
+     */
+    suspend fun setMaxDepth(depth: Int) {
+        maxDepth = depth.coerceAtLeast(1)
+        println("DesktopProfilerUI: Showing zones up to depth $maxDepth")
+    }
+    
+    /**
+     * Export the recorded events as Chrome trace JSON
+     */
+    suspend fun exportChromeTrace(file: File): File = withContext(Dispatchers.IO) {
+        ChromeTraceExporter.exportTo(file).also {
+            println("DesktopProfilerUI: Exported Chrome trace to ${it.absolutePath}")
+        }
+    }
+    
+    private fun displayFrame(frame: FrameProfile?) {
+        shownFrame = frame
+        println("DesktopProfilerUI: ┌─── Frame Timers ───┐")
+        if (frame == null) {
+            println("DesktopProfilerUI: │ No frames recorded yet")
+        } else {
+            frame.format(maxDepth).lineSequence().filter { it.isNotEmpty() }.forEach { line ->
+                println("DesktopProfilerUI: │ $line")
+            }
+        }
+        
+        // GC and allocation activity since the previous refresh
+        val sample = AllocationMonitor.sample()
+        lastAllocation?.let { previous ->
+            println("DesktopProfilerUI: │ Memory ${sample.since(previous).format()}")
+        }
+        lastAllocation = sample
+        println("DesktopProfilerUI: └────────────────────┘")
+    }
+}
+
 /**
  * Desktop Layout Manager - Handles desktop windowing system
  */
@@ -618,7 +897,7 @@ class DesktopLayoutManager : LayoutManager() {
 
 data class ChatTab(
     val name: String,
-    val messages: MutableList<ChatMessage>
+    val transcript: ChatTranscript = ChatTranscript()
 )
 
 data class WindowStyle(
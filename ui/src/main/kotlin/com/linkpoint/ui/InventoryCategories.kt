@@ -0,0 +1,13 @@
+package com.linkpoint.ui
+
+/**
+ * Inventory UI category names and the asset type codes they stand for
+ */
+internal object InventoryCategories {
+    // Asset type codes from the inventory protocol
+    private val ASSET_TYPES = mapOf("Clothing" to 5, "Objects" to 6, "Body Parts" to 13, "Animations" to 20)
+
+    fun assetType(category: String): Int? = ASSET_TYPES[category]
+
+    fun name(assetType: Int): String = ASSET_TYPES.entries.firstOrNull { it.value == assetType }?.key ?: "Other"
+}
@@ -1,7 +1,27 @@
 package com.linkpoint.ui
 
+import com.linkpoint.assets.maptiles.MapTileDraw
+import com.linkpoint.assets.maptiles.MapTileManager
+import com.linkpoint.assets.maptiles.MapViewport
+import com.linkpoint.assets.prefetch.RegionManifestStore
+import com.linkpoint.core.profiling.ChromeTraceExporter
+import com.linkpoint.core.profiling.FrameProfile
+import com.linkpoint.core.profiling.Profiler
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.inventory.InventoryFolderInfo
+import com.linkpoint.protocol.inventory.InventoryIndex
+import com.linkpoint.protocol.inventory.InventoryItemInfo
+import com.linkpoint.protocol.inventory.InventorySortOrder
+import com.linkpoint.protocol.inventory.InventoryStore
+import com.linkpoint.protocol.names.NameService
+import com.linkpoint.ui.chat.ChatTranscript
+import com.linkpoint.ui.teleport.TeleportPrefetcher
+import com.linkpoint.ui.teleport.TeleportSource
+import com.linkpoint.ui.teleport.Teleporter
 import kotlinx.coroutines.*
 import kotlinx.coroutines.flow.*
+import java.io.File
+import java.util.UUID
 
 /**
  * Mobile UI Components
@@ -24,7 +44,9 @@ class MobileChatUI(private val isPhone: Boolean) : UIComponent() {
     
     private var isVisible = false
     private var currentChannel = "Local"
-    private val messages = mutableListOf<ChatMessage>()
+    private val transcript = ChatTranscript()
+    /** Current transcript; a new version is published on every message */
+    val messages get() = transcript.messages
     private val _newMessage = MutableSharedFlow<ChatMessage>()
     val newMessage = _newMessage.asSharedFlow()
     
@@ -95,7 +117,7 @@ class MobileChatUI(private val isPhone: Boolean) : UIComponent() {
             sender = "LocalUser"
         )
         
-        messages.add(chatMessage)
+        transcript.append(chatMessage)
         _newMessage.emit(chatMessage)
         
         println("MobileChatUI: Sent message to $channel: $message")
@@ -113,7 +135,7 @@ class MobileChatUI(private val isPhone: Boolean) : UIComponent() {
      * Handle incoming chat message
      */
     suspend fun receiveMessage(message: ChatMessage) {
-        messages.add(message)
+        transcript.append(message)
         _newMessage.emit(message)
         
         // Auto-show chat panel for new messages if hidden
@@ -145,16 +167,25 @@ class MobileChatUI(private val isPhone: Boolean) : UIComponent() {
  * - Category-based browsing with large, clear icons
  * - Drag-and-drop with haptic feedback
  * - Search functionality with voice input support
+ * - Item creators by display name, through [names]
  */
-class MobileInventoryUI(private val isPhone: Boolean) : UIComponent() {
+class MobileInventoryUI(
+    private val isPhone: Boolean,
+    private val store: InventoryStore = InventoryStore(),
+    private val names: NameService? = null
+) : UIComponent() {
     
     private var isVisible = false
     private var currentCategory = "All"
-    private val items = mutableMapOf<String, InventoryItem>()
+    private val index = InventoryIndex(store)
+    private val matcher = index.matcher()
+    
+    /** Slots shown in the grid for [currentCategory], in name order */
+    private var visibleSlots = IntArray(0)
     
     init {
         // Initialize with sample inventory items
-        initializeSampleInventory()
+        if (store.itemCount == 0) initializeSampleInventory()
     }
     
     override suspend fun applyTheme(theme: UITheme) {
@@ -182,24 +213,33 @@ class MobileInventoryUI(private val isPhone: Boolean) : UIComponent() {
     }
     
     /**
-     * Filter inventory by category
+     * Filter inventory by category; a copy of a prebuilt type bucket, so it
+     * stays well within a frame at 200k items
      */
     suspend fun filterByCategory(category: String) {
         currentCategory = category
-        val filteredCount = items.values.count { 
-            category == "All" || it.category == category 
+        val assetType = InventoryCategories.assetType(category)
+        visibleSlots = when {
+            category == "All" -> index.sorted(InventorySortOrder.NAME)
+            assetType != null -> index.ofType(assetType)
+            else -> IntArray(0)
         }
+        matcher.reset()
         
-        println("MobileInventoryUI: Filtered to $category category ($filteredCount items)")
+        println("MobileInventoryUI: Filtered to $category category (${visibleSlots.size} items)")
     }
     
     /**
-     * Search inventory items
+     * Search item names and descriptions within the current category; each
+     * keystroke refines the previous results
      */
-    suspend fun searchItems(query: String): List<InventoryItem> {
-        val results = items.values.filter { item ->
-            item.name.contains(query, ignoreCase = true) ||
-            item.description.contains(query, ignoreCase = true)
+    suspend fun searchItems(query: String, limit: Int = PAGE_SIZE): List<InventoryItem> {
+        val assetType = InventoryCategories.assetType(currentCategory)
+        val found = withContext(Dispatchers.Default) { index.items(matcher.match(query, assetType), limit = limit) }
+        // One batched lookup for the page's creators
+        val creators = names?.getAll(found.map { it.creatorId }.filterNot { it == NO_CREATOR }).orEmpty()
+        val results = found.map {
+            InventoryItem(it.name, InventoryCategories.name(it.assetType), it.description, creators[it.creatorId]?.displayName ?: "")
         }
         
         println("MobileInventoryUI: Search '$query' returned ${results.size} results")
@@ -210,7 +250,7 @@ class MobileInventoryUI(private val isPhone: Boolean) : UIComponent() {
      * Wear/attach an item
      */
     suspend fun wearItem(itemId: String) {
-        val item = items[itemId]
+        val item = runCatching { UUID.fromString(itemId) }.getOrNull()?.let { store.item(it) }
         if (item != null) {
             println("MobileInventoryUI: Wearing item: ${item.name}")
             // Simulate haptic feedback
@@ -219,17 +259,34 @@ class MobileInventoryUI(private val isPhone: Boolean) : UIComponent() {
     }
     
     private fun initializeSampleInventory() {
-        items["shirt1"] = InventoryItem("Blue Shirt", "Clothing", "A comfortable blue shirt")
-        items["pants1"] = InventoryItem("Black Pants", "Clothing", "Stylish black pants")
-        items["hair1"] = InventoryItem("Blonde Hair", "Body Parts", "Long blonde hair")
-        items["sword1"] = InventoryItem("Magic Sword", "Objects", "A mystical glowing sword")
-        items["dance1"] = InventoryItem("Dance Animation", "Animations", "Smooth dance moves")
+        val folder = UUID.nameUUIDFromBytes("My Inventory".toByteArray())
+        store.putFolder(InventoryFolderInfo(folder, null, "My Inventory"))
+        listOf(
+            Triple("Blue Shirt", "Clothing", "A comfortable blue shirt"),
+            Triple("Black Pants", "Clothing", "Stylish black pants"),
+            Triple("Blonde Hair", "Body Parts", "Long blonde hair"),
+            Triple("Magic Sword", "Objects", "A mystical glowing sword"),
+            Triple("Dance Animation", "Animations", "Smooth dance moves")
+        ).forEach { (name, category, description) ->
+            store.putItem(InventoryItemInfo(
+                id = UUID.nameUUIDFromBytes(name.toByteArray()),
+                parentId = folder,
+                name = name,
+                description = description,
+                assetType = InventoryCategories.assetType(category)!!
+            ))
+        }
     }
     
     private suspend fun simulateHapticFeedback() {
         println("MobileInventoryUI: *haptic feedback*")
         delay(50)
     }
+    
+    companion object {
+        private const val PAGE_SIZE = 200
+        private val NO_CREATOR = UUID(0L, 0L)
+    }
 }
 
 /**
@@ -325,13 +382,26 @@ class MobileCameraUI(private val isPhone: Boolean) : UIComponent() {
 
 /**
  * Mobile World Map UI - Full-screen map with touch navigation
+ *
+ * [tiles] comes from the platform: it decodes with the platform's image
+ * codec and caches in the app's cache directory. Teleports picked on the
+ * map go through [teleporter], within [rlv]'s @tploc, with the destination
+ * warmed by [prefetcher] while the user confirms
  */
-class MobileWorldMapUI(private val isPhone: Boolean) : UIComponent() {
+class MobileWorldMapUI(
+    private val isPhone: Boolean,
+    private val tiles: MapTileManager,
+    private val prefetcher: TeleportPrefetcher? = null,
+    private val teleporter: Teleporter? = null,
+    private val rlv: RLVProcessor? = null
+) : UIComponent() {
     
     private var isVisible = false
     private var mapZoom = 1.0f
-    private var mapCenterX = 128.0f
-    private var mapCenterY = 128.0f
+    // Region grid coordinates of the view centre
+    private var mapCenterX = 1000.5
+    private var mapCenterY = 1000.5
+    private var screenSize = ScreenSize(if (isPhone) 1080 else 1600, if (isPhone) 1920 else 2560)
     
     override suspend fun applyTheme(theme: UITheme) {
         println("MobileWorldMapUI: Applied ${theme.name} theme")
@@ -340,6 +410,7 @@ class MobileWorldMapUI(private val isPhone: Boolean) : UIComponent() {
     override suspend fun show() {
         isVisible = true
         println("MobileWorldMapUI: Showing full-screen world map")
+        render()
     }
     
     override suspend fun hide() {
@@ -348,37 +419,78 @@ class MobileWorldMapUI(private val isPhone: Boolean) : UIComponent() {
     }
     
     override suspend fun updateLayout(screenSize: ScreenSize) {
+        this.screenSize = screenSize
         println("MobileWorldMapUI: Full-screen map ${screenSize.width}x${screenSize.height}")
     }
     
     /**
-     * Handle map pan
+     * Handle map pan by a finger drag of ([deltaX], [deltaY]) pixels
      */
-    suspend fun panMap(deltaX: Float, deltaY: Float) {
-        mapCenterX += deltaX
-        mapCenterY += deltaY
+    suspend fun panMap(deltaX: Float, deltaY: Float): List<MapTileDraw> {
+        val pixelsPerRegion = pixelsPerRegion()
+        // Dragging right moves the map east under the finger; screen y runs south
+        mapCenterX -= deltaX / pixelsPerRegion
+        mapCenterY += deltaY / pixelsPerRegion
         
-        println("MobileWorldMapUI: Map panned to ($mapCenterX, $mapCenterY)")
+        println("MobileWorldMapUI: Map panned to (${"%.2f".format(mapCenterX)}, ${"%.2f".format(mapCenterY)})")
+        return render()
     }
     
     /**
      * Handle map zoom
      */
-    suspend fun zoomMap(scaleFactor: Float) {
+    suspend fun zoomMap(scaleFactor: Float): List<MapTileDraw> {
         mapZoom *= scaleFactor
         mapZoom = mapZoom.coerceIn(0.1f, 10.0f)
         
         println("MobileWorldMapUI: Map zoomed to $mapZoom")
+        return render()
     }
     
+    fun viewport() = MapViewport(mapCenterX, mapCenterY, screenSize.width, screenSize.height, pixelsPerRegion())
+    
+    private fun pixelsPerRegion() = BASE_PIXELS_PER_REGION * mapZoom
+    
     /**
-     * Teleport to location (with confirmation)
+     * Request tiles for the current view and pick what to draw; cells whose
+     * tile is still loading show a scaled-up coarser tile
      */
-    suspend fun teleportTo(x: Float, y: Float) {
+    private fun render(): List<MapTileDraw> {
+        val viewport = viewport()
+        tiles.update(viewport)
+        val draws = tiles.visibleTiles(viewport)
+        val coarse = draws.count { it.isFallback }
+        val blank = viewport.tiles().size - draws.size
+        println("MobileWorldMapUI: ${draws.size} map tiles at level ${viewport.level} ($coarse coarse, $blank loading)")
+        return draws
+    }
+    
+    /**
+     * Teleport to ([x], [y]) in region grid coordinates, with confirmation
+     *
+     * @return false if RLV forbids it or there is no session to teleport
+     */
+    suspend fun teleportTo(x: Float, y: Float): Boolean {
         println("MobileWorldMapUI: Teleport requested to ($x, $y)")
+        if (rlv?.isRestricted(RLVProcessor.RLVCommand.TPLOC) == true) {
+            println("MobileWorldMapUI: Teleport to locations is restricted")
+            return false
+        }
+        val regionHandle = RegionManifestStore.regionHandle(x.toInt(), y.toInt())
+        // Start pulling the destination's assets while the user confirms
+        prefetcher?.onTeleportIntent(regionHandle, TeleportSource.MAP)
         println("MobileWorldMapUI: Showing confirmation dialog...")
         delay(1000) // Simulate user confirmation
-        println("MobileWorldMapUI: Teleport confirmed - initiating teleport")
+        // The simulator puts the agent on the ground below the point picked
+        val requested = teleporter?.teleport(regionHandle, (x % 1f) * REGION_METRES, (y % 1f) * REGION_METRES, 0f) == true
+        println("MobileWorldMapUI: Teleport ${if (requested) "confirmed - initiating teleport" else "unavailable"}")
+        return requested
+    }
+    
+    companion object {
+        // At zoom 1 a 256-pixel tile spans four regions
+        private const val BASE_PIXELS_PER_REGION = 64.0
+        private const val REGION_METRES = 256f
     }
 }
 
@@ -434,6 +546,68 @@ class MobileAvatarUI(private val isPhone: Boolean) : UIComponent() {
     }
 }
 
+/**
+ * Mobile Profiler UI - Compact frame-time overlay
+ * 
+ * Shows only the heaviest top-level zones of the last frame so the overlay
+ * stays readable on a phone; the full tree is available via trace export.
+ */
+class MobileProfilerUI(private val isPhone: Boolean) : UIComponent() {
+    
+    private var isVisible = false
+    // Ticks without a new frame leave the overlay as it is
+    private var shownFrame: FrameProfile? = null
+    
+    override suspend fun applyTheme(theme: UITheme) {
+        println("MobileProfilerUI: Applied ${theme.name} theme")
+    }
+    
+    override suspend fun show() {
+        isVisible = true
+        Profiler.isEnabled = true
+        println("MobileProfilerUI: Showing frame-time overlay")
+        shownFrame = null
+        refresh()
+    }
+    
+    override suspend fun hide() {
+        isVisible = false
+        Profiler.isEnabled = false
+        println("MobileProfilerUI: Hiding frame-time overlay")
+    }
+    
+    override suspend fun updateLayout(screenSize: ScreenSize) {
+        println("MobileProfilerUI: Overlay anchored top-left on ${screenSize.width}x${screenSize.height}")
+    }
+    
+    /**
+     * Refresh the overlay with the most recent frame, every UI tick while visible
+     */
+    override suspend fun refresh() {
+        if (!isVisible) return
+        val frame = Profiler.lastFrame ?: return
+        if (frame === shownFrame) return
+        shownFrame = frame
+        val topZones = if (isPhone) 3 else 6
+        
+        println("MobileProfilerUI: Frame ${"%.1f".format(frame.durationMs)}ms")
+        frame.threads
+            .flatMap { it.root.children }
+            .sortedByDescending { it.inclusiveNanos }
+            .take(topZones)
+            .forEach { node ->
+                println("MobileProfilerUI:   ${node.name} ${"%.2f".format(node.inclusiveNanos / 1_000_000.0)}ms")
+            }
+    }
+    
+    /**
+     * Export the recorded events as Chrome trace JSON (e.g. to share from the device)
+     */
+    suspend fun exportChromeTrace(file: File): File = withContext(Dispatchers.IO) {
+        ChromeTraceExporter.exportTo(file)
+    }
+}
+
 /**
  * Mobile Layout Manager - Handles mobile-specific layout logic
  */
@@ -462,7 +636,9 @@ data class ChatMessage(
     val text: String,
     val channel: String,
     val timestamp: Long,
-    val sender: String
+    val sender: String,
+    /** The speaking avatar, for name lookups and RLV exceptions; null for objects and the system */
+    val senderId: UUID? = null
 )
 
 data class ChatColors(
@@ -474,7 +650,9 @@ data class ChatColors(
 data class InventoryItem(
     val name: String,
     val category: String,
-    val description: String
+    val description: String,
+    /** Creator's display name, or empty if unknown */
+    val creator: String = ""
 )
 
 enum class CameraMode {
@@ -1,7 +1,15 @@
 package com.linkpoint.ui
 
+import com.linkpoint.assets.maptiles.HttpMapTileSource
+import com.linkpoint.assets.maptiles.MapTileDiskCache
+import com.linkpoint.assets.maptiles.MapTileManager
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.names.NameService
+import com.linkpoint.ui.teleport.TeleportPrefetcher
+import com.linkpoint.ui.teleport.Teleporter
 import kotlinx.coroutines.*
 import kotlinx.coroutines.flow.*
+import java.io.File
 
 /**
  * Multi-Platform UI Framework
@@ -28,6 +36,15 @@ class UIFramework private constructor() {
                 INSTANCE ?: UIFramework().also { INSTANCE = it }
             }
         }
+        
+        /** Desktop chat log location when the host doesn't provide one */
+        val DEFAULT_CHAT_HISTORY_DIRECTORY = File(System.getProperty("user.home"), ".linkpoint/cache/chat")
+        
+        /** Desktop map tile cache location when the host doesn't provide a tile manager */
+        val DEFAULT_MAP_CACHE_DIRECTORY = File(System.getProperty("user.home"), ".linkpoint/cache/map")
+        
+        /** How often components redraw live content, e.g. the profiler overlay */
+        const val UI_TICK_MS = 250L
     }
     
     private val _platformType = MutableStateFlow(PlatformType.UNKNOWN)
@@ -44,10 +61,19 @@ class UIFramework private constructor() {
     
     private val coroutineScope = CoroutineScope(Dispatchers.Main + SupervisorJob())
     
+    // Platform pieces for the components; kept for re-initialising on rotation
+    private var services: UIServices? = null
+    
+    private var uiTick: Job? = null
+    
     /**
      * Initialize the UI framework with platform detection
+     * 
+     * @param services platform-provided pieces; mobile components that need
+     *   them (the world map) are left out without
      */
-    suspend fun initialize(screenWidth: Int, screenHeight: Int): Boolean {
+    suspend fun initialize(screenWidth: Int, screenHeight: Int, services: UIServices? = null): Boolean {
+        this.services = services
         return try {
             // Detect platform type based on screen size and capabilities
             val detectedPlatform = detectPlatform(screenWidth, screenHeight)
@@ -56,6 +82,7 @@ class UIFramework private constructor() {
             
             // Initialize platform-specific components
             initializePlatformComponents(detectedPlatform)
+            startUiTick()
             
             println("UIFramework initialized for ${detectedPlatform.name} platform")
             println("Screen size: ${screenWidth}x${screenHeight}")
@@ -104,17 +131,20 @@ class UIFramework private constructor() {
         registerComponent("chat", MobileChatUI(isPhone))
         
         // Inventory UI - grid-based browser
-        registerComponent("inventory", MobileInventoryUI(isPhone))
+        registerComponent("inventory", MobileInventoryUI(isPhone, names = services?.names))
         
         // Camera UI - gesture-based controls
         registerComponent("camera", MobileCameraUI(isPhone))
         
         // World Map UI - full-screen with touch navigation
-        registerComponent("worldmap", MobileWorldMapUI(isPhone))
+        services?.let { registerComponent("worldmap", MobileWorldMapUI(isPhone, it.mapTiles, it.teleportPrefetcher, it.teleporter, it.rlv)) }
         
         // Avatar UI - mobile-optimized appearance controls
         registerComponent("avatar", MobileAvatarUI(isPhone))
         
+        // Profiler UI - compact frame-time overlay
+        registerComponent("profiler", MobileProfilerUI(isPhone))
+        
         // Create mobile layout manager
         _layouts["main"] = MobileLayoutManager(isPhone)
         
@@ -125,8 +155,10 @@ class UIFramework private constructor() {
      * Initialize desktop-specific UI components
      */
     private suspend fun initializeDesktopComponents() {
-        // Chat UI - traditional windowed interface
-        registerComponent("chat", DesktopChatUI())
+        // Chat UI - traditional windowed interface, with earlier sessions searchable
+        val chat = DesktopChatUI(services?.chatHistoryDirectory ?: DEFAULT_CHAT_HISTORY_DIRECTORY)
+        chat.loadHistory()
+        registerComponent("chat", chat)
         
         // Inventory UI - tree-view with detailed controls
         registerComponent("inventory", DesktopInventoryUI())
@@ -134,12 +166,17 @@ class UIFramework private constructor() {
         // Camera UI - mouse and keyboard controls
         registerComponent("camera", DesktopCameraUI())
         
-        // World Map UI - resizable window with advanced features
-        registerComponent("worldmap", DesktopWorldMapUI())
+        // World Map UI - resizable window with advanced features; the host's tiles, else its own
+        val worldMap = services?.let { DesktopWorldMapUI(it.mapTiles) }
+            ?: DesktopWorldMapUI(MapTileManager(HttpMapTileSource(), MapTileDiskCache(DEFAULT_MAP_CACHE_DIRECTORY)), ownsTiles = true)
+        registerComponent("worldmap", worldMap)
         
         // Avatar UI - comprehensive appearance editor
         registerComponent("avatar", DesktopAvatarUI())
         
+        // Profiler UI - fast-timer style zone tree
+        registerComponent("profiler", DesktopProfilerUI())
+        
         // Create desktop layout manager
         _layouts["main"] = DesktopLayoutManager()
         
@@ -191,7 +228,7 @@ class UIFramework private constructor() {
         // Reinitialize if platform type changed
         if (oldPlatform != newPlatform) {
             _platformType.value = newPlatform
-            _components.clear()
+            closeComponents()
             _layouts.clear()
             initializePlatformComponents(newPlatform)
             println("Platform changed from $oldPlatform to $newPlatform")
@@ -201,6 +238,17 @@ class UIFramework private constructor() {
         }
     }
     
+    // Components are refreshed on a UI tick rather than per rendered frame, off the render thread
+    private fun startUiTick() {
+        if (uiTick?.isActive == true) return
+        uiTick = coroutineScope.launch {
+            while (isActive) {
+                delay(UI_TICK_MS)
+                _components.values.toList().forEach { it.refresh() }
+            }
+        }
+    }
+    
     /**
      * Get the current layout manager
      */
@@ -213,12 +261,36 @@ class UIFramework private constructor() {
      */
     fun shutdown() {
         coroutineScope.cancel()
-        _components.clear()
+        closeComponents()
         _layouts.clear()
         println("UIFramework shutdown complete")
     }
+    
+    // Release what components hold open (e.g. the chat history files, the map tile loader) before dropping them
+    private fun closeComponents() {
+        _components.values.filterIsInstance<AutoCloseable>().forEach { it.close() }
+        _components.clear()
+    }
 }
 
+/**
+ * What the platform provides to the UI components, since the framework can't
+ * build these portably
+ */
+data class UIServices(
+    /** World map tiles, decoded with the platform's codec and cached in the app's cache directory */
+    val mapTiles: MapTileManager,
+    /** Warms the caches for a teleport picked on the map */
+    val teleportPrefetcher: TeleportPrefetcher? = null,
+    /** Performs teleports picked on the map, within [rlv]'s @tploc */
+    val teleporter: Teleporter? = null,
+    val rlv: RLVProcessor? = null,
+    /** Avatar names, e.g. for inventory creators */
+    val names: NameService? = null,
+    /** Where desktop chat is logged; [UIFramework.DEFAULT_CHAT_HISTORY_DIRECTORY] without */
+    val chatHistoryDirectory: File? = null
+)
+
 /**
  * Platform types supported by the UI framework
  */
@@ -275,6 +347,11 @@ abstract class UIComponent {
      * Update component layout for screen size changes
      */
     abstract suspend fun updateLayout(screenSize: ScreenSize)
+    
+    /**
+     * Redraw live content while shown; called every [UIFramework.UI_TICK_MS]
+     */
+    open suspend fun refresh() {}
 }
 
 /**
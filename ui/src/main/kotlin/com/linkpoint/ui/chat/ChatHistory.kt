@@ -0,0 +1,95 @@
+package com.linkpoint.ui.chat
+
+import com.linkpoint.ui.ChatMessage
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.flow
+import kotlinx.coroutines.flow.flowOn
+import java.io.File
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Persistent chat history: one [ChatLog] per conversation under [directory],
+ * with search across all of them.
+ */
+class ChatHistory(
+    val directory: File,
+    private val recentWindow: Int = ChatLog.DEFAULT_RECENT_WINDOW
+) : AutoCloseable {
+
+    private val logs = ConcurrentHashMap<String, ChatLog>()
+
+    /**
+     * The log for [conversation], opened on first use
+     */
+    fun log(conversation: String): ChatLog = logs.computeIfAbsent(conversation) {
+        ChatLog(File(directory, fileName(conversation)), conversation, recentWindow = recentWindow)
+    }
+
+    /**
+     * Open every conversation already logged under [directory] so that
+     * searches cover them; replays their active segments, so call off the UI
+     * thread
+     */
+    fun openExisting() {
+        directory.listFiles { file -> file.isDirectory }.orEmpty().forEach { dir ->
+            val name = File(dir, ChatLog.NAME_FILE).takeIf { it.exists() }?.readText() ?: return@forEach
+            log(name)
+        }
+    }
+
+    fun append(message: ChatMessage): Int = log(message.channel).append(message)
+
+    /**
+     * Search every opened conversation, emitting pages of up to [pageSize]
+     * messages, newest first. Each log is read a page at a time and the logs
+     * are merged by timestamp, so collecting only the first page touches only
+     * the newest matches.
+     */
+    fun search(query: String, pageSize: Int = ChatLog.DEFAULT_PAGE_SIZE): Flow<List<ChatMessage>> = flow {
+        val cursors = logs.values.map { Cursor(it, query, pageSize) }
+        val page = ArrayList<ChatMessage>(pageSize)
+        while (true) {
+            val next = cursors.filter { it.peek() != null }.maxByOrNull { it.peek()!!.message.timestamp } ?: break
+            page += next.take().message
+            if (page.size == pageSize) {
+                emit(page.toList())
+                page.clear()
+            }
+        }
+        if (page.isNotEmpty()) emit(page.toList())
+    }.flowOn(Dispatchers.IO)
+
+    override fun close() {
+        logs.values.forEach { it.close() }
+        logs.clear()
+    }
+
+    /**
+     * Pages through one log's hits
+     */
+    private class Cursor(private val log: ChatLog, private val query: String, private val pageSize: Int) {
+        private var buffer: List<ChatLogHit> = emptyList()
+        private var position = 0
+        private var exhausted = false
+
+        fun peek(): ChatLogHit? {
+            if (position == buffer.size && !exhausted) {
+                val before = buffer.lastOrNull()?.id ?: Int.MAX_VALUE
+                buffer = log.search(query, before, pageSize)
+                position = 0
+                exhausted = buffer.size < pageSize
+            }
+            return buffer.getOrNull(position)
+        }
+
+        fun take(): ChatLogHit = peek()!!.also { position++ }
+    }
+
+    companion object {
+        // Conversation names come from tab titles and avatar names
+        private fun fileName(conversation: String): String =
+            conversation.map { if (it.isLetterOrDigit() || it == '-' || it == '_') it else '_' }.joinToString("") +
+                "-" + Integer.toHexString(conversation.hashCode())
+    }
+}
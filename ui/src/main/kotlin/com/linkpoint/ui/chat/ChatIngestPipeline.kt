@@ -0,0 +1,248 @@
+package com.linkpoint.ui.chat
+
+import com.linkpoint.core.events.EventSystem
+import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.core.util.TokenBucket
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.names.NameService
+import com.linkpoint.ui.ChatMessage
+import kotlinx.coroutines.CoroutineDispatcher
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.channels.BufferOverflow
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.MutableSharedFlow
+import kotlinx.coroutines.flow.SharedFlow
+import kotlinx.coroutines.flow.asSharedFlow
+import kotlinx.coroutines.flow.filterIsInstance
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.withTimeoutOrNull
+import mu.KotlinLogging
+import java.util.concurrent.ConcurrentHashMap
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Names whose chat is dropped before it reaches the UI, compared case-insensitively
+ */
+class MuteList {
+    private val muted = ConcurrentHashMap.newKeySet<String>()
+
+    fun mute(name: String) { muted += name.lowercase() }
+    fun unmute(name: String) { muted -= name.lowercase() }
+    fun isMuted(name: String): Boolean = name.lowercase() in muted
+    val size: Int get() = muted.size
+}
+
+/**
+ * One digested line: [message] repeated [repeatCount] times in a row
+ */
+data class ChatLine(
+    val message: ChatMessage,
+    val repeatCount: Int = 1,
+    /**
+     * The line last handed out for the same text, when this is a later repeat
+     * of it; the UI replaces that line instead of appending
+     */
+    val replaces: ChatMessage? = null
+) {
+    /** Message as displayed, with a "×12" suffix for repeats; the same instance on every read */
+    val display: ChatMessage =
+        if (repeatCount == 1) message else message.copy(text = "${message.text} ×$repeatCount")
+}
+
+/**
+ * Chat digested during one frame
+ */
+data class ChatBatch(
+    val lines: List<ChatLine>,
+    /** Messages dropped by per-source rate limits */
+    val rateLimited: Int,
+    /** Messages dropped because the sender is muted */
+    val muted: Int
+)
+
+/**
+ * Background chat ingest stage between the network and the chat UI.
+ *
+ * Incoming chat is queued and processed off the UI thread in a single pass:
+ * muted senders are dropped, RLV @recvchat hides the text of senders without
+ * an exception, each sender is held to a token-bucket rate, and a line
+ * identical to the sender's previous one is folded into it as a repeat count.
+ * With [names], avatars are shown by display name, looked up once per batch.
+ * The result is handed out as at most one [ChatBatch] per [frameIntervalMs],
+ * so a chat flood costs the UI one append pass per frame instead of one
+ * recomposition per message.
+ *
+ * Based on concepts from:
+ * - Firestorm's chat spam protection (FSAntiSpam) and LLMuteList
+ * - RLVa's @recvchat filtering
+ */
+class ChatIngestPipeline(
+    private val muteList: MuteList = MuteList(),
+    private val rlv: RLVProcessor? = null,
+    private val names: NameService? = null,
+    private val frameIntervalMs: Long = DEFAULT_FRAME_INTERVAL_MS,
+    private val perSourceBurst: Double = DEFAULT_SOURCE_BURST,
+    private val perSourcePerSecond: Double = DEFAULT_SOURCE_PER_SECOND,
+    private val dispatcher: CoroutineDispatcher = Dispatchers.Default,
+    private val clock: () -> Long = System::nanoTime
+) {
+    private val input = Channel<ChatMessage>(INPUT_CAPACITY, BufferOverflow.DROP_OLDEST)
+    private val _batches = MutableSharedFlow<ChatBatch>(extraBufferCapacity = BATCH_BUFFER, onBufferOverflow = BufferOverflow.DROP_OLDEST)
+
+    /** Digested chat, at most one batch per frame */
+    val batches: SharedFlow<ChatBatch> = _batches.asSharedFlow()
+
+    // Only touched by the processing coroutine
+    private val buckets = HashMap<String, TokenBucket>()
+    private val lastLines = HashMap<String, ChatLine>()
+    private var lastEmitted: ChatLine? = null
+
+    /**
+     * Queue [message] for the next batch; never blocks, dropping the oldest
+     * queued message if the queue is full
+     */
+    fun submit(message: ChatMessage) {
+        input.trySend(message)
+    }
+
+    /**
+     * Start processing, fed from [ViewerEvent.ChatReceived] on [events]
+     */
+    fun start(scope: CoroutineScope, events: Flow<ViewerEvent> = EventSystem.events): Job = scope.launch(dispatcher) {
+        launch {
+            events.filterIsInstance<ViewerEvent.ChatReceived>().collect { event ->
+                submit(ChatMessage(
+                    text = event.message,
+                    channel = channelName(event.channel),
+                    timestamp = System.currentTimeMillis(),
+                    sender = event.sender,
+                    senderId = event.senderId
+                ))
+            }
+        }
+        while (isActive) {
+            // Sleep until chat arrives, then give the rest of the frame a chance to arrive too
+            val first = input.receive()
+            delay(frameIntervalMs)
+            val messages = arrayListOf(first)
+            while (true) messages += input.tryReceive().getOrNull() ?: break
+            val batch = BatchBuilder()
+            withDisplayNames(messages).forEach { ingest(it, batch) }
+            batch.build()?.let { _batches.emit(it) }
+        }
+    }
+
+    /**
+     * Run [messages] through the pipeline synchronously, for callers that
+     * already batch per frame
+     */
+    fun process(messages: List<ChatMessage>): ChatBatch? {
+        val batch = BatchBuilder()
+        messages.forEach { ingest(it, batch) }
+        return batch.build()
+    }
+
+    // A slow name lookup falls back to cached names rather than holding chat up
+    private suspend fun withDisplayNames(messages: List<ChatMessage>): List<ChatMessage> {
+        val names = names ?: return messages
+        val ids = messages.mapNotNullTo(HashSet()) { it.senderId }
+        if (ids.isEmpty()) return messages
+        val found = withTimeoutOrNull(NAME_WAIT_MS) { names.getAll(ids) }
+            ?: ids.mapNotNull { id -> names.cached(id)?.let { id to it } }.toMap()
+        return messages.map { message ->
+            message.senderId?.let(found::get)?.let { message.copy(sender = it.displayName) } ?: message
+        }
+    }
+
+    private fun ingest(message: ChatMessage, batch: BatchBuilder) {
+        if (muteList.isMuted(message.sender)) {
+            batch.muted++
+            return
+        }
+        // @recvchat exceptions name avatars by key, not by name
+        val visible = if (rlv?.isRestricted(RLVProcessor.RLVCommand.RECVCHAT, message.senderId?.toString()) == true && !message.text.startsWith("/me")) {
+            message.copy(text = "...")
+        } else {
+            message
+        }
+        val previous = lastLines[message.sender]
+        if (previous != null && previous.message.text == visible.text && batch.canFold(previous)) {
+            // Repeats are folded rather than rate limited, so the count stays accurate
+            batch.repeat(previous)
+            return
+        }
+        // A new line, or a repeat after other chat came in between, which starts a new line
+        val bucket = buckets.getOrPut(message.sender) { TokenBucket(perSourceBurst, perSourcePerSecond, clock) }
+        if (!bucket.tryAcquire()) {
+            batch.rateLimited++
+            return
+        }
+        batch.add(ChatLine(visible))
+        if (buckets.size > MAX_TRACKED_SOURCES) evictIdleSources()
+    }
+
+    private fun evictIdleSources() {
+        buckets.entries.removeIf { it.value.isFull() }
+        lastLines.keys.retainAll(buckets.keys)
+        logger.debug { "Chat ingest tracking ${buckets.size} sources after eviction" }
+    }
+
+    /**
+     * Lines of one batch; a repeat of a line from this batch updates it in
+     * place, a repeat of the last line already handed out replaces it
+     */
+    private inner class BatchBuilder {
+        val lines = ArrayList<ChatLine>()
+        // Index in lines of each sender's newest line in this batch
+        val indexBySender = HashMap<String, Int>()
+        var rateLimited = 0
+        var muted = 0
+
+        fun add(line: ChatLine) {
+            indexBySender[line.message.sender] = lines.size
+            lines += line
+            lastLines[line.message.sender] = line
+        }
+
+        /** Whether a repeat of [previous] can update it rather than add a line */
+        fun canFold(previous: ChatLine): Boolean =
+            isInBatch(previous) || (lines.isEmpty() && lastEmitted === previous)
+
+        fun repeat(previous: ChatLine) {
+            val updated = previous.copy(repeatCount = previous.repeatCount + 1)
+            if (isInBatch(previous)) {
+                lines[indexBySender.getValue(previous.message.sender)] = updated
+                lastLines[previous.message.sender] = updated
+            } else {
+                add(updated.copy(replaces = previous.display))
+            }
+        }
+
+        private fun isInBatch(line: ChatLine): Boolean =
+            indexBySender[line.message.sender]?.let { lines[it] === line } == true
+
+        fun build(): ChatBatch? {
+            if (lines.isEmpty() && rateLimited == 0 && muted == 0) return null
+            lastEmitted = lines.lastOrNull() ?: lastEmitted
+            return ChatBatch(lines.toList(), rateLimited, muted)
+        }
+    }
+
+    companion object {
+        const val DEFAULT_FRAME_INTERVAL_MS = 16L
+        const val DEFAULT_SOURCE_BURST = 10.0
+        const val DEFAULT_SOURCE_PER_SECOND = 2.0
+        private const val INPUT_CAPACITY = 4096
+        private const val BATCH_BUFFER = 16
+        private const val MAX_TRACKED_SOURCES = 1024
+        private const val NAME_WAIT_MS = 500L
+
+        fun channelName(channel: Int): String = if (channel == 0) "Local" else "Channel $channel"
+    }
+}
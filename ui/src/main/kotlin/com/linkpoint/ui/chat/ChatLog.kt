@@ -0,0 +1,478 @@
+package com.linkpoint.ui.chat
+
+import com.linkpoint.ui.ChatMessage
+import mu.KotlinLogging
+import java.io.EOFException
+import java.io.File
+import java.io.IOException
+import java.io.RandomAccessFile
+import java.io.UTFDataFormatException
+import java.nio.ByteBuffer
+import java.nio.channels.FileChannel
+import java.nio.file.Files
+import java.nio.file.StandardCopyOption
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Append-only, segmented on-disk log of one conversation with an inverted
+ * token index for search.
+ *
+ * Messages are numbered from 0 in arrival order and written to segment files
+ * of at most [segmentBytes]; a new segment is started when the active one is
+ * full, and sealed segments are never rewritten. Only the last [recentWindow]
+ * messages are kept in memory; older ones are read back from disk by id.
+ *
+ * The index maps each lower-cased word of the sender and text to the ascending
+ * ids of the messages containing it. The active segment's index is held in
+ * memory and extended on every append; when a segment is sealed its index is
+ * written next to it and memory-mapped, so reopening a log replays only the
+ * active segment (and any sealed segment whose index is missing or stale).
+ * Open the logs off the UI thread.
+ *
+ * Based on concepts from:
+ * - Firestorm's per-conversation chat transcripts (LLLogChat)
+ * - Log-structured storage with inverted-index search (Lucene postings)
+ */
+class ChatLog(
+    val directory: File,
+    val conversation: String,
+    private val segmentBytes: Long = DEFAULT_SEGMENT_BYTES,
+    private val recentWindow: Int = DEFAULT_RECENT_WINDOW
+) : AutoCloseable {
+
+    private val segments = ArrayList<RandomAccessFile>()
+    // One per segment but the last, in the same order
+    private val sealed = ArrayList<SealedSegment>()
+    private var active = ActiveSegment(0)
+    private var count = 0
+
+    private val recent = ArrayDeque<ChatMessage>()
+
+    /** Segments replayed from their records when the log was opened */
+    internal var replayedOnOpen = 0
+        private set
+
+    init {
+        require(segmentBytes <= Int.MAX_VALUE) { "Segment offsets are stored as 32-bit values" }
+        directory.mkdirs()
+        File(directory, NAME_FILE).takeUnless { it.exists() }?.writeText(conversation)
+        val existing = directory.listFiles { file -> file.name.endsWith(SEGMENT_SUFFIX) }.orEmpty().sortedBy { it.name }
+        existing.forEachIndexed { index, file ->
+            openSegment(file)
+            val isLast = index == existing.lastIndex
+            val loaded = if (isLast) null else loadIndex(index)
+            if (loaded != null) {
+                sealed += loaded
+                count += loaded.size
+            } else {
+                replaySegment(index, remember = isLast)
+                if (!isLast) sealed += seal(index)
+            }
+        }
+        if (segments.isEmpty()) openSegment(segmentFile(0))
+        fillRecent()
+        if (count > 0) logger.debug { "Reopened chat log '$conversation': $count messages in ${segments.size} segments, $replayedOnOpen replayed" }
+    }
+
+    /** Number of messages in the log */
+    val size: Int @Synchronized get() = count
+
+    /**
+     * Append [message] and index it
+     *
+     * @return the message id
+     */
+    @Synchronized
+    fun append(message: ChatMessage): Int {
+        var segment = segments.last()
+        if (segment.length() >= segmentBytes) {
+            sealed += seal(segments.size - 1)
+            segment = openSegment(segmentFile(segments.size))
+            active = ActiveSegment(count)
+        }
+
+        val offset = segment.length()
+        segment.seek(offset)
+        segment.writeLong(message.timestamp)
+        segment.writeUTF(message.sender)
+        segment.writeUTF(message.text)
+
+        remember(message)
+        return addMessage(message, offset)
+    }
+
+    /** The most recent messages, oldest first */
+    @Synchronized
+    fun recent(): List<ChatMessage> = recent.toList()
+
+    /** Read message [id], from memory if it is recent and otherwise from disk */
+    @Synchronized
+    fun read(id: Int): ChatMessage {
+        require(id in 0 until count) { "No message $id in '$conversation'" }
+        val recentIndex = id - (count - recent.size)
+        if (recentIndex >= 0) return recent[recentIndex]
+        return readFromDisk(id)
+    }
+
+    /**
+     * Messages containing every word of [query], newest first, limited to
+     * [limit] results with ids below [beforeId]; pass the last hit's id as
+     * [beforeId] to fetch the next page.
+     *
+     * Segments are walked newest first. Within each, candidates are taken
+     * from the rarest word's postings, walking backwards, and checked against
+     * the other words by binary search, so a page costs
+     * O(segments + limit x words x log n) regardless of log size.
+     */
+    @Synchronized
+    fun search(query: String, beforeId: Int = Int.MAX_VALUE, limit: Int = DEFAULT_PAGE_SIZE): List<ChatLogHit> {
+        val words = tokenize(query).distinct()
+        if (words.isEmpty()) return emptyList()
+
+        val hits = ArrayList<ChatLogHit>()
+        for (segment in sealed.size downTo 0) {
+            if (hits.size >= limit) break
+            val index: SegmentIndex = if (segment == sealed.size) active else sealed[segment]
+            if (index.firstId >= beforeId) continue
+            val lists = words.mapNotNull { index.postings(it) }.sortedBy { it.size }
+            if (lists.size < words.size) continue
+            val rarest = lists[0]
+            val others = lists.subList(1, lists.size)
+
+            var position = rarest.lowerBound(beforeId) - 1
+            while (position >= 0 && hits.size < limit) {
+                val id = rarest[position]
+                if (others.all { it.contains(id) }) hits += ChatLogHit(conversation, id, read(id))
+                position--
+            }
+        }
+        return hits
+    }
+
+    @Synchronized
+    override fun close() {
+        segments.forEach { it.close() }
+        segments.clear()
+    }
+
+    private fun addMessage(message: ChatMessage, offset: Long): Int {
+        val id = count++
+        active.add(id, offset.toInt(), tokenize(message.sender).plus(tokenize(message.text)).distinct())
+        return id
+    }
+
+    private fun remember(message: ChatMessage) {
+        recent.addLast(message)
+        while (recent.size > recentWindow) recent.removeFirst()
+    }
+
+    // After opening, top the recent window up from the sealed segments
+    private fun fillRecent() {
+        val wanted = minOf(recentWindow, count)
+        while (recent.size < wanted) recent.addFirst(readFromDisk(count - recent.size - 1))
+    }
+
+    private fun readFromDisk(id: Int): ChatMessage {
+        val (segment, offset) = if (id >= active.firstId) {
+            segments.last() to active.offset(id)
+        } else {
+            val index = findSealed(id)
+            segments[index] to sealed[index].offset(id)
+        }
+        segment.seek(offset)
+        return readRecord(segment)
+    }
+
+    private fun findSealed(id: Int): Int {
+        var low = 0
+        var high = sealed.size - 1
+        while (low < high) {
+            val mid = (low + high + 1) ushr 1
+            if (sealed[mid].firstId <= id) low = mid else high = mid - 1
+        }
+        return low
+    }
+
+    private fun replaySegment(index: Int, remember: Boolean) {
+        val segment = segments[index]
+        active = ActiveSegment(count)
+        replayedOnOpen++
+        segment.seek(0)
+        while (true) {
+            val offset = segment.filePointer
+            val message = try {
+                readRecord(segment)
+            } catch (e: IOException) {
+                if (e !is EOFException && e !is UTFDataFormatException) throw e
+                // A torn final record from a crash; drop it so appends start clean
+                if (offset < segment.length()) {
+                    logger.warn { "Truncating partial record in $conversation segment $index at $offset" }
+                    segment.setLength(offset)
+                }
+                break
+            }
+            if (remember) remember(message)
+            addMessage(message, offset)
+        }
+    }
+
+    /**
+     * Write the active index for segment [index] next to it and map it back
+     * read-only, so that its postings leave the heap. If the write fails the
+     * index is kept in memory and rebuilt on the next open.
+     */
+    private fun seal(index: Int): SealedSegment {
+        val buffer = active.encode(segments[index].length())
+        val file = indexFile(index)
+        val temp = File(directory, "${file.name}.tmp")
+        return try {
+            temp.outputStream().channel.use { channel ->
+                while (buffer.hasRemaining()) channel.write(buffer)
+            }
+            Files.move(temp.toPath(), file.toPath(), StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE)
+            SealedSegment(map(file))
+        } catch (e: IOException) {
+            logger.warn { "Failed to write chat index ${file.name} for '$conversation': ${e.message}" }
+            temp.delete()
+            SealedSegment(buffer)
+        }
+    }
+
+    /**
+     * Map the index of sealed segment [index] if it covers exactly the
+     * segment's current records and continues the ids read so far
+     *
+     * @return null if the segment must be replayed instead
+     */
+    private fun loadIndex(index: Int): SealedSegment? {
+        val file = indexFile(index)
+        if (!file.isFile || file.length() < INDEX_HEADER_BYTES) return null
+        return try {
+            val header = ByteBuffer.allocate(INDEX_HEADER_BYTES)
+            RandomAccessFile(file, "r").use { raf -> raf.channel.read(header, 0) }
+            val valid = header.getInt(0) == INDEX_MAGIC &&
+                header.getInt(4) == INDEX_VERSION &&
+                header.getLong(8) == segments[index].length() &&
+                header.getInt(16) == count &&
+                SealedSegment.expectedLength(header) == file.length()
+            if (valid) SealedSegment(map(file)) else {
+                logger.info { "Rebuilding stale chat index ${file.name} for '$conversation'" }
+                null
+            }
+        } catch (e: IOException) {
+            logger.warn { "Failed to read chat index ${file.name} for '$conversation': ${e.message}" }
+            null
+        }
+    }
+
+    private fun map(file: File): ByteBuffer = RandomAccessFile(file, "r").use { raf ->
+        raf.channel.map(FileChannel.MapMode.READ_ONLY, 0, raf.length())
+    }
+
+    private fun readRecord(segment: RandomAccessFile): ChatMessage {
+        val timestamp = segment.readLong()
+        val sender = segment.readUTF()
+        val text = segment.readUTF()
+        return ChatMessage(text = text, channel = conversation, timestamp = timestamp, sender = sender)
+    }
+
+    private fun openSegment(file: File): RandomAccessFile =
+        RandomAccessFile(file, "rw").also { segments += it }
+
+    private fun segmentFile(index: Int) = File(directory, "%06d%s".format(index, SEGMENT_SUFFIX))
+
+    private fun indexFile(index: Int) = File(directory, "%06d%s".format(index, INDEX_SUFFIX))
+
+    /**
+     * Ascending message ids for one word
+     */
+    private interface PostingList {
+        val size: Int
+
+        operator fun get(index: Int): Int
+
+        fun contains(id: Int): Boolean {
+            val position = lowerBound(id)
+            return position < size && get(position) == id
+        }
+
+        /** Index of the first id >= [id] */
+        fun lowerBound(id: Int): Int {
+            var low = 0
+            var high = size
+            while (low < high) {
+                val mid = (low + high) ushr 1
+                if (get(mid) < id) low = mid + 1 else high = mid
+            }
+            return low
+        }
+    }
+
+    private class Postings : PostingList {
+        private var ids = IntArray(4)
+        override var size = 0
+            private set
+
+        override operator fun get(index: Int): Int = ids[index]
+
+        fun add(id: Int) {
+            if (size == ids.size) ids = ids.copyOf(size * 2)
+            ids[size++] = id
+        }
+    }
+
+    /**
+     * Record offsets and postings of one segment's messages
+     */
+    private interface SegmentIndex {
+        val firstId: Int
+        val size: Int
+
+        /** Byte offset of message [id] within the segment */
+        fun offset(id: Int): Long
+
+        fun postings(word: String): PostingList?
+    }
+
+    /**
+     * In-memory index of the segment being appended to
+     */
+    private class ActiveSegment(override val firstId: Int) : SegmentIndex {
+        private var offsets = IntArray(64)
+        private val postings = HashMap<String, Postings>()
+        override var size = 0
+            private set
+
+        fun add(id: Int, offset: Int, words: List<String>) {
+            if (size == offsets.size) offsets = offsets.copyOf(size * 2)
+            offsets[size++] = offset
+            words.forEach { word -> postings.getOrPut(word) { Postings() }.add(id) }
+        }
+
+        override fun offset(id: Int): Long = offsets[id - firstId].toLong()
+
+        override fun postings(word: String): PostingList? = postings[word]
+
+        /**
+         * Serialise as a [SealedSegment] index of a segment [segmentLength]
+         * bytes long: header, record offsets, a dictionary sorted by word,
+         * the UTF-8 words, then the postings
+         */
+        fun encode(segmentLength: Long): ByteBuffer {
+            val words = postings.keys.sorted()
+            val names = words.map { it.toByteArray(Charsets.UTF_8) }
+            val nameBytes = names.sumOf { it.size }
+            val postingCount = words.sumOf { postings.getValue(it).size }
+            val dictionaryStart = INDEX_HEADER_BYTES + size * 4
+            var nameOffset = dictionaryStart + words.size * DICTIONARY_ENTRY_BYTES
+            var postingOffset = nameOffset + nameBytes
+
+            val buffer = ByteBuffer.allocate(postingOffset + postingCount * 4)
+            buffer.putInt(INDEX_MAGIC).putInt(INDEX_VERSION).putLong(segmentLength)
+            buffer.putInt(firstId).putInt(size).putInt(words.size).putInt(nameBytes).putInt(postingCount)
+            for (i in 0 until size) buffer.putInt(offsets[i])
+            words.forEachIndexed { i, word ->
+                val ids = postings.getValue(word)
+                buffer.putInt(nameOffset).putInt(names[i].size).putInt(postingOffset).putInt(ids.size)
+                nameOffset += names[i].size
+                postingOffset += ids.size * 4
+            }
+            names.forEach { buffer.put(it) }
+            words.forEach { word ->
+                val ids = postings.getValue(word)
+                for (i in 0 until ids.size) buffer.putInt(ids[i])
+            }
+            buffer.flip()
+            return buffer
+        }
+    }
+
+    /**
+     * Read-only index of a sealed segment, normally memory-mapped from its
+     * index file; words are found by binary search of the sorted dictionary
+     */
+    private class SealedSegment(private val buffer: ByteBuffer) : SegmentIndex {
+        override val firstId = buffer.getInt(16)
+        override val size = buffer.getInt(20)
+        private val wordCount = buffer.getInt(24)
+        private val dictionaryStart = INDEX_HEADER_BYTES + size * 4
+
+        override fun offset(id: Int): Long = buffer.getInt(INDEX_HEADER_BYTES + (id - firstId) * 4).toLong()
+
+        override fun postings(word: String): PostingList? {
+            var low = 0
+            var high = wordCount - 1
+            while (low <= high) {
+                val mid = (low + high) ushr 1
+                val entry = dictionaryStart + mid * DICTIONARY_ENTRY_BYTES
+                val order = word(entry).compareTo(word)
+                when {
+                    order < 0 -> low = mid + 1
+                    order > 0 -> high = mid - 1
+                    else -> return MappedPostings(buffer, buffer.getInt(entry + 8), buffer.getInt(entry + 12))
+                }
+            }
+            return null
+        }
+
+        private fun word(entry: Int): String {
+            val bytes = ByteArray(buffer.getInt(entry + 4))
+            val start = buffer.getInt(entry)
+            for (i in bytes.indices) bytes[i] = buffer.get(start + i)
+            return String(bytes, Charsets.UTF_8)
+        }
+
+        companion object {
+            /** File length implied by an index [header] */
+            fun expectedLength(header: ByteBuffer): Long =
+                INDEX_HEADER_BYTES + header.getInt(20) * 4L + header.getInt(24).toLong() * DICTIONARY_ENTRY_BYTES +
+                    header.getInt(28) + header.getInt(32) * 4L
+        }
+    }
+
+    private class MappedPostings(private val buffer: ByteBuffer, private val start: Int, override val size: Int) : PostingList {
+        override operator fun get(index: Int): Int = buffer.getInt(start + index * 4)
+    }
+
+    companion object {
+        const val DEFAULT_SEGMENT_BYTES = 4L * 1024 * 1024
+        const val DEFAULT_RECENT_WINDOW = 500
+        const val DEFAULT_PAGE_SIZE = 50
+        private const val SEGMENT_SUFFIX = ".chatlog"
+        private const val INDEX_SUFFIX = ".chatidx"
+        private const val INDEX_MAGIC = 0x4C504349 // "LPCI"
+        private const val INDEX_VERSION = 1
+        // Magic, version, segment length, first id, messages, words, name bytes, postings
+        private const val INDEX_HEADER_BYTES = 36
+        // Name offset, name length, postings offset, postings count
+        private const val DICTIONARY_ENTRY_BYTES = 16
+        internal const val NAME_FILE = "conversation.txt"
+
+        /**
+         * Lower-cased words: runs of letters and digits
+         */
+        fun tokenize(text: String): List<String> {
+            val words = ArrayList<String>()
+            var start = -1
+            for (i in 0..text.length) {
+                val isWordChar = i < text.length && text[i].isLetterOrDigit()
+                if (isWordChar && start < 0) start = i
+                if (!isWordChar && start >= 0) {
+                    words += text.substring(start, i).lowercase()
+                    start = -1
+                }
+            }
+            return words
+        }
+    }
+}
+
+/**
+ * One search result
+ */
+data class ChatLogHit(
+    val conversation: String,
+    val id: Int,
+    val message: ChatMessage
+)
@@ -0,0 +1,168 @@
+package com.linkpoint.ui.chat
+
+import com.linkpoint.core.util.ChunkedLog
+import com.linkpoint.ui.ChatMessage
+
+/**
+ * Wrapped layout of one message at one width
+ */
+class TextLayout(
+    val width: Int,
+    /** Character offset where each line starts */
+    val lineStarts: IntArray,
+    val height: Int
+) {
+    val lineCount: Int get() = lineStarts.size
+}
+
+/**
+ * Lays out text at a given width; the platform supplies a font-aware one
+ */
+fun interface TextMeasurer {
+    fun measure(text: String, width: Int): TextLayout
+}
+
+/**
+ * Greedy word wrap for fixed-width glyphs, as used by the console UI
+ */
+class MonospaceTextMeasurer(
+    private val charWidth: Int = 8,
+    private val lineHeight: Int = 16
+) : TextMeasurer {
+    override fun measure(text: String, width: Int): TextLayout {
+        val columns = (width / charWidth).coerceAtLeast(1)
+        val starts = ArrayList<Int>()
+        var lineStart = 0
+        starts += 0
+        while (text.length - lineStart > columns) {
+            val limit = lineStart + columns
+            val space = text.lastIndexOf(' ', limit)
+            lineStart = if (space > lineStart) space + 1 else limit
+            starts += lineStart
+        }
+        return TextLayout(width, starts.toIntArray(), starts.size * lineHeight)
+    }
+}
+
+/**
+ * One laid-out row of a [ChatTranscript] viewport
+ */
+data class TranscriptRow(
+    val sequence: Long,
+    val message: ChatMessage,
+    val layout: TextLayout,
+    /** Top of the row, relative to the top of the viewport */
+    val y: Int
+)
+
+/**
+ * Chat transcript model for virtualised rendering.
+ *
+ * Messages are kept in a [ChunkedLog], so appending during a chat flood is
+ * O(1) and [messages] can be published as state without copying. Layout is
+ * done per message, cached by sequence and width, and only for the rows a
+ * [viewport] actually shows; resizing re-lays out just the visible rows.
+ */
+class ChatTranscript(
+    capacity: Int = ChatLog.DEFAULT_RECENT_WINDOW,
+    private val measurer: TextMeasurer = MonospaceTextMeasurer(),
+    private val layoutCacheSize: Int = DEFAULT_LAYOUT_CACHE_SIZE
+) {
+    @Volatile
+    var messages: ChunkedLog<ChatMessage> = ChunkedLog.empty(capacity)
+        private set
+
+    private val layouts = object : LinkedHashMap<Long, TextLayout>(64, 0.75f, true) {
+        override fun removeEldestEntry(eldest: MutableMap.MutableEntry<Long, TextLayout>?) = size > layoutCacheSize
+    }
+
+    /** Layouts computed since creation, for checking that only visible rows are laid out */
+    var layoutCount = 0L
+        private set
+
+    val size: Int get() = messages.size
+
+    /**
+     * Append [message]
+     *
+     * @return the message dropped to stay within capacity, if any
+     */
+    @Synchronized
+    fun append(message: ChatMessage): ChatMessage? {
+        val before = messages
+        val evicted = if (before.size == before.capacity) before[0] else null
+        messages = before.append(message)
+        return evicted
+    }
+
+    /**
+     * Replace the newest message with [message] if it is [previous], e.g. to
+     * update a repeat count
+     *
+     * @return false, changing nothing, if [previous] is no longer the newest
+     */
+    @Synchronized
+    fun replaceLast(previous: ChatMessage, message: ChatMessage): Boolean {
+        val current = messages
+        if (current.isEmpty() || current.last() !== previous) return false
+        messages = current.replaceLast(message)
+        layouts.remove(current.sequence(current.size - 1))
+        return true
+    }
+
+    /**
+     * Keep only the newest [keep] messages
+     *
+     * @return the messages dropped, oldest first
+     */
+    @Synchronized
+    fun trimTo(keep: Int): List<ChatMessage> {
+        val current = messages
+        val drop = current.size - keep.coerceAtLeast(0)
+        if (drop <= 0) return emptyList()
+        val dropped = current.subList(0, drop).toList()
+        messages = current.dropOldest(drop)
+        return dropped
+    }
+
+    /**
+     * Lay out the rows visible in a [width] x [height] viewport whose bottom
+     * edge is at the end of the message with sequence [anchor] (the newest
+     * message by default, i.e. pinned to the bottom). Rows are returned top
+     * to bottom; rows above the viewport are never laid out.
+     */
+    fun viewport(width: Int, height: Int, anchor: Long = Long.MAX_VALUE): List<TranscriptRow> {
+        val snapshot = messages
+        if (snapshot.isEmpty()) return emptyList()
+        var index = if (anchor == Long.MAX_VALUE) snapshot.size - 1 else snapshot.indexOfSequence(anchor)
+        if (index < 0) return emptyList()
+
+        val rows = ArrayList<TranscriptRow>()
+        var bottom = height
+        while (index >= 0 && bottom > 0) {
+            val sequence = snapshot.sequence(index)
+            val message = snapshot[index]
+            val layout = layoutOf(sequence, message, width)
+            bottom -= layout.height
+            rows += TranscriptRow(sequence, message, layout, bottom)
+            index--
+        }
+        rows.reverse()
+        return rows
+    }
+
+    @Synchronized
+    private fun layoutOf(sequence: Long, message: ChatMessage, width: Int): TextLayout {
+        val cached = layouts[sequence]
+        if (cached != null && cached.width == width) return cached
+        layoutCount++
+        return measurer.measure(format(message), width).also { layouts[sequence] = it }
+    }
+
+    companion object {
+        const val DEFAULT_LAYOUT_CACHE_SIZE = 256
+
+        /** Text as displayed: "Sender: message" */
+        fun format(message: ChatMessage): String = "${message.sender}: ${message.text}"
+    }
+}
@@ -0,0 +1,189 @@
+package com.linkpoint.ui.minimap
+
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.data.ObjectType
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.data.WorldEntity
+import com.linkpoint.protocol.world.ObjectStore
+import com.linkpoint.protocol.world.SpatialGrid
+import java.util.UUID
+import java.util.concurrent.atomic.AtomicReferenceArray
+
+/**
+ * Rasterised terrain and static prims for one [SpatialGrid] cell, as packed
+ * ARGB pixels with the north edge in the first row
+ */
+class MinimapTile(
+    val cellX: Int,
+    val cellY: Int,
+    val version: Long,
+    val size: Int,
+    val pixels: IntArray
+)
+
+/**
+ * Something drawn live on top of the cached tiles
+ */
+data class MinimapDot(val id: UUID, val x: Float, val y: Float, val isAvatar: Boolean)
+
+/**
+ * Top-down map of the current region built from an [ObjectStore].
+ *
+ * Terrain and static prims change rarely, so each grid cell is rasterised
+ * once into a [MinimapTile] and reused until the cell's static version
+ * changes. Rasterising happens in [refresh], off the UI thread and within a
+ * time budget per call, cells never drawn before first; [tiles] only returns
+ * what is cached, so neither the first view of a busy region nor a burst of
+ * object updates can stall a frame (stale tiles keep showing their previous
+ * picture meanwhile). Avatars and moving objects are fetched from the grid
+ * for the visible area only, each frame, as [dots].
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's LLNetMap (mini-map object layer rendered to a texture
+ *   and refreshed on change, avatars drawn on top)
+ */
+class MinimapTiles(
+    private val store: ObjectStore,
+    val tilePixels: Int = 64,
+    private val nanoTime: () -> Long = System::nanoTime
+) {
+    private val grid = store.grid
+    // Written by [refresh], read by [tiles] on the UI thread
+    private val cache = AtomicReferenceArray<MinimapTile?>(grid.cellsPerSide * grid.cellsPerSide)
+
+    /** Region metres along each edge of a tile */
+    val cellSize: Float get() = grid.cellSize
+
+    /** Tiles rasterised since creation; changes whenever [tiles] has something new */
+    @Volatile
+    var rasterised = 0
+        private set
+
+    /** Cached tiles overlapping the region rectangle; cells not rasterised yet are left out */
+    fun tiles(minX: Float, minY: Float, maxX: Float, maxY: Float): List<MinimapTile> {
+        val result = ArrayList<MinimapTile>()
+        for (cy in grid.cellY(minY)..grid.cellY(maxY)) {
+            for (cx in grid.cellX(minX)..grid.cellX(maxX)) {
+                cache.get(cy * grid.cellsPerSide + cx)?.let { result += it }
+            }
+        }
+        return result
+    }
+
+    /**
+     * Rasterise missing, then stale, tiles overlapping the region rectangle
+     * until [budgetNanos] is spent; at least one tile is drawn per call. Call
+     * from one background thread at a time
+     *
+     * @return tiles in the rectangle still missing or stale
+     */
+    fun refresh(minX: Float, minY: Float, maxX: Float, maxY: Float, budgetNanos: Long = DEFAULT_BUDGET_NANOS): Int {
+        val deadline = nanoTime() + budgetNanos
+        var pending = 0
+        var drawn = 0
+        // Empty cells first: a blank square is worse than an out of date one
+        for (missingOnly in booleanArrayOf(true, false)) {
+            for (cy in grid.cellY(minY)..grid.cellY(maxY)) {
+                for (cx in grid.cellX(minX)..grid.cellX(maxX)) {
+                    val index = cy * grid.cellsPerSide + cx
+                    val cached = cache.get(index)
+                    val version = grid.staticVersion(cx, cy)
+                    if (cached?.version == version || missingOnly != (cached == null)) continue
+                    if (drawn > 0 && nanoTime() >= deadline) {
+                        pending++
+                        continue
+                    }
+                    cache.set(index, rasterise(cx, cy, version))
+                    drawn++
+                }
+            }
+        }
+        return pending
+    }
+
+    /** Avatars and moving objects in the region rectangle */
+    fun dots(minX: Float, minY: Float, maxX: Float, maxY: Float): List<MinimapDot> {
+        val dots = ArrayList<MinimapDot>()
+        grid.forEachIn(minX, minY, maxX, maxY, static = false) { entity ->
+            dots += MinimapDot(entity.id, entity.position.x, entity.position.y, entity is Avatar)
+        }
+        return dots
+    }
+
+    /** The entity nearest ([x], [y]) within [radius] metres, e.g. for a tap */
+    fun pick(x: Float, y: Float, radius: Float): WorldEntity? {
+        var nearest: WorldEntity? = null
+        var best = radius * radius
+        grid.forEachIn(x - radius, y - radius, x + radius, y + radius) { entity ->
+            val dx = entity.position.x - x
+            val dy = entity.position.y - y
+            val distance = dx * dx + dy * dy
+            if (distance <= best) {
+                best = distance
+                nearest = entity
+            }
+        }
+        return nearest
+    }
+
+    fun invalidate() {
+        for (index in 0 until cache.length()) cache.set(index, null)
+    }
+
+    private fun rasterise(cellX: Int, cellY: Int, version: Long): MinimapTile {
+        val size = tilePixels
+        val pixels = IntArray(size * size)
+        val metresPerPixel = grid.cellSize / size
+        val originX = cellX * grid.cellSize
+        val originY = cellY * grid.cellSize
+
+        // Terrain, shaded by height
+        for (row in 0 until size) {
+            val y = originY + (size - 1 - row + 0.5f) * metresPerPixel
+            for (column in 0 until size) {
+                val height = store.terrainHeight(originX + (column + 0.5f) * metresPerPixel, y)
+                pixels[row * size + column] = terrainColor(height)
+            }
+        }
+
+        // Static prims overlapping the cell as their footprint, ignoring rotation and clipped to the cell
+        for (entity in grid.staticIn(cellX, cellY)) {
+            val halfX = maxOf(entity.scale.x, metresPerPixel) / 2
+            val halfY = maxOf(entity.scale.y, metresPerPixel) / 2
+            val left = ((entity.position.x - halfX - originX) / metresPerPixel).toInt().coerceIn(0, size - 1)
+            val right = ((entity.position.x + halfX - originX) / metresPerPixel).toInt().coerceIn(0, size - 1)
+            val bottom = ((entity.position.y - halfY - originY) / metresPerPixel).toInt().coerceIn(0, size - 1)
+            val top = ((entity.position.y + halfY - originY) / metresPerPixel).toInt().coerceIn(0, size - 1)
+            val color = primColor(entity)
+            for (py in bottom..top) {
+                val row = size - 1 - py
+                pixels.fill(color, row * size + left, row * size + right + 1)
+            }
+        }
+        rasterised++
+        return MinimapTile(cellX, cellY, version, size, pixels)
+    }
+
+    private fun terrainColor(height: Float?): Int {
+        if (height == null) return UNKNOWN_GROUND
+        if (height < WATER_HEIGHT) return WATER
+        // Brighter green with altitude
+        val shade = (height / 2).toInt().coerceIn(0, 80)
+        return (0xFF shl 24) or ((60 + shade) shl 16) or ((110 + shade) shl 8) or (50 + shade / 2)
+    }
+
+    private fun primColor(entity: WorldEntity): Int = when ((entity as? VirtualObject)?.objectType) {
+        ObjectType.TREE, ObjectType.GRASS -> 0xFF2E6B2E.toInt()
+        ObjectType.WATER -> WATER
+        else -> 0xFF9A9A9A.toInt()
+    }
+
+    companion object {
+        /** A few tiles' worth, well inside one frame */
+        const val DEFAULT_BUDGET_NANOS = 4_000_000L
+
+        private const val WATER_HEIGHT = 20f
+        private val WATER = 0xFF3A6EA5.toInt()
+        private val UNKNOWN_GROUND = 0xFF5C7A4A.toInt()
+    }
+}
@@ -0,0 +1,362 @@
+package com.linkpoint.ui.radar
+
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.protocol.data.Avatar
+import com.linkpoint.protocol.world.ObjectStore
+import kotlinx.coroutines.CoroutineDispatcher
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.channels.BufferOverflow
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.MutableSharedFlow
+import kotlinx.coroutines.flow.SharedFlow
+import kotlinx.coroutines.flow.asSharedFlow
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import mu.KotlinLogging
+import java.util.UUID
+import kotlin.math.sqrt
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Distance bands the radar reports changes between, after the chat ranges
+ */
+enum class RadarBucket(val maxMetres: Float) {
+    WHISPER(10f),
+    SAY(20f),
+    SHOUT(100f),
+    FAR(Float.MAX_VALUE);
+
+    companion object {
+        fun of(distance: Float): RadarBucket = values().first { distance <= it.maxMetres }
+    }
+}
+
+/**
+ * One avatar on the radar; [name] is null until it has been resolved
+ */
+data class RadarEntry(
+    val id: UUID,
+    val name: String?,
+    val distance: Float,
+    val bucket: RadarBucket,
+    val region: Long
+)
+
+/**
+ * Changes since the previous diff. Apply [left] before [entered]: an avatar
+ * that left and came back between two ticks is in both
+ */
+data class RadarDiff(
+    val entered: List<RadarEntry>,
+    val left: List<UUID>,
+    val movedBucket: List<RadarEntry>,
+    val renamed: List<RadarEntry>,
+    /** Whether the distance order changed, even if no avatar changed bucket */
+    val reordered: Boolean,
+    /** Whether any avatar's distance changed by a whole metre, e.g. for a list showing metres */
+    val distancesChanged: Boolean = false,
+    /** Avatars whose whole metres changed, other than those already in [entered], [movedBucket] or [renamed] */
+    val remeasured: List<RadarEntry> = emptyList()
+) {
+    val isEmpty: Boolean
+        get() = entered.isEmpty() && left.isEmpty() && movedBucket.isEmpty() && renamed.isEmpty() && !reordered && !distancesChanged
+}
+
+/**
+ * Resolves avatar ids to display names, many per call
+ */
+fun interface NameLookup {
+    /** Names for those of [ids] that could be resolved; missing ids are unknown */
+    suspend fun lookup(ids: Set<UUID>): Map<UUID, String>
+}
+
+/**
+ * Nearby-avatars list ("radar") kept up to date from avatar events.
+ *
+ * Avatars of the current region come from the [ObjectStore] as an
+ * [ObjectStore.AvatarListener]; those only known from a simulator's coarse
+ * locations, beyond draw distance or in a neighbouring region, are fed
+ * through [updateCoarse] with positions relative to the agent's region, and
+ * give way to the store's position once it has one. Events only mark entries dirty;
+ * every [intervalMs] the service recomputes the distances that changed,
+ * restores distance order with an insertion sort (cheap, since the list is
+ * nearly sorted between ticks) and emits a [RadarDiff] of avatars that
+ * entered, left, changed [RadarBucket], got a name or moved by a whole
+ * metre, so a list showing metres can apply it without a [snapshot].
+ *
+ * Names are resolved through [names] in batches of at most [maxLookupBatch]
+ * ids per tick and cached for [nameTtlMs]; an expired name keeps showing
+ * until its refresh arrives.
+ *
+ * Based on concepts from:
+ * - Firestorm's FSRadar (distance-ranged radar with enter/leave reporting)
+ * - SecondLife viewer's LLAvatarNameCache (expiring display-name cache)
+ */
+class RadarService(
+    private val names: NameLookup,
+    private val intervalMs: Long = DEFAULT_INTERVAL_MS,
+    private val nameTtlMs: Long = DEFAULT_NAME_TTL_MS,
+    private val maxLookupBatch: Int = DEFAULT_LOOKUP_BATCH,
+    private val dispatcher: CoroutineDispatcher = Dispatchers.Default,
+    private val clock: () -> Long = System::currentTimeMillis
+) : ObjectStore.AvatarListener {
+
+    private class Tracked(val id: UUID, var region: Long, var position: Vector3) {
+        // Known only from a coarse location update
+        var coarse = false
+        var distance = 0f
+        var dirty = true
+        var reportedBucket: RadarBucket? = null
+        var reportedName: String? = null
+        var reportedMetres = -1
+    }
+
+    private class CachedName(val name: String?, val expiresAt: Long)
+
+    private val tracked = HashMap<UUID, Tracked>()
+    // Every tracked avatar, in distance order as of the last tick
+    private val sorted = ArrayList<Tracked>()
+    private val departed = ArrayList<UUID>()
+    private val nameCache = HashMap<UUID, CachedName>()
+    private val wantedNames = LinkedHashSet<UUID>()
+    private val namesInFlight = HashSet<UUID>()
+    private var self = Vector3(0f, 0f, 0f)
+    private var selfMoved = true
+
+    private val _diffs = MutableSharedFlow<RadarDiff>(extraBufferCapacity = DIFF_BUFFER, onBufferOverflow = BufferOverflow.DROP_OLDEST)
+
+    /** Non-empty diffs, at most one per [intervalMs] */
+    val diffs: SharedFlow<RadarDiff> = _diffs.asSharedFlow()
+
+    /** The agent's own avatar, never listed; dropped if already tracked */
+    @Volatile
+    var selfId: UUID? = null
+        set(value) {
+            field = value
+            value?.let(::remove)
+        }
+
+    /** Name lookups issued, for diagnostics */
+    @Volatile
+    var lookups = 0
+        private set
+
+    /**
+     * Add or move an avatar. [position] is relative to the agent's region;
+     * a [knownName] is cached as if resolved
+     */
+    @Synchronized
+    fun update(id: UUID, position: Vector3, region: Long = CURRENT_REGION, knownName: String? = null) {
+        track(id, position, region)?.coarse = false
+        if (!knownName.isNullOrBlank()) nameCache[id] = CachedName(knownName, clock() + nameTtlMs)
+    }
+
+    /**
+     * Replace [region]'s coarse locations (a CoarseLocationUpdate), positions
+     * relative to the agent's region. Avatars tracked through [update] keep
+     * their precise position; coarse ones of [region] missing from [avatars]
+     * are dropped
+     */
+    @Synchronized
+    fun updateCoarse(region: Long, avatars: Map<UUID, Vector3>) {
+        for ((id, position) in avatars) {
+            if (tracked[id]?.coarse == false) continue
+            track(id, position, region)?.coarse = true
+        }
+        tracked.values.filter { it.coarse && it.region == region && it.id !in avatars }.forEach { remove(it.id) }
+    }
+
+    @Synchronized
+    fun remove(id: UUID) {
+        val entry = tracked.remove(id) ?: return
+        sorted.remove(entry)
+        if (entry.reportedBucket != null) departed += id
+    }
+
+    /** Drop every avatar of [region], e.g. when its neighbour circuit closes */
+    @Synchronized
+    fun removeRegion(region: Long) {
+        tracked.values.filter { it.region == region }.forEach { remove(it.id) }
+    }
+
+    // Null for the agent itself
+    private fun track(id: UUID, position: Vector3, region: Long): Tracked? {
+        if (id == selfId) return null
+        val entry = tracked[id]
+        if (entry == null) {
+            val added = Tracked(id, region, position)
+            tracked[id] = added
+            sorted += added
+            return added
+        }
+        if (entry.position != position || entry.region != region) {
+            entry.position = position
+            entry.region = region
+            entry.dirty = true
+        }
+        return entry
+    }
+
+    /** Move the agent, relative to its region */
+    @Synchronized
+    fun setSelf(position: Vector3) {
+        if (position == self) return
+        self = position
+        selfMoved = true
+    }
+
+    override fun onAvatarUpdated(avatar: Avatar) =
+        update(avatar.id, avatar.position, CURRENT_REGION, avatar.displayName.ifBlank { null })
+
+    override fun onAvatarRemoved(id: UUID) = remove(id)
+
+    /**
+     * Bring distances and order up to date and return what changed since the
+     * last tick, or null if nothing did
+     */
+    @Synchronized
+    fun tick(): RadarDiff? {
+        val now = clock()
+        for (entry in sorted) {
+            if (selfMoved || entry.dirty) {
+                entry.distance = distanceTo(entry.position)
+                entry.dirty = false
+            }
+        }
+        selfMoved = false
+        val reordered = insertionSort()
+
+        val entered = ArrayList<RadarEntry>()
+        val moved = ArrayList<RadarEntry>()
+        val renamed = ArrayList<RadarEntry>()
+        val remeasured = ArrayList<RadarEntry>()
+        var distancesChanged = false
+        for (entry in sorted) {
+            val metres = entry.distance.toInt()
+            val metresChanged = metres != entry.reportedMetres
+            if (metresChanged) {
+                entry.reportedMetres = metres
+                distancesChanged = true
+            }
+            val cached = nameCache[entry.id]
+            if ((cached == null || cached.expiresAt <= now) && entry.id !in namesInFlight) wantedNames += entry.id
+            val name = cached?.name ?: entry.reportedName
+            val bucket = RadarBucket.of(entry.distance)
+            when {
+                entry.reportedBucket == null -> entered += entry.toRadarEntry(name, bucket)
+                entry.reportedBucket != bucket -> moved += entry.toRadarEntry(name, bucket)
+                entry.reportedName != name -> renamed += entry.toRadarEntry(name, bucket)
+                metresChanged -> {
+                    remeasured += entry.toRadarEntry(name, bucket)
+                    continue
+                }
+                else -> continue
+            }
+            entry.reportedBucket = bucket
+            entry.reportedName = name
+        }
+        val left = departed.toList()
+        departed.clear()
+        val diff = RadarDiff(entered, left, moved, renamed, reordered, distancesChanged, remeasured)
+        return if (diff.isEmpty) null else diff
+    }
+
+    /** Avatars nearest first, as of the last tick */
+    @Synchronized
+    fun snapshot(): List<RadarEntry> = sorted.map { entry ->
+        entry.toRadarEntry(nameCache[entry.id]?.name ?: entry.reportedName, RadarBucket.of(entry.distance))
+    }
+
+    /**
+     * Resolve one batch of the names the last tick found missing or expired
+     *
+     * @return number of ids looked up
+     */
+    suspend fun resolveNames(): Int {
+        val batch = synchronized(this) {
+            wantedNames.filter { it in tracked }.take(maxLookupBatch).toSet().also {
+                wantedNames.removeAll(it)
+                wantedNames.retainAll(tracked.keys)
+                namesInFlight += it
+            }
+        }
+        if (batch.isEmpty()) return 0
+        val resolved = try {
+            names.lookup(batch)
+        } catch (e: Exception) {
+            logger.warn(e) { "Name lookup for ${batch.size} avatars failed" }
+            emptyMap()
+        }
+        synchronized(this) {
+            lookups++
+            val now = clock()
+            for (id in batch) {
+                val name = resolved[id]
+                // Unknown ids are retried sooner, but not every tick
+                nameCache[id] = if (name != null) CachedName(name, now + nameTtlMs)
+                    else CachedName(nameCache[id]?.name, now + minOf(nameTtlMs, UNRESOLVED_RETRY_MS))
+            }
+            namesInFlight -= batch
+            if (nameCache.size > MAX_CACHED_NAMES) {
+                // Forget expired names first, then those of avatars no longer around
+                nameCache.values.removeIf { it.expiresAt <= now }
+                if (nameCache.size > MAX_CACHED_NAMES) nameCache.keys.retainAll(tracked.keys)
+            }
+        }
+        return batch.size
+    }
+
+    /**
+     * Tick every [intervalMs] in [scope], resolving names between ticks
+     */
+    fun start(scope: CoroutineScope): Job = scope.launch(dispatcher) {
+        while (isActive) {
+            tick()?.let { _diffs.emit(it) }
+            resolveNames()
+            delay(intervalMs)
+        }
+    }
+
+    // Stable for ties and O(n) when nothing moved past a neighbour
+    private fun insertionSort(): Boolean {
+        var changed = false
+        for (i in 1 until sorted.size) {
+            val entry = sorted[i]
+            var j = i - 1
+            while (j >= 0 && sorted[j].distance > entry.distance) {
+                sorted[j + 1] = sorted[j]
+                j--
+            }
+            if (j != i - 1) {
+                sorted[j + 1] = entry
+                changed = true
+            }
+        }
+        return changed
+    }
+
+    private fun distanceTo(position: Vector3): Float {
+        val dx = position.x - self.x
+        val dy = position.y - self.y
+        val dz = position.z - self.z
+        return sqrt(dx * dx + dy * dy + dz * dz)
+    }
+
+    private fun Tracked.toRadarEntry(name: String?, bucket: RadarBucket) =
+        RadarEntry(id, name, distance, bucket, region)
+
+    companion object {
+        /** Region handle for avatars in the agent's own region */
+        const val CURRENT_REGION = 0L
+
+        const val DEFAULT_INTERVAL_MS = 500L
+        const val DEFAULT_NAME_TTL_MS = 30 * 60 * 1000L
+        const val DEFAULT_LOOKUP_BATCH = 64
+        private const val UNRESOLVED_RETRY_MS = 60 * 1000L
+        private const val MAX_CACHED_NAMES = 2048
+        private const val DIFF_BUFFER = 8
+    }
+}
@@ -0,0 +1,208 @@
+package com.linkpoint.ui.state
+
+import com.linkpoint.core.util.ChunkedLog
+import com.linkpoint.ui.ChatMessage
+import com.linkpoint.ui.chat.ChatBatch
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import java.util.UUID
+
+enum class ConnectionStatus { DISCONNECTED, CONNECTING, CONNECTED, BACKGROUND }
+
+data class ConnectionState(
+    val status: ConnectionStatus = ConnectionStatus.DISCONNECTED,
+    val region: String? = null,
+    val detail: String? = null
+)
+
+/**
+ * Chat transcript as an append-only log whose sequence numbers are stable row keys
+ */
+data class ChatState(
+    val log: ChunkedLog<ChatMessage> = ChunkedLog.empty(CHAT_CAPACITY),
+    val rateLimited: Int = 0,
+    val muted: Int = 0
+)
+
+/**
+ * One radar row; [distance] is whole metres so small moves don't change it
+ */
+data class NearbyAvatar(val id: UUID, val name: String, val distance: Int)
+
+data class NearbyAvatarsState(val avatars: List<NearbyAvatar> = emptyList())
+
+data class ViewerStats(
+    val fps: Int = 0,
+    val pingMs: Int = 0,
+    val objects: Int = 0,
+    val kilobytesPerSecond: Int = 0,
+    // Object cache: share of offered objects found cached, and download avoided
+    val cacheHitPercent: Int = 0,
+    val cacheKilobytesSaved: Long = 0
+)
+
+/**
+ * Startup status of each subsystem, by display name, and the cold start time
+ */
+data class SubsystemState(
+    val statuses: Map<String, String> = emptyMap(),
+    val coldStartMs: Long? = null
+)
+
+private const val CHAT_CAPACITY = 500
+private const val ACTIVITY_LOG_CAPACITY = 50
+
+/**
+ * UI state split into independent slices, each its own [StateFlow].
+ *
+ * Engine code writes whenever it likes, from any thread; writes only mark
+ * their slice dirty. A publisher publishes dirty slices at most once per
+ * [publishIntervalMs] (the first change after a quiet spell goes out at
+ * once), so a burst of updates becomes one new value per slice per
+ * interval, and slices nobody touched don't emit at all. Values are
+ * immutable snapshots: the chat and activity logs share structure between
+ * versions and key rows by sequence, and equal values are never re-emitted,
+ * so a screen that collects each slice in its own composable recomposes only
+ * the part that changed.
+ *
+ * [emissions] counts values published per slice, for measuring what a burst
+ * costs the UI.
+ *
+ * Based on concepts from:
+ * - Unidirectional data flow with per-feature state holders
+ * - SecondLife viewer's LLFloater refresh throttling (dirty flag, periodic redraw)
+ */
+class ViewerStateHub(private val publishIntervalMs: Long = DEFAULT_PUBLISH_INTERVAL_MS) {
+
+    enum class Slice { CONNECTION, CHAT, NEARBY_AVATARS, STATS, SUBSYSTEMS, ACTIVITY_LOG }
+
+    private val _connection = MutableStateFlow(ConnectionState())
+    private val _chat = MutableStateFlow(ChatState())
+    private val _nearbyAvatars = MutableStateFlow(NearbyAvatarsState())
+    private val _stats = MutableStateFlow(ViewerStats())
+    private val _subsystems = MutableStateFlow(SubsystemState())
+    private val _activityLog = MutableStateFlow(ChunkedLog.empty<String>(ACTIVITY_LOG_CAPACITY))
+
+    val connection: StateFlow<ConnectionState> = _connection.asStateFlow()
+    val chat: StateFlow<ChatState> = _chat.asStateFlow()
+    val nearbyAvatars: StateFlow<NearbyAvatarsState> = _nearbyAvatars.asStateFlow()
+    val stats: StateFlow<ViewerStats> = _stats.asStateFlow()
+    val subsystems: StateFlow<SubsystemState> = _subsystems.asStateFlow()
+    val activityLog: StateFlow<ChunkedLog<String>> = _activityLog.asStateFlow()
+
+    // Pending values, guarded by lock
+    private val lock = Any()
+    private var connectionPending = _connection.value
+    private var chatPending = _chat.value
+    private var avatarsPending = _nearbyAvatars.value
+    private var statsPending = _stats.value
+    private var subsystemsPending = _subsystems.value
+    private var logPending = _activityLog.value
+    private val dirty = HashSet<Slice>()
+
+    private val wake = Channel<Unit>(Channel.CONFLATED)
+    // Guarded by lock
+    private val counts = IntArray(Slice.values().size)
+
+    /** Values published per slice since creation */
+    val emissions: Map<Slice, Int> get() = synchronized(lock) { Slice.values().associateWith { counts[it.ordinal] } }
+
+    fun setConnection(state: ConnectionState) = write(Slice.CONNECTION) { connectionPending = state }
+
+    /**
+     * Add a digested chat batch; a line that continues the previous one
+     * (repeat folding) replaces it instead of appending
+     */
+    fun appendChat(batch: ChatBatch) = write(Slice.CHAT) {
+        var log = chatPending.log
+        for (line in batch.lines) {
+            log = if (line.replaces != null && log.isNotEmpty() && log.last() === line.replaces) {
+                log.replaceLast(line.display)
+            } else {
+                log.append(line.display)
+            }
+        }
+        chatPending = chatPending.copy(
+            log = log,
+            rateLimited = chatPending.rateLimited + batch.rateLimited,
+            muted = chatPending.muted + batch.muted
+        )
+    }
+
+    /** Replace the radar list; [avatars] should already be sorted nearest first */
+    fun setNearbyAvatars(avatars: List<NearbyAvatar>) = write(Slice.NEARBY_AVATARS) {
+        avatarsPending = NearbyAvatarsState(avatars.toList())
+    }
+
+    fun setStats(stats: ViewerStats) = write(Slice.STATS) { statsPending = stats }
+
+    fun setSubsystemStatus(subsystem: String, status: String) = write(Slice.SUBSYSTEMS) {
+        subsystemsPending = subsystemsPending.copy(statuses = subsystemsPending.statuses + (subsystem to status))
+    }
+
+    fun setColdStart(coldStartMs: Long) = write(Slice.SUBSYSTEMS) {
+        subsystemsPending = subsystemsPending.copy(coldStartMs = coldStartMs)
+    }
+
+    fun log(entry: String) = write(Slice.ACTIVITY_LOG) { logPending = logPending.append(entry) }
+
+    /**
+     * Start publishing in [scope]; until then (and in tests) [publish] can be called directly
+     */
+    fun start(scope: CoroutineScope): Job = scope.launch {
+        while (isActive) {
+            wake.receive()
+            publish()
+            delay(publishIntervalMs)
+        }
+    }
+
+    /** Push every dirty slice to its flow now */
+    fun publish() {
+        val slices: List<Slice>
+        synchronized(lock) {
+            if (dirty.isEmpty()) return
+            slices = dirty.toList()
+            dirty.clear()
+            for (slice in slices) {
+                val changed = when (slice) {
+                    Slice.CONNECTION -> emit(_connection, connectionPending)
+                    // Logs are new instances exactly when they change; skip the element-wise equals
+                    Slice.CHAT -> _chat.value !== chatPending && emit(_chat, chatPending)
+                    Slice.NEARBY_AVATARS -> emit(_nearbyAvatars, avatarsPending)
+                    Slice.STATS -> emit(_stats, statsPending)
+                    Slice.SUBSYSTEMS -> emit(_subsystems, subsystemsPending)
+                    Slice.ACTIVITY_LOG -> _activityLog.value !== logPending && emit(_activityLog, logPending)
+                }
+                if (changed) counts[slice.ordinal]++
+            }
+        }
+    }
+
+    private fun <T> emit(flow: MutableStateFlow<T>, value: T): Boolean {
+        val before = flow.value
+        flow.value = value
+        // StateFlow drops a value equal to the current one; count only real emissions
+        return before != value
+    }
+
+    private inline fun write(slice: Slice, update: () -> Unit) {
+        synchronized(lock) {
+            update()
+            dirty += slice
+        }
+        wake.trySend(Unit)
+    }
+
+    companion object {
+        /** About six frames at 60 Hz: faster than reading speed, slow enough to batch a flood */
+        const val DEFAULT_PUBLISH_INTERVAL_MS = 100L
+    }
+}
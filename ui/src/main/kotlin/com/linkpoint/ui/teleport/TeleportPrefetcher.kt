@@ -0,0 +1,240 @@
+package com.linkpoint.ui.teleport
+
+import com.linkpoint.assets.AssetManager.AssetType
+import com.linkpoint.assets.TextureFetchScheduler
+import com.linkpoint.assets.prefetch.RegionManifest
+import com.linkpoint.assets.prefetch.RegionManifestStore
+import com.linkpoint.graphics.rendering.TextureCoverage
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.world.ObjectStore
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.CoroutineDispatcher
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.withContext
+import mu.KotlinLogging
+import java.util.UUID
+import java.util.concurrent.atomic.AtomicInteger
+
+private val logger = KotlinLogging.logger {}
+
+/**
+ * Where a teleport request came from; decides which RLV restriction applies
+ */
+enum class TeleportSource {
+    /** A location picked on the world map (@tploc) */
+    MAP,
+    /** An RLV @tpto from a scripted object; already vetted by RLV */
+    RLV
+}
+
+/**
+ * Performs a teleport to ([x], [y], [z]) in region [regionHandle], e.g.
+ * [com.linkpoint.protocol.SecondLifeProtocol.teleportTo]
+ */
+fun interface Teleporter {
+    suspend fun teleport(regionHandle: Long, x: Float, y: Float, z: Float): Boolean
+}
+
+/**
+ * Brings an asset into the caches, e.g. [com.linkpoint.assets.AssetManager.warm]
+ */
+fun interface AssetWarmer {
+    suspend fun warm(id: UUID, type: AssetType): Boolean
+}
+
+/**
+ * Arrival-to-rendered time of one teleport: from landing until the texture
+ * scheduler saw most of the view sharp. [warm] is whether a manifest from an
+ * earlier visit was prefetched
+ */
+data class ArrivalTiming(val regionHandle: Long, val warm: Boolean, val renderedMs: Long)
+
+/**
+ * Warm start for teleports.
+ *
+ * While in a region, [observe] samples which textures cover the screen;
+ * when the agent leaves, the region's objects, textures (ranked by that
+ * coverage, blended with earlier visits) and meshes are written to a
+ * [RegionManifest]. A teleport intent towards a region with a manifest
+ * starts warming the asset caches with it at once, [maxConcurrent] assets at
+ * a time, most-covered textures first, so the confirmation dialog and the
+ * teleport handshake overlap the downloads. Intents that RLV would refuse
+ * don't prefetch.
+ *
+ * [onArrived] writes the manifest of the region left behind and starts the
+ * sharpness timer of the texture scheduler from [textureFetch] (which may
+ * not exist yet while assets start up); the result is kept in [arrivals]
+ * for comparing warm and cold visits.
+ *
+ * The prefetcher only warms caches: callers check RLV before teleporting,
+ * and an intent RLV would refuse is not prefetched.
+ *
+ * Based on concepts from:
+ * - SecondLife viewer's texture and object cache warm-up on region entry
+ *   (LLViewerRegion cache load, LLAppViewer prefetch of the start location)
+ * - RLVa's @tplm / @tploc teleport restrictions
+ */
+class TeleportPrefetcher(
+    private val manifests: RegionManifestStore,
+    private val warmer: AssetWarmer,
+    private val objects: ObjectStore,
+    private val scope: CoroutineScope,
+    private val textureFetch: () -> TextureFetchScheduler? = { null },
+    private val rlv: RLVProcessor? = null,
+    private val maxConcurrent: Int = DEFAULT_MAX_CONCURRENT,
+    private val ioDispatcher: CoroutineDispatcher = Dispatchers.IO,
+    private val clock: () -> Long = System::currentTimeMillis
+) {
+    // Highest coverage seen per texture during the current visit
+    private val visitCoverage = HashMap<UUID, Float>()
+    private var framesObserved = 0L
+    private var prefetch: Job? = null
+    private var destination: Long? = null
+    private var destinationWarm = false
+    private var arrivedWarm = false
+    private var awaitingRender = false
+    private val _arrivals = ArrayList<ArrivalTiming>()
+    private val warmedCount = AtomicInteger()
+
+    /** Region the agent is in, once known */
+    @Volatile
+    var currentRegion: Long? = null
+
+    /** Assets warmed since creation */
+    val warmed: Int get() = warmedCount.get()
+
+    val arrivals: List<ArrivalTiming> @Synchronized get() = _arrivals.toList()
+
+    /**
+     * The user asked to go to [regionHandle]; starts prefetching the
+     * destination's manifest
+     *
+     * @return false if RLV forbids this teleport, so nothing was started
+     */
+    fun onTeleportIntent(regionHandle: Long, source: TeleportSource): Boolean {
+        if (isRestricted(source)) {
+            logger.debug { "Teleport intent from $source refused by RLV; not prefetching" }
+            return false
+        }
+        synchronized(this) {
+            prefetch?.cancel()
+            destination = regionHandle
+            destinationWarm = false
+            prefetch = scope.launch {
+                val manifest = withContext(ioDispatcher) { manifests.load(regionHandle) } ?: return@launch
+                synchronized(this@TeleportPrefetcher) { if (destination == regionHandle) destinationWarm = true }
+                warm(manifest)
+            }
+        }
+        return true
+    }
+
+    /**
+     * The agent arrived in [regionHandle] (by default the intended
+     * destination); record the region it left and time how long the view
+     * takes to render
+     */
+    @Synchronized
+    fun onArrived(regionHandle: Long? = null) {
+        val region = regionHandle ?: destination ?: currentRegion
+        if (region != currentRegion) recordVisit()
+        currentRegion = region
+        arrivedWarm = region != null && region == destination && destinationWarm
+        destination = null
+        visitCoverage.clear()
+        val fetch = textureFetch()
+        awaitingRender = fetch != null
+        fetch?.markTeleport()
+    }
+
+    /**
+     * Call once per frame with the renderer's coverage; samples it for the
+     * manifest and notices when an arrival has rendered
+     */
+    @Synchronized
+    fun observe(coverage: TextureCoverage) {
+        if (framesObserved++ % SAMPLE_FRAMES == 0L) {
+            coverage.forEach { id, pixels, _ -> if (pixels > (visitCoverage[id] ?: 0f)) visitCoverage[id] = pixels }
+        }
+        if (awaitingRender) {
+            val renderedMs = textureFetch()?.lastTimeToSharpMs ?: return
+            awaitingRender = false
+            val region = currentRegion ?: return
+            _arrivals += ArrivalTiming(region, arrivedWarm, renderedMs)
+            logger.info { "Region ${java.lang.Long.toHexString(region)} rendered $renderedMs ms after arrival (${if (arrivedWarm) "prefetched" else "cold"})" }
+        }
+    }
+
+    /**
+     * Write the current region's manifest, e.g. before leaving it or when the
+     * app goes to the background
+     *
+     * @return the write, or null if there was nothing to record
+     */
+    fun recordVisit(): Job? {
+        val region = currentRegion ?: return null
+        val coverage = synchronized(this) { HashMap(visitCoverage) }
+        val prims = objects.all().filterIsInstance<VirtualObject>()
+        if (prims.isEmpty()) return null
+        return scope.launch(ioDispatcher) {
+            val previous = manifests.load(region)
+            val weights = HashMap<UUID, Float>()
+            previous?.textureWeights?.forEach { (id, weight) -> weights[id] = weight * HISTORY_WEIGHT }
+            for (prim in prims) {
+                for (texture in prim.textureIds) {
+                    val seen = coverage[texture] ?: UNSEEN_WEIGHT
+                    weights[texture] = maxOf(weights[texture] ?: 0f, seen)
+                }
+            }
+            val meshes = LinkedHashSet<UUID>()
+            prims.mapNotNullTo(meshes) { it.meshId }
+            previous?.meshes?.let { meshes.addAll(it) }
+            manifests.save(RegionManifest(region, clock(), prims.map { it.id }, weights, meshes.toList()))
+        }
+    }
+
+    private suspend fun warm(manifest: RegionManifest) {
+        val queue = manifest.textures.map { it to AssetType.TEXTURE } + manifest.meshes.map { it to AssetType.MESH }
+        val next = AtomicInteger()
+        coroutineScope {
+            repeat(maxConcurrent) {
+                launch {
+                    while (true) {
+                        val (id, type) = queue.getOrNull(next.getAndIncrement()) ?: break
+                        try {
+                            if (warmer.warm(id, type)) warmedCount.incrementAndGet()
+                        } catch (e: CancellationException) {
+                            throw e
+                        } catch (e: Exception) {
+                            logger.debug { "Prefetch of $type $id failed: ${e.message}" }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    private fun isRestricted(source: TeleportSource): Boolean {
+        val rlv = rlv ?: return false
+        return when (source) {
+            TeleportSource.MAP -> rlv.isRestricted(RLVProcessor.RLVCommand.TPLOC)
+            TeleportSource.RLV -> false
+        }
+    }
+
+    companion object {
+        const val DEFAULT_MAX_CONCURRENT = 4
+
+        // Coverage sampled every this many frames
+        private const val SAMPLE_FRAMES = 30L
+        // Earlier visits count for half at each new recording
+        private const val HISTORY_WEIGHT = 0.5f
+        // Textures on objects that were never seen on screen still get warmed, last
+        private const val UNSEEN_WEIGHT = 1f
+    }
+}
@@ -0,0 +1,111 @@
+package com.linkpoint.ui.chat
+
+import com.linkpoint.core.events.ViewerEvent
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.names.AvatarName
+import com.linkpoint.protocol.names.NameResponse
+import com.linkpoint.protocol.names.NameService
+import com.linkpoint.protocol.names.NameSource
+import com.linkpoint.ui.ChatMessage
+import kotlinx.coroutines.async
+import kotlinx.coroutines.flow.MutableSharedFlow
+import kotlinx.coroutines.flow.first
+import kotlinx.coroutines.test.StandardTestDispatcher
+import kotlinx.coroutines.test.runCurrent
+import kotlinx.coroutines.test.runTest
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertSame
+import kotlin.test.assertTrue
+
+/**
+ * Tests for mute filtering, rate limiting and repeat coalescing in chat ingest
+ */
+class ChatIngestPipelineTest {
+
+    private fun chat(sender: String, text: String) = ChatMessage(text = text, channel = "Local", timestamp = 0, sender = sender)
+
+    @Test
+    fun `should coalesce repeats and drop muted and flooding senders`() {
+        val mutes = MuteList().apply { mute("Griefer Resident") }
+        var now = 0L
+        val pipeline = ChatIngestPipeline(muteList = mutes, perSourceBurst = 3.0, perSourcePerSecond = 1.0, clock = { now })
+
+        val flood = List(12) { chat("Door", "Alice has entered") } +
+            chat("griefer resident", "spam") +
+            List(5) { i -> chat("Spammer", "line $i") }
+        val batch = pipeline.process(flood)!!
+
+        assertEquals(listOf("Alice has entered ×12", "line 0", "line 1", "line 2"), batch.lines.map { it.display.text })
+        assertEquals(2, batch.rateLimited)
+        assertEquals(1, batch.muted)
+    }
+
+    @Test
+    fun `should replace the previous batch's line when a repeat continues it`() {
+        val pipeline = ChatIngestPipeline()
+        val first = pipeline.process(List(3) { chat("Door", "Bob has entered") })!!.lines.single()
+        val next = pipeline.process(listOf(chat("Door", "Bob has entered")))!!.lines.single()
+
+        assertEquals(4, next.repeatCount)
+        assertSame(first.display, next.replaces)
+
+        val transcript = ChatTranscript()
+        transcript.append(first.display)
+        assertTrue(transcript.replaceLast(next.replaces!!, next.display))
+        assertEquals(listOf("Bob has entered ×4"), transcript.messages.map { it.text })
+        assertFalse(transcript.replaceLast(next.replaces!!, next.display), "The ×3 line is gone")
+    }
+
+    @Test
+    fun `should rate limit repeats that start a new line`() {
+        var now = 0L
+        val pipeline = ChatIngestPipeline(perSourceBurst = 2.0, perSourcePerSecond = 1.0, clock = { now })
+        // Each repeat arrives in a later batch, after someone else spoke
+        val batches = List(3) { i ->
+            pipeline.process(listOf(chat("Spammer", "buy")))!!.also { pipeline.process(listOf(chat("Bystander $i", "hi"))) }
+        }
+
+        assertEquals(listOf(listOf("buy"), listOf("buy"), emptyList()), batches.map { batch -> batch.lines.map { it.display.text } })
+        assertEquals(1, batches.last().rateLimited)
+    }
+
+    @Test
+    fun `should show avatars by display name, looked up once per batch`() = runTest {
+        val alice = UUID(7, 1)
+        var requests = 0
+        val names = NameService(NameSource { ids ->
+            requests++
+            NameResponse(ids.associateWith { AvatarName(it, "Alice", "alice.resident", Long.MAX_VALUE) })
+        }, this)
+        val events = MutableSharedFlow<ViewerEvent>()
+        val pipeline = ChatIngestPipeline(names = names, dispatcher = StandardTestDispatcher(testScheduler))
+        val job = pipeline.start(this, events)
+        val batch = async { pipeline.batches.first() }
+        runCurrent()
+
+        events.emit(ViewerEvent.ChatReceived("hi", "alice.resident", 0, alice))
+        events.emit(ViewerEvent.ChatReceived("anyone here?", "alice.resident", 0, alice))
+        events.emit(ViewerEvent.ChatReceived("Bob has entered", "Door", 0))
+
+        assertEquals(listOf("Alice", "Alice", "Door"), batch.await().lines.map { it.message.sender })
+        assertEquals(1, requests)
+        job.cancel()
+    }
+
+    @Test
+    fun `should hide chat under recvchat except from avatars excepted by key`() {
+        val owner = UUID(7, 2)
+        val rlv = RLVProcessor().apply { processRLVCommand("@recvchat=n,recvchat:$owner=add", "collar", "Collar") }
+        val pipeline = ChatIngestPipeline(rlv = rlv)
+
+        val batch = pipeline.process(listOf(
+            chat("Stranger", "hello").copy(senderId = UUID(7, 3)),
+            chat("Owner's Display Name", "kneel").copy(senderId = owner)
+        ))!!
+
+        assertEquals(listOf("...", "kneel"), batch.lines.map { it.display.text })
+    }
+}
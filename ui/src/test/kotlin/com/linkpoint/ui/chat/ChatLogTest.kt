@@ -0,0 +1,58 @@
+package com.linkpoint.ui.chat
+
+import com.linkpoint.ui.ChatMessage
+import java.nio.file.Files
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the segmented, indexed chat log
+ */
+class ChatLogTest {
+
+    private fun message(i: Int, text: String) = ChatMessage(text = text, channel = "Local", timestamp = i.toLong(), sender = "Resident $i")
+
+    @Test
+    fun `should page search results newest first`() {
+        val dir = Files.createTempDirectory("chatlog").toFile()
+        ChatLog(dir, "Local", segmentBytes = 256, recentWindow = 4).use { log ->
+            repeat(100) { i -> log.append(message(i, if (i % 10 == 0) "Teleport to the party" else "hello there")) }
+
+            val first = log.search("party TELEPORT", limit = 6)
+            assertEquals(listOf(90, 80, 70, 60, 50, 40), first.map { it.id })
+            val second = log.search("party teleport", beforeId = first.last().id, limit = 6)
+            assertEquals(listOf(30, 20, 10, 0), second.map { it.id })
+            assertEquals("Teleport to the party", second.last().message.text, "Old messages are read back from disk")
+            assertEquals(4, log.recent().size, "Only the recent window stays in memory")
+        }
+        dir.deleteRecursively()
+    }
+
+    @Test
+    fun `should reopen from the sealed segments' indexes`() {
+        val dir = Files.createTempDirectory("chatlog").toFile()
+        ChatLog(dir, "Local", segmentBytes = 128).use { log ->
+            repeat(20) { i -> log.append(message(i, "message number $i")) }
+        }
+
+        ChatLog(dir, "Local", segmentBytes = 128).use { log ->
+            assertEquals(20, log.size)
+            assertTrue(dir.listFiles()!!.count { it.name.endsWith(".chatlog") } > 1, "Log should span several segments")
+            assertEquals(listOf(7), log.search("number 7").map { it.id })
+            assertEquals(20, log.append(message(20, "after reopen")))
+            assertEquals(1, log.replayedOnOpen, "Only the active segment is replayed")
+            assertEquals("message number 19", log.recent()[19].text, "The recent window is refilled across segments")
+        }
+
+        // A stale index is rebuilt from its segment
+        val index = dir.listFiles()!!.filter { it.name.endsWith(".chatidx") }.minByOrNull { it.name }!!
+        index.writeBytes(index.readBytes().copyOf(40))
+        ChatLog(dir, "Local", segmentBytes = 128).use { log ->
+            assertEquals(2, log.replayedOnOpen)
+            assertEquals(listOf(0), log.search("number 0").map { it.id })
+            assertEquals(listOf(20), log.search("reopen").map { it.id })
+        }
+        dir.deleteRecursively()
+    }
+}
@@ -0,0 +1,59 @@
+package com.linkpoint.ui.chat
+
+import com.linkpoint.ui.ChatMessage
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+/**
+ * Tests for the virtualised chat transcript and its layout cache
+ */
+class ChatTranscriptTest {
+
+    private fun message(i: Int, text: String = "hello") = ChatMessage(text = text, channel = "Local", timestamp = i.toLong(), sender = "Resident $i")
+
+    @Test
+    fun `should lay out only the visible rows, once per width`() {
+        val transcript = ChatTranscript(capacity = 1000)
+        repeat(1000) { transcript.append(message(it)) }
+
+        // 16 px lines: ten one-line rows fill 160 px, pinned to the newest
+        val rows = transcript.viewport(800, 160)
+        assertEquals((990 until 1000).map { "Resident $it" }, rows.map { it.message.sender })
+        assertEquals(0, rows.first().y)
+        assertEquals(144, rows.last().y)
+        assertEquals(10L, transcript.layoutCount)
+
+        transcript.viewport(800, 160)
+        assertEquals(10L, transcript.layoutCount, "Cached layouts are reused")
+        transcript.viewport(400, 160)
+        assertEquals(20L, transcript.layoutCount, "A resize re-lays out only the visible rows")
+
+        val scrolled = transcript.viewport(400, 160, anchor = transcript.messages.sequence(500))
+        assertEquals("Resident 500", scrolled.last().message.sender)
+        assertEquals(30L, transcript.layoutCount)
+    }
+
+    @Test
+    fun `should re-lay out a replaced message and evict beyond capacity`() {
+        val transcript = ChatTranscript(capacity = 3)
+        val first = message(1)
+        assertNull(transcript.append(first))
+        transcript.viewport(800, 160)
+
+        val longer = message(1, "word ".repeat(30).trim())
+        assertTrue(transcript.replaceLast(first, longer))
+        assertFalse(transcript.replaceLast(first, message(2)), "Only the newest message can be replaced")
+        val row = transcript.viewport(800, 160).single()
+        assertEquals(longer, row.message)
+        assertEquals(2, row.layout.lineCount)
+        assertEquals(2L, transcript.layoutCount)
+
+        transcript.append(message(2))
+        transcript.append(message(3))
+        assertEquals(longer, transcript.append(message(4)), "The oldest message makes room")
+        assertEquals(3, transcript.size)
+    }
+}
@@ -0,0 +1,49 @@
+package com.linkpoint.ui.minimap
+
+import com.linkpoint.core.events.Quaternion
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.protocol.data.ObjectMaterial
+import com.linkpoint.protocol.data.ObjectType
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.world.ObjectStore
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNotEquals
+
+/**
+ * Tests for budgeted minimap tile rasterising
+ */
+class MinimapTilesTest {
+
+    private fun prim(n: Long, x: Float, y: Float) = VirtualObject(
+        UUID(7, n), "Prim $n", Vector3(x, y, 22f), Quaternion(0f, 0f, 0f, 1f), Vector3(1f, 1f, 1f),
+        description = "", creatorId = UUID(0, 0), ownerId = UUID(0, 0),
+        objectType = ObjectType.PRIMITIVE, material = ObjectMaterial.WOOD, textureIds = emptyList()
+    )
+
+    @Test
+    fun `should rasterise within the nanosecond budget, missing tiles before stale ones`() {
+        val store = ObjectStore()
+        // Each reading of the clock moves it on a microsecond
+        var now = 0L
+        val minimap = MinimapTiles(store, tilePixels = 8, nanoTime = { now.also { now += 1_000 } })
+        val edge = minimap.cellSize * 2 - 1 // a 2 x 2 block of cells
+
+        assertEquals(1, minimap.refresh(0f, 0f, edge, edge, budgetNanos = 2_500), "Three tiles fit in 2.5 us")
+        assertEquals(3, minimap.tiles(0f, 0f, edge, edge).size)
+        assertEquals(3, minimap.rasterised)
+
+        store.put(prim(1, 1f, 1f))
+        assertEquals(1, minimap.refresh(0f, 0f, edge, edge, budgetNanos = 0), "One tile is drawn even without budget")
+        val tiles = minimap.tiles(0f, 0f, edge, edge)
+        assertEquals(4, tiles.size, "The missing tile is drawn before the stale one")
+        val stale = tiles.single { it.cellX == 0 && it.cellY == 0 }
+        assertNotEquals(store.grid.staticVersion(0, 0), stale.version, "The prim's cell still shows its old picture")
+
+        assertEquals(0, minimap.refresh(0f, 0f, edge, edge, budgetNanos = 0))
+        assertEquals(store.grid.staticVersion(0, 0), minimap.tiles(0f, 0f, 1f, 1f).single().version)
+        assertEquals(0, minimap.refresh(0f, 0f, edge, edge, budgetNanos = 0), "Nothing is redrawn while current")
+        assertEquals(5, minimap.rasterised)
+    }
+}
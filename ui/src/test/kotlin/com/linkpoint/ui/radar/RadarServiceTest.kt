@@ -0,0 +1,144 @@
+package com.linkpoint.ui.radar
+
+import com.linkpoint.core.events.Vector3
+import kotlinx.coroutines.test.runTest
+import java.util.UUID
+import kotlin.random.Random
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertNull
+import kotlin.test.assertTrue
+
+/**
+ * Tests for incremental radar ordering, diffs and batched name resolution
+ */
+class RadarServiceTest {
+
+    private val requested = ArrayList<Set<UUID>>()
+    private val lookup = NameLookup { ids -> requested += ids; ids.associateWith { "Resident ${it.toString().take(4)}" } }
+
+    @Test
+    fun `should keep 100 avatars over 9 regions sorted with diffs matching the list`() = runTest {
+        val radar = RadarService(lookup, maxLookupBatch = 100)
+        val random = Random(7)
+        // Neighbour offsets relative to the agent's region, handle = index
+        val regions = (0 until 9).map { Pair((it % 3 - 1) * 256f, (it / 3 - 1) * 256f) }
+        val positions = HashMap<UUID, Vector3>()
+        val regionOf = HashMap<UUID, Long>()
+        repeat(100) {
+            val id = UUID.randomUUID()
+            val region = random.nextInt(9)
+            positions[id] = Vector3(regions[region].first + random.nextFloat() * 256, regions[region].second + random.nextFloat() * 256, 25f)
+            regionOf[id] = region.toLong()
+        }
+        // Bucket and whole metres of each listed avatar, as the diffs tell them
+        val shown = HashMap<UUID, Pair<RadarBucket, Int>>()
+        var self = Vector3(128f, 128f, 25f)
+
+        repeat(40) { tick ->
+            self = Vector3(self.x + random.nextFloat() * 4 - 2, self.y + random.nextFloat() * 4 - 2, 25f)
+            radar.setSelf(self)
+            for ((id, position) in positions) {
+                if (random.nextInt(10) < 3) {
+                    positions[id] = Vector3(position.x + random.nextFloat() * 6 - 3, position.y + random.nextFloat() * 6 - 3, 25f)
+                }
+                radar.update(id, positions.getValue(id), regionOf.getValue(id))
+            }
+            // A few leave for a tick now and then
+            val leaving = positions.keys.filter { tick % 5 == 4 && random.nextInt(20) == 0 }
+            leaving.forEach { radar.remove(it) }
+
+            radar.tick()?.let { diff ->
+                diff.left.forEach { shown.remove(it) }
+                (diff.entered + diff.movedBucket + diff.renamed + diff.remeasured).forEach { shown[it.id] = Pair(it.bucket, it.distance.toInt()) }
+            }
+            radar.resolveNames()
+
+            val snapshot = radar.snapshot()
+            assertEquals(positions.size - leaving.size, snapshot.size)
+            assertEquals(snapshot.associate { it.id to Pair(it.bucket, it.distance.toInt()) }, shown, "Diffs replay to the list on tick $tick")
+            val expected = snapshot.map { it.id }.sortedBy { id ->
+                val p = positions.getValue(id)
+                (p.x - self.x) * (p.x - self.x) + (p.y - self.y) * (p.y - self.y)
+            }
+            assertEquals(expected, snapshot.map { it.id }, "Nearest first on tick $tick")
+        }
+
+        assertTrue(radar.snapshot().all { it.name != null })
+        assertEquals(100, requested.flatten().toSet().size)
+        assertEquals(requested.flatten().size, requested.flatten().toSet().size, "Each name was looked up once")
+        assertTrue(requested.size < 40, "Names were batched, not looked up per tick")
+    }
+
+    @Test
+    fun `should refresh expired names without blanking them`() = runTest {
+        var now = 0L
+        val radar = RadarService(lookup, nameTtlMs = 1000, clock = { now })
+        val id = UUID.randomUUID()
+        radar.update(id, Vector3(5f, 0f, 0f))
+
+        val entered = radar.tick()!!.entered.single()
+        assertNull(entered.name)
+        assertEquals(RadarBucket.WHISPER, entered.bucket)
+        radar.resolveNames()
+        val named = radar.tick()!!.renamed.single().name
+        assertNull(radar.tick(), "Nothing changed")
+
+        now += 1500
+        assertNull(radar.tick(), "Expired name still shown")
+        assertEquals(named, radar.snapshot().single().name)
+        radar.resolveNames()
+        assertEquals(2, requested.size)
+
+        radar.update(id, Vector3(50f, 0f, 0f))
+        assertEquals(RadarBucket.SHOUT, radar.tick()!!.movedBucket.single().bucket)
+        radar.remove(id)
+        assertEquals(listOf(id), radar.tick()!!.left)
+    }
+
+    @Test
+    fun `should flag distance changes within a bucket and never list the agent`() = runTest {
+        val radar = RadarService(lookup)
+        val self = UUID.randomUUID()
+        val other = UUID.randomUUID()
+        radar.update(self, Vector3(0f, 0f, 0f))
+        radar.update(other, Vector3(5f, 0f, 0f))
+        radar.tick()
+
+        radar.selfId = self
+        radar.update(other, Vector3(7f, 0f, 0f))
+        val diff = radar.tick()!!
+        assertEquals(listOf(self), diff.left)
+        assertTrue(diff.movedBucket.isEmpty(), "Still within whisper range")
+        assertTrue(diff.distancesChanged)
+        assertEquals(listOf(other), diff.remeasured.map { it.id })
+        assertEquals(listOf(7f), radar.snapshot().map { it.distance })
+
+        radar.update(self, Vector3(1f, 0f, 0f))
+        radar.update(other, Vector3(7.2f, 0f, 0f))
+        assertNull(radar.tick(), "Less than a metre, and the agent is ignored")
+    }
+
+    @Test
+    fun `should track coarse locations until the store places the avatar`() = runTest {
+        val radar = RadarService(lookup)
+        val near = UUID.randomUUID()
+        val far = UUID.randomUUID()
+        val neighbour = 42L
+        radar.updateCoarse(RadarService.CURRENT_REGION, mapOf(near to Vector3(10f, 0f, 0f), far to Vector3(200f, 0f, 0f)))
+        radar.updateCoarse(neighbour, mapOf(UUID(1, 1) to Vector3(300f, 0f, 0f)))
+        assertEquals(3, radar.tick()!!.entered.size)
+
+        radar.update(near, Vector3(10.5f, 0f, 0f))
+        radar.updateCoarse(RadarService.CURRENT_REGION, mapOf(near to Vector3(12f, 0f, 0f)))
+        val diff = radar.tick()!!
+        assertEquals(listOf(far), diff.left, "Gone from the region's coarse locations")
+        assertEquals(listOf(10.5f, 300f), radar.snapshot().map { it.distance }, "The store's position wins")
+
+        radar.removeRegion(neighbour)
+        radar.remove(near)
+        radar.updateCoarse(RadarService.CURRENT_REGION, mapOf(near to Vector3(12f, 0f, 0f)))
+        radar.tick()
+        assertEquals(listOf(12f), radar.snapshot().map { it.distance }, "Coarse again once the store lost it")
+    }
+}
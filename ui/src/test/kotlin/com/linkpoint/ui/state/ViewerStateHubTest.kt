@@ -0,0 +1,64 @@
+package com.linkpoint.ui.state
+
+import com.linkpoint.ui.ChatMessage
+import com.linkpoint.ui.chat.ChatIngestPipeline
+import com.linkpoint.ui.state.ViewerStateHub.Slice
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.test.advanceTimeBy
+import kotlinx.coroutines.test.runCurrent
+import kotlinx.coroutines.test.runTest
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertTrue
+
+/**
+ * Tests for per-slice publishing of UI state
+ */
+class ViewerStateHubTest {
+
+    private fun chat(sender: String, text: String) = ChatMessage(text = text, channel = "Local", timestamp = 0, sender = sender)
+
+    @Test
+    fun `chat flood should publish one chat value per interval and leave other slices alone`() = runTest {
+        val hub = ViewerStateHub(publishIntervalMs = 100)
+        val publisher = hub.start(this)
+        val pipeline = ChatIngestPipeline(perSourceBurst = 1000.0, perSourcePerSecond = 1000.0)
+        val avatars = List(20) { NearbyAvatar(UUID(0, it.toLong()), "Avatar $it", distance = it * 5) }
+
+        // Five seconds of 60 Hz frames, 16 messages each, while stats and radar keep reporting the same values
+        repeat(300) { frame ->
+            val messages = List(16) { i -> (frame * 16 + i).let { chat("Sender ${it % 50}", "message $it") } }
+            pipeline.process(messages)?.let { hub.appendChat(it) }
+            hub.setStats(ViewerStats(fps = 60, objects = 1200))
+            if (frame % 30 == 0) hub.setNearbyAvatars(avatars)
+            delay(16)
+        }
+        advanceTimeBy(200)
+        runCurrent()
+        publisher.cancel()
+
+        val emissions = hub.emissions
+        assertTrue(emissions.getValue(Slice.CHAT) in 40..55, "One chat value per interval, not per message")
+        assertEquals(1, emissions.getValue(Slice.STATS), "Unchanged stats are not re-emitted")
+        assertEquals(1, emissions.getValue(Slice.NEARBY_AVATARS))
+        assertEquals(0, emissions.getValue(Slice.CONNECTION))
+
+        val log = hub.chat.value.log
+        assertEquals(500, log.size)
+        assertEquals("message 4799", log.last().text)
+        assertEquals(4799L, log.sequence(log.size - 1), "Sequence numbers stay stable as old lines drop")
+    }
+
+    @Test
+    fun `a continued repeat should replace its line instead of appending`() {
+        val hub = ViewerStateHub()
+        val pipeline = ChatIngestPipeline()
+        hub.appendChat(pipeline.process(List(2) { chat("Door", "Carol has entered") })!!)
+        hub.appendChat(pipeline.process(listOf(chat("Door", "Carol has entered")))!!)
+        hub.publish()
+
+        assertEquals(listOf("Carol has entered ×3"), hub.chat.value.log.map { it.text })
+        assertEquals(1, hub.emissions.getValue(Slice.CHAT))
+    }
+}
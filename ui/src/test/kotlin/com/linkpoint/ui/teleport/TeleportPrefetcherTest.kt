@@ -0,0 +1,159 @@
+package com.linkpoint.ui.teleport
+
+import com.linkpoint.assets.TextureFetchScheduler
+import com.linkpoint.assets.prefetch.RegionManifestStore
+import com.linkpoint.core.events.Quaternion
+import com.linkpoint.core.events.Vector3
+import com.linkpoint.graphics.rendering.TextureCoverage
+import com.linkpoint.protocol.RLVProcessor
+import com.linkpoint.protocol.data.ObjectMaterial
+import com.linkpoint.protocol.data.ObjectType
+import com.linkpoint.protocol.data.VirtualObject
+import com.linkpoint.protocol.world.ObjectStore
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.test.StandardTestDispatcher
+import kotlinx.coroutines.test.TestScope
+import kotlinx.coroutines.test.advanceUntilIdle
+import kotlinx.coroutines.test.runTest
+import java.nio.file.Files
+import java.util.Collections
+import java.util.UUID
+import kotlin.test.Test
+import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertTrue
+
+/**
+ * Tests for prefetching a teleport destination from its region manifest
+ */
+class TeleportPrefetcherTest {
+
+    private val home = RegionManifestStore.regionHandle(1000, 1000)
+    private val away = RegionManifestStore.regionHandle(1003, 998)
+
+    // 20 prims with two textures each, a few large walls and many small details
+    private val prims = List(20) { n ->
+        VirtualObject(
+            UUID(7, n.toLong()), "Prim $n", Vector3(128f + n, 128f, 22f), Quaternion(0f, 0f, 0f, 1f), Vector3(1f, 1f, 1f),
+            description = "", creatorId = UUID(0, 0), ownerId = UUID(0, 0),
+            objectType = ObjectType.PRIMITIVE, material = ObjectMaterial.WOOD,
+            textureIds = listOf(UUID(9, 2L * n), UUID(9, 2L * n + 1)),
+            meshId = if (n % 5 == 0) UUID(10, n.toLong()) else null
+        )
+    }
+
+    @Test
+    fun `should render a revisited region at least three times sooner after prefetching`() = runTest {
+        val directory = Files.createTempDirectory("regions").toFile()
+        val cache: MutableSet<UUID> = Collections.synchronizedSet(HashSet())
+        val objects = ObjectStore().apply { prims.forEach { put(it) } }
+        var fetch = scheduler(cache)
+        val prefetcher = TeleportPrefetcher(
+            RegionManifestStore(directory),
+            AssetWarmer { id, _ ->
+                delay(WARM_MS)
+                cache.add(id)
+            },
+            objects,
+            backgroundScope,
+            textureFetch = { fetch },
+            ioDispatcher = StandardTestDispatcher(testScheduler),
+            clock = { testScheduler.currentTime }
+        )
+
+        // First visit: nothing cached
+        prefetcher.currentRegion = home
+        prefetcher.onArrived()
+        render(prefetcher, fetch)
+
+        // Leave, and lose the textures to cache eviction while away
+        assertTrue(prefetcher.onTeleportIntent(away, TeleportSource.MAP))
+        delay(TELEPORT_MS)
+        fetch = scheduler(cache)
+        prefetcher.onArrived()
+        cache.clear()
+
+        // Come back: the manifest written on arrival away is warmed during the teleport
+        assertTrue(prefetcher.onTeleportIntent(home, TeleportSource.MAP))
+        delay(TELEPORT_MS)
+        fetch = scheduler(cache)
+        prefetcher.onArrived()
+        render(prefetcher, fetch)
+
+        val (cold, warm) = prefetcher.arrivals
+        assertEquals(home, warm.regionHandle)
+        assertFalse(cold.warm)
+        assertTrue(warm.warm)
+        assertEquals(44, prefetcher.warmed, "40 textures and 4 meshes")
+        assertTrue(warm.renderedMs * 3 < cold.renderedMs, "Rendered ${warm.renderedMs} ms after a prefetched arrival, ${cold.renderedMs} ms cold")
+        directory.deleteRecursively()
+    }
+
+    @Test
+    fun `should not prefetch teleports RLV forbids`() = runTest {
+        val directory = Files.createTempDirectory("regions").toFile()
+        val warmed = ArrayList<UUID>()
+        val prefetcher = TeleportPrefetcher(
+            RegionManifestStore(directory),
+            AssetWarmer { id, _ -> warmed.add(id) },
+            ObjectStore().apply { prims.forEach { put(it) } },
+            backgroundScope,
+            ioDispatcher = StandardTestDispatcher(testScheduler)
+        )
+        prefetcher.currentRegion = home
+        prefetcher.recordVisit()?.join()
+        val rlv = RLVProcessor()
+        rlv.processRLVCommand("@tploc=n", "collar", "Collar")
+        val restricted = TeleportPrefetcher(
+            RegionManifestStore(directory),
+            AssetWarmer { id, _ -> warmed.add(id) },
+            ObjectStore(),
+            backgroundScope,
+            rlv = rlv,
+            ioDispatcher = StandardTestDispatcher(testScheduler)
+        )
+
+        assertFalse(restricted.onTeleportIntent(home, TeleportSource.MAP))
+        advanceUntilIdle()
+        assertTrue(warmed.isEmpty())
+
+        assertTrue(restricted.onTeleportIntent(home, TeleportSource.RLV))
+        advanceUntilIdle()
+        assertEquals(44, warmed.size)
+        directory.deleteRecursively()
+    }
+
+    // Slow from the network, fast from the local cache
+    private fun TestScope.scheduler(cache: Set<UUID>) = TextureFetchScheduler({ id, discard ->
+        delay(if (id in cache) CACHED_MS else DOWNLOAD_MS)
+        discard
+    }, clock = { testScheduler.currentTime }).also { it.start(backgroundScope) }
+
+    // Frames of the prims in view until the prefetcher has timed the arrival
+    private suspend fun render(prefetcher: TeleportPrefetcher, fetch: TextureFetchScheduler) {
+        val coverage = TextureCoverage()
+        val arrivals = prefetcher.arrivals.size
+        var frames = 0
+        while (prefetcher.arrivals.size == arrivals && frames < MAX_FRAMES) {
+            coverage.beginFrame(1080, 1920, 60f)
+            prims.forEachIndexed { n, prim ->
+                prim.textureIds.forEach { coverage.addFace(it, area = if (n < 4) 16f else 1f, distance = 4f + n) }
+            }
+            coverage.forEach(fetch::updateDemand)
+            fetch.endFrame()
+            prefetcher.observe(coverage)
+            delay(FRAME_MS)
+            frames++
+        }
+    }
+
+    companion object {
+        private const val FRAME_MS = 16L
+        private const val MAX_FRAMES = 2000
+        private const val DOWNLOAD_MS = 200L
+        private const val CACHED_MS = 5L
+        private const val WARM_MS = 100L
+        // Confirmation, TeleportRequest and region handshake
+        private const val TELEPORT_MS = 3000L
+    }
+}